@@ -15,4 +15,15 @@ inline std::string get_client_secret() {
     return secret ? secret : "RHrbLV5gN29aTc-qXdI67ojOL2-tIbP0hKmAe5FupOo";  // Fallback value
 }
 
+// Endpoint overrides, e.g. DERIBIT_HOST=127.0.0.1 to run against mock_exchange_server
+inline std::string get_api_host() {
+    const char* host = std::getenv("DERIBIT_HOST");
+    return host ? host : "test.deribit.com";
+}
+
+inline std::string get_api_port() {
+    const char* port = std::getenv("DERIBIT_PORT");
+    return port ? port : "443";
+}
+
 #endif // API_CREDENTIALS_H
\ No newline at end of file
@@ -0,0 +1,13 @@
+#include "awaitable_orders.h"
+#include "ws_connector.h"
+
+std::error_code replyError(int error_code) {
+    if (error_code == 0) {
+        return std::error_code();
+    }
+    return make_error_code(error_code == -1 ? OrderErrc::NoReply : OrderErrc::Rejected);
+}
+
+AwaitableOrders::AwaitableOrders(OrderManager& order_mgr)
+    : order_mgr_(order_mgr), executor_(order_mgr.connections().connection(
+          order_mgr.connections().route(ConnectionRole::OrderEntry)).executor()) {}
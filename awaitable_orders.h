@@ -0,0 +1,289 @@
+#ifndef AWAITABLE_ORDERS_H
+#define AWAITABLE_ORDERS_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <boost/asio.hpp>
+#include "order_manager.h"
+
+// 0 is success; -1 marks the errors OrderManager synthesizes for requests that lost their connection
+std::error_code replyError(int error_code);
+
+// Completion values: one argument, so use_awaitable hands it back instead of throwing
+struct AckResult {
+    std::error_code error;
+    OrderAck ack;
+};
+
+struct BookResult {
+    std::error_code error;
+    BookSnapshot book;
+};
+
+struct PositionsResult {
+    std::error_code error;
+    RpcStatus status;
+    std::vector<PositionSnapshot> positions;
+};
+
+struct CancelResult {
+    std::error_code error;
+    RpcStatus status;
+    int64_t cancelled = 0;
+};
+
+struct BatchOutcome {
+    std::error_code error;  // Rejected when any leg failed; the acks say which
+    BatchResult batch;
+};
+
+// Boost.Asio initiating functions over OrderManager's typed async API, one per order operation,
+// for any completion token: boost::asio::use_awaitable in C++20 coroutines, a callback, or
+// boost::asio::use_future. Inside a coroutine a workflow reads as straight-line code and only
+// suspends its own frame while the request is in flight:
+//
+//     AckResult cancelled = co_await orders.removeOrder(order_id, boost::asio::use_awaitable);
+//     if (!cancelled.error) {
+//         AckResult placed = co_await orders.submitOrder(request, boost::asio::use_awaitable);
+//     }
+//
+// Spawned on get_executor(), the first order-entry connection's io_context, any number of
+// workflows share its reader thread without blocking it. Replies resume the caller on the
+// token's executor: inline when they arrive on that thread, posted otherwise, and never from
+// inside the initiating call. Order entry (submits, cancels, edits and their batches) goes through
+// OrderManager's try* calls, so refusals and local failures complete with an OrderErrc and nothing
+// is thrown. A mass-cancel filter that cannot be encoded completes with InvalidRequest too. Mass
+// cancels and the book and positions requests still throw from the initiating call when they cannot
+// be queued, as the callback API does. Blocking calls must not be made from a coroutine on an io thread.
+// Operations still in flight at stop() complete with NoReply onto a stopped io_context, so
+// workflows should finish first. Strings and vectors are copied into the operation, so a deferred
+// token may start it after they are gone; the text behind views must last until it starts.
+class AwaitableOrders {
+public:
+    using executor_type = boost::asio::io_context::executor_type;
+
+    explicit AwaitableOrders(OrderManager& order_mgr);
+
+    executor_type get_executor() const { return executor_; }
+    OrderManager& manager() { return order_mgr_; }
+
+    template <typename Token>
+    auto submitOrder(const OrderRequest& request, Token&& token) {
+        return initiate<AckResult>(std::forward<Token>(token), [this, request](auto completion) {
+            failIfUnsent(*completion, order_mgr_.trySubmitOrderAsync(request, ackHandler(completion)));
+        });
+    }
+
+    // Post-only limits, like OrderManager's shorthands
+    template <typename Token>
+    auto submitBuyOrder(std::string_view asset, double qty, double rate, Token&& token) {
+        return submitOrder(postOnly(asset, Side::Buy, qty, rate), std::forward<Token>(token));
+    }
+
+    template <typename Token>
+    auto submitSellOrder(std::string_view asset, double qty, double rate, Token&& token) {
+        return submitOrder(postOnly(asset, Side::Sell, qty, rate), std::forward<Token>(token));
+    }
+
+    template <typename Token>
+    auto removeOrder(std::string_view order_ref, Token&& token) {
+        return initiate<AckResult>(std::forward<Token>(token), [this, order_ref](auto completion) {
+            failIfUnsent(*completion, order_mgr_.tryRemoveOrderAsync(order_ref, ackHandler(completion)));
+        });
+    }
+
+    template <typename Token>
+    auto updateOrder(std::string_view order_ref, double new_rate, double new_qty, Token&& token) {
+        return initiate<AckResult>(std::forward<Token>(token), [this, order_ref, new_rate, new_qty](auto completion) {
+            RequestStatus status = order_mgr_.tryUpdateOrderAsync(order_ref, new_rate, new_qty, ackHandler(completion));
+            failIfUnsent(*completion, status);
+        });
+    }
+
+    template <typename Token>
+    auto retrieveOrderBook(const std::string& asset, Token&& token) {
+        return initiate<BookResult>(std::forward<Token>(token), [this, asset](auto completion) {
+            order_mgr_.retrieveOrderBookAsync(asset, [completion](const BookSnapshot& book) {
+                completion->complete(BookResult{replyError(book.error_code), book});
+            });
+        });
+    }
+
+    template <typename Token>
+    auto fetchPositions(std::string_view currency, Token&& token) {
+        return initiate<PositionsResult>(std::forward<Token>(token), [this, currency](auto completion) {
+            order_mgr_.fetchPositionsAsync(currency, [completion](const RpcStatus& status,
+                                                                  const std::vector<PositionSnapshot>& positions) {
+                completion->complete(PositionsResult{replyError(status.error_code), status, positions});
+            });
+        });
+    }
+
+    template <typename Token>
+    auto cancelAll(Token&& token) {
+        return initiate<CancelResult>(std::forward<Token>(token), [this](auto completion) {
+            order_mgr_.cancelAllAsync(cancelHandler(completion));
+        });
+    }
+
+    template <typename Token>
+    auto cancelAllByInstrument(std::string_view asset, Token&& token) {
+        return initiate<CancelResult>(std::forward<Token>(token), [this, asset](auto completion) {
+            if (!refuseText(*completion, asset)) {
+                order_mgr_.cancelAllByInstrumentAsync(asset, cancelHandler(completion));
+            }
+        });
+    }
+
+    template <typename Token>
+    auto cancelAllByCurrency(std::string_view currency, Token&& token) {
+        return initiate<CancelResult>(std::forward<Token>(token), [this, currency](auto completion) {
+            if (!refuseText(*completion, currency)) {
+                order_mgr_.cancelAllByCurrencyAsync(currency, cancelHandler(completion));
+            }
+        });
+    }
+
+    template <typename Token>
+    auto cancelByLabel(std::string_view label, Token&& token) {
+        return initiate<CancelResult>(std::forward<Token>(token), [this, label](auto completion) {
+            if (!refuseText(*completion, label)) {
+                order_mgr_.cancelByLabelAsync(label, cancelHandler(completion));
+            }
+        });
+    }
+
+    // Batches need start(); all legs pass the risk gate or none is sent
+    template <typename Token>
+    auto submitOrders(const std::vector<OrderRequest>& orders, Token&& token) {
+        return initiate<BatchOutcome>(std::forward<Token>(token), [this, orders](auto completion) {
+            failIfUnsent(*completion, order_mgr_.trySubmitOrdersAsync(orders, batchHandler(completion)));
+        });
+    }
+
+    template <typename Token>
+    auto updateOrders(const std::vector<BatchEdit>& edits, Token&& token) {
+        return initiate<BatchOutcome>(std::forward<Token>(token), [this, edits](auto completion) {
+            failIfUnsent(*completion, order_mgr_.tryUpdateOrdersAsync(edits, batchHandler(completion)));
+        });
+    }
+
+private:
+    // Owns the caller's completion handler until the reply comes in, on whichever io thread
+    template <typename Value, typename Handler>
+    class Completion {
+    public:
+        using Result = Value;
+
+        Completion(Handler handler, executor_type fallback)
+            : handler_(std::move(handler)), executor_(boost::asio::get_associated_executor(handler_, fallback)) {}
+
+        // Called once. Until the initiating call returns the handler is posted, as Asio requires.
+        void complete(Result result) {
+            auto resume = [handler = std::move(handler_), result = std::move(result)]() mutable {
+                handler(std::move(result));
+            };
+            if (initiating_.load(std::memory_order_acquire)) {
+                boost::asio::post(executor_, std::move(resume));
+            } else {
+                boost::asio::dispatch(executor_, std::move(resume));
+            }
+        }
+
+        void started() { initiating_.store(false, std::memory_order_release); }
+
+    private:
+        Handler handler_;
+        boost::asio::associated_executor_t<Handler, executor_type> executor_;
+        std::atomic<bool> initiating_{true};
+    };
+
+    template <typename Result, typename Token, typename Start>
+    auto initiate(Token&& token, Start start) {
+        return boost::asio::async_initiate<Token, void(Result)>(
+            [executor = executor_, start = std::move(start)](auto handler) {
+                using Handler = std::decay_t<decltype(handler)>;
+                auto completion = std::make_shared<Completion<Result, Handler>>(std::move(handler), executor);
+                start(completion);
+                completion->started();
+            },
+            token);
+    }
+
+    template <typename Pending>
+    static OrderManager::AckHandler ackHandler(const std::shared_ptr<Pending>& completion) {
+        return [completion](const OrderAck& ack) { completion->complete(AckResult{replyError(ack.error_code), ack}); };
+    }
+
+    template <typename Pending>
+    static OrderManager::CancelAllHandler cancelHandler(const std::shared_ptr<Pending>& completion) {
+        return [completion](const RpcStatus& status, int64_t cancelled) {
+            completion->complete(CancelResult{replyError(status.error_code), status, cancelled});
+        };
+    }
+
+    template <typename Pending>
+    static OrderManager::BatchHandler batchHandler(const std::shared_ptr<Pending>& completion) {
+        return [completion](BatchResult& batch) {
+            std::error_code error = batch.failed > 0 ? make_error_code(OrderErrc::Rejected) : std::error_code();
+            completion->complete(BatchOutcome{error, std::move(batch)});
+        };
+    }
+
+    // A request that was not sent never registered its handler, so the operation completes here with
+    // the code, and the reason where the result has room for one
+    template <typename Pending>
+    static void failIfUnsent(Pending& completion, const RequestStatus& status) {
+        if (!status.ok()) {
+            completion.complete(failure<typename Pending::Result>(status.error, status.reason));
+        }
+    }
+
+    // Mass cancels have no try* call: a filter the encoder would refuse completes here instead of throwing
+    template <typename Pending>
+    static bool refuseText(Pending& completion, std::string_view text) {
+        const char* invalid = OrderEncoder::invalidText(text);
+        if (invalid) {
+            completion.complete(failure<typename Pending::Result>(make_error_code(OrderErrc::InvalidRequest), invalid));
+        }
+        return invalid != nullptr;
+    }
+
+    template <typename Result>
+    static Result failure(std::error_code error, std::string_view reason) {
+        Result result;
+        result.error = error;
+        if constexpr (std::is_same_v<Result, AckResult>) {
+            describe(result.ack, reason);
+        } else if constexpr (std::is_same_v<Result, BookResult>) {
+            describe(result.book, reason);
+        } else if constexpr (!std::is_same_v<Result, BatchOutcome>) {
+            describe(result.status, reason);
+        }
+        return result;
+    }
+
+    template <typename Reply>
+    static void describe(Reply& reply, std::string_view reason) {
+        reply.error_code = -1;
+        reply.error_message.assign(reason.data(), reason.size());
+    }
+
+    static OrderRequest postOnly(std::string_view asset, Side side, double qty, double rate) {
+        OrderRequest request = OrderRequest::limit(asset, side, qty, rate);
+        request.post_only = true;
+        return request;
+    }
+
+    OrderManager& order_mgr_;
+    executor_type executor_;
+};
+
+#endif // AWAITABLE_ORDERS_H
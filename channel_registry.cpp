@@ -0,0 +1,116 @@
+#include "channel_registry.h"
+
+namespace {
+
+size_t roundUpToPowerOfTwo(size_t value) {
+    size_t result = 8;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+}  // namespace
+
+ChannelRegistry::ChannelRegistry(size_t initial_capacity)
+    : slots_(roundUpToPowerOfTwo(initial_capacity)),
+      mask_(slots_.size() - 1) {}
+
+uint64_t ChannelRegistry::hash(std::string_view channel) {
+    // FNV-1a: cheap enough to run once per notification
+    uint64_t value = 14695981039346656037ull;
+    for (unsigned char c : channel) {
+        value ^= c;
+        value *= 1099511628211ull;
+    }
+    return value;
+}
+
+size_t ChannelRegistry::probe(uint64_t hash, std::string_view channel) const {
+    size_t index = hash & mask_;
+    while (slots_[index].used) {
+        if (slots_[index].hash == hash && slots_[index].name == channel) {
+            return index;
+        }
+        index = (index + 1) & mask_;
+    }
+    return index;  // First free slot
+}
+
+void ChannelRegistry::add(std::string_view channel, FeedHandler handler) {
+    if ((count_ + 1) * 2 > slots_.size()) {
+        grow();  // Keep load factor under 1/2 so probes stay short
+    }
+
+    uint64_t h = hash(channel);
+    Slot& slot = slots_[probe(h, channel)];
+    if (!slot.used) {
+        slot.used = true;
+        slot.hash = h;
+        slot.name.assign(channel);
+        ++count_;
+    }
+    slot.handler = std::move(handler);
+}
+
+bool ChannelRegistry::remove(std::string_view channel) {
+    size_t index = probe(hash(channel), channel);
+    if (!slots_[index].used) {
+        return false;
+    }
+
+    slots_[index] = Slot{};
+    --count_;
+
+    // Backward-shift the rest of the cluster so lookups never need tombstones
+    size_t next = (index + 1) & mask_;
+    while (slots_[next].used) {
+        size_t home = slots_[next].hash & mask_;
+        if (((next - home) & mask_) >= ((next - index) & mask_)) {
+            slots_[index] = std::move(slots_[next]);
+            slots_[next] = Slot{};
+            index = next;
+        }
+        next = (next + 1) & mask_;
+    }
+    return true;
+}
+
+const ChannelRegistry::FeedHandler* ChannelRegistry::find(std::string_view channel) const {
+    const Slot& slot = slots_[probe(hash(channel), channel)];
+    return slot.used ? &slot.handler : nullptr;
+}
+
+std::vector<std::string> ChannelRegistry::channels() const {
+    std::vector<std::string> names;
+    names.reserve(count_);
+    for (const Slot& slot : slots_) {
+        if (slot.used) {
+            names.push_back(slot.name);
+        }
+    }
+    return names;
+}
+
+void ChannelRegistry::clear() {
+    for (Slot& slot : slots_) {
+        slot = Slot{};
+    }
+    count_ = 0;
+}
+
+void ChannelRegistry::grow() {
+    std::vector<Slot> old_slots(slots_.size() * 2);
+    old_slots.swap(slots_);
+    mask_ = slots_.size() - 1;
+
+    for (Slot& slot : old_slots) {
+        if (slot.used) {
+            size_t index = slot.hash & mask_;
+            while (slots_[index].used) {
+                index = (index + 1) & mask_;
+            }
+            slots_[index] = std::move(slot);
+        }
+    }
+}
@@ -0,0 +1,46 @@
+#ifndef CHANNEL_REGISTRY_H
+#define CHANNEL_REGISTRY_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "response_parser.h"
+
+// Open-addressing table from subscription channel name to handler.
+// Names are hashed once at registration; a lookup costs one hash of the
+// incoming channel plus a short probe, independent of how many channels exist.
+class ChannelRegistry {
+public:
+    using FeedHandler = std::function<void(const FeedMessage&)>;
+
+    explicit ChannelRegistry(size_t initial_capacity = 256);
+
+    void add(std::string_view channel, FeedHandler handler);
+    bool remove(std::string_view channel);
+    const FeedHandler* find(std::string_view channel) const;
+
+    size_t size() const { return count_; }
+    std::vector<std::string> channels() const;
+    void clear();
+
+    static uint64_t hash(std::string_view channel);
+
+private:
+    struct Slot {
+        uint64_t hash = 0;
+        std::string name;
+        FeedHandler handler;
+        bool used = false;
+    };
+
+    void grow();
+    size_t probe(uint64_t hash, std::string_view channel) const;
+
+    std::vector<Slot> slots_;
+    size_t mask_;
+    size_t count_ = 0;
+};
+
+#endif // CHANNEL_REGISTRY_H
@@ -0,0 +1,50 @@
+#include "connection_pool.h"
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include "ws_connector.h"
+
+ConnectionPool::ConnectionPool(const std::string& server, const std::string& port_num, const std::string& path,
+                               PoolConfig config) {
+    if (config.order_entry == 0) {
+        throw std::invalid_argument("Connection pool needs an order-entry connection");
+    }
+
+    size_t total = config.order_entry + config.market_data;
+    for (size_t i = 0; i < total; ++i) {
+        owned_.push_back(std::make_unique<WsConnector>(server, port_num, path, config.receive_limit));
+        connections_.push_back(owned_.back().get());
+        (i < config.order_entry ? order_entry_ : market_data_).push_back(i);
+    }
+    if (market_data_.empty()) {
+        market_data_ = order_entry_;
+    }
+}
+
+ConnectionPool::ConnectionPool(WsConnector& ws_conn)
+    : connections_{&ws_conn}, order_entry_{0}, market_data_{0} {}
+
+ConnectionPool::~ConnectionPool() = default;
+
+bool ConnectionPool::serves(size_t index, ConnectionRole role) const {
+    const std::vector<size_t>& indices = members(role);
+    return std::find(indices.begin(), indices.end(), index) != indices.end();
+}
+
+size_t ConnectionPool::route(ConnectionRole role, std::string_view instrument) const {
+    const std::vector<size_t>& indices = members(role);
+    if (indices.size() == 1 || instrument.empty()) {
+        return indices.front();
+    }
+    return indices[std::hash<std::string_view>{}(instrument) % indices.size()];
+}
+
+void ConnectionPool::disconnect() {
+    for (WsConnector* connection : connections_) {
+        connection->disconnect();
+    }
+}
+
+void ConnectionPool::captureTo(FrameJournalWriter* journal) {
+    connection(market_data_.front()).captureTo(journal);
+}
@@ -0,0 +1,63 @@
+#ifndef CONNECTION_POOL_H
+#define CONNECTION_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class FrameJournalWriter;
+class WsConnector;
+
+enum class ConnectionRole : uint8_t {
+    OrderEntry,  // Authentication, orders, private requests and user.* subscriptions
+    MarketData,  // Public subscriptions, book snapshots and reference data
+};
+
+struct PoolConfig {
+    size_t order_entry = 1;  // At least one
+    size_t market_data = 1;  // 0 keeps market data on the order-entry connections
+    size_t receive_limit = 1 << 20;  // Per connection, see WsConnector
+};
+
+// The WebSocket connections one OrderManager spreads its traffic over. Each connection
+// has its own io_context and reader thread, so a burst of book deltas or a large
+// snapshot on a market-data connection never queues in front of an order ack.
+// Within a role an instrument always maps to the same connection, which keeps the
+// requests and notifications of one instrument in order.
+class ConnectionPool {
+public:
+    ConnectionPool(const std::string& server, const std::string& port_num, const std::string& path,
+                   PoolConfig config = {});
+    explicit ConnectionPool(WsConnector& ws_conn);  // One borrowed connection in both roles
+
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+    ~ConnectionPool();
+
+    size_t size() const { return connections_.size(); }
+    WsConnector& connection(size_t index) const { return *connections_[index]; }
+    const std::vector<size_t>& members(ConnectionRole role) const {
+        return role == ConnectionRole::OrderEntry ? order_entry_ : market_data_;
+    }
+    bool serves(size_t index, ConnectionRole role) const;
+
+    // Index of the connection carrying an instrument's traffic in a role; an empty
+    // instrument, or a role with one connection, gets the role's first connection
+    size_t route(ConnectionRole role, std::string_view instrument = {}) const;
+
+    void disconnect();  // Closes every connection
+
+    // Journals the frames of the first market-data connection; the writer takes one thread
+    void captureTo(FrameJournalWriter* journal);
+
+private:
+    std::vector<std::unique_ptr<WsConnector>> owned_;
+    std::vector<WsConnector*> connections_;
+    std::vector<size_t> order_entry_;
+    std::vector<size_t> market_data_;
+};
+
+#endif // CONNECTION_POOL_H
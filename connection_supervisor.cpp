@@ -0,0 +1,226 @@
+#include "connection_supervisor.h"
+#include <algorithm>
+#include <stdexcept>
+#include "logger.h"
+#include "connection_pool.h"
+#include "order_manager.h"
+#include "performance_tracker.h"
+#include "ws_connector.h"
+
+namespace {
+
+// Time from noticing a drop or stall until the session is authenticated and subscribed again
+const PerformanceTracker::ProbeId kRecoveryProbe = PerformanceTracker::registerProbe("conn.recovery");
+
+int64_t toNanos(std::chrono::milliseconds duration) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+}
+
+}  // namespace
+
+ConnectionSupervisor::ConnectionSupervisor(OrderManager& order_mgr, SupervisorConfig config)
+    : order_mgr_(order_mgr), config_(config) {
+    if (config_.stall_timeout <= config_.probe_after || config_.probe_after.count() <= 0) {
+        throw std::invalid_argument("Supervisor needs 0 < probe_after < stall_timeout");
+    }
+    order_mgr_.setDisconnectHandler([this](const std::string& reason) { onDisconnect(reason); });
+}
+
+ConnectionSupervisor::~ConnectionSupervisor() {
+    stop();
+    order_mgr_.setDisconnectHandler(nullptr);
+}
+
+void ConnectionSupervisor::start() {
+    if (thread_.joinable()) {
+        throw std::logic_error("ConnectionSupervisor already running");
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = false;
+        link_down_ = false;
+    }
+    order_mgr_.setRequestTimeout(config_.request_timeout);
+
+    std::chrono::milliseconds backoff = config_.backoff_initial;
+    for (int attempt = 1;; ++attempt) {
+        try {
+            connect(false);
+            break;
+        } catch (const std::exception& ex) {
+            failed_attempts_.fetch_add(1, std::memory_order_relaxed);
+            order_mgr_.stop();
+            if (attempt >= config_.connect_attempts) {
+                LOG_ERROR("Connection failed after {} attempts: {}", attempt, ex.what());
+                throw;
+            }
+            LOG_WARN("Connection attempt {} failed: {}", attempt, ex.what());
+        }
+        std::this_thread::sleep_for(backoff);
+        backoff = std::min(backoff * 2, config_.backoff_max);
+    }
+
+    thread_ = std::thread([this] { run(); });
+}
+
+void ConnectionSupervisor::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    order_mgr_.stop();
+    connected_.store(false, std::memory_order_release);
+}
+
+SupervisorStats ConnectionSupervisor::stats() const {
+    SupervisorStats out;
+    out.disconnects = disconnects_.load(std::memory_order_relaxed);
+    out.stalls = stalls_.load(std::memory_order_relaxed);
+    out.reconnects = reconnects_.load(std::memory_order_relaxed);
+    out.failed_attempts = failed_attempts_.load(std::memory_order_relaxed);
+    out.tls_resumed = tls_resumed_.load(std::memory_order_relaxed);
+    out.last_recovery_ns = last_recovery_ns_.load(std::memory_order_relaxed);
+    return out;
+}
+
+void ConnectionSupervisor::onDisconnect(const std::string& reason) {
+    // Reader thread: record and hand off, reconnecting here would deadlock on our own join
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (recovering_ || link_down_) {
+            return;
+        }
+        link_down_ = true;
+        down_reason_ = reason;
+        down_ns_ = PerformanceTracker::now();
+    }
+    wake_.notify_all();
+}
+
+void ConnectionSupervisor::run() {
+    const int64_t probe_after_ns = toNanos(config_.probe_after);
+    const int64_t stall_timeout_ns = toNanos(config_.stall_timeout);
+    const auto check_interval = std::max(std::chrono::milliseconds(1), config_.probe_after / 4);
+    int64_t probed_at_ns = 0;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        wake_.wait_for(lock, check_interval, [this] { return stopping_ || link_down_; });
+        if (stopping_) {
+            return;
+        }
+
+        std::string reason;
+        int64_t detected_ns = 0;
+        if (link_down_) {
+            reason = down_reason_;
+            detected_ns = down_ns_;
+        } else {
+            int64_t now = PerformanceTracker::now();
+            // Queued only; the reply lands on the io thread, so the watchdog never waits on it
+            lock.unlock();
+            order_mgr_.refreshAuthenticationIfDue(now);
+            order_mgr_.reconcilePositionsIfDue(now);
+            lock.lock();
+            if (stopping_ || link_down_) {
+                continue;
+            }
+
+            int64_t last_receive_ns = order_mgr_.lastReceiveNs();
+            int64_t silent_ns = now - last_receive_ns;
+            if (silent_ns < probe_after_ns) {
+                continue;
+            }
+            if (silent_ns < stall_timeout_ns) {
+                if (probed_at_ns < last_receive_ns) {
+                    // One probe per quiet spell; any frame back, not just its reply, clears it
+                    probed_at_ns = now;
+                    lock.unlock();
+                    try {
+                        order_mgr_.sendTest();
+                    } catch (const std::exception& ex) {
+                        LOG_WARN("Heartbeat probe failed: {}", ex.what());
+                    }
+                    lock.lock();
+                }
+                continue;
+            }
+            stalls_.fetch_add(1, std::memory_order_relaxed);
+            reason = "no traffic for " + std::to_string(silent_ns / 1000000) + " ms";
+            detected_ns = now;
+        }
+
+        recovering_ = true;
+        link_down_ = false;
+        lock.unlock();
+        recover(reason, detected_ns);
+        probed_at_ns = 0;
+        lock.lock();
+        recovering_ = false;
+    }
+}
+
+void ConnectionSupervisor::recover(const std::string& reason, int64_t detected_ns) {
+    LOG_WARN("Connection lost ({}), reconnecting", reason);
+    connected_.store(false, std::memory_order_release);
+    disconnects_.fetch_add(1, std::memory_order_relaxed);
+
+    // A stalled socket may never finish a close handshake; cut it so the reader exits
+    ConnectionPool& pool = order_mgr_.connections();
+    for (size_t link = 0; link < pool.size(); ++link) {
+        pool.connection(link).abort();
+    }
+    order_mgr_.stop();
+
+    std::chrono::milliseconds backoff = config_.backoff_initial;
+    while (true) {
+        try {
+            connect(true);
+            break;
+        } catch (const std::exception& ex) {
+            failed_attempts_.fetch_add(1, std::memory_order_relaxed);
+            LOG_WARN("Reconnect attempt failed: {}", ex.what());
+            order_mgr_.stop();
+        }
+        if (!waitFor(backoff)) {
+            return;
+        }
+        backoff = std::min(backoff * 2, config_.backoff_max);
+    }
+
+    int64_t recovery_ns = PerformanceTracker::now() - detected_ns;
+    bool resumed = true;
+    for (size_t link = 0; link < pool.size(); ++link) {
+        resumed = resumed && pool.connection(link).sessionResumed();
+    }
+    PerformanceTracker::record(kRecoveryProbe, recovery_ns);
+    last_recovery_ns_.store(recovery_ns, std::memory_order_relaxed);
+    reconnects_.fetch_add(1, std::memory_order_relaxed);
+    if (resumed) {
+        tls_resumed_.fetch_add(1, std::memory_order_relaxed);
+    }
+    LOG_INFO("Session restored in {} us, TLS session {}", recovery_ns / 1000, resumed ? "resumed" : "renegotiated");
+}
+
+void ConnectionSupervisor::connect(bool restore_session) {
+    ConnectionPool& pool = order_mgr_.connections();
+    for (size_t link = 0; link < pool.size(); ++link) {
+        pool.connection(link).establishConnection();
+    }
+    order_mgr_.start();
+    if (restore_session) {
+        order_mgr_.restoreSession();
+    } else if (config_.heartbeat_interval_seconds > 0) {
+        order_mgr_.enableHeartbeat(config_.heartbeat_interval_seconds);
+    }
+    connected_.store(true, std::memory_order_release);
+}
+
+bool ConnectionSupervisor::waitFor(std::chrono::milliseconds delay) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return !wake_.wait_for(lock, delay, [this] { return stopping_; });
+}
@@ -0,0 +1,86 @@
+#ifndef CONNECTION_SUPERVISOR_H
+#define CONNECTION_SUPERVISOR_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+class OrderManager;
+
+struct SupervisorConfig {
+    int heartbeat_interval_seconds = 10;  // public/set_heartbeat; 0 leaves the exchange's heartbeat off
+    std::chrono::milliseconds probe_after{500};     // Silence before a public/test probe
+    std::chrono::milliseconds stall_timeout{2000};  // Silence before the link counts as dead
+    std::chrono::milliseconds backoff_initial{50};  // First retry is immediate, then this, doubling
+    std::chrono::milliseconds backoff_max{5000};
+    int connect_attempts = 5;  // For the first connection; reconnects retry until stop()
+    // Applied to the order manager so a blocking request, including a restore, never outwaits a dead link
+    std::chrono::milliseconds request_timeout{5000};
+};
+
+struct SupervisorStats {
+    uint64_t disconnects = 0;      // Drops and stalls
+    uint64_t stalls = 0;           // Of which no traffic within stall_timeout
+    uint64_t reconnects = 0;       // Sessions restored
+    uint64_t failed_attempts = 0;
+    uint64_t tls_resumed = 0;      // Reconnects where every connection skipped the full TLS handshake
+    int64_t last_recovery_ns = 0;  // Detection to session restored; also the conn.recovery probe
+};
+
+// Keeps an OrderManager's connections alive. A watchdog thread probes a quiet link
+// with public/test and declares it stalled when nothing at all arrives within
+// stall_timeout; drops are reported by the reader as they happen. Either way the
+// supervisor reconnects with exponential backoff, offering the previous TLS session,
+// then re-authenticates and re-subscribes through OrderManager::restoreSession().
+// A pool is watched by its quietest connection and recovered as a whole.
+// Requests in flight at the drop fail with "Connection closed"; nothing is replayed.
+// The same tick renews the access token before it expires and reconciles tracked positions.
+class ConnectionSupervisor {
+public:
+    explicit ConnectionSupervisor(OrderManager& order_mgr, SupervisorConfig config = {});
+    ~ConnectionSupervisor();
+
+    ConnectionSupervisor(const ConnectionSupervisor&) = delete;
+    ConnectionSupervisor& operator=(const ConnectionSupervisor&) = delete;
+
+    // Connects, starts the order manager and enables the heartbeat, then watches.
+    // Throws the last error when the first connection fails connect_attempts times.
+    void start();
+    void stop();  // Also stops the order manager
+
+    bool isConnected() const { return connected_.load(std::memory_order_acquire); }
+    SupervisorStats stats() const;
+
+private:
+    void run();
+    void onDisconnect(const std::string& reason);
+    void recover(const std::string& reason, int64_t detected_ns);
+    void connect(bool restore_session);
+    bool waitFor(std::chrono::milliseconds delay);  // False when stopping
+
+    OrderManager& order_mgr_;
+    SupervisorConfig config_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+    bool recovering_ = false;  // Closes of the connection being replaced are expected
+    bool link_down_ = false;
+    std::string down_reason_;
+    int64_t down_ns_ = 0;
+    std::thread thread_;
+
+    std::atomic<bool> connected_{false};
+    std::atomic<uint64_t> disconnects_{0};
+    std::atomic<uint64_t> stalls_{0};
+    std::atomic<uint64_t> reconnects_{0};
+    std::atomic<uint64_t> failed_attempts_{0};
+    std::atomic<uint64_t> tls_resumed_{0};
+    std::atomic<int64_t> last_recovery_ns_{0};
+};
+
+#endif // CONNECTION_SUPERVISOR_H
@@ -0,0 +1,233 @@
+// Coroutine order workflows against an in-process MockExchange, built with TRADING_CXX20.
+//   coroutine_bench [cycles_per_workflow] [max_workflows]
+// Requote: cancel a resting bid, then resubmit it, as one cycle. First through the blocking API,
+// one request at a time on the bench thread; then as C++20 coroutines over AwaitableOrders,
+// 1, 8, 64 ... up to max_workflows at once, every one on the connection's single io thread.
+// Book then quote: fetch the book, bid a few ticks under the touch and pull the bid again.
+// Errors: orders over the risk limit complete with OrderErrc::RiskRefused instead of throwing.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <future>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include "awaitable_orders.h"
+#include "logger.h"
+#include "mock_exchange.h"
+#include "order_manager.h"
+#include "ws_connector.h"
+
+namespace {
+
+using boost::asio::awaitable;
+using boost::asio::use_awaitable;
+
+const std::string kInstrument = "BTC-PERPETUAL";
+constexpr double kMaxOrderAmount = 1000.0;
+
+int64_t nowNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void report(const std::string& name, std::vector<int64_t>& latencies, int64_t wall_ns) {
+    if (latencies.empty()) {
+        return;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p) {
+        return latencies[std::min(latencies.size() - 1, static_cast<size_t>(p * latencies.size()))];
+    };
+    std::cout << name << " (" << latencies.size() << " cycles)"
+              << "  p50 " << percentile(0.50) / 1000.0 << " us"
+              << "  p99 " << percentile(0.99) / 1000.0 << " us"
+              << "  max " << latencies.back() / 1000.0 << " us"
+              << "  " << latencies.size() * 1e9 / wall_ns << " cycles/s" << std::endl;
+}
+
+// Shared by the workflows of one run; they all resume on the same io thread, so no locking
+struct RunState {
+    std::vector<int64_t> latencies;
+    size_t errors = 0;
+    std::string first_error;
+
+    void noteError(std::string_view step, const std::error_code& error, std::string_view detail) {
+        if (errors++ == 0) {
+            first_error = std::string(step) + ": " + error.message() + " (" + std::string(detail) + ")";
+        }
+    }
+};
+
+awaitable<void> requote(AwaitableOrders& orders, RunState& state, int cycles, double price) {
+    AckResult placed = co_await orders.submitBuyOrder(kInstrument, 10.0, price, use_awaitable);
+    if (placed.error) {
+        state.noteError("buy", placed.error, placed.ack.error_message.view());
+        co_return;
+    }
+    std::string order_id(placed.ack.order_id.view());
+
+    for (int i = 0; i < cycles; ++i) {
+        int64_t start_ns = nowNanos();
+        AckResult cancelled = co_await orders.removeOrder(order_id, use_awaitable);
+        if (cancelled.error) {
+            state.noteError("cancel", cancelled.error, cancelled.ack.error_message.view());
+            co_return;
+        }
+        placed = co_await orders.submitBuyOrder(kInstrument, 10.0, price, use_awaitable);
+        if (placed.error) {
+            state.noteError("buy", placed.error, placed.ack.error_message.view());
+            co_return;
+        }
+        order_id.assign(placed.ack.order_id.view());
+        state.latencies.push_back(nowNanos() - start_ns);
+    }
+    co_await orders.removeOrder(order_id, use_awaitable);
+}
+
+awaitable<void> bookThenQuote(AwaitableOrders& orders, RunState& state, int cycles, double tick) {
+    for (int i = 0; i < cycles; ++i) {
+        int64_t start_ns = nowNanos();
+        BookResult book = co_await orders.retrieveOrderBook(kInstrument, use_awaitable);
+        if (book.error || book.book.bids.empty()) {
+            state.noteError("book", book.error, book.book.error_message.view());
+            co_return;
+        }
+        AckResult placed = co_await orders.submitBuyOrder(kInstrument, 10.0, book.book.bids[0].price - 4 * tick,
+                                                          use_awaitable);
+        if (placed.error) {
+            state.noteError("buy", placed.error, placed.ack.error_message.view());
+            co_return;
+        }
+        AckResult cancelled = co_await orders.removeOrder(placed.ack.order_id.view(), use_awaitable);
+        if (cancelled.error) {
+            state.noteError("cancel", cancelled.error, cancelled.ack.error_message.view());
+            co_return;
+        }
+        state.latencies.push_back(nowNanos() - start_ns);
+    }
+}
+
+// Spawns the workflows on the order connection's io thread and waits for the last to finish
+template <typename Workflow>
+void runConcurrently(AwaitableOrders& orders, const std::string& name, int workflows, Workflow&& workflow) {
+    RunState state;
+    std::promise<void> finished;
+    size_t remaining = static_cast<size_t>(workflows);
+    int64_t start_ns = nowNanos();
+    for (int i = 0; i < workflows; ++i) {
+        boost::asio::co_spawn(orders.get_executor(), workflow(state, i), [&](std::exception_ptr ex) {
+            if (ex) {
+                ++state.errors;  // Only a bug escapes: every order error comes back as a code
+            }
+            if (--remaining == 0) {
+                finished.set_value();
+            }
+        });
+    }
+    finished.get_future().wait();
+    int64_t wall_ns = nowNanos() - start_ns;
+
+    report(name + ", " + std::to_string(workflows) + " concurrent", state.latencies, wall_ns);
+    if (state.errors > 0) {
+        throw std::runtime_error(name + ": " + std::to_string(state.errors) + " workflows failed, first " +
+                                 state.first_error);
+    }
+}
+
+void runBlocking(OrderManager& order_mgr, int cycles) {
+    std::vector<int64_t> latencies;
+    latencies.reserve(static_cast<size_t>(cycles));
+    auto orderId = [](const rapidjson::Document& reply) {
+        return std::string(reply["result"]["order"]["order_id"].GetString());
+    };
+
+    std::string order_id = orderId(order_mgr.submitBuyOrder(kInstrument, 10.0, 49000.0));
+    int64_t start_ns = nowNanos();
+    for (int i = 0; i < cycles; ++i) {
+        int64_t cycle_ns = nowNanos();
+        order_mgr.removeOrder(order_id);
+        order_id = orderId(order_mgr.submitBuyOrder(kInstrument, 10.0, 49000.0));
+        latencies.push_back(nowNanos() - cycle_ns);
+    }
+    int64_t wall_ns = nowNanos() - start_ns;
+    order_mgr.removeOrder(order_id);
+    report("requote, blocking calls", latencies, wall_ns);
+}
+
+void runRefusals(AwaitableOrders& orders) {
+    constexpr int kRefusals = 1000;
+    int refused = 0;
+    std::promise<void> finished;
+    auto refusals = [&]() -> awaitable<void> {
+        for (int i = 0; i < kRefusals; ++i) {
+            AckResult result = co_await orders.submitBuyOrder(kInstrument, kMaxOrderAmount * 2, 49000.0, use_awaitable);
+            refused += result.error == OrderErrc::RiskRefused;
+        }
+    };
+    int64_t start_ns = nowNanos();
+    boost::asio::co_spawn(orders.get_executor(), refusals(), [&](std::exception_ptr) { finished.set_value(); });
+    finished.get_future().wait();
+    int64_t wall_ns = nowNanos() - start_ns;
+    std::cout << "risk refusals: " << refused << "/" << kRefusals << " completed with RiskRefused, "
+              << wall_ns / kRefusals << " ns each" << std::endl;
+    if (refused != kRefusals) {
+        throw std::runtime_error("Oversized orders were not refused with an error code");
+    }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    int cycles = argc > 1 ? std::atoi(argv[1]) : 2000;
+    int max_workflows = argc > 2 ? std::atoi(argv[2]) : 64;
+
+    MockExchangeConfig config;
+    config.feed_rate = 0.0;  // Snapshots only: the workflows have the connection to themselves
+
+    Logger::start("coroutine_bench.log");
+    int status = 0;
+    try {
+        MockExchange exchange(config);
+        exchange.start();
+
+        WsConnector ws_client(config.address, std::to_string(exchange.port()), "/ws/api/v2");
+        ws_client.establishConnection();
+        OrderManager order_mgr(ws_client);
+        order_mgr.start();
+        order_mgr.performAuthentication("bench", "bench");
+
+        RiskLimits limits;
+        limits.max_order_amount = kMaxOrderAmount;
+        limits.max_position = 1e9;
+        order_mgr.riskGate().setLimits(kInstrument, limits);
+
+        AwaitableOrders orders(order_mgr);
+        runBlocking(order_mgr, cycles);
+        for (int workflows = 1; workflows <= max_workflows; workflows *= 8) {
+            int per_workflow = std::max(1, cycles / workflows);
+            runConcurrently(orders, "requote, coroutines", workflows, [&](RunState& state, int index) {
+                return requote(orders, state, per_workflow, 49000.0 - index * config.tick_size);
+            });
+        }
+        runConcurrently(orders, "book then quote, coroutines", 8, [&](RunState& state, int) {
+            return bookThenQuote(orders, state, std::max(1, cycles / 8), config.tick_size);
+        });
+        runRefusals(orders);
+
+        order_mgr.stop();
+        ws_client.disconnect();
+        exchange.stop();
+    } catch (const std::exception& ex) {
+        std::cerr << "Benchmark failed: " << ex.what() << std::endl;
+        status = 1;
+    }
+    Logger::stop();
+    return status;
+}
@@ -0,0 +1,585 @@
+// End-to-end benchmark against an in-process MockExchange over loopback TLS.
+//   exchange_bench [round_trips] [feed_seconds] [feed_rate_per_second] [capture_journal]
+// Round trips: buy -> edit -> cancel, one request in flight at a time, through
+// OrderManager's pipelined path; latency is submit to ack handler.
+// Batches: per-batch wall time of a bulk submit and bulk edit of 20 quotes and of the mass cancel by label.
+// Feed: a tracked book.* subscription; counts book updates applied per second.
+// Isolation: buy -> cancel round trips with and without a busy book feed, once with market data
+// sharing the order connection and once through a ConnectionPool with its own market-data connection.
+// Receive modes: the same round trips with the default socket, with SocketTuning's options, and
+// with a spinning reader.
+// Steady state: buy -> edit -> cancel under the book feed on a connection of its own; neither the
+// bench thread nor the io thread may call malloc, and no MessageArena may overflow.
+// Token refresh: tokens live one second here; private calls keep succeeding across several
+// expiries while the supervisor renews the connection's session in the background.
+// Positions: market orders fill at the touch; the position store follows user.trades, is checked
+// against private/get_positions, and a position the server moves without a trade is corrected by
+// the next background reconcile.
+// Recovery: the server drops, then stalls, every connection; time from detection to the session
+// being authenticated and re-subscribed, and until the tracked book is synced again.
+// With a journal path every received frame is captured for journal_replay.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "connection_pool.h"
+#include "connection_supervisor.h"
+#include "frame_journal.h"
+#include "heap_counter.h"
+#include "logger.h"
+#include "memory_arena.h"
+#include "mock_exchange.h"
+#include "order_manager.h"
+#include "performance_tracker.h"
+#include "ws_connector.h"
+
+namespace {
+
+const std::string kInstrument = "BTC-PERPETUAL";
+constexpr int kWarmupRoundTrips = 200;
+constexpr int kBatches = 500;
+constexpr size_t kBatchSize = 20;  // Quotes pulled or repriced together
+constexpr int kRecoveries = 20;    // Per fault kind
+constexpr int kFills = 200;
+constexpr int kPositionLookups = 1000000;
+
+int64_t nowNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void report(const char* name, std::vector<int64_t>& latencies) {
+    if (latencies.empty()) {
+        return;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p) {
+        return latencies[std::min(latencies.size() - 1, static_cast<size_t>(p * latencies.size()))];
+    };
+    std::cout << name << " (" << latencies.size() << " round trips)"
+              << "  p50 " << percentile(0.50) / 1000.0 << " us"
+              << "  p99 " << percentile(0.99) / 1000.0 << " us"
+              << "  p99.9 " << percentile(0.999) / 1000.0 << " us"
+              << "  max " << latencies.back() / 1000.0 << " us" << std::endl;
+}
+
+// Sends one request and spins until its ack arrives on the io thread
+template <typename Send>
+int64_t roundTrip(Send&& send, OrderAck& ack) {
+    std::atomic<bool> done{false};
+    int64_t received_ns = 0;
+    int64_t start_ns = nowNanos();
+    send([&](const OrderAck& reply) {
+        received_ns = nowNanos();
+        ack = reply;
+        done.store(true, std::memory_order_release);
+    });
+    while (!done.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+    }
+    if (!ack.ok()) {
+        throw std::runtime_error("Order rejected: " + std::string(ack.error_message.view()));
+    }
+    return received_ns - start_ns;
+}
+
+void runRoundTrips(OrderManager& order_mgr, int round_trips) {
+    std::vector<int64_t> buys;
+    std::vector<int64_t> edits;
+    std::vector<int64_t> cancels;
+    buys.reserve(static_cast<size_t>(round_trips));
+    edits.reserve(static_cast<size_t>(round_trips));
+    cancels.reserve(static_cast<size_t>(round_trips));
+
+    OrderAck ack;
+    for (int i = -kWarmupRoundTrips; i < round_trips; ++i) {
+        double price = 49000.0 + (i & 63) * 0.5;
+        int64_t buy_ns = roundTrip([&](OrderManager::AckHandler handler) {
+            order_mgr.submitBuyOrderAsync(kInstrument, 10.0, price, std::move(handler));
+        }, ack);
+
+        std::string order_id(ack.order_id.view());
+        int64_t edit_ns = roundTrip([&](OrderManager::AckHandler handler) {
+            order_mgr.updateOrderAsync(order_id, price - 0.5, 20.0, std::move(handler));
+        }, ack);
+        int64_t cancel_ns = roundTrip([&](OrderManager::AckHandler handler) {
+            order_mgr.removeOrderAsync(order_id, std::move(handler));
+        }, ack);
+
+        if (i >= 0) {
+            buys.push_back(buy_ns);
+            edits.push_back(edit_ns);
+            cancels.push_back(cancel_ns);
+        }
+    }
+
+    report("private/buy", buys);
+    report("private/edit", edits);
+    report("private/cancel", cancels);
+}
+
+// Whole batches: submit kBatchSize labelled quotes, reprice them all, then pull them with one mass cancel
+void runBatches(OrderManager& order_mgr) {
+    std::vector<int64_t> submits;
+    std::vector<int64_t> edits;
+    std::vector<int64_t> cancels;
+
+    std::vector<OrderRequest> orders(kBatchSize);
+    std::vector<std::string> order_ids(kBatchSize);
+    std::vector<BatchEdit> reprices(kBatchSize);
+    for (int batch = -kWarmupRoundTrips / 10; batch < kBatches; ++batch) {
+        for (size_t i = 0; i < kBatchSize; ++i) {
+            bool bid = i % 2 == 0;
+            orders[i] = OrderRequest::limit(kInstrument, bid ? Side::Buy : Side::Sell, 10.0,
+                                            bid ? 49000.0 - i : 51000.0 + i);
+            orders[i].post_only = true;
+            orders[i].label = "quote";
+        }
+        BatchResult placed = order_mgr.submitOrders(orders);
+        if (placed.failed != 0) {
+            throw std::runtime_error("Batch submit rejected: " + std::string(placed.acks[0].error_message.view()));
+        }
+
+        for (size_t i = 0; i < kBatchSize; ++i) {
+            order_ids[i].assign(placed.acks[i].order_id.view());
+            reprices[i] = BatchEdit{order_ids[i], orders[i].price + (orders[i].side == Side::Buy ? 0.5 : -0.5), 20.0};
+        }
+        BatchResult repriced = order_mgr.updateOrders(reprices);
+
+        int64_t cancel_start = nowNanos();
+        int64_t cancelled = order_mgr.cancelByLabel("quote");
+        int64_t cancel_ns = nowNanos() - cancel_start;
+        if (cancelled != static_cast<int64_t>(kBatchSize)) {
+            throw std::runtime_error("Mass cancel removed " + std::to_string(cancelled) + " orders");
+        }
+
+        if (batch >= 0) {
+            submits.push_back(placed.elapsed_ns);
+            edits.push_back(repriced.elapsed_ns);
+            cancels.push_back(cancel_ns);
+        }
+    }
+
+    std::string legs = " x" + std::to_string(kBatchSize);
+    report(("batch private/buy+sell" + legs).c_str(), submits);
+    report(("batch private/edit" + legs).c_str(), edits);
+    report("private/cancel_by_label", cancels);
+}
+
+void runFeed(OrderManager& order_mgr, const MockExchange& exchange, int feed_seconds) {
+    std::atomic<uint64_t> updates{0};
+    order_mgr.setBookListener([&updates](std::string_view, const OrderBook&) {
+        updates.store(updates.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);  // Reader thread only
+    });
+    order_mgr.trackOrderBook(kInstrument);
+
+    // Let the snapshot land and the feed reach its steady rate
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    uint64_t updates_before = updates.load(std::memory_order_relaxed);
+    uint64_t sent_before = exchange.feedMessagesSent();
+    uint64_t skipped_before = exchange.feedMessagesSkipped();
+    auto start = std::chrono::steady_clock::now();
+
+    std::this_thread::sleep_for(std::chrono::seconds(feed_seconds));
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    uint64_t applied = updates.load(std::memory_order_relaxed) - updates_before;
+    uint64_t sent = exchange.feedMessagesSent() - sent_before;
+    uint64_t skipped = exchange.feedMessagesSkipped() - skipped_before;
+    order_mgr.setBookListener(nullptr);
+
+    std::cout << "book feed: " << static_cast<uint64_t>(applied / elapsed) << " updates/s applied, "
+              << static_cast<uint64_t>(sent / elapsed) << " msgs/s sent, "
+              << skipped << " skipped by the server for backlog" << std::endl;
+}
+
+// Buy -> cancel round trips on a manager of its own, reported together
+void measureOrderAcks(OrderManager& order_mgr, const std::string& name, int round_trips) {
+    std::vector<int64_t> round_trip_ns;
+    round_trip_ns.reserve(static_cast<size_t>(round_trips) * 2);
+    OrderAck ack;
+    for (int i = -kWarmupRoundTrips; i < round_trips; ++i) {
+        order_mgr.refreshAuthenticationIfDue(nowNanos());  // No supervisor here, and tokens live a second
+        int64_t buy_ns = roundTrip([&](OrderManager::AckHandler handler) {
+            order_mgr.submitBuyOrderAsync(kInstrument, 10.0, 49000.0 + (i & 63) * 0.5, std::move(handler));
+        }, ack);
+        std::string order_id(ack.order_id.view());
+        int64_t cancel_ns = roundTrip([&](OrderManager::AckHandler handler) {
+            order_mgr.removeOrderAsync(order_id, std::move(handler));
+        }, ack);
+        if (i >= 0) {
+            round_trip_ns.push_back(buy_ns);
+            round_trip_ns.push_back(cancel_ns);
+        }
+    }
+    report(name.c_str(), round_trip_ns);
+}
+
+// The same round trips over pool, first quiet, then under the tracked book's feed
+void runIsolation(const MockExchangeConfig& config, const MockExchange& exchange, PoolConfig layout,
+                  const char* name, int round_trips) {
+    ConnectionPool pool(config.address, std::to_string(exchange.port()), "/ws/api/v2", layout);
+    OrderManager order_mgr(pool);
+    for (size_t link = 0; link < pool.size(); ++link) {
+        pool.connection(link).establishConnection();
+    }
+    order_mgr.start();
+    order_mgr.performAuthentication("bench", "bench");
+
+    measureOrderAcks(order_mgr, std::string(name) + ", quiet", round_trips);
+    order_mgr.trackOrderBook(kInstrument);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));  // Feed at its steady rate
+    measureOrderAcks(order_mgr, std::string(name) + ", busy feed", round_trips);
+
+    order_mgr.stop();
+    pool.disconnect();
+}
+
+// Order acks with the reader sleeping in epoll, with the socket options, and with a spinning reader
+void runReceiveModes(const MockExchangeConfig& config, const MockExchange& exchange, int round_trips) {
+    SocketTuning tuned;
+    tuned.busy_poll_us = 50;
+    tuned.receive_buffer_bytes = 1 << 20;
+    tuned.send_buffer_bytes = 1 << 20;
+    tuned.quick_ack = true;
+    SocketTuning spinning = tuned;
+    spinning.spin = true;  // Unpinned, so it still yields to the server and the bench thread
+
+    const std::pair<const char*, SocketTuning> modes[] = {
+        {"order ack, blocking reader", SocketTuning()},
+        {"order ack, tuned socket", tuned},
+        {"order ack, spinning reader", spinning},
+    };
+    for (const auto& [name, tuning] : modes) {
+        WsConnector ws_client(config.address, std::to_string(exchange.port()), "/ws/api/v2");
+        ws_client.setSocketTuning(tuning);
+        ws_client.establishConnection();
+        OrderManager order_mgr(ws_client);
+        order_mgr.start();
+        order_mgr.performAuthentication("bench", "bench");
+        measureOrderAcks(order_mgr, name, round_trips);
+        order_mgr.stop();
+        ws_client.disconnect();
+    }
+}
+
+// Heap and arena counters of whichever thread takes them
+struct ThreadMemory {
+    HeapCounter::Counts heap;
+    MessageArena::Stats arena;
+
+    static ThreadMemory take() { return ThreadMemory{HeapCounter::thread(), MessageArena::local().stats()}; }
+};
+
+// Read on the connection's io thread; spins rather than waits on a future, which would allocate
+ThreadMemory ioThreadMemory(WsConnector& ws_client) {
+    ThreadMemory memory;
+    std::atomic<bool> taken{false};
+    boost::asio::post(ws_client.executor(), [&] {
+        memory = ThreadMemory::take();
+        taken.store(true, std::memory_order_release);
+    });
+    while (!taken.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+    }
+    return memory;
+}
+
+// A server of its own with the default token lifetime: renewing a session parses a DOM reply, which
+// the steady-state path does not
+void runSteadyState(MockExchangeConfig config, int round_trips) {
+    config.token_lifetime_seconds = MockExchangeConfig().token_lifetime_seconds;
+    MockExchange exchange(config);
+    exchange.start();
+
+    WsConnector ws_client(config.address, std::to_string(exchange.port()), "/ws/api/v2");
+    ws_client.establishConnection();
+    OrderManager order_mgr(ws_client);
+    order_mgr.start();
+    order_mgr.performAuthentication("bench", "bench");
+    RiskLimits limits;
+    limits.max_order_amount = 1000.0;
+    limits.max_position = 1e6;
+    order_mgr.riskGate().setLimits(kInstrument, limits);
+    order_mgr.trackOrders();
+    order_mgr.trackOrderBook(kInstrument);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));  // Feed at its steady rate
+
+    // One pointer of capture, so the handler fits std::function's inline buffer
+    struct Pending {
+        std::atomic<bool> done{false};
+        OrderAck ack;
+    } pending;
+    auto send = [&pending](auto&& submit) {
+        submit([p = &pending](const OrderAck& reply) {
+            p->ack = reply;
+            p->done.store(true, std::memory_order_release);
+        });
+        while (!pending.done.load(std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+        pending.done.store(false, std::memory_order_relaxed);
+        if (!pending.ack.ok()) {
+            throw std::runtime_error("Order rejected: " + std::string(pending.ack.error_message.view()));
+        }
+    };
+    char order_id[64];
+    auto cycle = [&](int i) {
+        double price = 49000.0 + (i & 63) * 0.5;
+        send([&](OrderManager::AckHandler handler) {
+            order_mgr.submitBuyOrderAsync(kInstrument, 10.0, price, std::move(handler));
+        });
+        std::string_view placed = pending.ack.order_id.view();
+        std::string_view id(order_id, placed.copy(order_id, sizeof(order_id)));
+        send([&](OrderManager::AckHandler handler) {
+            order_mgr.updateOrderAsync(id, price - 0.5, 20.0, std::move(handler));
+        });
+        send([&](OrderManager::AckHandler handler) { order_mgr.removeOrderAsync(id, std::move(handler)); });
+    };
+
+    for (int i = 0; i < kWarmupRoundTrips; ++i) {
+        cycle(i);
+    }
+    ThreadMemory io_before = ioThreadMemory(ws_client);
+    ThreadMemory bench_before = ThreadMemory::take();
+    for (int i = 0; i < round_trips; ++i) {
+        cycle(i);
+    }
+    ThreadMemory bench_after = ThreadMemory::take();
+    ThreadMemory io_after = ioThreadMemory(ws_client);
+
+    order_mgr.stop();
+    ws_client.disconnect();
+    exchange.stop();
+
+    uint64_t bench_allocations = bench_after.heap.allocations - bench_before.heap.allocations;
+    uint64_t io_allocations = io_after.heap.allocations - io_before.heap.allocations;
+    uint64_t overflows = bench_after.arena.overflows - bench_before.arena.overflows +
+                         io_after.arena.overflows - io_before.arena.overflows;
+    std::cout << "steady state (" << round_trips * 3 << " requests under the book feed): " << bench_allocations
+              << " allocations on the bench thread, " << io_allocations << " on the io thread, " << overflows
+              << " arena overflows; io arena " << io_after.arena.cycles - io_before.arena.cycles << " cycles, "
+              << io_after.arena.high_water << " bytes high water" << std::endl;
+    if (!HeapCounter::enabled()) {
+        std::cout << "  (allocation counting is off in this build)" << std::endl;
+    } else if (bench_allocations != 0 || io_allocations != 0 || overflows != 0) {
+        throw std::runtime_error("Steady-state order path touched the heap");
+    }
+}
+
+void runTokenRefresh(OrderManager& order_mgr, int seconds) {
+    int calls = 0;
+    int failures = 0;
+    int refreshes = 0;
+    int64_t expires_ns = order_mgr.authExpiresNs();
+    auto end = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+    while (std::chrono::steady_clock::now() < end) {
+        try {
+            order_mgr.fetchPositions();
+        } catch (const std::exception&) {
+            ++failures;
+        }
+        ++calls;
+        if (order_mgr.authExpiresNs() != expires_ns) {
+            expires_ns = order_mgr.authExpiresNs();
+            ++refreshes;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    std::cout << "token refresh: " << refreshes << " renewals in " << seconds << " s, " << failures << "/" << calls
+              << " private calls failed" << std::endl;
+}
+
+void runPositions(OrderManager& order_mgr, MockExchange& exchange) {
+    order_mgr.trackPositions({"BTC"}, std::chrono::seconds(1));
+    uint64_t applied_before = order_mgr.positions().fillsApplied();
+
+    // Alternating sizes so the position adds, reduces and flips
+    OrderAck ack;
+    for (int i = 0; i < kFills; ++i) {
+        Side side = (i % 3 == 2) ? Side::Sell : Side::Buy;
+        double amount = side == Side::Sell ? 50.0 : 20.0;
+        roundTrip([&](OrderManager::AckHandler handler) {
+            order_mgr.submitOrderAsync(OrderRequest::market(kInstrument, side, amount), std::move(handler));
+        }, ack);
+    }
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (order_mgr.positions().fillsApplied() - applied_before < static_cast<uint64_t>(kFills)) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            throw std::runtime_error("Fills not applied within 5 s");
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    InstrumentId id = order_mgr.instruments().find(kInstrument);
+    int64_t lookup_start = nowNanos();
+    for (int i = 0; i < kPositionLookups; ++i) {
+        order_mgr.positions().find(id);  // Takes the record's lock, so it is not optimized away
+    }
+    int64_t lookup_ns = nowNanos() - lookup_start;
+
+    std::optional<PositionRecord> local = order_mgr.findPosition(kInstrument);
+    rapidjson::Document snapshot = order_mgr.fetchPositions("BTC");
+    double exchange_size = 0.0;
+    for (const rapidjson::Value& position : snapshot["result"].GetArray()) {
+        if (kInstrument == position["instrument_name"].GetString()) {
+            exchange_size = position["size"].GetDouble();
+        }
+    }
+    std::cout << "positions: " << kFills << " fills applied, " << kInstrument << " " << local->size << " @ "
+              << local->average_price << " (exchange " << exchange_size << "), upl " << local->unrealized_pnl
+              << " rpl " << local->realized_pnl << " fees " << local->fees << " BTC" << std::endl;
+    std::cout << "position lookup: " << static_cast<double>(lookup_ns) / kPositionLookups << " ns" << std::endl;
+
+    // A position change the client never sees a trade for
+    uint64_t corrections = order_mgr.positions().corrections();
+    int64_t shifted_ns = nowNanos();
+    exchange.shiftPosition(kInstrument, 100.0, 50000.0);
+    deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (order_mgr.positions().corrections() == corrections) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            throw std::runtime_error("Drift not reconciled within 5 s");
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::cout << "position drift corrected after " << (nowNanos() - shifted_ns) / 1e6
+              << " ms (reconcile every 1 s), size now " << order_mgr.findPosition(kInstrument)->size << std::endl;
+}
+
+// Injects one fault per round and waits for the supervisor to restore the session and the book
+void runRecovery(ConnectionSupervisor& supervisor, OrderManager& order_mgr, MockExchange& exchange, bool stall) {
+    std::vector<int64_t> recoveries;
+    std::vector<int64_t> resyncs;
+    std::vector<int64_t> detections;
+    uint64_t resumed_before = supervisor.stats().tls_resumed;
+
+    for (int round = 0; round < kRecoveries; ++round) {
+        uint64_t reconnects = supervisor.stats().reconnects;
+        int64_t fault_ns = nowNanos();
+        if (stall) {
+            exchange.stallConnections();
+        } else {
+            exchange.dropConnections();
+        }
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (supervisor.stats().reconnects == reconnects) {
+            if (std::chrono::steady_clock::now() > deadline) {
+                throw std::runtime_error("Session not restored within 10 s");
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        int64_t restored_ns = nowNanos();
+        while (!order_mgr.readOrderBook(kInstrument, [](const OrderBook&) {})) {
+            if (std::chrono::steady_clock::now() > deadline) {
+                throw std::runtime_error("Book not resynced within 10 s");
+            }
+            std::this_thread::yield();
+        }
+
+        int64_t recovery_ns = supervisor.stats().last_recovery_ns;
+        recoveries.push_back(recovery_ns);
+        detections.push_back(restored_ns - fault_ns - recovery_ns);
+        resyncs.push_back(nowNanos() - fault_ns);
+    }
+
+    std::string fault = stall ? "stall" : "drop";
+    report(("detect " + fault).c_str(), detections);
+    report(("reconnect + re-auth + resubscribe after " + fault).c_str(), recoveries);
+    report(("fault to book resynced, " + fault).c_str(), resyncs);
+    std::cout << "TLS sessions resumed: " << supervisor.stats().tls_resumed - resumed_before << "/" << kRecoveries
+              << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    int round_trips = argc > 1 ? std::atoi(argv[1]) : 10000;
+    int feed_seconds = argc > 2 ? std::atoi(argv[2]) : 5;
+
+    MockExchangeConfig config;
+    config.feed_rate = argc > 3 ? std::atof(argv[3]) : 50000.0;
+    config.token_lifetime_seconds = 1;  // Renewed every 800 ms for the whole run
+
+    Logger::start("exchange_bench.log");
+    int status = 0;
+    try {
+        MockExchange exchange(config);
+        exchange.start();
+
+        std::optional<FrameJournalWriter> journal;
+        if (argc > 4) {
+            journal.emplace(argv[4]);
+        }
+
+        WsConnector ws_client(config.address, std::to_string(exchange.port()), "/ws/api/v2");
+        ws_client.captureTo(journal ? &*journal : nullptr);
+
+        // Tight timings so the stall rounds finish quickly; loopback answers a probe in microseconds
+        OrderManager order_mgr(ws_client);
+        SupervisorConfig supervision;
+        supervision.probe_after = std::chrono::milliseconds(50);
+        supervision.stall_timeout = std::chrono::milliseconds(150);
+        supervision.backoff_initial = std::chrono::milliseconds(5);
+        ConnectionSupervisor supervisor(order_mgr, supervision);
+        supervisor.start();
+        order_mgr.performAuthentication("bench", "bench");
+
+        // Cold load from the exchange, then the warm restart path from the file it wrote
+        std::string cache_path = "exchange_bench.instruments";
+        std::remove(cache_path.c_str());
+        for (const char* start : {"cold", "warm"}) {
+            int64_t load_start = nowNanos();
+            size_t loaded = order_mgr.loadInstruments("BTC", "any", cache_path);
+            std::cout << "instruments (" << start << "): " << loaded << " in " << (nowNanos() - load_start) / 1000.0
+                      << " us" << std::endl;
+        }
+
+        // Loose limits: the bench measures the gate's cost, not its rejections
+        RiskLimits limits;
+        limits.max_order_amount = 1000.0;
+        limits.max_position = 1e6;
+        order_mgr.riskGate().setLimits(kInstrument, limits);
+        order_mgr.trackOrders();
+        runRoundTrips(order_mgr, round_trips);
+        runBatches(order_mgr);
+        std::cout << "open orders in the local store afterwards: " << order_mgr.orders().openCount()
+                  << ", working exposure " << order_mgr.riskGate().working(kInstrument, Side::Buy) << " bid / "
+                  << order_mgr.riskGate().working(kInstrument, Side::Sell) << " ask" << std::endl;
+
+        // Order acks behind book traffic on one socket, then with the feed on its own
+        PoolConfig shared;
+        shared.market_data = 0;
+        runIsolation(config, exchange, shared, "order ack, shared connection", round_trips);
+        runIsolation(config, exchange, PoolConfig(), "order ack, split connections", round_trips);
+        runReceiveModes(config, exchange, round_trips);
+        runSteadyState(config, round_trips);
+        runFeed(order_mgr, exchange, feed_seconds);
+        runTokenRefresh(order_mgr, 3);
+        runPositions(order_mgr, exchange);
+
+        runRecovery(supervisor, order_mgr, exchange, false);
+        runRecovery(supervisor, order_mgr, exchange, true);
+
+        std::cout << "\nClient-side probes:\n";
+        PerformanceTracker::report(std::cout);
+
+        supervisor.stop();
+        ws_client.disconnect();
+        exchange.stop();
+        if (journal) {
+            std::cout << "\nCaptured " << journal->frames() << " frames to " << argv[4] << std::endl;
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << "Benchmark failed: " << ex.what() << std::endl;
+        status = 1;
+    }
+    Logger::stop();
+    return status;
+}
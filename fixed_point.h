@@ -0,0 +1,174 @@
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+#include <cmath>
+#include <cstdint>
+
+// Prices and amounts on an instrument's grid. A Price counts ticks and a Qty counts
+// lots of the instrument it was cut for; they are distinct types so a size cannot be
+// passed as a price, and neither has a value without its InstrumentSpec.
+struct Price {
+    int64_t ticks = 0;
+
+    constexpr bool operator==(Price other) const { return ticks == other.ticks; }
+    constexpr bool operator!=(Price other) const { return ticks != other.ticks; }
+    constexpr bool operator<(Price other) const { return ticks < other.ticks; }
+    constexpr bool operator>(Price other) const { return ticks > other.ticks; }
+};
+
+struct Qty {
+    int64_t lots = 0;
+
+    constexpr bool operator==(Qty other) const { return lots == other.lots; }
+    constexpr bool operator!=(Qty other) const { return lots != other.lots; }
+    constexpr bool operator<(Qty other) const { return lots < other.lots; }
+    constexpr bool operator>(Qty other) const { return lots > other.lots; }
+};
+
+constexpr int64_t kPowersOf10[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000};
+constexpr uint8_t kMaxGridDecimals = 8;
+
+// One grid step as an exact decimal: step = step_units / 10^decimals.
+// Tick 0.5 at two decimals is {50, 2}; a lot of 10 at none is {10, 0}.
+struct DecimalGrid {
+    int64_t step_units = 0;
+    uint8_t decimals = 0;
+
+    // false when step is not a whole number of 10^-decimals
+    bool assign(double step, uint8_t places) {
+        double scaled = step * static_cast<double>(kPowersOf10[places]);
+        int64_t units = std::llround(scaled);
+        if (units <= 0 || std::fabs(scaled - static_cast<double>(units)) > 1e-6) {
+            return false;
+        }
+        step_units = units;
+        decimals = places;
+        return true;
+    }
+    double step() const { return static_cast<double>(step_units) / static_cast<double>(kPowersOf10[decimals]); }
+};
+
+// Which way an off-grid value moves: buys round their price down and sells up, so
+// rounding never makes an order more aggressive; amounts round down
+enum class Rounding : uint8_t { Down, Up, Nearest };
+
+// Shapes of listing the order path specializes for
+enum class InstrumentClass : uint8_t {
+    Perpetual,  // BTC-PERPETUAL: USD amounts in whole contracts, ticks of 0.5 or 0.05
+    Future,     // BTC-27MAR26: as perpetuals, ticks of 2.5
+    Option,     // BTC-27MAR26-60000-C: prices in coin to 4 places, amounts in tenths
+    Generic,    // Anything else, e.g. linear USDC contracts and spot: decimals from the grid
+};
+
+// Decimal places fixed at compile time for each class; an instrument whose grid needs
+// more falls back to Generic when its spec is built. A fixed count lets the conversions
+// scale by a constant power of ten and render a constant number of digits.
+template <InstrumentClass Class>
+struct InstrumentTraits {
+    static constexpr int kPriceDecimals = -1;  // -1: the grid's own
+    static constexpr int kAmountDecimals = -1;
+};
+
+template <>
+struct InstrumentTraits<InstrumentClass::Perpetual> {
+    static constexpr int kPriceDecimals = 2;
+    static constexpr int kAmountDecimals = 0;
+};
+
+template <>
+struct InstrumentTraits<InstrumentClass::Future> {
+    static constexpr int kPriceDecimals = 2;
+    static constexpr int kAmountDecimals = 0;
+};
+
+template <>
+struct InstrumentTraits<InstrumentClass::Option> {
+    static constexpr int kPriceDecimals = 4;
+    static constexpr int kAmountDecimals = 1;
+};
+
+// An instrument's tick and lot grids. For every class but Generic the grids' decimals
+// equal the class's InstrumentTraits.
+struct InstrumentSpec {
+    InstrumentClass instrument_class = InstrumentClass::Generic;
+    DecimalGrid tick;
+    DecimalGrid lot;  // Minimum trade amount, which every amount is a multiple of
+};
+
+// Grid arithmetic for one class. A value converts to integer units once, with one multiply
+// by the scale; everything after that is exact integer arithmetic.
+template <InstrumentClass Class>
+struct GridMath {
+    static constexpr InstrumentClass kClass = Class;
+    using Traits = InstrumentTraits<Class>;
+
+    static constexpr int64_t scale(int decimals, const DecimalGrid& grid) {
+        return decimals >= 0 ? kPowersOf10[decimals] : kPowersOf10[grid.decimals];
+    }
+
+    // Three digits past the grid's decimals, so a value just off the grid still rounds the
+    // right way; anything within 10^-3 of a unit counts as on it
+    static constexpr int64_t kGuard = 1000;
+
+    // Floor, ceiling or nearest multiple of the step, in steps
+    static int64_t toSteps(double value, int64_t scale, int64_t step_units, Rounding rounding) {
+        int64_t units = std::llround(value * static_cast<double>(scale * kGuard));
+        step_units *= kGuard;
+        int64_t steps = units / step_units;
+        int64_t remainder = units % step_units;
+        steps -= remainder < 0;  // Floor for negative combo prices
+        remainder += remainder < 0 ? step_units : 0;
+        steps += (rounding == Rounding::Up && remainder != 0) ||
+                 (rounding == Rounding::Nearest && 2 * remainder >= step_units);
+        return steps;
+    }
+
+    static Price toPrice(double price, const InstrumentSpec& spec, Rounding rounding) {
+        return Price{toSteps(price, scale(Traits::kPriceDecimals, spec.tick), spec.tick.step_units, rounding)};
+    }
+    static Qty toQty(double amount, const InstrumentSpec& spec, Rounding rounding = Rounding::Down) {
+        return Qty{toSteps(amount, scale(Traits::kAmountDecimals, spec.lot), spec.lot.step_units, rounding)};
+    }
+    static double toDouble(Price price, const InstrumentSpec& spec) {
+        return static_cast<double>(price.ticks * spec.tick.step_units) /
+               static_cast<double>(scale(Traits::kPriceDecimals, spec.tick));
+    }
+    static double toDouble(Qty amount, const InstrumentSpec& spec) {
+        return static_cast<double>(amount.lots * spec.lot.step_units) /
+               static_cast<double>(scale(Traits::kAmountDecimals, spec.lot));
+    }
+};
+
+// Runtime entry points: one switch on the class, then the specialized arithmetic
+template <typename Fn>
+inline decltype(auto) withInstrumentClass(InstrumentClass instrument_class, Fn&& fn) {
+    switch (instrument_class) {
+    case InstrumentClass::Perpetual:
+        return fn(GridMath<InstrumentClass::Perpetual>());
+    case InstrumentClass::Future:
+        return fn(GridMath<InstrumentClass::Future>());
+    case InstrumentClass::Option:
+        return fn(GridMath<InstrumentClass::Option>());
+    case InstrumentClass::Generic:
+    default:
+        return fn(GridMath<InstrumentClass::Generic>());
+    }
+}
+
+inline Price toPrice(double price, const InstrumentSpec& spec, Rounding rounding) {
+    return withInstrumentClass(spec.instrument_class, [&](auto math) { return math.toPrice(price, spec, rounding); });
+}
+
+inline Qty toQty(double amount, const InstrumentSpec& spec, Rounding rounding = Rounding::Down) {
+    return withInstrumentClass(spec.instrument_class, [&](auto math) { return math.toQty(amount, spec, rounding); });
+}
+
+inline double toDouble(Price price, const InstrumentSpec& spec) {
+    return withInstrumentClass(spec.instrument_class, [&](auto math) { return math.toDouble(price, spec); });
+}
+
+inline double toDouble(Qty amount, const InstrumentSpec& spec) {
+    return withInstrumentClass(spec.instrument_class, [&](auto math) { return math.toDouble(amount, spec); });
+}
+
+#endif // FIXED_POINT_H
@@ -0,0 +1,254 @@
+#include "frame_journal.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "logger.h"
+#include "performance_tracker.h"
+
+namespace {
+
+// How far behind its captured schedule each paced frame was delivered
+const PerformanceTracker::ProbeId kLagProbe = PerformanceTracker::registerProbe("replay.lag");
+
+std::runtime_error journalError(const std::string& what, const std::string& path) {
+    return std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+}
+
+// Sleeps most of the way, then spins, so paced frames land within a few microseconds
+void waitUntil(std::chrono::steady_clock::time_point due) {
+    auto remaining = due - std::chrono::steady_clock::now();
+    if (remaining > std::chrono::microseconds(200)) {
+        std::this_thread::sleep_for(remaining - std::chrono::microseconds(100));
+    }
+    while (std::chrono::steady_clock::now() < due) {
+    }
+}
+
+}  // namespace
+
+FrameJournalWriter::FrameJournalWriter(const std::string& path, size_t chunk_size)
+    : path_(path), chunk_size_(std::max<size_t>(chunk_size, 4096)) {
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        throw journalError("Cannot open frame journal", path);
+    }
+
+    struct stat info;
+    if (::fstat(fd_, &info) != 0) {
+        int err = errno;
+        ::close(fd_);
+        errno = err;
+        throw journalError("Cannot stat frame journal", path);
+    }
+
+    // Check an existing file before mapping it, so a wrong path is never resized
+    FrameJournalHeader existing;
+    if (info.st_size != 0 &&
+        (static_cast<size_t>(info.st_size) < sizeof(existing) ||
+         ::pread(fd_, &existing, sizeof(existing), 0) != static_cast<ssize_t>(sizeof(existing)) ||
+         std::memcmp(existing.magic, FrameJournalHeader::kMagic, sizeof(existing.magic)) != 0 ||
+         existing.version != FrameJournalHeader::kVersion ||
+         existing.header_size != sizeof(FrameJournalHeader))) {
+        ::close(fd_);
+        throw std::runtime_error("Not a frame journal: " + path);
+    }
+
+    try {
+        if (info.st_size == 0) {
+            map(sizeof(FrameJournalHeader) + chunk_size_);
+            FrameJournalHeader* head = header();
+            std::memcpy(head->magic, FrameJournalHeader::kMagic, sizeof(head->magic));
+            head->version = FrameJournalHeader::kVersion;
+            head->header_size = sizeof(FrameJournalHeader);
+            head->created_ns = now();
+            head->data_end = 0;
+        } else {
+            map(static_cast<size_t>(info.st_size));
+            used_ = static_cast<size_t>(std::min<uint64_t>(existing.data_end, mapped_ - sizeof(FrameJournalHeader)));
+        }
+    } catch (...) {
+        close();
+        throw;
+    }
+}
+
+FrameJournalWriter::~FrameJournalWriter() {
+    close();
+}
+
+int64_t FrameJournalWriter::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void FrameJournalWriter::map(size_t capacity) {
+    if (::ftruncate(fd_, static_cast<off_t>(capacity)) != 0) {
+        throw journalError("Cannot size frame journal", path_);
+    }
+    void* mapping = ::mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (mapping == MAP_FAILED) {
+        throw journalError("Cannot map frame journal", path_);
+    }
+    base_ = static_cast<char*>(mapping);
+    mapped_ = capacity;
+}
+
+void FrameJournalWriter::grow(size_t needed) {
+    size_t capacity = mapped_ + std::max(chunk_size_, needed);
+    if (::ftruncate(fd_, static_cast<off_t>(capacity)) != 0) {
+        throw journalError("Cannot grow frame journal", path_);
+    }
+    // The mapping may move; nothing outside the writer holds pointers into it
+    void* mapping = ::mremap(base_, mapped_, capacity, MREMAP_MAYMOVE);
+    if (mapping == MAP_FAILED) {
+        throw journalError("Cannot remap frame journal", path_);
+    }
+    base_ = static_cast<char*>(mapping);
+    mapped_ = capacity;
+}
+
+void FrameJournalWriter::append(std::string_view frame, int64_t received_ns) {
+    if (frame.size() > std::numeric_limits<uint32_t>::max()) {
+        throw std::length_error("Frame too large for journal");
+    }
+    if (!base_) {
+        throw std::logic_error("Frame journal is closed");
+    }
+
+    size_t record_size = kRecordHeaderSize + frame.size();
+    if (sizeof(FrameJournalHeader) + used_ + record_size > mapped_) {
+        grow(record_size);
+    }
+
+    char* out = base_ + sizeof(FrameJournalHeader) + used_;
+    auto size = static_cast<uint32_t>(frame.size());
+    std::memcpy(out, &received_ns, sizeof(received_ns));
+    std::memcpy(out + sizeof(received_ns), &size, sizeof(size));
+    std::memcpy(out + kRecordHeaderSize, frame.data(), frame.size());
+
+    used_ += record_size;
+    header()->data_end = used_;  // Readers of a live or crashed journal stop here
+    ++frames_;
+}
+
+void FrameJournalWriter::append(std::string_view frame) {
+    append(frame, now());
+}
+
+void FrameJournalWriter::close() {
+    if (base_) {
+        ::munmap(base_, mapped_);
+        base_ = nullptr;
+        // Drop the unused tail of the last chunk; on failure data_end still marks the last record
+        if (::ftruncate(fd_, static_cast<off_t>(sizeof(FrameJournalHeader) + used_)) != 0) {
+            LOG_WARN("Cannot trim frame journal {}: {}", path_, std::strerror(errno));
+        }
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+FrameJournalReader::FrameJournalReader(const std::string& path) {
+    fd_ = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd_ < 0) {
+        throw journalError("Cannot open frame journal", path);
+    }
+
+    struct stat info;
+    if (::fstat(fd_, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(FrameJournalHeader)) {
+        ::close(fd_);
+        throw std::runtime_error("Not a frame journal: " + path);
+    }
+
+    mapped_ = static_cast<size_t>(info.st_size);
+    void* mapping = ::mmap(nullptr, mapped_, PROT_READ, MAP_SHARED, fd_, 0);
+    if (mapping == MAP_FAILED) {
+        int err = errno;
+        ::close(fd_);
+        errno = err;
+        throw journalError("Cannot map frame journal", path);
+    }
+    base_ = static_cast<const char*>(mapping);
+    ::madvise(mapping, mapped_, MADV_SEQUENTIAL);
+
+    FrameJournalHeader head;
+    std::memcpy(&head, base_, sizeof(head));
+    if (std::memcmp(head.magic, FrameJournalHeader::kMagic, sizeof(head.magic)) != 0 ||
+        head.version != FrameJournalHeader::kVersion || head.header_size < sizeof(FrameJournalHeader) ||
+        head.header_size > mapped_) {
+        ::munmap(mapping, mapped_);
+        ::close(fd_);
+        throw std::runtime_error("Not a frame journal: " + path);
+    }
+
+    records_ = base_ + head.header_size;
+    data_end_ = static_cast<size_t>(std::min<uint64_t>(head.data_end, mapped_ - head.header_size));
+    created_ns_ = head.created_ns;
+}
+
+FrameJournalReader::~FrameJournalReader() {
+    if (base_) {
+        ::munmap(const_cast<char*>(base_), mapped_);
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+bool FrameJournalReader::next(Frame& frame) {
+    if (offset_ + FrameJournalWriter::kRecordHeaderSize > data_end_) {
+        return false;
+    }
+
+    const char* record = records_ + offset_;
+    uint32_t size;
+    std::memcpy(&frame.received_ns, record, sizeof(frame.received_ns));
+    std::memcpy(&size, record + sizeof(frame.received_ns), sizeof(size));
+    if (offset_ + FrameJournalWriter::kRecordHeaderSize + size > data_end_) {
+        return false;  // Torn write
+    }
+
+    frame.data = std::string_view(record + FrameJournalWriter::kRecordHeaderSize, size);
+    offset_ += FrameJournalWriter::kRecordHeaderSize + size;
+    return true;
+}
+
+ReplayStats replayJournal(FrameJournalReader& reader, const std::function<void(std::string_view)>& sink,
+                          double speed) {
+    ReplayStats stats;
+    FrameJournalReader::Frame frame;
+    bool paced = speed > 0.0;
+    int64_t first_ns = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    while (reader.next(frame)) {
+        if (paced) {
+            if (stats.frames == 0) {
+                first_ns = frame.received_ns;
+            }
+            auto offset = std::chrono::nanoseconds(static_cast<int64_t>((frame.received_ns - first_ns) / speed));
+            auto due = start + offset;
+            waitUntil(due);
+
+            int64_t lag = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - due).count();
+            PerformanceTracker::record(kLagProbe, lag);
+            stats.max_lag_ns = std::max(stats.max_lag_ns, lag);
+        }
+
+        sink(frame.data);
+        ++stats.frames;
+        stats.bytes += frame.data.size();
+    }
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
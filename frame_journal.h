@@ -0,0 +1,108 @@
+#ifndef FRAME_JOURNAL_H
+#define FRAME_JOURNAL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+// On-disk layout: a 64-byte header followed by back-to-back records of
+// [int64 received_ns][uint32 size][size bytes of frame], unaligned.
+// received_ns is system_clock time when the frame came off the socket.
+struct FrameJournalHeader {
+    static constexpr char kMagic[8] = {'H', 'F', 'T', 'J', 'R', 'N', 'L', '1'};
+    static constexpr uint32_t kVersion = 1;
+
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    int64_t created_ns;
+    uint64_t data_end;  // Record bytes after the header; advanced on every append
+    char reserved[32];
+};
+static_assert(sizeof(FrameJournalHeader) == 64, "Journal header layout is part of the file format");
+
+// Append-only capture file backed by a shared memory mapping. Appending is two
+// memcpys into the mapping; the file grows by chunk_size at a time, so the
+// hot path only touches the filesystem once per chunk. Not thread-safe: one
+// reading thread appends at a time. Opening an existing journal continues it.
+class FrameJournalWriter {
+public:
+    static constexpr size_t kRecordHeaderSize = sizeof(int64_t) + sizeof(uint32_t);
+    static constexpr size_t kDefaultChunkSize = size_t{64} << 20;
+
+    explicit FrameJournalWriter(const std::string& path, size_t chunk_size = kDefaultChunkSize);
+    ~FrameJournalWriter();
+
+    FrameJournalWriter(const FrameJournalWriter&) = delete;
+    FrameJournalWriter& operator=(const FrameJournalWriter&) = delete;
+
+    void append(std::string_view frame, int64_t received_ns);
+    void append(std::string_view frame);  // Stamped with the current system_clock time
+    void close();                          // Trims the file to its records; also done on destruction
+
+    uint64_t frames() const { return frames_; }  // Appended through this writer
+    uint64_t bytes() const { return used_; }     // All records in the file
+
+    static int64_t now();
+
+private:
+    void map(size_t capacity);
+    void grow(size_t needed);
+    FrameJournalHeader* header() const { return reinterpret_cast<FrameJournalHeader*>(base_); }
+
+    std::string path_;
+    size_t chunk_size_;
+    int fd_ = -1;
+    char* base_ = nullptr;
+    size_t mapped_ = 0;  // Header plus record capacity
+    size_t used_ = 0;    // Record bytes written
+    uint64_t frames_ = 0;
+};
+
+// Read-only view of a journal. Frames point into the mapping and stay valid
+// for the reader's lifetime. A torn final record from a crash is ignored.
+class FrameJournalReader {
+public:
+    struct Frame {
+        int64_t received_ns;
+        std::string_view data;
+    };
+
+    explicit FrameJournalReader(const std::string& path);
+    ~FrameJournalReader();
+
+    FrameJournalReader(const FrameJournalReader&) = delete;
+    FrameJournalReader& operator=(const FrameJournalReader&) = delete;
+
+    bool next(Frame& frame);
+    void rewind() { offset_ = 0; }
+    uint64_t bytes() const { return data_end_; }
+    int64_t createdNanos() const { return created_ns_; }
+
+private:
+    int fd_ = -1;
+    const char* base_ = nullptr;
+    size_t mapped_ = 0;
+    const char* records_ = nullptr;
+    size_t data_end_ = 0;
+    size_t offset_ = 0;
+    int64_t created_ns_ = 0;
+};
+
+struct ReplayStats {
+    uint64_t frames = 0;
+    uint64_t bytes = 0;
+    double seconds = 0.0;
+    int64_t max_lag_ns = 0;  // Paced replay only: worst delay behind the captured schedule
+
+    double framesPerSecond() const { return seconds > 0.0 ? static_cast<double>(frames) / seconds : 0.0; }
+};
+
+// Feeds every remaining frame to sink. speed 0 replays back to back; otherwise frames keep
+// their captured spacing divided by speed (1 is real time). Paced lag goes to "replay.lag".
+ReplayStats replayJournal(FrameJournalReader& reader, const std::function<void(std::string_view)>& sink,
+                          double speed = 0.0);
+
+#endif // FRAME_JOURNAL_H
@@ -0,0 +1,121 @@
+#include "heap_counter.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifndef TRADING_COUNT_ALLOCATIONS
+#define TRADING_COUNT_ALLOCATIONS 1
+#endif
+
+namespace {
+
+// Plain thread-locals: operator new may run before anything could register a thread
+thread_local uint64_t t_allocations = 0;
+thread_local uint64_t t_bytes = 0;
+std::atomic<uint64_t> g_allocations{0};
+std::atomic<uint64_t> g_bytes{0};
+
+}  // namespace
+
+#if TRADING_COUNT_ALLOCATIONS
+
+namespace {
+
+void count(std::size_t size) {
+    ++t_allocations;
+    t_bytes += size;
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+void* allocate(std::size_t size) {
+    count(size);
+    if (void* ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void* allocateAligned(std::size_t size, std::align_val_t align) {
+    count(size);
+    std::size_t alignment = static_cast<std::size_t>(align);
+    // aligned_alloc wants a multiple of the alignment
+    if (void* ptr = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+}  // namespace
+
+void* operator new(std::size_t size) {
+    return allocate(size);
+}
+
+void* operator new[](std::size_t size) {
+    return allocate(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    count(size);
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    count(size);
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new(std::size_t size, std::align_val_t align) {
+    return allocateAligned(size, align);
+}
+
+void* operator new[](std::size_t size, std::align_val_t align) {
+    return allocateAligned(size, align);
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+
+#endif
+
+bool HeapCounter::enabled() {
+    return TRADING_COUNT_ALLOCATIONS != 0;
+}
+
+HeapCounter::Counts HeapCounter::thread() {
+    return Counts{t_allocations, t_bytes};
+}
+
+HeapCounter::Counts HeapCounter::process() {
+    return Counts{g_allocations.load(std::memory_order_relaxed), g_bytes.load(std::memory_order_relaxed)};
+}
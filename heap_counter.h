@@ -0,0 +1,24 @@
+#ifndef HEAP_COUNTER_H
+#define HEAP_COUNTER_H
+
+#include <cstdint>
+
+// Counts calls to the global operator new, which heap_counter.cpp replaces when the build
+// has TRADING_COUNT_ALLOCATIONS on (the default). Only the benchmarks link heap_counter.cpp;
+// the client keeps the standard allocator. Each allocation adds to the calling thread's
+// counts and to the process totals; with counting off everything reads zero.
+// Steady-state paths are checked by taking thread() before and after a stretch of work
+// on the thread that does it.
+class HeapCounter {
+public:
+    struct Counts {
+        uint64_t allocations = 0;
+        uint64_t bytes = 0;
+    };
+
+    static bool enabled();
+    static Counts thread();   // The calling thread's, since it started
+    static Counts process();  // All threads', since start-up
+};
+
+#endif // HEAP_COUNTER_H
@@ -0,0 +1,323 @@
+#include "instrument_cache.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include "logger.h"
+
+namespace {
+
+// On-disk layout: header, then count records. Fixed sizes so the format does not follow the in-memory structs.
+struct InstrumentFileHeader {
+    static constexpr char kMagic[8] = {'H', 'F', 'T', 'I', 'N', 'S', 'T', '1'};
+    static constexpr uint32_t kVersion = 1;
+
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    int64_t saved_ns;  // system_clock time of the save
+    uint64_t count;
+    char reserved[32];
+};
+static_assert(sizeof(InstrumentFileHeader) == 64, "Instrument cache header layout is part of the file format");
+
+struct InstrumentFileRecord {
+    char name[64];  // Unterminated when exactly 64 characters
+    char base_currency[16];
+    double tick_size;
+    double contract_size;
+    double min_trade_amount;
+    uint8_t kind;
+    char reserved[23];
+};
+static_assert(sizeof(InstrumentFileRecord) == 128, "Instrument cache record layout is part of the file format");
+
+constexpr const char* kKindNames[] = {"unknown", "future", "option", "spot", "future_combo", "option_combo"};
+
+template <size_t N>
+void copyOut(char (&out)[N], const FixedString<N>& value) {
+    std::memset(out, 0, N);
+    std::memcpy(out, value.data, value.size);
+}
+
+template <size_t N>
+void copyIn(FixedString<N>& value, const char (&in)[N]) {
+    value.assign(in, strnlen(in, N));
+}
+
+// The fewest decimal places that hold step exactly
+bool assignFewestPlaces(DecimalGrid& grid, double step) {
+    for (uint8_t places = 0; places <= kMaxGridDecimals; ++places) {
+        if (grid.assign(step, places)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool sameGrid(const DecimalGrid& a, const DecimalGrid& b) {
+    return a.step_units == b.step_units && a.decimals == b.decimals;
+}
+
+int64_t systemNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+}  // namespace
+
+const char* toString(InstrumentKind kind) {
+    size_t index = static_cast<size_t>(kind);
+    return index < std::size(kKindNames) ? kKindNames[index] : "unknown";
+}
+
+InstrumentKind parseInstrumentKind(std::string_view kind) {
+    for (size_t i = 1; i < std::size(kKindNames); ++i) {
+        if (kind == kKindNames[i]) {
+            return static_cast<InstrumentKind>(i);
+        }
+    }
+    return InstrumentKind::Unknown;
+}
+
+std::optional<InstrumentSpec> makeInstrumentSpec(const InstrumentInfo& info) {
+    double lot_size = info.min_trade_amount > 0.0 ? info.min_trade_amount : info.contract_size;
+    if (info.tick_size <= 0.0 || lot_size <= 0.0) {
+        return std::nullopt;
+    }
+
+    InstrumentSpec spec;
+    std::string_view name = info.name.view();
+    constexpr std::string_view kPerpetualSuffix = "-PERPETUAL";
+    if (info.kind == InstrumentKind::Future) {
+        bool perpetual = name.size() >= kPerpetualSuffix.size() &&
+                         name.substr(name.size() - kPerpetualSuffix.size()) == kPerpetualSuffix;
+        spec.instrument_class = perpetual ? InstrumentClass::Perpetual : InstrumentClass::Future;
+    } else if (info.kind == InstrumentKind::Option) {
+        spec.instrument_class = InstrumentClass::Option;
+    }
+
+    int price_places = -1;
+    int amount_places = -1;
+    withInstrumentClass(spec.instrument_class, [&](auto math) {
+        using Traits = typename decltype(math)::Traits;
+        price_places = Traits::kPriceDecimals;
+        amount_places = Traits::kAmountDecimals;
+    });
+    if (price_places >= 0 && spec.tick.assign(info.tick_size, static_cast<uint8_t>(price_places)) &&
+        spec.lot.assign(lot_size, static_cast<uint8_t>(amount_places))) {
+        return spec;
+    }
+
+    spec.instrument_class = InstrumentClass::Generic;
+    if (!assignFewestPlaces(spec.tick, info.tick_size) || !assignFewestPlaces(spec.lot, lot_size)) {
+        return std::nullopt;
+    }
+    return spec;
+}
+
+InstrumentCache::InstrumentCache()
+    : names_(new FixedString<64>[kMaxInstruments]),
+      infos_(new InstrumentInfo[kMaxInstruments]),
+      specs_(new std::atomic<const InstrumentSpec*>[kMaxInstruments]),
+      index_hashes_(new uint64_t[kIndexSize]()),
+      index_(new std::atomic<uint32_t>[kIndexSize]) {
+    for (size_t i = 0; i < kMaxInstruments; ++i) {
+        specs_[i].store(nullptr, std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < kIndexSize; ++i) {
+        index_[i].store(kEmpty, std::memory_order_relaxed);
+    }
+}
+
+uint64_t InstrumentCache::hash(std::string_view name) {
+    // FNV-1a, as for channel names
+    uint64_t value = 14695981039346656037ull;
+    for (unsigned char c : name) {
+        value ^= c;
+        value *= 1099511628211ull;
+    }
+    return value;
+}
+
+InstrumentId InstrumentCache::find(std::string_view name) const {
+    uint64_t value = hash(name);
+    size_t mask = kIndexSize - 1;
+    for (size_t pos = value & mask;; pos = (pos + 1) & mask) {
+        uint32_t entry = index_[pos].load(std::memory_order_acquire);
+        if (entry == kEmpty) {
+            return kNoInstrument;
+        }
+        if (index_hashes_[pos] == value && names_[entry - 1].view() == name) {
+            return entry - 1;
+        }
+    }
+}
+
+InstrumentId InstrumentCache::internLocked(std::string_view name) {
+    InstrumentId id = find(name);
+    if (id != kNoInstrument) {
+        return id;
+    }
+    size_t count = count_.load(std::memory_order_relaxed);
+    if (count == kMaxInstruments) {
+        throw std::length_error("Instrument cache is full");
+    }
+    if (name.empty() || name.size() > sizeof(names_[0].data)) {
+        throw std::invalid_argument("Bad instrument name: " + std::string(name));
+    }
+
+    id = static_cast<InstrumentId>(count);
+    names_[id].assign(name.data(), name.size());
+    infos_[id].name = names_[id];
+
+    // Publish the id only once its name and hash are in place
+    uint64_t value = hash(name);
+    size_t mask = kIndexSize - 1;
+    size_t pos = value & mask;
+    while (index_[pos].load(std::memory_order_relaxed) != kEmpty) {
+        pos = (pos + 1) & mask;
+    }
+    index_hashes_[pos] = value;
+    index_[pos].store(id + 1, std::memory_order_release);
+    count_.store(count + 1, std::memory_order_release);
+    return id;
+}
+
+InstrumentId InstrumentCache::intern(std::string_view name) {
+    InstrumentId id = find(name);
+    if (id != kNoInstrument) {
+        return id;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    return internLocked(name);
+}
+
+InstrumentId InstrumentCache::update(const InstrumentInfo& info) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    InstrumentId id = internLocked(info.name.view());
+    infos_[id] = info;
+
+    // Readers may hold the current spec, so a changed one is published alongside it, never over it
+    std::optional<InstrumentSpec> spec = makeInstrumentSpec(infos_[id]);
+    const InstrumentSpec* current = specs_[id].load(std::memory_order_relaxed);
+    if (!spec) {
+        specs_[id].store(nullptr, std::memory_order_release);
+    } else if (!current || current->instrument_class != spec->instrument_class ||
+               !sameGrid(current->tick, spec->tick) || !sameGrid(current->lot, spec->lot)) {
+        spec_storage_.push_back(std::make_unique<InstrumentSpec>(*spec));
+        specs_[id].store(spec_storage_.back().get(), std::memory_order_release);
+    }
+    return id;
+}
+
+std::string_view InstrumentCache::name(InstrumentId id) const {
+    return id < size() ? names_[id].view() : std::string_view();
+}
+
+std::optional<InstrumentInfo> InstrumentCache::info(InstrumentId id) const {
+    if (id >= size()) {
+        return std::nullopt;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    return infos_[id];
+}
+
+double InstrumentCache::tickSize(InstrumentId id) const {
+    std::optional<InstrumentInfo> entry = info(id);
+    return entry ? entry->tick_size : 0.0;
+}
+
+std::vector<InstrumentInfo> InstrumentCache::list(std::string_view currency, InstrumentKind kind) const {
+    std::vector<InstrumentInfo> out;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t id = 0, count = size(); id < count; ++id) {
+        const InstrumentInfo& entry = infos_[id];
+        if (entry.hasReferenceData() && (currency.empty() || entry.base_currency.view() == currency) &&
+            (kind == InstrumentKind::Unknown || entry.kind == kind)) {
+            out.push_back(entry);
+        }
+    }
+    return out;
+}
+
+void InstrumentCache::save(const std::string& path) const {
+    std::vector<InstrumentInfo> entries = list();
+
+    InstrumentFileHeader header{};
+    std::memcpy(header.magic, InstrumentFileHeader::kMagic, sizeof(header.magic));
+    header.version = InstrumentFileHeader::kVersion;
+    header.record_size = sizeof(InstrumentFileRecord);
+    header.saved_ns = systemNanos();
+    header.count = entries.size();
+
+    std::vector<InstrumentFileRecord> records(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i) {
+        InstrumentFileRecord& record = records[i];
+        std::memset(&record, 0, sizeof(record));
+        copyOut(record.name, entries[i].name);
+        copyOut(record.base_currency, entries[i].base_currency);
+        record.tick_size = entries[i].tick_size;
+        record.contract_size = entries[i].contract_size;
+        record.min_trade_amount = entries[i].min_trade_amount;
+        record.kind = static_cast<uint8_t>(entries[i].kind);
+    }
+
+    // Readers never see a half-written cache
+    std::string temp_path = path + ".tmp";
+    FILE* file = std::fopen(temp_path.c_str(), "wb");
+    if (!file) {
+        throw std::runtime_error("Cannot write instrument cache " + temp_path + ": " + std::strerror(errno));
+    }
+    bool written = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+                   std::fwrite(records.data(), sizeof(InstrumentFileRecord), records.size(), file) == records.size();
+    written = std::fclose(file) == 0 && written;
+    if (!written || std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::remove(temp_path.c_str());
+        throw std::runtime_error("Cannot write instrument cache " + path);
+    }
+}
+
+size_t InstrumentCache::load(const std::string& path, int64_t max_age_seconds) {
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        return 0;  // No cache yet
+    }
+
+    InstrumentFileHeader header;
+    std::vector<InstrumentFileRecord> records;
+    bool valid = std::fread(&header, sizeof(header), 1, file) == 1 &&
+                 std::memcmp(header.magic, InstrumentFileHeader::kMagic, sizeof(header.magic)) == 0 &&
+                 header.version == InstrumentFileHeader::kVersion &&
+                 header.record_size == sizeof(InstrumentFileRecord) && header.count <= kMaxInstruments;
+    if (valid) {
+        records.resize(header.count);
+        valid = std::fread(records.data(), sizeof(InstrumentFileRecord), records.size(), file) == records.size();
+    }
+    std::fclose(file);
+    if (!valid) {
+        LOG_WARN("Ignoring {}: not an instrument cache or truncated", path);
+        return 0;
+    }
+
+    int64_t age_seconds = (systemNanos() - header.saved_ns) / 1000000000;
+    if (age_seconds > max_age_seconds) {
+        LOG_INFO("Instrument cache {} is {} s old, refetching", path, age_seconds);
+        return 0;
+    }
+
+    for (const InstrumentFileRecord& record : records) {
+        InstrumentInfo entry;
+        copyIn(entry.name, record.name);
+        copyIn(entry.base_currency, record.base_currency);
+        entry.kind = record.kind < std::size(kKindNames) ? static_cast<InstrumentKind>(record.kind)
+                                                         : InstrumentKind::Unknown;
+        entry.tick_size = record.tick_size;
+        entry.contract_size = record.contract_size;
+        entry.min_trade_amount = record.min_trade_amount;
+        update(entry);
+    }
+    return records.size();
+}
@@ -0,0 +1,97 @@
+#ifndef INSTRUMENT_CACHE_H
+#define INSTRUMENT_CACHE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "fixed_point.h"
+#include "response_parser.h"
+
+// Dense per-process instrument number: 0, 1, 2... in interning order.
+// Tables keyed by instrument are plain arrays of InstrumentCache::kMaxInstruments.
+using InstrumentId = uint32_t;
+constexpr InstrumentId kNoInstrument = UINT32_MAX;
+
+enum class InstrumentKind : uint8_t { Unknown, Future, Option, Spot, FutureCombo, OptionCombo };
+
+const char* toString(InstrumentKind kind);  // Deribit's spelling, e.g. "future_combo"
+InstrumentKind parseInstrumentKind(std::string_view kind);
+
+// Reference data from public/get_instruments
+struct InstrumentInfo {
+    FixedString<64> name;
+    FixedString<16> base_currency;
+    InstrumentKind kind = InstrumentKind::Unknown;
+    double tick_size = 0.0;  // 0 until reference data is loaded
+    double contract_size = 0.0;
+    double min_trade_amount = 0.0;
+
+    bool hasReferenceData() const { return tick_size > 0.0; }
+};
+
+// Tick and lot grids from reference data; nullopt without a tick size or a lot size.
+// Futures named *-PERPETUAL are perpetuals; a grid finer than its class's fixed decimals
+// makes the spec Generic.
+std::optional<InstrumentSpec> makeInstrumentSpec(const InstrumentInfo& info);
+
+// Interns instrument names to InstrumentIds and holds their reference data.
+// Ids are never reused or removed, so find() reads an open-addressing index of
+// atomics without locking; interning new names and reference data updates
+// take a mutex. The cache can be saved to disk so a warm restart skips the
+// public/get_instruments round trip.
+//
+// File layout: a 64-byte header then `count` 128-byte records, see instrument_cache.cpp.
+class InstrumentCache {
+public:
+    static constexpr size_t kMaxInstruments = 8192;
+
+    InstrumentCache();
+
+    InstrumentId intern(std::string_view name);     // Assigns the next id on first sight; throws when full
+    InstrumentId find(std::string_view name) const;  // kNoInstrument if never interned
+    InstrumentId update(const InstrumentInfo& info);  // Interns info.name and stores its reference data
+
+    std::string_view name(InstrumentId id) const;
+    std::optional<InstrumentInfo> info(InstrumentId id) const;
+    std::optional<InstrumentInfo> info(std::string_view name) const { return info(find(name)); }
+    double tickSize(InstrumentId id) const;  // 0 without reference data
+    // Lock-free; nullptr without reference data. A spec stays valid for the cache's lifetime,
+    // though reloaded reference data may publish a newer one.
+    const InstrumentSpec* spec(InstrumentId id) const {
+        return id < kMaxInstruments ? specs_[id].load(std::memory_order_acquire) : nullptr;
+    }
+    // Instruments with reference data; empty currency or Unknown kind match all
+    std::vector<InstrumentInfo> list(std::string_view currency = {},
+                                     InstrumentKind kind = InstrumentKind::Unknown) const;
+    size_t size() const { return count_.load(std::memory_order_acquire); }
+
+    // Writes every instrument with reference data; atomic through a rename
+    void save(const std::string& path) const;
+    // Adds the file's instruments; 0 if it is missing, not a cache, or older than max_age_seconds
+    size_t load(const std::string& path, int64_t max_age_seconds);
+
+private:
+    static constexpr size_t kIndexSize = kMaxInstruments * 2;
+    static constexpr uint32_t kEmpty = 0;  // Index entries hold id + 1
+
+    InstrumentId internLocked(std::string_view name);
+
+    static uint64_t hash(std::string_view name);
+
+    std::unique_ptr<FixedString<64>[]> names_;  // Written once, before the id is published
+    std::unique_ptr<InstrumentInfo[]> infos_;   // Guarded by mutex_
+    std::unique_ptr<std::atomic<const InstrumentSpec*>[]> specs_;
+    std::vector<std::unique_ptr<InstrumentSpec>> spec_storage_;  // Guarded by mutex_; never shrinks
+    std::unique_ptr<uint64_t[]> index_hashes_;
+    std::unique_ptr<std::atomic<uint32_t>[]> index_;
+    std::atomic<size_t> count_{0};
+    mutable std::mutex mutex_;
+};
+
+#endif // INSTRUMENT_CACHE_H
@@ -0,0 +1,274 @@
+#include "logger.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "ring_buffer.h"
+
+namespace {
+
+using LogRing = SpscRing<LogRecord, 4096>;  // 1 MB per logging thread
+
+constexpr size_t kMaxFormats = 4096;
+
+struct FormatInfo {
+    LogLevel level;
+    const char* format;
+    const char* file;
+    int line;
+};
+
+struct LoggerState {
+    std::mutex mutex;  // Registration and ring list; never taken on the write path
+    FormatInfo formats[kMaxFormats];
+    std::atomic<size_t> format_count{0};
+
+    // Rings outlive their threads so late records still reach the file
+    std::vector<std::shared_ptr<LogRing>> rings;
+
+    std::atomic<bool> running{false};
+    std::atomic<uint64_t> dropped{0};
+    std::thread writer;
+    std::FILE* file = nullptr;
+};
+
+LoggerState& state() {
+    static LoggerState instance;
+    return instance;
+}
+
+LogRing& localRing() {
+    thread_local LogRing* ring = [] {
+        auto created = std::make_shared<LogRing>();
+        LoggerState& log = state();
+        std::lock_guard<std::mutex> lock(log.mutex);
+        log.rings.push_back(created);
+        return created.get();
+    }();
+    return *ring;
+}
+
+const char* levelName(LogLevel level) {
+    switch (level) {
+    case LogLevel::Debug: return "DEBUG";
+    case LogLevel::Info: return "INFO";
+    case LogLevel::Warn: return "WARN";
+    case LogLevel::Error: return "ERROR";
+    }
+    return "?";
+}
+
+const char* baseName(const char* path) {
+    const char* slash = std::strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+// Renders one argument at payload[pos] and advances pos; false on a truncated record
+bool appendArg(std::string& line, const LogRecord& record, size_t& pos) {
+    if (pos >= record.payload_size) {
+        return false;
+    }
+    auto type = static_cast<LogArgType>(record.payload[pos++]);
+
+    char number[32];
+    switch (type) {
+    case LogArgType::Int: {
+        int64_t value;
+        std::memcpy(&value, record.payload + pos, sizeof(value));
+        pos += sizeof(value);
+        line += std::to_string(value);
+        return true;
+    }
+    case LogArgType::Uint: {
+        uint64_t value;
+        std::memcpy(&value, record.payload + pos, sizeof(value));
+        pos += sizeof(value);
+        line += std::to_string(value);
+        return true;
+    }
+    case LogArgType::Double: {
+        double value;
+        std::memcpy(&value, record.payload + pos, sizeof(value));
+        pos += sizeof(value);
+        std::snprintf(number, sizeof(number), "%.10g", value);
+        line += number;
+        return true;
+    }
+    case LogArgType::Bool:
+        line += record.payload[pos++] ? "true" : "false";
+        return true;
+    case LogArgType::Char:
+        line += record.payload[pos++];
+        return true;
+    case LogArgType::String: {
+        uint16_t length;
+        std::memcpy(&length, record.payload + pos, sizeof(length));
+        pos += sizeof(length);
+        line.append(record.payload + pos, length);
+        pos += length;
+        return true;
+    }
+    }
+    return false;
+}
+
+void formatRecord(std::string& line, const LogRecord& record, const FormatInfo& info) {
+    line.clear();
+
+    std::time_t seconds = static_cast<std::time_t>(record.timestamp_ns / 1000000000);
+    std::tm utc;
+    gmtime_r(&seconds, &utc);
+    char stamp[64];
+    size_t length = std::strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &utc);
+    std::snprintf(stamp + length, sizeof(stamp) - length, ".%06lld",
+                  static_cast<long long>(record.timestamp_ns % 1000000000 / 1000));
+    line += stamp;
+    line += ' ';
+    line += levelName(info.level);
+    line += ' ';
+    line += baseName(info.file);
+    line += ':';
+    line += std::to_string(info.line);
+    line += "  ";
+
+    size_t pos = 0;
+    for (const char* c = info.format; *c; ++c) {
+        if (c[0] == '{' && c[1] == '}') {
+            if (!appendArg(line, record, pos)) {
+                line += "{}";
+            }
+            ++c;
+        } else {
+            line += *c;
+        }
+    }
+    line += '\n';
+}
+
+// Returns the number of records written
+size_t drainRings(LoggerState& log, std::string& line) {
+    std::vector<LogRing*> rings;
+    {
+        std::lock_guard<std::mutex> lock(log.mutex);
+        for (const auto& ring : log.rings) {
+            rings.push_back(ring.get());
+        }
+    }
+
+    size_t written = 0;
+    LogRecord record;
+    for (LogRing* ring : rings) {
+        while (ring->tryPop(record)) {
+            if (record.format_id < log.format_count.load(std::memory_order_acquire)) {
+                formatRecord(line, record, log.formats[record.format_id]);
+                std::fwrite(line.data(), 1, line.size(), log.file);
+            }
+            ++written;
+        }
+    }
+    return written;
+}
+
+}  // namespace
+
+void Logger::start(const std::string& path) {
+    LoggerState& log = state();
+    std::lock_guard<std::mutex> lock(log.mutex);
+    if (log.running.load()) {
+        return;
+    }
+
+    log.file = std::fopen(path.c_str(), "a");
+    if (!log.file) {
+        throw std::runtime_error("Cannot open log file " + path);
+    }
+    std::setvbuf(log.file, nullptr, _IOFBF, 1 << 16);
+
+    log.running.store(true, std::memory_order_release);
+    log.writer = std::thread([&log] {
+        std::string line;
+        line.reserve(512);
+        while (log.running.load(std::memory_order_acquire)) {
+            if (drainRings(log, line) == 0) {
+                std::fflush(log.file);
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+        drainRings(log, line);
+        std::fflush(log.file);
+    });
+}
+
+void Logger::stop() {
+    LoggerState& log = state();
+    if (!log.running.exchange(false)) {
+        return;
+    }
+
+    log.writer.join();
+    std::fclose(log.file);
+    log.file = nullptr;
+}
+
+bool Logger::isRunning() {
+    return state().running.load(std::memory_order_relaxed);
+}
+
+uint16_t Logger::registerFormat(LogLevel level, const char* format, const char* file, int line) {
+    LoggerState& log = state();
+    std::lock_guard<std::mutex> lock(log.mutex);
+    size_t id = log.format_count.load(std::memory_order_relaxed);
+    if (id == kMaxFormats) {
+        throw std::length_error("Too many log statements");
+    }
+    log.formats[id] = FormatInfo{level, format, file, line};
+    log.format_count.store(id + 1, std::memory_order_release);
+    return static_cast<uint16_t>(id);
+}
+
+uint64_t Logger::droppedRecords() {
+    return state().dropped.load(std::memory_order_relaxed);
+}
+
+int64_t Logger::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void Logger::push(const LogRecord& record) {
+    if (!localRing().tryPush(record)) {
+        state().dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void Logger::encodeBytes(LogRecord& record, LogArgType type, const void* data, size_t size) {
+    if (record.truncated || record.payload_size + 1 + size > LogRecord::kPayloadSize) {
+        record.truncated = true;  // The writer prints {} for the missing arguments
+        return;
+    }
+    record.payload[record.payload_size++] = static_cast<char>(type);
+    std::memcpy(record.payload + record.payload_size, data, size);
+    record.payload_size = static_cast<uint16_t>(record.payload_size + size);
+}
+
+void Logger::encodeString(LogRecord& record, std::string_view text) {
+    size_t header = 1 + sizeof(uint16_t);
+    if (record.truncated || record.payload_size + header > LogRecord::kPayloadSize) {
+        record.truncated = true;
+        return;
+    }
+
+    // Long strings are truncated to what is left of the record
+    auto length = static_cast<uint16_t>(std::min(text.size(), LogRecord::kPayloadSize - record.payload_size - header));
+    record.payload[record.payload_size++] = static_cast<char>(LogArgType::String);
+    std::memcpy(record.payload + record.payload_size, &length, sizeof(length));
+    record.payload_size = static_cast<uint16_t>(record.payload_size + sizeof(length));
+    std::memcpy(record.payload + record.payload_size, text.data(), length);
+    record.payload_size = static_cast<uint16_t>(record.payload_size + length);
+}
@@ -0,0 +1,117 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// Compile-time verbosity: 0 debug, 1 info, 2 warn, 3 error, 4 off.
+// Statements below the level compile to nothing, arguments included.
+#ifndef TRADING_LOG_LEVEL
+#define TRADING_LOG_LEVEL 1
+#endif
+
+enum class LogLevel : uint8_t { Debug = 0, Info = 1, Warn = 2, Error = 3 };
+
+constexpr bool isLogLevelEnabled(int level) {
+    return level >= TRADING_LOG_LEVEL;
+}
+
+enum class LogArgType : uint8_t { Int, Uint, Double, Bool, Char, String };
+
+// One log statement as the hot thread leaves it: a format id and the raw argument
+// bytes, tagged by type. Formatting happens on the writer thread.
+struct LogRecord {
+    static constexpr size_t kSize = 256;
+    static constexpr size_t kPayloadSize = kSize - 16;
+
+    int64_t timestamp_ns;  // system_clock
+    uint16_t format_id;
+    uint16_t payload_size;
+    bool truncated;  // An argument did not fit; it and everything after it are dropped
+    char payload[kPayloadSize];
+};
+static_assert(sizeof(LogRecord) == LogRecord::kSize, "LogRecord must stay one fixed-size ring slot");
+
+// Asynchronous logger. Each thread appends records to its own lock-free ring;
+// a background thread drains all rings, formats `{}` placeholders and writes
+// to a file. A full ring drops the record rather than blocking the caller.
+class Logger {
+public:
+    static void start(const std::string& path);  // Appends to path
+    static void stop();                           // Drains every ring, then closes the file
+    static bool isRunning();
+
+    static uint16_t registerFormat(LogLevel level, const char* format, const char* file, int line);
+
+    template <typename... Args>
+    static void write(uint16_t format_id, const Args&... args);
+
+    static uint64_t droppedRecords();
+
+private:
+    static int64_t now();
+    static void push(const LogRecord& record);
+
+    template <typename T>
+    static void encode(LogRecord& record, const T& value);
+    static void encodeBytes(LogRecord& record, LogArgType type, const void* data, size_t size);
+    static void encodeString(LogRecord& record, std::string_view text);
+};
+
+template <typename... Args>
+void Logger::write(uint16_t format_id, const Args&... args) {
+    if (!isRunning()) {
+        return;
+    }
+
+    LogRecord record;
+    record.timestamp_ns = now();
+    record.format_id = format_id;
+    record.payload_size = 0;
+    record.truncated = false;
+    (encode(record, args), ...);
+    push(record);
+}
+
+template <typename T>
+void Logger::encode(LogRecord& record, const T& value) {
+    if constexpr (std::is_same_v<T, bool>) {
+        encodeBytes(record, LogArgType::Bool, &value, sizeof(value));
+    } else if constexpr (std::is_same_v<T, char>) {
+        encodeBytes(record, LogArgType::Char, &value, sizeof(value));
+    } else if constexpr (std::is_enum_v<T>) {
+        int64_t raw = static_cast<int64_t>(value);
+        encodeBytes(record, LogArgType::Int, &raw, sizeof(raw));
+    } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+        int64_t raw = value;
+        encodeBytes(record, LogArgType::Int, &raw, sizeof(raw));
+    } else if constexpr (std::is_integral_v<T>) {
+        uint64_t raw = value;
+        encodeBytes(record, LogArgType::Uint, &raw, sizeof(raw));
+    } else if constexpr (std::is_floating_point_v<T>) {
+        double raw = value;
+        encodeBytes(record, LogArgType::Double, &raw, sizeof(raw));
+    } else if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+        encodeString(record, std::string_view(value));
+    } else {
+        static_assert(std::is_convertible_v<const T&, std::string_view>, "Unsupported log argument type");
+    }
+}
+
+#define TRADING_LOG(level, format, ...)                                                                    \
+    do {                                                                                                   \
+        if constexpr (isLogLevelEnabled(static_cast<int>(level))) {                                       \
+            static const uint16_t trading_log_format_id = Logger::registerFormat(level, format, __FILE__, __LINE__); \
+            Logger::write(trading_log_format_id, ##__VA_ARGS__);                                           \
+        }                                                                                                  \
+    } while (0)
+
+#define LOG_DEBUG(...) TRADING_LOG(LogLevel::Debug, __VA_ARGS__)
+#define LOG_INFO(...) TRADING_LOG(LogLevel::Info, __VA_ARGS__)
+#define LOG_WARN(...) TRADING_LOG(LogLevel::Warn, __VA_ARGS__)
+#define LOG_ERROR(...) TRADING_LOG(LogLevel::Error, __VA_ARGS__)
+
+#endif // LOGGER_H
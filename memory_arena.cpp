@@ -0,0 +1,176 @@
+#include "memory_arena.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "logger.h"
+
+namespace {
+
+constexpr size_t kHugePageSize = size_t{2} << 20;
+
+MemoryConfig g_config;
+
+size_t roundUp(size_t value, size_t step) {
+    return (value + step - 1) / step * step;
+}
+
+}  // namespace
+
+void setMemoryConfig(const MemoryConfig& config) {
+    g_config = config;
+}
+
+const MemoryConfig& memoryConfig() {
+    return g_config;
+}
+
+MemorySlab::MemorySlab(size_t bytes) : MemorySlab(bytes, memoryConfig()) {}
+
+MemorySlab::MemorySlab(size_t bytes, const MemoryConfig& config) {
+    if (bytes == 0) {
+        return;
+    }
+    size_ = roundUp(bytes, config.huge_pages ? kHugePageSize : static_cast<size_t>(::sysconf(_SC_PAGESIZE)));
+
+    void* mapped = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    if (config.huge_pages) {
+        // Only succeeds with pages reserved in vm.nr_hugepages
+        mapped = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        huge_pages_ = mapped != MAP_FAILED;
+    }
+#endif
+    if (mapped == MAP_FAILED) {
+        mapped = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    }
+    if (mapped == MAP_FAILED) {
+        size_ = 0;
+        throw std::runtime_error(std::string("Cannot map memory slab: ") + std::strerror(errno));
+    }
+    data_ = static_cast<char*>(mapped);
+
+#ifdef MADV_HUGEPAGE
+    // Transparent huge pages: the kernel backs the range with 2 MiB pages where it can
+    if (config.huge_pages && !huge_pages_) {
+        huge_pages_ = ::madvise(data_, size_, MADV_HUGEPAGE) == 0;
+    }
+#endif
+    if (config.huge_pages && !huge_pages_) {
+        LOG_WARN("Huge pages unavailable, {} byte slab uses normal pages", size_);
+    }
+    // Touched after the advice so the pages fault in huge
+    if (config.prefault) {
+        std::memset(data_, 0, size_);
+    }
+}
+
+MemorySlab::~MemorySlab() {
+    release();
+}
+
+MemorySlab::MemorySlab(MemorySlab&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr)),
+      size_(std::exchange(other.size_, 0)),
+      huge_pages_(std::exchange(other.huge_pages_, false)) {}
+
+MemorySlab& MemorySlab::operator=(MemorySlab&& other) noexcept {
+    if (this != &other) {
+        release();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        huge_pages_ = std::exchange(other.huge_pages_, false);
+    }
+    return *this;
+}
+
+void MemorySlab::release() {
+    if (data_) {
+        ::munmap(data_, size_);
+        data_ = nullptr;
+        size_ = 0;
+    }
+}
+
+MessageArena& MessageArena::local() {
+    thread_local MessageArena arena(memoryConfig().message_arena_bytes);
+    return arena;
+}
+
+MessageArena::MessageArena(size_t capacity, const MemoryConfig& config) : slab_(capacity, config) {
+    overflow_.reserve(64);
+}
+
+void* MessageArena::allocate(size_t bytes, size_t alignment) {
+    ++stats_.allocations;
+    stats_.bytes += bytes;
+
+    size_t offset = roundUp(used_, alignment);
+    if (offset + bytes > slab_.size()) {
+        return overflow(bytes);
+    }
+    used_ = offset + bytes;
+    last_ = offset;
+    stats_.high_water = std::max(stats_.high_water, used_);
+    return slab_.data() + offset;
+}
+
+void* MessageArena::reallocate(void* ptr, size_t old_bytes, size_t new_bytes) {
+    if (new_bytes <= old_bytes) {
+        return ptr;
+    }
+    char* bytes = static_cast<char*>(ptr);
+    if (last_ != SIZE_MAX && bytes == slab_.data() + last_ && last_ + new_bytes <= slab_.size()) {
+        stats_.bytes += new_bytes - old_bytes;
+        used_ = last_ + new_bytes;
+        stats_.high_water = std::max(stats_.high_water, used_);
+        return ptr;
+    }
+
+    void* moved = allocate(new_bytes);
+    std::memcpy(moved, ptr, old_bytes);
+    return moved;
+}
+
+void* MessageArena::overflow(size_t bytes) {
+    ++stats_.overflows;
+    size_t blocks = (bytes + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t);
+    overflow_.emplace_back(new std::max_align_t[std::max<size_t>(blocks, 1)]);
+    return overflow_.back().get();
+}
+
+void MessageArena::rewind(size_t mark, size_t overflow_mark) {
+    ++stats_.cycles;
+    used_ = mark;
+    last_ = SIZE_MAX;
+    overflow_.resize(overflow_mark);
+}
+
+ScratchDocument::ScratchDocument(size_t pool_bytes, MessageArena& arena)
+    : stack_allocator_(arena),
+      pool_(arena.allocate(pool_bytes), pool_bytes),
+      document_(&pool_, 1024, &stack_allocator_) {}
+
+void* HandlerMemory::allocate(size_t bytes) {
+    if (bytes <= kBlockSize) {
+        for (size_t i = 0; i < kBlocks; ++i) {
+            if (!in_use_[i].load(std::memory_order_relaxed) && !in_use_[i].exchange(true, std::memory_order_acquire)) {
+                return blocks_[i].bytes;
+            }
+        }
+    }
+    heap_fallbacks_.fetch_add(1, std::memory_order_relaxed);
+    return ::operator new(bytes);
+}
+
+void HandlerMemory::deallocate(void* ptr) {
+    auto* bytes = static_cast<unsigned char*>(ptr);
+    if (bytes >= blocks_[0].bytes && bytes < blocks_[0].bytes + sizeof(blocks_)) {
+        in_use_[(bytes - blocks_[0].bytes) / sizeof(Block)].store(false, std::memory_order_release);
+        return;
+    }
+    ::operator delete(ptr);
+}
@@ -0,0 +1,272 @@
+#ifndef MEMORY_ARENA_H
+#define MEMORY_ARENA_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <rapidjson/document.h>
+
+// Process-wide memory settings, read whenever a slab is mapped. Set them once at start-up,
+// before OrderManager is built and before any thread touches its MessageArena.
+struct MemoryConfig {
+    size_t message_arena_bytes = size_t{1} << 20;  // Each thread's MessageArena
+    bool huge_pages = false;  // 2 MiB pages: MAP_HUGETLB when pages are reserved, else transparent huge pages
+    bool prefault = true;     // Populate slabs when mapped, so the first messages take no page faults
+};
+
+void setMemoryConfig(const MemoryConfig& config);
+const MemoryConfig& memoryConfig();
+
+// One anonymous, page-aligned mapping, optionally on huge pages. Never resized; unmapped on destruction.
+class MemorySlab {
+public:
+    MemorySlab() = default;
+    explicit MemorySlab(size_t bytes);  // With memoryConfig()
+    MemorySlab(size_t bytes, const MemoryConfig& config);
+    ~MemorySlab();
+
+    MemorySlab(MemorySlab&& other) noexcept;
+    MemorySlab& operator=(MemorySlab&& other) noexcept;
+    MemorySlab(const MemorySlab&) = delete;
+    MemorySlab& operator=(const MemorySlab&) = delete;
+
+    char* data() const { return data_; }
+    size_t size() const { return size_; }  // Rounded up to the page size in use
+    bool hugePages() const { return huge_pages_; }
+
+private:
+    void release();
+
+    char* data_ = nullptr;
+    size_t size_ = 0;
+    bool huge_pages_ = false;
+};
+
+// A fixed number of T constructed in their own slab, for tables sized once up front
+// such as OrderStore's records and indexes
+template <typename T>
+class SlabArray {
+public:
+    explicit SlabArray(size_t count) : slab_(count * sizeof(T)), size_(count) {
+        static_assert(alignof(T) <= alignof(std::max_align_t), "Slabs are only page aligned");
+        T* items = data();
+        for (size_t i = 0; i < size_; ++i) {
+            new (items + i) T();
+        }
+    }
+    ~SlabArray() {
+        for (size_t i = 0; i < size_; ++i) {
+            data()[i].~T();
+        }
+    }
+
+    SlabArray(const SlabArray&) = delete;
+    SlabArray& operator=(const SlabArray&) = delete;
+
+    T& operator[](size_t index) { return data()[index]; }
+    const T& operator[](size_t index) const { return data()[index]; }
+    size_t size() const { return size_; }
+    T* begin() { return data(); }
+    T* end() { return data() + size_; }
+    const T* begin() const { return data(); }
+    const T* end() const { return data() + size_; }
+    bool hugePages() const { return slab_.hugePages(); }
+
+private:
+    T* data() const { return reinterpret_cast<T*>(slab_.data()); }
+
+    MemorySlab slab_;
+    size_t size_;
+};
+
+// Bump allocator over one thread's slab for memory that lives for one message cycle:
+// request documents being built, DOMs parsed for a feed handler, JSON writer stacks.
+// A Cycle marks where one begins and gives back everything allocated inside it when it
+// ends, so steady-state messages reuse the same warm pages and never reach malloc.
+// Cycles nest: a request built while a frame is being handled releases only its own part.
+// Anything the slab cannot hold is served from the heap, counted as an overflow, and freed
+// when its cycle ends. Not thread-safe; each thread uses its own local() arena.
+class MessageArena {
+public:
+    struct Stats {
+        uint64_t allocations = 0;
+        uint64_t bytes = 0;
+        uint64_t cycles = 0;      // Cycles ended, outermost or nested
+        uint64_t overflows = 0;   // Allocations the slab could not hold
+        size_t high_water = 0;    // Most slab bytes in use at once
+    };
+
+    class Cycle {
+    public:
+        explicit Cycle(MessageArena& arena = MessageArena::local())
+            : arena_(arena), mark_(arena.used_), overflow_mark_(arena.overflow_.size()) {
+            arena.last_ = SIZE_MAX;  // An allocation from before the mark must not grow into this cycle
+        }
+        ~Cycle() { arena_.rewind(mark_, overflow_mark_); }
+
+        Cycle(const Cycle&) = delete;
+        Cycle& operator=(const Cycle&) = delete;
+
+    private:
+        MessageArena& arena_;
+        size_t mark_;
+        size_t overflow_mark_;
+    };
+
+    // The calling thread's arena, mapped with memoryConfig() on first use
+    static MessageArena& local();
+
+    explicit MessageArena(size_t capacity, const MemoryConfig& config = memoryConfig());
+
+    MessageArena(const MessageArena&) = delete;
+    MessageArena& operator=(const MessageArena&) = delete;
+
+    void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+    // Grows in place when ptr is the latest allocation of the current cycle and the slab has room.
+    // Otherwise the copy belongs to the current cycle, like any other allocation made in it.
+    void* reallocate(void* ptr, size_t old_bytes, size_t new_bytes);
+
+    size_t used() const { return used_; }
+    size_t capacity() const { return slab_.size(); }
+    bool hugePages() const { return slab_.hugePages(); }
+    const Stats& stats() const { return stats_; }
+
+private:
+    void rewind(size_t mark, size_t overflow_mark);
+    void* overflow(size_t bytes);
+
+    MemorySlab slab_;
+    size_t used_ = 0;
+    size_t last_ = SIZE_MAX;  // Offset of the latest slab allocation, for in-place growth
+    std::vector<std::unique_ptr<std::max_align_t[]>> overflow_;
+    Stats stats_;
+};
+
+// rapidjson Allocator concept over the calling thread's MessageArena. Used for parse and
+// writer stacks; nothing is freed until the enclosing cycle ends.
+class ArenaStackAllocator {
+public:
+    static const bool kNeedFree = false;
+
+    explicit ArenaStackAllocator(MessageArena& arena = MessageArena::local()) : arena_(&arena) {}
+
+    void* Malloc(size_t size) { return size ? arena_->allocate(size) : nullptr; }
+    void* Realloc(void* ptr, size_t old_size, size_t new_size) {
+        if (new_size == 0) {
+            return nullptr;
+        }
+        return ptr ? arena_->reallocate(ptr, old_size, new_size) : arena_->allocate(new_size);
+    }
+    static void Free(void*) {}
+
+private:
+    MessageArena* arena_;
+};
+
+// Values are plain rapidjson::Value; only the parse stack differs from rapidjson::Document
+using ArenaDocument = rapidjson::GenericDocument<rapidjson::UTF8<>, rapidjson::MemoryPoolAllocator<>, ArenaStackAllocator>;
+
+// A DOM whose value pool and parse stack sit in the thread's MessageArena, for documents that
+// do not outlive the current cycle: open a MessageArena::Cycle first. Documents larger than
+// pool_bytes spill into heap chunks.
+class ScratchDocument {
+public:
+    static constexpr size_t kDefaultPoolBytes = 16 << 10;
+
+    explicit ScratchDocument(size_t pool_bytes = kDefaultPoolBytes, MessageArena& arena = MessageArena::local());
+
+    ScratchDocument(const ScratchDocument&) = delete;
+    ScratchDocument& operator=(const ScratchDocument&) = delete;
+
+    ArenaDocument& operator*() { return document_; }
+    ArenaDocument* operator->() { return &document_; }
+    const ArenaDocument& operator*() const { return document_; }
+    const ArenaDocument* operator->() const { return &document_; }
+
+private:
+    ArenaStackAllocator stack_allocator_;
+    rapidjson::MemoryPoolAllocator<> pool_;
+    ArenaDocument document_;
+};
+
+// Recycled storage for one connection's Asio handlers: the read, write and wake-up operations
+// Beast and Asio allocate per call come from a few fixed blocks instead of the heap. A block is
+// claimed with an atomic flag, so it may be allocated on one thread and released on another.
+// Oversized or surplus requests fall back to operator new and are counted.
+class HandlerMemory {
+public:
+    static constexpr size_t kBlockSize = 1024;
+    static constexpr size_t kBlocks = 8;
+
+    HandlerMemory() = default;
+    HandlerMemory(const HandlerMemory&) = delete;
+    HandlerMemory& operator=(const HandlerMemory&) = delete;
+
+    void* allocate(size_t bytes);
+    void deallocate(void* ptr);
+    uint64_t heapFallbacks() const { return heap_fallbacks_.load(std::memory_order_relaxed); }
+
+private:
+    struct alignas(std::max_align_t) Block {
+        unsigned char bytes[kBlockSize];
+    };
+
+    Block blocks_[kBlocks];
+    std::atomic<bool> in_use_[kBlocks] = {};
+    std::atomic<uint64_t> heap_fallbacks_{0};
+};
+
+template <typename T>
+class HandlerAllocator {
+public:
+    using value_type = T;
+
+    explicit HandlerAllocator(HandlerMemory& memory) noexcept : memory_(&memory) {}
+    template <typename U>
+    HandlerAllocator(const HandlerAllocator<U>& other) noexcept : memory_(other.memory()) {}
+
+    T* allocate(size_t count) { return static_cast<T*>(memory_->allocate(count * sizeof(T))); }
+    void deallocate(T* ptr, size_t) { memory_->deallocate(ptr); }
+
+    HandlerMemory* memory() const noexcept { return memory_; }
+
+    template <typename U>
+    bool operator==(const HandlerAllocator<U>& other) const noexcept { return memory_ == other.memory(); }
+    template <typename U>
+    bool operator!=(const HandlerAllocator<U>& other) const noexcept { return memory_ != other.memory(); }
+
+private:
+    HandlerMemory* memory_;
+};
+
+// A completion handler that tells Asio to allocate its operation from a HandlerMemory
+template <typename Handler>
+class MemoryBoundHandler {
+public:
+    using allocator_type = HandlerAllocator<void>;
+
+    MemoryBoundHandler(HandlerMemory& memory, Handler handler) : memory_(&memory), handler_(std::move(handler)) {}
+
+    allocator_type get_allocator() const noexcept { return allocator_type(*memory_); }
+
+    template <typename... Args>
+    void operator()(Args&&... args) {
+        handler_(std::forward<Args>(args)...);
+    }
+
+private:
+    HandlerMemory* memory_;
+    Handler handler_;
+};
+
+template <typename Handler>
+MemoryBoundHandler<std::decay_t<Handler>> bindHandlerMemory(HandlerMemory& memory, Handler&& handler) {
+    return MemoryBoundHandler<std::decay_t<Handler>>(memory, std::forward<Handler>(handler));
+}
+
+#endif // MEMORY_ARENA_H
@@ -0,0 +1,1389 @@
+#include "mock_exchange.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <stdexcept>
+#include <boost/beast.hpp>
+#include <boost/beast/websocket/ssl.hpp>
+#include <openssl/evp.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+#include <rapidjson/document.h>
+#include "logger.h"
+#include "position_store.h"
+
+namespace ssl_alias = boost::asio::ssl;
+namespace ip_alias = boost::asio::ip;
+namespace beast_alias = boost::beast;
+
+namespace {
+
+constexpr auto kFeedTick = std::chrono::milliseconds(1);
+constexpr uint64_t kMaxDeltasPerTick = 4096;  // Beyond this the feed skips ahead instead of bursting
+constexpr size_t kMaxBacklog = 1024;          // Outbound frames queued before a session counts as slow
+constexpr double kMinHeartbeatSeconds = 10.0; // Deribit's lower bound for public/set_heartbeat
+constexpr uint64_t kMarkTicks = 100;           // Feed ticks between mark price moves
+constexpr double kTakerFee = 0.0005;           // Of notional, in the settlement currency
+
+// Deribit error codes the client may see
+constexpr int kErrorUnauthorized = 13009;
+constexpr int kErrorInvalidCredentials = 13004;
+constexpr int kErrorNotOpenOrder = 11044;
+constexpr int kErrorInvalidParams = -32602;
+constexpr int kErrorMethodNotFound = -32601;
+constexpr int kErrorParse = -32700;
+
+int64_t wallMillis() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+int64_t wallMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Self-signed P-256 certificate for CN=localhost, generated per run so nothing lives on disk
+void useSelfSignedCertificate(ssl_alias::context& ctx) {
+    std::unique_ptr<EVP_PKEY, decltype(&EVP_PKEY_free)> key(nullptr, EVP_PKEY_free);
+    {
+        std::unique_ptr<EVP_PKEY_CTX, decltype(&EVP_PKEY_CTX_free)> key_ctx(
+            EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr), EVP_PKEY_CTX_free);
+        EVP_PKEY* raw_key = nullptr;
+        if (!key_ctx || EVP_PKEY_keygen_init(key_ctx.get()) <= 0 ||
+            EVP_PKEY_CTX_set_ec_paramgen_curve_nid(key_ctx.get(), NID_X9_62_prime256v1) <= 0 ||
+            EVP_PKEY_keygen(key_ctx.get(), &raw_key) <= 0) {
+            throw std::runtime_error("Failed to generate mock exchange key");
+        }
+        key.reset(raw_key);
+    }
+
+    std::unique_ptr<X509, decltype(&X509_free)> cert(X509_new(), X509_free);
+    if (!cert) {
+        throw std::runtime_error("Failed to allocate mock exchange certificate");
+    }
+    X509_set_version(cert.get(), 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(cert.get()), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert.get()), -60);
+    X509_gmtime_adj(X509_getm_notAfter(cert.get()), 24 * 3600);
+    X509_set_pubkey(cert.get(), key.get());
+
+    X509_NAME* name = X509_get_subject_name(cert.get());
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char*>("localhost"), -1, -1, 0);
+    X509_set_issuer_name(cert.get(), name);
+
+    if (X509_sign(cert.get(), key.get(), EVP_sha256()) <= 0 ||
+        SSL_CTX_use_certificate(ctx.native_handle(), cert.get()) != 1 ||
+        SSL_CTX_use_PrivateKey(ctx.native_handle(), key.get()) != 1) {
+        throw std::runtime_error("Failed to install mock exchange certificate");
+    }
+}
+
+void beginReply(rapidjson::Writer<rapidjson::StringBuffer>& writer, const rapidjson::Value* id) {
+    writer.StartObject();
+    writer.Key("jsonrpc");
+    writer.String("2.0");
+    writer.Key("id");
+    if (id && id->IsInt64()) {
+        writer.Int64(id->GetInt64());
+    } else {
+        writer.Null();
+    }
+}
+
+void endReply(rapidjson::Writer<rapidjson::StringBuffer>& writer, int64_t us_in) {
+    // Deribit stamps every reply with its own receive/send times
+    int64_t us_out = wallMicros();
+    writer.Key("usIn");
+    writer.Int64(us_in);
+    writer.Key("usOut");
+    writer.Int64(us_out);
+    writer.Key("usDiff");
+    writer.Int64(us_out - us_in);
+    writer.Key("testnet");
+    writer.Bool(true);
+    writer.EndObject();
+}
+
+void writeError(rapidjson::Writer<rapidjson::StringBuffer>& writer, int code, const char* message) {
+    writer.Key("error");
+    writer.StartObject();
+    writer.Key("code");
+    writer.Int(code);
+    writer.Key("message");
+    writer.String(message);
+    writer.EndObject();
+}
+
+const rapidjson::Value* findMember(const rapidjson::Value& object, const char* name) {
+    if (!object.IsObject()) {
+        return nullptr;
+    }
+    auto it = object.FindMember(name);
+    return it != object.MemberEnd() ? &it->value : nullptr;
+}
+
+const char* stringParam(const rapidjson::Value& params, const char* name) {
+    const rapidjson::Value* value = findMember(params, name);
+    return value && value->IsString() ? value->GetString() : nullptr;
+}
+
+bool boolParam(const rapidjson::Value& params, const char* name) {
+    const rapidjson::Value* value = findMember(params, name);
+    return value && value->IsBool() && value->GetBool();
+}
+
+// Resting orders: open, or stop orders waiting for their trigger
+bool isLive(const std::string& state) {
+    return state == "open" || state == "untriggered";
+}
+
+bool numberParam(const rapidjson::Value& params, const char* name, double& out) {
+    const rapidjson::Value* value = findMember(params, name);
+    if (!value || !value->IsNumber()) {
+        return false;
+    }
+    out = value->GetDouble();
+    return true;
+}
+
+// book.<instrument>.<interval>; empty for any other channel
+std::string bookInstrument(const std::string& channel) {
+    if (channel.compare(0, 5, "book.") != 0) {
+        return {};
+    }
+    size_t last_dot = channel.rfind('.');
+    return last_dot > 5 ? channel.substr(5, last_dot - 5) : std::string();
+}
+
+// user.orders.<instrument or kind.currency>.raw; empty for any other channel
+std::string ordersScope(const std::string& channel) {
+    if (channel.compare(0, 12, "user.orders.") != 0) {
+        return {};
+    }
+    size_t last_dot = channel.rfind('.');
+    return last_dot > 12 ? channel.substr(12, last_dot - 12) : std::string();
+}
+
+// user.trades.<instrument or kind.currency>.raw; empty for any other channel
+std::string tradesScope(const std::string& channel) {
+    if (channel.compare(0, 12, "user.trades.") != 0) {
+        return {};
+    }
+    size_t last_dot = channel.rfind('.');
+    return last_dot > 12 ? channel.substr(12, last_dot - 12) : std::string();
+}
+
+// incremental_ticker.<instrument>; empty for any other channel
+std::string markInstrument(const std::string& channel) {
+    constexpr std::string_view kPrefix = "incremental_ticker.";
+    return channel.compare(0, kPrefix.size(), kPrefix) == 0 ? channel.substr(kPrefix.size()) : std::string();
+}
+
+// Instrument scopes match one instrument; kind.currency scopes match everything here
+bool scopeMatches(const std::string& scope, const std::string& instrument_name) {
+    return scope == instrument_name || scope.find('.') != std::string::npos;
+}
+
+double positionProfit(PnlModel model, double size, double entry, double exit) {
+    if (size == 0.0 || entry <= 0.0 || exit <= 0.0) {
+        return 0.0;
+    }
+    return model == PnlModel::Inverse ? size * (1.0 / entry - 1.0 / exit) : size * (exit - entry);
+}
+
+}  // namespace
+
+// One client connection. Reads, writes and the feed all run on the exchange's io thread.
+class MockExchange::Session : public std::enable_shared_from_this<MockExchange::Session> {
+public:
+    Session(MockExchange& exchange, ip_alias::tcp::socket socket)
+        : exchange_(exchange), ws_(std::move(socket), exchange.ssl_ctx_), heartbeat_timer_(exchange.io_context_) {}
+
+    void start() {
+        ws_.next_layer().async_handshake(ssl_alias::stream_base::server,
+            [self = shared_from_this()](beast_alias::error_code ec) {
+                if (ec) {
+                    LOG_WARN("Mock exchange TLS handshake failed: {}", ec.message());
+                    return;
+                }
+                self->ws_.text(true);
+                self->ws_.async_accept([self](beast_alias::error_code accept_ec) {
+                    if (accept_ec) {
+                        LOG_WARN("Mock exchange WebSocket accept failed: {}", accept_ec.message());
+                        return;
+                    }
+                    self->doRead();
+                });
+            });
+    }
+
+    void send(std::string frame) {
+        if (stalled) {
+            return;
+        }
+        outbox_.push_back(std::move(frame));
+        if (!writing_) {
+            doWrite();
+        }
+    }
+
+    void close() {
+        heartbeat_timer_.cancel();
+        beast_alias::error_code ec;
+        beast_alias::get_lowest_layer(ws_).close(ec);
+    }
+
+    // Sends a test_request every interval; an unanswered one ends the session at the next
+    void startHeartbeat(std::chrono::seconds interval) {
+        heartbeat_interval_ = interval;
+        awaiting_test_ = false;
+        scheduleHeartbeat();
+    }
+
+    void stopHeartbeat() { heartbeat_timer_.cancel(); }
+    void onTest() { awaiting_test_ = false; }
+
+    bool backlogged() const { return outbox_.size() >= kMaxBacklog; }
+
+    std::chrono::steady_clock::time_point authenticated_until{};  // Expiry of the token that authorized it
+    bool stalled = false;  // Requests are read and dropped, nothing is sent
+
+private:
+    void doRead() {
+        buffer_.clear();
+        ws_.async_read(buffer_, [self = shared_from_this()](beast_alias::error_code ec, size_t) {
+            if (ec) {
+                self->heartbeat_timer_.cancel();
+                return;  // Client went away or the exchange is stopping
+            }
+            if (!self->stalled) {
+                auto data = self->buffer_.data();
+                self->exchange_.handleRequest(self, std::string_view(static_cast<const char*>(data.data()), data.size()));
+            }
+            self->doRead();
+        });
+    }
+
+    void doWrite() {
+        writing_ = true;
+        ws_.async_write(boost::asio::buffer(outbox_.front()),
+            [self = shared_from_this()](beast_alias::error_code ec, size_t) {
+                self->outbox_.pop_front();
+                if (ec || self->outbox_.empty()) {
+                    self->writing_ = false;
+                    if (ec) {
+                        self->outbox_.clear();
+                    }
+                    return;
+                }
+                self->doWrite();
+            });
+    }
+
+    void scheduleHeartbeat() {
+        heartbeat_timer_.expires_after(heartbeat_interval_);
+        heartbeat_timer_.async_wait([self = shared_from_this()](beast_alias::error_code ec) {
+            if (ec) {
+                return;  // Disabled, replaced or the session closed
+            }
+            if (self->awaiting_test_ && !self->stalled) {
+                LOG_WARN("Mock exchange dropping a session that did not answer its heartbeat");
+                self->close();
+                return;
+            }
+            self->awaiting_test_ = true;
+            self->send(R"({"jsonrpc":"2.0","method":"heartbeat","params":{"type":"test_request"}})");
+            self->scheduleHeartbeat();
+        });
+    }
+
+    MockExchange& exchange_;
+    beast_alias::websocket::stream<ssl_alias::stream<ip_alias::tcp::socket>> ws_;
+    beast_alias::flat_buffer buffer_;
+    std::deque<std::string> outbox_;
+    bool writing_ = false;
+    boost::asio::steady_timer heartbeat_timer_;
+    std::chrono::seconds heartbeat_interval_{0};
+    bool awaiting_test_ = false;
+};
+
+MockExchange::MockExchange(MockExchangeConfig config)
+    : config_(std::move(config)),
+      ssl_ctx_(ssl_alias::context::tlsv13_server),
+      acceptor_(io_context_),
+      feed_timer_(io_context_) {
+    if (config_.book_depth == 0 || config_.tick_size <= 0.0) {
+        throw std::invalid_argument("Mock exchange needs a positive book depth and tick size");
+    }
+    mark_price_ = config_.mid_price;
+}
+
+MockExchange::~MockExchange() {
+    stop();
+}
+
+void MockExchange::start() {
+    if (running_.exchange(true)) {
+        throw std::logic_error("MockExchange already running");
+    }
+
+    try {
+        useSelfSignedCertificate(ssl_ctx_);
+
+        ip_alias::tcp::endpoint endpoint(ip_alias::make_address(config_.address), config_.port);
+        acceptor_.open(endpoint.protocol());
+        acceptor_.set_option(ip_alias::tcp::acceptor::reuse_address(true));
+        acceptor_.bind(endpoint);
+        acceptor_.listen();
+        bound_port_.store(acceptor_.local_endpoint().port(), std::memory_order_release);
+    } catch (const std::exception& ex) {
+        LOG_ERROR("Mock exchange failed to start: {}", ex.what());
+        running_.store(false);
+        throw;
+    }
+
+    doAccept();
+    feed_start_ = std::chrono::steady_clock::now();
+    if (config_.feed_rate > 0.0) {
+        scheduleFeed();
+    }
+    io_thread_ = std::thread([this] { io_context_.run(); });
+}
+
+void MockExchange::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+
+    // Closing the acceptor and every socket cancels all pending work, so run() returns
+    boost::asio::post(io_context_, [this] {
+        beast_alias::error_code ec;
+        acceptor_.close(ec);
+        feed_timer_.cancel();
+        for (const auto& weak : sessions_) {
+            if (auto session = weak.lock()) {
+                session->close();
+            }
+        }
+        sessions_.clear();
+    });
+    if (io_thread_.joinable()) {
+        io_thread_.join();
+    }
+}
+
+unsigned short MockExchange::port() const {
+    return bound_port_.load(std::memory_order_acquire);
+}
+
+void MockExchange::dropConnections() {
+    boost::asio::post(io_context_, [this] {
+        for (const auto& weak : sessions_) {
+            if (auto session = weak.lock()) {
+                session->close();
+            }
+        }
+    });
+}
+
+void MockExchange::stallConnections() {
+    boost::asio::post(io_context_, [this] {
+        for (const auto& weak : sessions_) {
+            if (auto session = weak.lock()) {
+                session->stalled = true;
+            }
+        }
+    });
+}
+
+void MockExchange::shiftPosition(const std::string& instrument_name, double size_delta, double price) {
+    boost::asio::post(io_context_, [this, instrument_name, size_delta, price] {
+        Position& position = positions_[instrument_name];
+        double size = position.size + size_delta;
+        if (size == 0.0) {
+            position.average_price = 0.0;
+        } else if (position.size == 0.0 || (position.size > 0.0) != (size > 0.0)) {
+            position.average_price = price;
+        }
+        position.size = size;
+    });
+}
+
+void MockExchange::doAccept() {
+    acceptor_.async_accept([this](beast_alias::error_code ec, ip_alias::tcp::socket socket) {
+        if (ec) {
+            return;  // Acceptor closed
+        }
+
+        socket.set_option(ip_alias::tcp::no_delay(true));
+        auto session = std::make_shared<Session>(*this, std::move(socket));
+        sessions_.erase(std::remove_if(sessions_.begin(), sessions_.end(),
+                                       [](const std::weak_ptr<Session>& weak) { return weak.expired(); }),
+                        sessions_.end());
+        sessions_.push_back(session);
+        session->start();
+        doAccept();
+    });
+}
+
+uint64_t MockExchange::feedTarget() const {
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - feed_start_;
+    return static_cast<uint64_t>(elapsed.count() * config_.feed_rate);
+}
+
+void MockExchange::scheduleFeed() {
+    feed_timer_.expires_after(kFeedTick);
+    feed_timer_.async_wait([this](beast_alias::error_code ec) {
+        if (ec || !running_.load(std::memory_order_acquire)) {
+            return;
+        }
+        onFeedTick();
+        scheduleFeed();
+    });
+}
+
+void MockExchange::onFeedTick() {
+    uint64_t target = feedTarget();
+    if (++mark_ticks_ % kMarkTicks == 0) {
+        moveMark();
+    }
+
+    for (auto& entry : books_) {
+        Book& book = entry.second;
+        book.subscribers.erase(std::remove_if(book.subscribers.begin(), book.subscribers.end(),
+                                              [](const Subscriber& subscriber) { return subscriber.session.expired(); }),
+                               book.subscribers.end());
+
+        if (book.subscribers.empty()) {
+            book.feed_due = target;
+            continue;
+        }
+
+        // Keep pace with the configured rate, but never queue unbounded work behind a slow reader
+        uint64_t budget = kMaxDeltasPerTick;
+        while (book.feed_due < target) {
+            bool slow = budget == 0 || std::any_of(book.subscribers.begin(), book.subscribers.end(),
+                [](const Subscriber& subscriber) {
+                    auto session = subscriber.session.lock();
+                    return session && session->backlogged();
+                });
+            if (slow) {
+                feed_messages_skipped_.fetch_add(target - book.feed_due, std::memory_order_relaxed);
+                book.feed_due = target;
+                break;
+            }
+
+            BookChange change = mutateBook(book);
+            for (const Subscriber& subscriber : book.subscribers) {
+                if (auto session = subscriber.session.lock()) {
+                    session->send(bookNotification(book, subscriber.channel, &change));
+                    feed_messages_sent_.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+            ++book.feed_due;
+            --budget;
+        }
+    }
+}
+
+void MockExchange::handleRequest(const std::shared_ptr<Session>& session, std::string_view frame) {
+    int64_t us_in = wallMicros();
+    requests_served_.fetch_add(1, std::memory_order_relaxed);
+
+    rapidjson::StringBuffer buffer;
+    JsonWriter writer(buffer);
+    std::vector<std::string> snapshots;
+
+    rapidjson::Document request;
+    request.Parse(frame.data(), frame.size());
+    if (request.HasParseError() || !request.IsObject()) {
+        beginReply(writer, nullptr);
+        writeError(writer, kErrorParse, "parse_error");
+        endReply(writer, us_in);
+        session->send(buffer.GetString());
+        return;
+    }
+
+    const rapidjson::Value* id = findMember(request, "id");
+    static const rapidjson::Value kEmptyParams(rapidjson::kObjectType);
+    const rapidjson::Value* params = findMember(request, "params");
+    if (!params || !params->IsObject()) {
+        params = &kEmptyParams;
+    }
+    const char* method_name = stringParam(request, "method");
+    std::string_view method = method_name ? method_name : "";
+
+    beginReply(writer, id);
+    if (method.compare(0, 8, "private/") == 0 && !isAuthorized(*session, *params)) {
+        writeError(writer, kErrorUnauthorized, "unauthorized");
+    } else if (method == "public/auth") {
+        handleAuth(*session, writer, *params);
+    } else if (method == "private/buy") {
+        handlePlaceOrder(writer, "buy", *params);
+    } else if (method == "private/sell") {
+        handlePlaceOrder(writer, "sell", *params);
+    } else if (method == "private/cancel") {
+        handleCancel(writer, *params);
+    } else if (method == "private/edit") {
+        handleEdit(writer, *params);
+    } else if (method == "private/cancel_all" || method == "private/cancel_all_by_instrument" ||
+               method == "private/cancel_all_by_currency" || method == "private/cancel_by_label") {
+        handleCancelAll(writer, method, *params);
+    } else if (method == "public/get_order_book") {
+        handleOrderBook(writer, *params);
+    } else if (method == "public/get_instruments") {
+        handleInstruments(writer, *params);
+    } else if (method == "private/get_positions") {
+        handlePositions(writer, *params);
+    } else if (method == "public/set_heartbeat") {
+        handleSetHeartbeat(*session, writer, *params);
+    } else if (method == "public/disable_heartbeat") {
+        session->stopHeartbeat();
+        writer.Key("result");
+        writer.String("ok");
+    } else if (method == "public/test") {
+        session->onTest();
+        writer.Key("result");
+        writer.StartObject();
+        writer.Key("version");
+        writer.String("1.2.26");
+        writer.EndObject();
+    } else if (method == "public/subscribe" || method == "private/subscribe") {
+        handleSubscribe(session, writer, *params, true, snapshots);
+    } else if (method == "public/unsubscribe" || method == "private/unsubscribe") {
+        handleSubscribe(session, writer, *params, false, snapshots);
+    } else {
+        writeError(writer, kErrorMethodNotFound, "Method not found");
+    }
+    endReply(writer, us_in);
+
+    session->send(buffer.GetString());
+    for (std::string& snapshot : snapshots) {
+        session->send(std::move(snapshot));
+    }
+    publishOrderUpdates();
+    publishTrades();
+}
+
+void MockExchange::publishOrderUpdates() {
+    order_subscribers_.erase(std::remove_if(order_subscribers_.begin(), order_subscribers_.end(),
+                                            [](const Subscriber& subscriber) { return subscriber.session.expired(); }),
+                             order_subscribers_.end());
+
+    for (const std::string& order_id : changed_orders_) {
+        auto it = orders_.find(order_id);
+        if (it == orders_.end()) {
+            continue;
+        }
+        const Order& order = it->second;
+        for (const Subscriber& subscriber : order_subscribers_) {
+            if (!scopeMatches(ordersScope(subscriber.channel), order.instrument_name)) {
+                continue;
+            }
+            if (auto session = subscriber.session.lock()) {
+                session->send(orderNotification(subscriber.channel, order));
+            }
+        }
+        if (!isLive(order.state)) {
+            orders_.erase(it);  // Closed orders only answer not_open_order, as when unknown
+        }
+    }
+    changed_orders_.clear();
+}
+
+void MockExchange::publishTrades() {
+    trade_subscribers_.erase(std::remove_if(trade_subscribers_.begin(), trade_subscribers_.end(),
+                                            [](const Subscriber& subscriber) { return subscriber.session.expired(); }),
+                             trade_subscribers_.end());
+
+    for (const Trade& trade : new_trades_) {
+        for (const Subscriber& subscriber : trade_subscribers_) {
+            if (!scopeMatches(tradesScope(subscriber.channel), trade.instrument_name)) {
+                continue;
+            }
+            if (auto session = subscriber.session.lock()) {
+                session->send(tradesNotification(subscriber.channel, trade));
+            }
+        }
+    }
+    new_trades_.clear();
+}
+
+void MockExchange::recordFill(const Order& order) {
+    PnlModel model = pnlModel(order.instrument_name);
+    Position& position = positions_[order.instrument_name];
+    bool buy = order.direction == "buy";
+    double amount = order.filled_amount;
+    double price = order.average_price;
+
+    if (position.size == 0.0 || (position.size > 0.0) == buy) {
+        double open = std::abs(position.size);
+        position.average_price = open == 0.0 ? price
+                               : model == PnlModel::Inverse ? (open + amount) / (open / position.average_price + amount / price)
+                                                            : (open * position.average_price + amount * price) / (open + amount);
+        position.size += buy ? amount : -amount;
+    } else {
+        double closed = std::min(amount, std::abs(position.size));
+        double before = position.size;
+        position.realized_profit_loss +=
+            positionProfit(model, before > 0.0 ? closed : -closed, position.average_price, price);
+        position.size += buy ? amount : -amount;
+        if (position.size == 0.0) {
+            position.average_price = 0.0;
+        } else if ((position.size > 0.0) != (before > 0.0)) {
+            position.average_price = price;
+        }
+    }
+
+    Trade trade;
+    trade.trade_id = "MOCK-T-" + std::to_string(next_trade_id_++);
+    trade.trade_seq = ++position.trade_seq;
+    trade.instrument_name = order.instrument_name;
+    trade.order_id = order.order_id;
+    trade.direction = order.direction;
+    trade.amount = amount;
+    trade.price = price;
+    trade.fee = kTakerFee * (model == PnlModel::Inverse ? amount / price : amount * price);
+    new_trades_.push_back(std::move(trade));
+}
+
+void MockExchange::moveMark() {
+    // A step of at most one tick, kept inside the touch
+    uint32_t random = nextRandom();
+    double step = config_.tick_size * static_cast<double>(static_cast<int>(random % 3) - 1);
+    double mark = std::min(std::max(mark_price_ + step, bidPrice(0)), askPrice(0));
+    if (mark == mark_price_) {
+        return;
+    }
+    mark_price_ = mark;
+
+    mark_subscribers_.erase(std::remove_if(mark_subscribers_.begin(), mark_subscribers_.end(),
+                                           [](const Subscriber& subscriber) { return subscriber.session.expired(); }),
+                            mark_subscribers_.end());
+    for (const Subscriber& subscriber : mark_subscribers_) {
+        if (auto session = subscriber.session.lock()) {
+            session->send(markNotification(subscriber.channel, markInstrument(subscriber.channel), false));
+        }
+    }
+}
+
+bool MockExchange::isAuthorized(const Session& session, const rapidjson::Value& params) const {
+    auto now = std::chrono::steady_clock::now();
+    if (session.authenticated_until > now) {
+        return true;
+    }
+    const char* token = stringParam(params, "access_token");
+    auto it = token ? tokens_.find(token) : tokens_.end();
+    return it != tokens_.end() && it->second > now;
+}
+
+void MockExchange::handleAuth(Session& session, JsonWriter& writer, const rapidjson::Value& params) {
+    // Any credentials are accepted; only the shape of the request is checked. Refresh tokens work once.
+    const char* grant_type = stringParam(params, "grant_type");
+    std::string_view grant = grant_type ? grant_type : "";
+    if (grant == "client_credentials") {
+        if (!stringParam(params, "client_id") || !stringParam(params, "client_secret")) {
+            writeError(writer, kErrorInvalidParams, "Invalid params");
+            return;
+        }
+    } else if (grant == "refresh_token") {
+        const char* refresh_token = stringParam(params, "refresh_token");
+        if (!refresh_token || refresh_tokens_.erase(refresh_token) == 0) {
+            writeError(writer, kErrorInvalidCredentials, "invalid_credentials");
+            return;
+        }
+    } else if (grant.empty()) {
+        writeError(writer, kErrorInvalidParams, "Invalid params");
+        return;
+    }
+
+    uint64_t serial = next_token_++;
+    std::string access_token = "mock-access-" + std::to_string(serial);
+    std::string refresh_token = "mock-refresh-" + std::to_string(serial);
+    auto expires = std::chrono::steady_clock::now() + std::chrono::seconds(config_.token_lifetime_seconds);
+    tokens_[access_token] = expires;
+    refresh_tokens_.insert(refresh_token);
+    session.authenticated_until = expires;
+
+    writer.Key("result");
+    writer.StartObject();
+    writer.Key("access_token");
+    writer.String(access_token.c_str());
+    writer.Key("expires_in");
+    writer.Int(config_.token_lifetime_seconds);
+    writer.Key("refresh_token");
+    writer.String(refresh_token.c_str());
+    writer.Key("scope");
+    writer.String("connection mainaccount trade:read_write");
+    writer.Key("token_type");
+    writer.String("bearer");
+    writer.EndObject();
+}
+
+void MockExchange::handlePlaceOrder(JsonWriter& writer, const char* direction, const rapidjson::Value& params) {
+    const char* instrument_name = stringParam(params, "instrument_name");
+    double amount = 0.0;
+    if (!instrument_name || !numberParam(params, "amount", amount) || amount <= 0.0) {
+        writeError(writer, kErrorInvalidParams, "Invalid params");
+        return;
+    }
+
+    Order order;
+    const char* type = stringParam(params, "type");
+    const char* time_in_force = stringParam(params, "time_in_force");
+    order.order_type = type ? type : "limit";
+    order.time_in_force = time_in_force ? time_in_force : "good_til_cancelled";
+    bool stop = order.order_type == "stop_limit" || order.order_type == "stop_market";
+    if ((order.order_type != "limit" && order.order_type != "market" && !stop) ||
+        (order.time_in_force != "good_til_cancelled" && order.time_in_force != "good_til_day" &&
+         order.time_in_force != "fill_or_kill" && order.time_in_force != "immediate_or_cancel") ||
+        (stop && !numberParam(params, "trigger_price", order.trigger_price))) {
+        writeError(writer, kErrorInvalidParams, "Invalid params");
+        return;
+    }
+
+    order.order_id = "MOCK-" + std::to_string(next_order_id_++);
+    order.instrument_name = instrument_name;
+    order.direction = direction;
+    order.amount = amount;
+    order.post_only = boolParam(params, "post_only") && order.order_type == "limit";
+    order.reduce_only = boolParam(params, "reduce_only");
+    if (!numberParam(params, "price", order.price)) {
+        order.price = config_.mid_price;
+    }
+    if (const char* label = stringParam(params, "label")) {
+        order.label = label;
+    }
+    order.creation_timestamp = wallMillis();
+    order.last_update_timestamp = order.creation_timestamp;
+
+    // Fills happen against the touch of the synthetic grid, all at once
+    bool buy = order.direction == "buy";
+    double touch = buy ? askPrice(0) : bidPrice(0);
+    bool crossing = order.order_type == "market" || (buy ? order.price >= touch : order.price <= touch);
+    if (stop) {
+        order.state = "untriggered";  // Triggers never fire here
+    } else if (crossing && order.post_only) {
+        order.price = buy ? bidPrice(0) : askPrice(0);  // Deribit reprices post-only orders to the passive side
+        order.state = "open";
+    } else if (crossing) {
+        order.state = "filled";
+        order.filled_amount = amount;
+        order.average_price = touch;
+        order.price = touch;
+    } else {
+        bool immediate = order.time_in_force == "immediate_or_cancel" || order.time_in_force == "fill_or_kill";
+        order.state = immediate ? "cancelled" : "open";
+    }
+
+    if (order.state == "filled") {
+        recordFill(order);
+    }
+
+    writer.Key("result");
+    writer.StartObject();
+    writer.Key("order");
+    writeOrder(writer, order);
+    writer.Key("trades");
+    writer.StartArray();
+    for (const Trade& trade : new_trades_) {
+        if (trade.order_id == order.order_id) {
+            writeTrade(writer, trade);
+        }
+    }
+    writer.EndArray();
+    writer.EndObject();
+
+    changed_orders_.push_back(order.order_id);
+    orders_.emplace(order.order_id, std::move(order));
+}
+
+void MockExchange::handleCancel(JsonWriter& writer, const rapidjson::Value& params) {
+    const char* order_id = stringParam(params, "order_id");
+    auto it = order_id ? orders_.find(order_id) : orders_.end();
+    if (it == orders_.end() || !isLive(it->second.state)) {
+        writeError(writer, kErrorNotOpenOrder, "not_open_order");
+        return;
+    }
+
+    Order& order = it->second;
+    order.state = "cancelled";
+    order.last_update_timestamp = wallMillis();
+    changed_orders_.push_back(order.order_id);
+
+    writer.Key("result");
+    writeOrder(writer, order);
+}
+
+void MockExchange::handleCancelAll(JsonWriter& writer, std::string_view method, const rapidjson::Value& params) {
+    // The filter parameter each variant requires; plain cancel_all takes none
+    const char* filter_key = method == "private/cancel_all_by_instrument" ? "instrument_name"
+                           : method == "private/cancel_all_by_currency"   ? "currency"
+                           : method == "private/cancel_by_label"          ? "label"
+                                                                          : nullptr;
+    const char* filter = filter_key ? stringParam(params, filter_key) : nullptr;
+    if (filter_key && !filter) {
+        writeError(writer, kErrorInvalidParams, "Invalid params");
+        return;
+    }
+
+    std::string_view key = filter_key ? filter_key : "";
+    auto matches = [&](const Order& order) {
+        if (key == "instrument_name") {
+            return order.instrument_name == filter;
+        }
+        if (key == "currency") {
+            // BTC covers BTC-PERPETUAL, BTC-27DEC24, ...
+            std::string prefix = std::string(filter) + "-";
+            return order.instrument_name.compare(0, prefix.size(), prefix) == 0;
+        }
+        if (key == "label") {
+            return order.label == filter;
+        }
+        return true;
+    };
+
+    int64_t cancelled = 0;
+    int64_t now = wallMillis();
+    for (auto& [order_id, order] : orders_) {
+        if (!isLive(order.state) || !matches(order)) {
+            continue;
+        }
+        order.state = "cancelled";
+        order.last_update_timestamp = now;
+        changed_orders_.push_back(order_id);
+        ++cancelled;
+    }
+
+    writer.Key("result");
+    writer.Int64(cancelled);
+}
+
+void MockExchange::handleEdit(JsonWriter& writer, const rapidjson::Value& params) {
+    const char* order_id = stringParam(params, "order_id");
+    auto it = order_id ? orders_.find(order_id) : orders_.end();
+    if (it == orders_.end() || !isLive(it->second.state)) {
+        writeError(writer, kErrorNotOpenOrder, "not_open_order");
+        return;
+    }
+
+    double amount = 0.0;
+    double price = 0.0;
+    if (!numberParam(params, "amount", amount) || amount <= 0.0 || !numberParam(params, "price", price)) {
+        writeError(writer, kErrorInvalidParams, "Invalid params");
+        return;
+    }
+
+    Order& order = it->second;
+    order.amount = amount;
+    order.price = price;
+    order.last_update_timestamp = wallMillis();
+    changed_orders_.push_back(order.order_id);
+
+    writer.Key("result");
+    writer.StartObject();
+    writer.Key("order");
+    writeOrder(writer, order);
+    writer.Key("trades");
+    writer.StartArray();
+    writer.EndArray();
+    writer.EndObject();
+}
+
+void MockExchange::handleOrderBook(JsonWriter& writer, const rapidjson::Value& params) {
+    const char* instrument_name = stringParam(params, "instrument_name");
+    if (!instrument_name) {
+        writeError(writer, kErrorInvalidParams, "Invalid params");
+        return;
+    }
+    const Book& book = findOrCreateBook(instrument_name);
+
+    auto writeSide = [&](const std::vector<double>& amounts, bool bid) {
+        writer.StartArray();
+        for (size_t level = 0; level < amounts.size(); ++level) {
+            if (amounts[level] > 0.0) {
+                writer.StartArray();
+                writer.Double(bid ? bidPrice(level) : askPrice(level));
+                writer.Double(amounts[level]);
+                writer.EndArray();
+            }
+        }
+        writer.EndArray();
+    };
+
+    writer.Key("result");
+    writer.StartObject();
+    writer.Key("timestamp");
+    writer.Int64(wallMillis());
+    writer.Key("state");
+    writer.String("open");
+    writer.Key("instrument_name");
+    writer.String(book.instrument_name.c_str());
+    writer.Key("change_id");
+    writer.Uint64(book.change_id);
+    writer.Key("mark_price");
+    writer.Double(config_.mid_price);
+    writer.Key("bids");
+    writeSide(book.bid_amounts, true);
+    writer.Key("asks");
+    writeSide(book.ask_amounts, false);
+    writer.EndObject();
+}
+
+void MockExchange::handleInstruments(JsonWriter& writer, const rapidjson::Value& params) {
+    const char* currency = stringParam(params, "currency");
+    if (!currency) {
+        writeError(writer, kErrorInvalidParams, "Invalid params");
+        return;
+    }
+    const char* kind = stringParam(params, "kind");
+    bool expired = boolParam(params, "expired");
+
+    // A fixed listing per currency: the perpetual, two quarterlies and one call
+    struct Listing {
+        std::string suffix;
+        const char* kind;
+        double tick_size;
+        double contract_size;
+        double min_trade_amount;
+    };
+    const Listing listings[] = {
+        {"-PERPETUAL", "future", config_.tick_size, 10.0, 10.0},
+        {"-27MAR26", "future", config_.tick_size * 5, 10.0, 10.0},
+        {"-26JUN26", "future", config_.tick_size * 5, 10.0, 10.0},
+        {"-27MAR26-50000-C", "option", 0.0005, 1.0, 0.1},
+    };
+
+    writer.Key("result");
+    writer.StartArray();
+    for (const Listing& listing : listings) {
+        if (expired || (kind && std::strcmp(kind, listing.kind) != 0)) {
+            continue;
+        }
+        std::string name = currency + listing.suffix;
+        writer.StartObject();
+        writer.Key("instrument_name");
+        writer.String(name.c_str());
+        writer.Key("kind");
+        writer.String(listing.kind);
+        writer.Key("base_currency");
+        writer.String(currency);
+        writer.Key("quote_currency");
+        writer.String("USD");
+        writer.Key("tick_size");
+        writer.Double(listing.tick_size);
+        writer.Key("contract_size");
+        writer.Double(listing.contract_size);
+        writer.Key("min_trade_amount");
+        writer.Double(listing.min_trade_amount);
+        writer.Key("is_active");
+        writer.Bool(true);
+        writer.EndObject();
+    }
+    writer.EndArray();
+}
+
+void MockExchange::handlePositions(JsonWriter& writer, const rapidjson::Value& params) {
+    // Every instrument the client has touched, flat unless something filled
+    const char* currency = stringParam(params, "currency");
+
+    std::vector<std::string> instruments;
+    for (const auto& entry : books_) {
+        instruments.push_back(entry.first);
+    }
+    for (const auto& entry : orders_) {
+        instruments.push_back(entry.second.instrument_name);
+    }
+    for (const auto& entry : positions_) {
+        instruments.push_back(entry.first);
+    }
+    std::sort(instruments.begin(), instruments.end());
+    instruments.erase(std::unique(instruments.begin(), instruments.end()), instruments.end());
+
+    writer.Key("result");
+    writer.StartArray();
+    for (const std::string& instrument : instruments) {
+        if (currency && settlementCurrency(instrument) != currency) {
+            continue;
+        }
+        auto it = positions_.find(instrument);
+        Position position = it != positions_.end() ? it->second : Position{};
+        double floating = positionProfit(pnlModel(instrument), position.size, position.average_price, mark_price_);
+        bool option = std::count(instrument.begin(), instrument.end(), '-') == 3;
+
+        writer.StartObject();
+        writer.Key("instrument_name");
+        writer.String(instrument.c_str());
+        writer.Key("kind");
+        writer.String(option ? "option" : "future");
+        writer.Key("direction");
+        writer.String(position.size > 0.0 ? "buy" : position.size < 0.0 ? "sell" : "zero");
+        writer.Key("size");
+        writer.Double(position.size);
+        writer.Key("average_price");
+        writer.Double(position.average_price);
+        writer.Key("mark_price");
+        writer.Double(mark_price_);
+        writer.Key("index_price");
+        writer.Double(config_.mid_price);
+        writer.Key("floating_profit_loss");
+        writer.Double(floating);
+        writer.Key("realized_profit_loss");
+        writer.Double(position.realized_profit_loss);
+        writer.Key("total_profit_loss");
+        writer.Double(floating + position.realized_profit_loss);
+        writer.EndObject();
+    }
+    writer.EndArray();
+}
+
+void MockExchange::handleSetHeartbeat(Session& session, JsonWriter& writer, const rapidjson::Value& params) {
+    double interval = 0.0;
+    if (!numberParam(params, "interval", interval) || interval < kMinHeartbeatSeconds) {
+        writeError(writer, kErrorInvalidParams, "Invalid params");
+        return;
+    }
+
+    session.startHeartbeat(std::chrono::seconds(static_cast<int64_t>(interval)));
+    writer.Key("result");
+    writer.String("ok");
+}
+
+void MockExchange::handleSubscribe(const std::shared_ptr<Session>& session, JsonWriter& writer,
+                                   const rapidjson::Value& params, bool subscribe, std::vector<std::string>& snapshots) {
+    const rapidjson::Value* channels = findMember(params, "channels");
+    if (!channels || !channels->IsArray()) {
+        writeError(writer, kErrorInvalidParams, "Invalid params");
+        return;
+    }
+
+    writer.Key("result");
+    writer.StartArray();
+    for (const auto& value : channels->GetArray()) {
+        if (!value.IsString()) {
+            continue;
+        }
+        std::string channel = value.GetString();
+        writer.String(channel.c_str());
+
+        // Order, trade and mark channels: a flat subscriber list each
+        std::string mark_instrument = markInstrument(channel);
+        std::vector<Subscriber>* subscribers = !ordersScope(channel).empty() ? &order_subscribers_
+                                             : !tradesScope(channel).empty() ? &trade_subscribers_
+                                             : !mark_instrument.empty()      ? &mark_subscribers_
+                                                                             : nullptr;
+        if (subscribers) {
+            auto existing = std::find_if(subscribers->begin(), subscribers->end(),
+                [&](const Subscriber& subscriber) {
+                    return subscriber.session.lock() == session && subscriber.channel == channel;
+                });
+            if (!subscribe && existing != subscribers->end()) {
+                subscribers->erase(existing);
+            } else if (subscribe && existing == subscribers->end()) {
+                subscribers->push_back(Subscriber{session, channel});
+            }
+            if (subscribe && !mark_instrument.empty()) {
+                snapshots.push_back(markNotification(channel, mark_instrument, true));
+            }
+            continue;
+        }
+
+        std::string instrument = bookInstrument(channel);
+        if (instrument.empty()) {
+            continue;  // Accepted, but carries no data
+        }
+
+        Book& book = findOrCreateBook(instrument);
+        auto existing = std::find_if(book.subscribers.begin(), book.subscribers.end(),
+            [&](const Subscriber& subscriber) {
+                return subscriber.session.lock() == session && subscriber.channel == channel;
+            });
+
+        if (!subscribe) {
+            if (existing != book.subscribers.end()) {
+                book.subscribers.erase(existing);
+            }
+            continue;
+        }
+        if (existing == book.subscribers.end()) {
+            if (book.subscribers.empty()) {
+                book.feed_due = feedTarget();  // Start pacing now rather than owing a backlog
+            }
+            book.subscribers.push_back(Subscriber{session, channel});
+        }
+        snapshots.push_back(bookNotification(book, channel, nullptr));
+    }
+    writer.EndArray();
+}
+
+MockExchange::Book& MockExchange::findOrCreateBook(const std::string& instrument_name) {
+    auto it = books_.find(instrument_name);
+    if (it != books_.end()) {
+        return it->second;
+    }
+
+    Book& book = books_[instrument_name];
+    book.instrument_name = instrument_name;
+    book.bid_amounts.resize(config_.book_depth);
+    book.ask_amounts.resize(config_.book_depth);
+    for (size_t level = 0; level < config_.book_depth; ++level) {
+        book.bid_amounts[level] = randomAmount();
+        book.ask_amounts[level] = randomAmount();
+    }
+    book.feed_due = feedTarget();
+    return book;
+}
+
+void MockExchange::writeOrder(JsonWriter& writer, const Order& order) const {
+    writer.StartObject();
+    writer.Key("order_id");
+    writer.String(order.order_id.c_str());
+    writer.Key("order_state");
+    writer.String(order.state.c_str());
+    writer.Key("order_type");
+    writer.String(order.order_type.c_str());
+    writer.Key("time_in_force");
+    writer.String(order.time_in_force.c_str());
+    writer.Key("post_only");
+    writer.Bool(order.post_only);
+    writer.Key("reduce_only");
+    writer.Bool(order.reduce_only);
+    writer.Key("instrument_name");
+    writer.String(order.instrument_name.c_str());
+    writer.Key("direction");
+    writer.String(order.direction.c_str());
+    writer.Key("label");
+    writer.String(order.label.c_str());
+    writer.Key("amount");
+    writer.Double(order.amount);
+    writer.Key("filled_amount");
+    writer.Double(order.filled_amount);
+    writer.Key("price");
+    writer.Double(order.price);
+    writer.Key("average_price");
+    writer.Double(order.average_price);
+    if (order.trigger_price > 0.0) {
+        writer.Key("trigger_price");
+        writer.Double(order.trigger_price);
+        writer.Key("trigger");
+        writer.String("last_price");
+    }
+    writer.Key("creation_timestamp");
+    writer.Int64(order.creation_timestamp);
+    writer.Key("last_update_timestamp");
+    writer.Int64(order.last_update_timestamp);
+    writer.EndObject();
+}
+
+std::string MockExchange::bookNotification(const Book& book, const std::string& channel,
+                                           const BookChange* change) const {
+    rapidjson::StringBuffer buffer;
+    JsonWriter writer(buffer);
+
+    auto writeLevel = [&](const char* action, bool bid, size_t level) {
+        writer.StartArray();
+        writer.String(action);
+        writer.Double(bid ? bidPrice(level) : askPrice(level));
+        writer.Double(bid ? book.bid_amounts[level] : book.ask_amounts[level]);
+        writer.EndArray();
+    };
+    auto writeSide = [&](bool bid) {
+        writer.StartArray();
+        if (change) {
+            if (change->bid == bid) {
+                writeLevel(change->action, bid, change->level);
+            }
+        } else {
+            const std::vector<double>& amounts = bid ? book.bid_amounts : book.ask_amounts;
+            for (size_t level = 0; level < amounts.size(); ++level) {
+                if (amounts[level] > 0.0) {
+                    writeLevel("new", bid, level);
+                }
+            }
+        }
+        writer.EndArray();
+    };
+
+    writer.StartObject();
+    writer.Key("jsonrpc");
+    writer.String("2.0");
+    writer.Key("method");
+    writer.String("subscription");
+    writer.Key("params");
+    writer.StartObject();
+    writer.Key("channel");
+    writer.String(channel.c_str());
+    writer.Key("data");
+    writer.StartObject();
+    writer.Key("type");
+    writer.String(change ? "change" : "snapshot");
+    writer.Key("timestamp");
+    writer.Int64(wallMillis());
+    writer.Key("instrument_name");
+    writer.String(book.instrument_name.c_str());
+    if (change) {
+        writer.Key("prev_change_id");
+        writer.Uint64(book.change_id - 1);
+    }
+    writer.Key("change_id");
+    writer.Uint64(book.change_id);
+    writer.Key("bids");
+    writeSide(true);
+    writer.Key("asks");
+    writeSide(false);
+    writer.EndObject();
+    writer.EndObject();
+    writer.EndObject();
+    return std::string(buffer.GetString(), buffer.GetSize());
+}
+
+void MockExchange::writeTrade(JsonWriter& writer, const Trade& trade) const {
+    std::string_view currency = settlementCurrency(trade.instrument_name);
+    writer.StartObject();
+    writer.Key("trade_id");
+    writer.String(trade.trade_id.c_str());
+    writer.Key("trade_seq");
+    writer.Int64(trade.trade_seq);
+    writer.Key("timestamp");
+    writer.Int64(wallMillis());
+    writer.Key("instrument_name");
+    writer.String(trade.instrument_name.c_str());
+    writer.Key("order_id");
+    writer.String(trade.order_id.c_str());
+    writer.Key("direction");
+    writer.String(trade.direction.c_str());
+    writer.Key("state");
+    writer.String("filled");
+    writer.Key("liquidity");
+    writer.String("T");
+    writer.Key("amount");
+    writer.Double(trade.amount);
+    writer.Key("price");
+    writer.Double(trade.price);
+    writer.Key("mark_price");
+    writer.Double(mark_price_);
+    writer.Key("index_price");
+    writer.Double(config_.mid_price);
+    writer.Key("fee");
+    writer.Double(trade.fee);
+    writer.Key("fee_currency");
+    writer.String(currency.data(), static_cast<rapidjson::SizeType>(currency.size()));
+    writer.EndObject();
+}
+
+std::string MockExchange::tradesNotification(const std::string& channel, const Trade& trade) const {
+    rapidjson::StringBuffer buffer;
+    JsonWriter writer(buffer);
+    writer.StartObject();
+    writer.Key("jsonrpc");
+    writer.String("2.0");
+    writer.Key("method");
+    writer.String("subscription");
+    writer.Key("params");
+    writer.StartObject();
+    writer.Key("channel");
+    writer.String(channel.c_str());
+    writer.Key("data");
+    writer.StartArray();
+    writeTrade(writer, trade);
+    writer.EndArray();
+    writer.EndObject();
+    writer.EndObject();
+    return std::string(buffer.GetString(), buffer.GetSize());
+}
+
+std::string MockExchange::markNotification(const std::string& channel, const std::string& instrument_name,
+                                           bool snapshot) const {
+    rapidjson::StringBuffer buffer;
+    JsonWriter writer(buffer);
+    writer.StartObject();
+    writer.Key("jsonrpc");
+    writer.String("2.0");
+    writer.Key("method");
+    writer.String("subscription");
+    writer.Key("params");
+    writer.StartObject();
+    writer.Key("channel");
+    writer.String(channel.c_str());
+    writer.Key("data");
+    writer.StartObject();
+    writer.Key("type");
+    writer.String(snapshot ? "snapshot" : "change");
+    writer.Key("timestamp");
+    writer.Int64(wallMillis());
+    writer.Key("instrument_name");
+    writer.String(instrument_name.c_str());
+    writer.Key("mark_price");
+    writer.Double(mark_price_);
+    if (snapshot) {
+        writer.Key("index_price");
+        writer.Double(config_.mid_price);
+        writer.Key("best_bid_price");
+        writer.Double(bidPrice(0));
+        writer.Key("best_ask_price");
+        writer.Double(askPrice(0));
+    }
+    writer.EndObject();
+    writer.EndObject();
+    writer.EndObject();
+    return std::string(buffer.GetString(), buffer.GetSize());
+}
+
+std::string MockExchange::orderNotification(const std::string& channel, const Order& order) const {
+    rapidjson::StringBuffer buffer;
+    JsonWriter writer(buffer);
+    writer.StartObject();
+    writer.Key("jsonrpc");
+    writer.String("2.0");
+    writer.Key("method");
+    writer.String("subscription");
+    writer.Key("params");
+    writer.StartObject();
+    writer.Key("channel");
+    writer.String(channel.c_str());
+    writer.Key("data");
+    writeOrder(writer, order);
+    writer.EndObject();
+    writer.EndObject();
+    return std::string(buffer.GetString(), buffer.GetSize());
+}
+
+MockExchange::BookChange MockExchange::mutateBook(Book& book) {
+    uint32_t random = nextRandom();
+
+    BookChange change;
+    change.bid = (random & 1) != 0;
+    change.level = (random >> 1) % config_.book_depth;
+    double& amount = change.bid ? book.bid_amounts[change.level] : book.ask_amounts[change.level];
+
+    // Roughly one in eight updates pulls a level; an empty level always comes back
+    bool remove = amount > 0.0 && ((random >> 16) & 7) == 0;
+    change.action = remove ? "delete" : amount > 0.0 ? "change" : "new";
+    amount = remove ? 0.0 : randomAmount();
+
+    ++book.change_id;
+    return change;
+}
+
+double MockExchange::bidPrice(size_t level) const {
+    return config_.mid_price - config_.tick_size * static_cast<double>(level + 1);
+}
+
+double MockExchange::askPrice(size_t level) const {
+    return config_.mid_price + config_.tick_size * static_cast<double>(level + 1);
+}
+
+double MockExchange::randomAmount() {
+    return 10.0 * static_cast<double>(1 + nextRandom() % 50);  // Perpetual amounts are multiples of 10 USD
+}
+
+uint32_t MockExchange::nextRandom() {
+    // xorshift32: deterministic across runs, so feeds are reproducible
+    random_state_ ^= random_state_ << 13;
+    random_state_ ^= random_state_ >> 17;
+    random_state_ ^= random_state_ << 5;
+    return random_state_;
+}
@@ -0,0 +1,204 @@
+#ifndef MOCK_EXCHANGE_H
+#define MOCK_EXCHANGE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>  // Boost 1.74's awaitable.hpp uses std::exchange without including it
+#include <vector>
+#include <boost/asio.hpp>
+#include <boost/asio/ssl.hpp>
+#include <rapidjson/document.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+
+struct MockExchangeConfig {
+    std::string address = "127.0.0.1";
+    unsigned short port = 0;    // 0 lets the OS pick; read it back with MockExchange::port()
+    double feed_rate = 1000.0;  // Book deltas per second per subscribed instrument; 0 sends snapshots only
+    double mid_price = 50000.0;
+    double tick_size = 0.5;
+    size_t book_depth = 10;     // Levels per side
+    int token_lifetime_seconds = 900;  // expires_in of issued access tokens; private calls fail after it
+};
+
+// Local stand-in for the Deribit JSON-RPC WebSocket API over TLS, for offline runs and
+// benchmarks. Serves public/auth, public/subscribe, public/unsubscribe, private/buy,
+// private/sell, private/cancel, private/cancel_all*, private/cancel_by_label,
+// private/edit, public/get_order_book, public/get_instruments, private/get_positions,
+// public/set_heartbeat, public/disable_heartbeat and public/test, and streams synthetic book.* deltas and user.orders.*.raw updates. Orders that cross the synthetic touch fill
+// there in full; others rest. Stop orders never trigger. Fills go out on user.trades.*.raw and move the
+// positions private/get_positions reports; incremental_ticker.* carries a mark price that wanders
+// around the mid while the feed runs. As on Deribit, a session that leaves a
+// heartbeat test_request unanswered until the next one is due gets disconnected.
+// public/auth accepts any client credentials and single-use refresh tokens; the session stays
+// authorized for token_lifetime_seconds, so long runs must refresh as against Deribit.
+// The certificate is self-signed and generated at start-up; WsConnector does not verify peers.
+class MockExchange {
+public:
+    explicit MockExchange(MockExchangeConfig config = MockExchangeConfig());
+    ~MockExchange();
+
+    MockExchange(const MockExchange&) = delete;
+    MockExchange& operator=(const MockExchange&) = delete;
+
+    void start();  // Binds and serves on a background thread
+    void stop();   // Closes every session and joins the thread
+    unsigned short port() const;
+
+    // Fault injection for reconnect tests; sessions accepted afterwards behave normally
+    void dropConnections();   // Closes every client socket without a close handshake
+    void stallConnections();  // Sessions stay open but stop reading requests and sending anything
+    // Moves a position without publishing a trade, as a missed fill or a settlement would
+    void shiftPosition(const std::string& instrument_name, double size_delta, double price);
+
+    uint64_t requestsServed() const { return requests_served_.load(std::memory_order_relaxed); }
+    uint64_t feedMessagesSent() const { return feed_messages_sent_.load(std::memory_order_relaxed); }
+    uint64_t feedMessagesSkipped() const { return feed_messages_skipped_.load(std::memory_order_relaxed); }
+
+private:
+    class Session;
+    using JsonWriter = rapidjson::Writer<rapidjson::StringBuffer>;
+
+    struct Order {
+        std::string order_id;
+        std::string instrument_name;
+        std::string direction;
+        std::string state;
+        std::string label;
+        std::string order_type;
+        std::string time_in_force;
+        bool post_only = false;
+        bool reduce_only = false;
+        double amount = 0.0;
+        double filled_amount = 0.0;
+        double price = 0.0;
+        double average_price = 0.0;
+        double trigger_price = 0.0;
+        int64_t creation_timestamp = 0;
+        int64_t last_update_timestamp = 0;
+    };
+
+    // Signed size; realized profit is booked as positions reduce
+    struct Position {
+        double size = 0.0;
+        double average_price = 0.0;
+        double realized_profit_loss = 0.0;
+        int64_t trade_seq = 0;  // Last trade on the instrument
+    };
+
+    struct Trade {
+        std::string trade_id;
+        int64_t trade_seq = 0;
+        std::string instrument_name;
+        std::string order_id;
+        std::string direction;
+        double amount = 0.0;
+        double price = 0.0;
+        double fee = 0.0;
+    };
+
+    struct BookChange {
+        bool bid;
+        size_t level;
+        const char* action;  // "new", "change" or "delete"
+    };
+
+    struct Subscriber {
+        std::weak_ptr<Session> session;
+        std::string channel;
+    };
+
+    // Fixed price grid around the mid; deltas only change amounts, so change_ids stay contiguous
+    struct Book {
+        std::string instrument_name;
+        std::vector<double> bid_amounts;
+        std::vector<double> ask_amounts;
+        uint64_t change_id = 1;
+        uint64_t feed_due = 0;  // Deltas generated or skipped so far, against feedTarget()
+        std::vector<Subscriber> subscribers;
+    };
+
+    void doAccept();
+    void scheduleFeed();
+    void onFeedTick();
+    uint64_t feedTarget() const;
+
+    // Request handling, all on the io thread
+    void handleRequest(const std::shared_ptr<Session>& session, std::string_view frame);
+    // Each writes the "result" or "error" member of the reply
+    void handleAuth(Session& session, JsonWriter& writer, const rapidjson::Value& params);
+    void handlePlaceOrder(JsonWriter& writer, const char* direction, const rapidjson::Value& params);
+    void handleCancel(JsonWriter& writer, const rapidjson::Value& params);
+    void handleEdit(JsonWriter& writer, const rapidjson::Value& params);
+    void handleCancelAll(JsonWriter& writer, std::string_view method, const rapidjson::Value& params);
+    void handleOrderBook(JsonWriter& writer, const rapidjson::Value& params);
+    void handleInstruments(JsonWriter& writer, const rapidjson::Value& params);
+    void handlePositions(JsonWriter& writer, const rapidjson::Value& params);
+    void handleSetHeartbeat(Session& session, JsonWriter& writer, const rapidjson::Value& params);
+    // Snapshots for new book subscriptions are returned so they go out after the reply
+    void handleSubscribe(const std::shared_ptr<Session>& session, JsonWriter& writer, const rapidjson::Value& params,
+                         bool subscribe, std::vector<std::string>& snapshots);
+    bool isAuthorized(const Session& session, const rapidjson::Value& params) const;
+
+    Book& findOrCreateBook(const std::string& instrument_name);
+    void writeOrder(JsonWriter& writer, const Order& order) const;
+    std::string bookNotification(const Book& book, const std::string& channel, const BookChange* change) const;
+    std::string orderNotification(const std::string& channel, const Order& order) const;
+    void publishOrderUpdates();  // Sends changed_orders_ to user.orders subscribers after each reply
+    void publishTrades();        // Sends new_trades_ to user.trades subscribers after each reply
+    void recordFill(const Order& order);
+    void writeTrade(JsonWriter& writer, const Trade& trade) const;
+    std::string tradesNotification(const std::string& channel, const Trade& trade) const;
+    std::string markNotification(const std::string& channel, const std::string& instrument_name, bool snapshot) const;
+    void moveMark();
+    BookChange mutateBook(Book& book);
+    double bidPrice(size_t level) const;
+    double askPrice(size_t level) const;
+    double randomAmount();
+    uint32_t nextRandom();
+
+    MockExchangeConfig config_;
+    boost::asio::io_context io_context_;
+    boost::asio::ssl::context ssl_ctx_;
+    boost::asio::ip::tcp::acceptor acceptor_;
+    boost::asio::steady_timer feed_timer_;
+    std::thread io_thread_;
+    std::atomic<bool> running_{false};
+    std::atomic<unsigned short> bound_port_{0};
+
+    // Only touched on the io thread
+    std::vector<std::weak_ptr<Session>> sessions_;
+    std::map<std::string, Order> orders_;
+    std::map<std::string, Book> books_;
+    std::vector<Subscriber> order_subscribers_;
+    std::vector<std::string> changed_orders_;  // Touched by the request being handled
+    std::map<std::string, Position> positions_;
+    std::vector<Subscriber> trade_subscribers_;
+    std::vector<Subscriber> mark_subscribers_;
+    std::vector<Trade> new_trades_;  // Made by the request being handled
+    uint64_t next_trade_id_ = 1;
+    double mark_price_ = 0.0;
+    uint64_t mark_ticks_ = 0;
+    uint64_t next_order_id_ = 1;
+    uint64_t next_token_ = 1;
+    // Issued access tokens, accepted on any connection until they expire, and unused refresh tokens
+    std::unordered_map<std::string, std::chrono::steady_clock::time_point> tokens_;
+    std::unordered_set<std::string> refresh_tokens_;
+    std::chrono::steady_clock::time_point feed_start_;
+    uint32_t random_state_ = 2463534242u;
+
+    std::atomic<uint64_t> requests_served_{0};
+    std::atomic<uint64_t> feed_messages_sent_{0};
+    std::atomic<uint64_t> feed_messages_skipped_{0};
+};
+
+#endif // MOCK_EXCHANGE_H
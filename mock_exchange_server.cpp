@@ -0,0 +1,57 @@
+// Runs MockExchange as a standalone process until interrupted:
+//   mock_exchange_server [port] [feed_rate_per_second]
+// Point trading_client at it with DERIBIT_HOST=127.0.0.1 DERIBIT_PORT=<port>.
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include "logger.h"
+#include "mock_exchange.h"
+
+namespace {
+
+std::atomic<bool> g_interrupted{false};
+
+void onSignal(int) {
+    g_interrupted.store(true);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    MockExchangeConfig config;
+    config.port = 8443;
+    if (argc > 1) {
+        config.port = static_cast<unsigned short>(std::atoi(argv[1]));
+    }
+    if (argc > 2) {
+        config.feed_rate = std::atof(argv[2]);
+    }
+
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+
+    Logger::start("mock_exchange.log");
+    int status = 0;
+    try {
+        MockExchange exchange(config);
+        exchange.start();
+        std::cout << "Mock exchange listening on wss://" << config.address << ":" << exchange.port()
+                  << " (" << config.feed_rate << " book deltas/s per instrument)" << std::endl;
+
+        while (!g_interrupted.load()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+
+        exchange.stop();
+        std::cout << "Served " << exchange.requestsServed() << " requests, sent "
+                  << exchange.feedMessagesSent() << " feed messages" << std::endl;
+    } catch (const std::exception& ex) {
+        std::cerr << "Mock exchange failed: " << ex.what() << std::endl;
+        status = 1;
+    }
+    Logger::stop();
+    return status;
+}
@@ -0,0 +1,115 @@
+#include "order_book.h"
+#include "response_parser.h"
+#include <algorithm>
+#include <limits>
+
+OrderBook::OrderBook(double tick_size, size_t reserve_levels)
+    : tick_size_(tick_size),
+      inv_tick_size_(1.0 / tick_size) {
+    bids_.reserve(reserve_levels);
+    asks_.reserve(reserve_levels);
+}
+
+void OrderBook::clear() {
+    bids_.clear();
+    asks_.clear();
+    change_id_ = 0;
+    synced_ = false;
+}
+
+void OrderBook::beginSnapshot(int64_t change_id) {
+    bids_.clear();
+    asks_.clear();
+    change_id_ = change_id;
+    synced_ = true;
+}
+
+bool OrderBook::beginChange(int64_t change_id, int64_t prev_change_id) {
+    if (!synced_ || prev_change_id != change_id_) {
+        synced_ = false;  // Missed a delta; the book must be rebuilt from a snapshot
+        return false;
+    }
+    change_id_ = change_id;
+    return true;
+}
+
+void OrderBook::updateLevel(Side side, int64_t price, double amount) {
+    std::vector<Level>& levels = side == Side::Bid ? bids_ : asks_;
+
+    // Bids ascend and asks descend so both sides keep the touch at back()
+    auto it = side == Side::Bid
+        ? std::lower_bound(levels.begin(), levels.end(), price,
+              [](const Level& level, int64_t p) { return level.price < p; })
+        : std::lower_bound(levels.begin(), levels.end(), price,
+              [](const Level& level, int64_t p) { return level.price > p; });
+
+    bool exists = it != levels.end() && it->price == price;
+    if (amount <= 0.0) {
+        if (exists) {
+            levels.erase(it);
+        }
+    } else if (exists) {
+        it->amount = amount;
+    } else {
+        levels.insert(it, Level{price, amount});
+    }
+}
+
+bool OrderBook::apply(const BookSnapshot& update) {
+    if (update.is_change) {
+        if (!beginChange(update.change_id, update.prev_change_id)) {
+            return false;
+        }
+    } else {
+        beginSnapshot(update.change_id);
+    }
+
+    // Deleted levels arrive with amount 0
+    for (const BookLevelUpdate& entry : update.bids) {
+        updateLevel(Side::Bid, toTicks(entry.price), entry.amount);
+    }
+    for (const BookLevelUpdate& entry : update.asks) {
+        updateLevel(Side::Ask, toTicks(entry.price), entry.amount);
+    }
+    return true;
+}
+
+const OrderBook::Level* OrderBook::level(Side side, size_t index) const {
+    const std::vector<Level>& levels = side == Side::Bid ? bids_ : asks_;
+    return index < levels.size() ? &levels[levels.size() - 1 - index] : nullptr;
+}
+
+double OrderBook::midPrice() const {
+    if (bids_.empty() || asks_.empty()) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    return toPrice(bids_.back().price + asks_.back().price) * 0.5;
+}
+
+double OrderBook::cumulativeAmount(Side side, size_t levels) const {
+    const std::vector<Level>& book_side = side == Side::Bid ? bids_ : asks_;
+    size_t count = std::min(levels, book_side.size());
+
+    double total = 0.0;
+    for (size_t i = 0; i < count; ++i) {
+        total += book_side[book_side.size() - 1 - i].amount;
+    }
+    return total;
+}
+
+double OrderBook::vwapToSize(Side side, double size) const {
+    const std::vector<Level>& book_side = side == Side::Bid ? bids_ : asks_;
+
+    double remaining = size;
+    double notional_ticks = 0.0;
+    for (auto it = book_side.rbegin(); it != book_side.rend() && remaining > 0.0; ++it) {
+        double take = std::min(remaining, it->amount);
+        notional_ticks += take * static_cast<double>(it->price);
+        remaining -= take;
+    }
+
+    if (remaining > 0.0 || size <= 0.0) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    return notional_ticks / size * tick_size_;
+}
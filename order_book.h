@@ -0,0 +1,59 @@
+#ifndef ORDER_BOOK_H
+#define ORDER_BOOK_H
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+struct BookSnapshot;
+
+// Local L2 book for one instrument. Prices are stored as integer ticks and each
+// side is a contiguous vector ordered so the best level sits at back(): updates
+// near the touch shift only a few elements and top-of-book reads are one load.
+// Not thread-safe; OrderManager serializes the feed writer and readers.
+class OrderBook {
+public:
+    enum class Side : uint8_t { Bid, Ask };
+
+    struct Level {
+        int64_t price;  // In ticks
+        double amount;
+    };
+
+    static constexpr double kDefaultTickSize = 1e-8;  // Fine enough for any Deribit instrument
+
+    explicit OrderBook(double tick_size = kDefaultTickSize, size_t reserve_levels = 1024);
+
+    void clear();
+    void beginSnapshot(int64_t change_id);
+    bool beginChange(int64_t change_id, int64_t prev_change_id);  // False on a change_id gap
+    void updateLevel(Side side, int64_t price, double amount);   // amount <= 0 removes the level
+
+    // Applies a parsed book.* notification or public/get_order_book result; false on a gap
+    bool apply(const BookSnapshot& update);
+
+    bool isSynced() const { return synced_; }
+    int64_t changeId() const { return change_id_; }
+    double tickSize() const { return tick_size_; }
+    int64_t toTicks(double price) const { return std::llround(price * inv_tick_size_); }
+    double toPrice(int64_t ticks) const { return static_cast<double>(ticks) * tick_size_; }
+
+    size_t depth(Side side) const { return side == Side::Bid ? bids_.size() : asks_.size(); }
+    const Level* level(Side side, size_t index) const;  // 0 is the best level
+    const Level* bestBid() const { return bids_.empty() ? nullptr : &bids_.back(); }
+    const Level* bestAsk() const { return asks_.empty() ? nullptr : &asks_.back(); }
+    double midPrice() const;
+    double cumulativeAmount(Side side, size_t levels) const;
+    double vwapToSize(Side side, double size) const;  // NaN when the side cannot fill size
+
+private:
+    double tick_size_;
+    double inv_tick_size_;
+    int64_t change_id_ = 0;
+    bool synced_ = false;
+
+    std::vector<Level> bids_;  // Ascending price, best bid at back()
+    std::vector<Level> asks_;  // Descending price, best ask at back()
+};
+
+#endif // ORDER_BOOK_H
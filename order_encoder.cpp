@@ -0,0 +1,405 @@
+#include "order_encoder.h"
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+// Longest rendering of the numeric fields plus all literals of the largest template
+constexpr size_t kFixedBytes = 384;
+
+constexpr char kDigitPairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+template <size_t N>
+inline char* append(char* out, const char (&literal)[N]) {
+    std::memcpy(out, literal, N - 1);
+    return out + N - 1;
+}
+
+inline char* append(char* out, std::string_view text) {
+    std::memcpy(out, text.data(), text.size());
+    return out + text.size();
+}
+
+// Indexed by the enums so the per-order choices are table loads, not branches
+constexpr std::string_view kSideMethods[] = {"private/buy", "private/sell"};
+constexpr std::string_view kTypeFragments[] = {
+    ",\"type\":\"limit\"",
+    ",\"type\":\"market\"",
+    ",\"type\":\"stop_limit\"",
+    ",\"type\":\"stop_market\"",
+};
+constexpr std::string_view kTimeInForceFragments[] = {
+    "",  // good_til_cancelled is the exchange default
+    ",\"time_in_force\":\"good_til_day\"",
+    ",\"time_in_force\":\"fill_or_kill\"",
+    ",\"time_in_force\":\"immediate_or_cancel\"",
+};
+constexpr std::string_view kPostOnlyFragments[] = {"", ",\"post_only\":true"};
+constexpr std::string_view kReduceOnlyFragments[] = {"", ",\"reduce_only\":true"};
+constexpr size_t kMaxLabelSize = 64;
+constexpr const char* kNeedsEscaping = "Order text with a quote, backslash or control character";
+// Bytes JSON strings must escape
+constexpr std::array<bool, 256> kEscapes = [] {
+    std::array<bool, 256> escapes{};
+    for (size_t c = 0; c < 0x20; ++c) {
+        escapes[c] = true;
+    }
+    escapes['"'] = true;
+    escapes['\\'] = true;
+    return escapes;
+}();
+
+// units / 10^places with exactly places decimals; Places >= 0 fixes the count at compile time
+template <int Places>
+char* writeDecimal(char* out, int64_t units, int places) {
+    if constexpr (Places >= 0) {
+        places = Places;
+    }
+    if (places == 0) {
+        return OrderEncoder::writeInt(out, units);
+    }
+    if (units < 0) {
+        *out++ = '-';
+        units = -units;
+    }
+    int64_t scale = kPowersOf10[places];
+    out = OrderEncoder::writeInt(out, units / scale);
+    *out++ = '.';
+    int64_t fraction = units % scale;
+    for (int i = places - 1; i >= 0; --i) {
+        out[i] = static_cast<char>('0' + fraction % 10);
+        fraction /= 10;
+    }
+    return out + places;
+}
+
+// Request values as given
+struct DoubleFields {
+    char* price(char* out, double value) const { return OrderEncoder::writeDouble(out, value); }
+    char* amount(char* out, double value) const { return OrderEncoder::writeDouble(out, value); }
+};
+
+// Request values as the nearest ticks and lots of one instrument class's grid
+template <InstrumentClass Class>
+struct GridFields {
+    using Math = GridMath<Class>;
+    using Traits = InstrumentTraits<Class>;
+
+    const InstrumentSpec& spec;
+
+    char* price(char* out, double value) const {
+        Price price = Math::toPrice(value, spec, Rounding::Nearest);
+        return writeDecimal<Traits::kPriceDecimals>(out, price.ticks * spec.tick.step_units, spec.tick.decimals);
+    }
+    char* amount(char* out, double value) const {
+        Qty amount = Math::toQty(value, spec, Rounding::Nearest);
+        return writeDecimal<Traits::kAmountDecimals>(out, amount.lots * spec.lot.step_units, spec.lot.decimals);
+    }
+};
+
+}  // namespace
+
+char* OrderEncoder::writeInt(char* out, int64_t value) {
+    uint64_t magnitude = static_cast<uint64_t>(value);
+    if (value < 0) {
+        *out++ = '-';
+        magnitude = 0 - magnitude;
+    }
+
+    // Render two digits at a time from the back of a scratch area
+    char scratch[20];
+    char* end = scratch + sizeof(scratch);
+    char* pos = end;
+    while (magnitude >= 100) {
+        size_t pair = (magnitude % 100) * 2;
+        magnitude /= 100;
+        pos -= 2;
+        std::memcpy(pos, kDigitPairs + pair, 2);
+    }
+    if (magnitude >= 10) {
+        pos -= 2;
+        std::memcpy(pos, kDigitPairs + magnitude * 2, 2);
+    } else {
+        *--pos = static_cast<char>('0' + magnitude);
+    }
+
+    size_t length = static_cast<size_t>(end - pos);
+    std::memcpy(out, pos, length);
+    return out + length;
+}
+
+char* OrderEncoder::writeDouble(char* out, double value) {
+    // Prices and sizes rarely carry more than 8 decimals. When value * 1e8 is an
+    // integer whose quotient rounds back to value exactly, print it with integer ops.
+    constexpr double kScale = 1e8;
+    if (std::fabs(value) < 9e7) {
+        double product = value * kScale;
+        int64_t scaled = static_cast<int64_t>(product + (product < 0.0 ? -0.5 : 0.5));
+        if (static_cast<double>(scaled) / kScale == value) {
+            if (scaled < 0) {
+                *out++ = '-';
+                scaled = -scaled;
+            }
+            out = writeInt(out, scaled / 100000000);
+
+            int64_t fraction = scaled % 100000000;
+            if (fraction != 0) {
+                char digits[8];
+                for (int i = 7; i >= 0; --i) {
+                    digits[i] = static_cast<char>('0' + fraction % 10);
+                    fraction /= 10;
+                }
+                size_t length = 8;
+                while (digits[length - 1] == '0') {
+                    --length;
+                }
+                *out++ = '.';
+                std::memcpy(out, digits, length);
+                out += length;
+            }
+            return out;
+        }
+    }
+
+    // Shortest round-trip form for everything else
+    return std::to_chars(out, out + 32, value).ptr;
+}
+
+char* OrderEncoder::writePrice(char* out, Price price, const InstrumentSpec& spec) {
+    return withInstrumentClass(spec.instrument_class, [&](auto math) {
+        using Traits = typename decltype(math)::Traits;
+        return writeDecimal<Traits::kPriceDecimals>(out, price.ticks * spec.tick.step_units, spec.tick.decimals);
+    });
+}
+
+char* OrderEncoder::writeQty(char* out, Qty amount, const InstrumentSpec& spec) {
+    return withInstrumentClass(spec.instrument_class, [&](auto math) {
+        using Traits = typename decltype(math)::Traits;
+        return writeDecimal<Traits::kAmountDecimals>(out, amount.lots * spec.lot.step_units, spec.lot.decimals);
+    });
+}
+
+const char* OrderEncoder::invalidOrder(const OrderRequest& request) {
+    if (request.label.size() > kMaxLabelSize) {
+        return "Order label longer than 64 characters";
+    }
+    if (!fits(request.instrument.size() + request.label.size())) {
+        return "Order request exceeds encoder buffer";
+    }
+    if (needsEscaping(request.instrument) || needsEscaping(request.label)) {
+        return kNeedsEscaping;
+    }
+    return nullptr;
+}
+
+const char* OrderEncoder::invalidText(std::string_view text) {
+    if (!fits(text.size())) {
+        return "Order request exceeds encoder buffer";
+    }
+    return needsEscaping(text) ? kNeedsEscaping : nullptr;
+}
+
+bool OrderEncoder::fits(size_t variable_bytes) {
+    return variable_bytes + kFixedBytes <= kBufferSize;
+}
+
+bool OrderEncoder::needsEscaping(std::string_view text) {
+    // One table load per byte and no early exit: names, labels and order ids are short
+    bool escape = false;
+    for (char c : text) {
+        escape |= kEscapes[static_cast<unsigned char>(c)];
+    }
+    return escape;
+}
+
+void OrderEncoder::ensureCapacity(size_t variable_bytes) const {
+    if (!fits(variable_bytes)) {
+        throw std::length_error("Order request exceeds encoder buffer");
+    }
+}
+
+void OrderEncoder::ensureVerbatim(std::string_view text) {
+    if (needsEscaping(text)) {
+        throw std::invalid_argument(kNeedsEscaping);
+    }
+}
+
+template <OrderType Type, typename Fields>
+std::string_view OrderEncoder::encodeOrderFields(int id, const OrderRequest& request, const Fields& fields) {
+    using Traits = OrderTypeTraits<Type>;
+    if (request.label.size() > kMaxLabelSize) {
+        throw std::invalid_argument("Order label longer than 64 characters");
+    }
+    ensureCapacity(request.instrument.size() + request.label.size());
+    ensureVerbatim(request.instrument);
+    ensureVerbatim(request.label);
+
+    char* out = buffer_;
+    out = append(out, "{\"jsonrpc\":\"2.0\",\"id\":");
+    out = writeInt(out, id);
+    out = append(out, ",\"method\":\"");
+    out = append(out, kSideMethods[static_cast<size_t>(request.side)]);
+    out = append(out, "\",\"params\":{\"instrument_name\":\"");
+    out = append(out, request.instrument);
+    out = append(out, "\",\"amount\":");
+    out = fields.amount(out, request.amount);
+    out = append(out, kTypeFragments[static_cast<size_t>(Type)]);
+    if constexpr (Traits::kHasPrice) {
+        out = append(out, ",\"price\":");
+        out = fields.price(out, request.price);
+    }
+    if constexpr (Traits::kHasTrigger) {
+        out = append(out, ",\"trigger_price\":");
+        out = fields.price(out, request.trigger_price);
+        out = append(out, ",\"trigger\":\"last_price\"");
+    }
+    out = append(out, kTimeInForceFragments[static_cast<size_t>(request.time_in_force)]);
+    if constexpr (Traits::kAllowsPostOnly) {
+        out = append(out, kPostOnlyFragments[request.post_only]);
+    }
+    out = append(out, kReduceOnlyFragments[request.reduce_only]);
+    if (!request.label.empty()) {
+        out = append(out, ",\"label\":\"");
+        out = append(out, request.label);
+        out = append(out, "\"");
+    }
+    out = append(out, "}}");
+    return std::string_view(buffer_, static_cast<size_t>(out - buffer_));
+}
+
+template <OrderType Type>
+std::string_view OrderEncoder::encodeOrder(int id, const OrderRequest& request) {
+    return encodeOrderFields<Type>(id, request, DoubleFields{});
+}
+
+template std::string_view OrderEncoder::encodeOrder<OrderType::Limit>(int, const OrderRequest&);
+template std::string_view OrderEncoder::encodeOrder<OrderType::Market>(int, const OrderRequest&);
+template std::string_view OrderEncoder::encodeOrder<OrderType::StopLimit>(int, const OrderRequest&);
+template std::string_view OrderEncoder::encodeOrder<OrderType::StopMarket>(int, const OrderRequest&);
+
+std::string_view OrderEncoder::encodeOrder(int id, const OrderRequest& request) {
+    switch (request.type) {
+    case OrderType::Market:
+        return encodeOrder<OrderType::Market>(id, request);
+    case OrderType::StopLimit:
+        return encodeOrder<OrderType::StopLimit>(id, request);
+    case OrderType::StopMarket:
+        return encodeOrder<OrderType::StopMarket>(id, request);
+    case OrderType::Limit:
+    default:
+        return encodeOrder<OrderType::Limit>(id, request);
+    }
+}
+
+std::string_view OrderEncoder::encodeOrder(int id, const OrderRequest& request, const InstrumentSpec& spec) {
+    // One switch on the class and one on the type pick a fully specialized encoder
+    return withInstrumentClass(spec.instrument_class, [&](auto math) {
+        constexpr InstrumentClass kClass = decltype(math)::kClass;
+        GridFields<kClass> fields{spec};
+        switch (request.type) {
+        case OrderType::Market:
+            return encodeOrderFields<OrderType::Market>(id, request, fields);
+        case OrderType::StopLimit:
+            return encodeOrderFields<OrderType::StopLimit>(id, request, fields);
+        case OrderType::StopMarket:
+            return encodeOrderFields<OrderType::StopMarket>(id, request, fields);
+        case OrderType::Limit:
+        default:
+            return encodeOrderFields<OrderType::Limit>(id, request, fields);
+        }
+    });
+}
+
+std::string_view OrderEncoder::encodeBuy(int id, std::string_view asset, double qty, double rate) {
+    OrderRequest request = OrderRequest::limit(asset, Side::Buy, qty, rate);
+    request.post_only = true;
+    return encodeOrder<OrderType::Limit>(id, request);
+}
+
+std::string_view OrderEncoder::encodeSell(int id, std::string_view asset, double qty, double rate) {
+    OrderRequest request = OrderRequest::limit(asset, Side::Sell, qty, rate);
+    request.post_only = true;
+    return encodeOrder<OrderType::Limit>(id, request);
+}
+
+std::string_view OrderEncoder::encodeCancel(int id, std::string_view order_ref) {
+    ensureCapacity(order_ref.size());
+    ensureVerbatim(order_ref);
+
+    char* out = buffer_;
+    out = append(out, "{\"jsonrpc\":\"2.0\",\"id\":");
+    out = writeInt(out, id);
+    out = append(out, ",\"method\":\"private/cancel\",\"params\":{\"order_id\":\"");
+    out = append(out, order_ref);
+    out = append(out, "\"}}");
+    return std::string_view(buffer_, static_cast<size_t>(out - buffer_));
+}
+
+template <typename Fields>
+std::string_view OrderEncoder::encodeEditFields(int id, std::string_view order_ref, double new_rate, double new_qty,
+                                                const Fields& fields) {
+    ensureCapacity(order_ref.size());
+    ensureVerbatim(order_ref);
+
+    char* out = buffer_;
+    out = append(out, "{\"jsonrpc\":\"2.0\",\"id\":");
+    out = writeInt(out, id);
+    out = append(out, ",\"method\":\"private/edit\",\"params\":{\"order_id\":\"");
+    out = append(out, order_ref);
+    out = append(out, "\",\"price\":");
+    out = fields.price(out, new_rate);
+    out = append(out, ",\"amount\":");
+    char* amount = out;
+    out = fields.amount(out, new_qty);
+    size_t amount_size = static_cast<size_t>(out - amount);
+    out = append(out, ",\"quantity\":");  // Required for contracts
+    out = append(out, std::string_view(amount, amount_size));
+    out = append(out, "}}");
+    return std::string_view(buffer_, static_cast<size_t>(out - buffer_));
+}
+
+std::string_view OrderEncoder::encodeEdit(int id, std::string_view order_ref, double new_rate, double new_qty) {
+    return encodeEditFields(id, order_ref, new_rate, new_qty, DoubleFields{});
+}
+
+std::string_view OrderEncoder::encodeEdit(int id, std::string_view order_ref, double new_rate, double new_qty,
+                                          const InstrumentSpec& spec) {
+    return withInstrumentClass(spec.instrument_class, [&](auto math) {
+        return encodeEditFields(id, order_ref, new_rate, new_qty, GridFields<decltype(math)::kClass>{spec});
+    });
+}
+
+std::string_view OrderEncoder::encodeCancelAll(int id, std::string_view method, std::string_view filter_key,
+                                               std::string_view filter_value) {
+    ensureCapacity(method.size() + filter_key.size() + filter_value.size());
+    ensureVerbatim(filter_value);  // method and filter_key are literals
+
+    char* out = buffer_;
+    out = append(out, "{\"jsonrpc\":\"2.0\",\"id\":");
+    out = writeInt(out, id);
+    out = append(out, ",\"method\":\"");
+    out = append(out, method);
+    out = append(out, "\",\"params\":{");
+    if (!filter_key.empty()) {
+        out = append(out, "\"");
+        out = append(out, filter_key);
+        out = append(out, "\":\"");
+        out = append(out, filter_value);
+        out = append(out, "\"");
+    }
+    out = append(out, "}}");
+    return std::string_view(buffer_, static_cast<size_t>(out - buffer_));
+}
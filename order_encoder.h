@@ -0,0 +1,67 @@
+#ifndef ORDER_ENCODER_H
+#define ORDER_ENCODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include "fixed_point.h"
+#include "order_request.h"
+
+// Pre-templated JSON-RPC encoder for the order entry methods. The fixed parts of
+// each request are literals; only id, instrument/order id, price and amount are
+// patched into a buffer owned by the encoder, so encoding never allocates.
+// The returned view stays valid until the next encode call on the same encoder.
+// Frames carry no access_token: the WebSocket connection is authenticated once by public/auth.
+class OrderEncoder {
+public:
+    static constexpr size_t kBufferSize = 1024;
+
+    // Any OrderRequest: dispatches once on type to the specialization below
+    std::string_view encodeOrder(int id, const OrderRequest& request);
+    // Per-type encoder: fields the type cannot carry are dropped at compile time
+    template <OrderType Type>
+    std::string_view encodeOrder(int id, const OrderRequest& request);
+    // On the instrument's grid: price and amount go out as integer ticks and lots rendered
+    // with the class's fixed decimals, never through a double formatter. Values are taken to
+    // the nearest step; round them first (see OrderManager) to pick the direction.
+    std::string_view encodeOrder(int id, const OrderRequest& request, const InstrumentSpec& spec);
+
+    // Post-only limit orders, the market-making default
+    std::string_view encodeBuy(int id, std::string_view asset, double qty, double rate);
+    std::string_view encodeSell(int id, std::string_view asset, double qty, double rate);
+    std::string_view encodeCancel(int id, std::string_view order_ref);
+    std::string_view encodeEdit(int id, std::string_view order_ref, double new_rate, double new_qty);
+    std::string_view encodeEdit(int id, std::string_view order_ref, double new_rate, double new_qty,
+                                const InstrumentSpec& spec);
+    // private/cancel_all* and private/cancel_by_label; an empty filter_key sends no filter
+    std::string_view encodeCancelAll(int id, std::string_view method, std::string_view filter_key,
+                                     std::string_view filter_value);
+
+    // Text goes into the frame verbatim, so anything that would need JSON escaping (a quote, a
+    // backslash or a control character) is refused, as is text too long for the buffer. For callers
+    // that must not throw: what the encoder would throw for, or nullptr when it encodes.
+    static const char* invalidOrder(const OrderRequest& request);
+    static const char* invalidText(std::string_view text);  // An order id or a mass-cancel filter value
+
+    static char* writeInt(char* out, int64_t value);
+    static char* writeDouble(char* out, double value);
+    static char* writePrice(char* out, Price price, const InstrumentSpec& spec);
+    static char* writeQty(char* out, Qty amount, const InstrumentSpec& spec);
+
+private:
+    static bool fits(size_t variable_bytes);
+    static bool needsEscaping(std::string_view text);
+    void ensureCapacity(size_t variable_bytes) const;
+    static void ensureVerbatim(std::string_view text);  // Throws std::invalid_argument if it needs escaping
+
+    // Fields renders price and amount: as doubles, or as steps of one instrument class's grid
+    template <OrderType Type, typename Fields>
+    std::string_view encodeOrderFields(int id, const OrderRequest& request, const Fields& fields);
+    template <typename Fields>
+    std::string_view encodeEditFields(int id, std::string_view order_ref, double new_rate, double new_qty,
+                                      const Fields& fields);
+
+    char buffer_[kBufferSize];
+};
+
+#endif // ORDER_ENCODER_H
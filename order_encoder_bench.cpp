@@ -0,0 +1,172 @@
+#include "heap_counter.h"
+#include "instrument_cache.h"
+#include "order_encoder.h"
+#include "ws_connector.h"
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <rapidjson/document.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+
+namespace {
+
+constexpr int kIterations = 1000000;
+const std::string kAsset = "BTC-PERPETUAL";
+const std::string kOrderRef = "USDC-1234567890";
+const std::string kOption = "BTC-27MAR26-60000-C";
+
+InstrumentSpec specFor(const std::string& name, InstrumentKind kind, double tick_size, double min_trade_amount) {
+    InstrumentInfo info;
+    info.name.assign(name.data(), name.size());
+    info.kind = kind;
+    info.tick_size = tick_size;
+    info.contract_size = min_trade_amount;
+    info.min_trade_amount = min_trade_amount;
+    return *makeInstrumentSpec(info);
+}
+
+volatile size_t g_sink = 0;  // Keeps the encoded output observable
+
+template <typename Fn>
+void runCase(const char* name, int iterations, Fn&& fn) {
+    uint64_t allocations_before = HeapCounter::thread().allocations;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        fn(i);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    long allocations = static_cast<long>(HeapCounter::thread().allocations - allocations_before);
+
+    double ns_per_op = std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+    std::cout << name << ": " << ns_per_op << " ns/op, "
+              << static_cast<double>(allocations) / iterations << " allocations/op" << std::endl;
+}
+
+// The per-call DOM construction OrderManager used before the encoder
+std::string encodeBuyWithDom(int id, double qty, double rate) {
+    static thread_local rapidjson::Document json_cache;
+    json_cache.SetObject();
+    auto& allocator = json_cache.GetAllocator();
+
+    json_cache.AddMember("jsonrpc", "2.0", allocator);
+    json_cache.AddMember("method", "private/buy", allocator);
+    json_cache.AddMember("id", id, allocator);
+
+    rapidjson::Value params(rapidjson::kObjectType);
+    params.AddMember("instrument_name", rapidjson::Value(kAsset.c_str(), allocator), allocator);
+    params.AddMember("amount", qty, allocator);
+    params.AddMember("price", rate, allocator);
+    params.AddMember("type", "limit", allocator);
+    params.AddMember("post_only", true, allocator);
+    json_cache.AddMember("params", params, allocator);
+
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    json_cache.Accept(writer);
+    return buffer.GetString();
+}
+
+}  // namespace
+
+int main() {
+    if (!HeapCounter::enabled()) {
+        std::cout << "Heap allocations are not counted in this build (TRADING_COUNT_ALLOCATIONS=OFF)" << std::endl;
+    }
+    OrderEncoder encoder;
+
+    runCase("rapidjson DOM private/buy", kIterations, [](int i) {
+        g_sink = g_sink + encodeBuyWithDom(i, 10.0 + i % 7, 50000.5 + i % 13).size();
+    });
+    runCase("OrderEncoder private/buy", kIterations, [&](int i) {
+        g_sink = g_sink + encoder.encodeBuy(i, kAsset, 10.0 + i % 7, 50000.5 + i % 13).size();
+    });
+    runCase("OrderEncoder private/sell", kIterations, [&](int i) {
+        g_sink = g_sink + encoder.encodeSell(i, kAsset, 10.0 + i % 7, 50000.5 + i % 13).size();
+    });
+    // Typed requests: runtime dispatch once on type, then the compile-time specialization
+    OrderRequest ioc_sell = OrderRequest::limit(kAsset, Side::Sell, 10.0, 50000.5);
+    ioc_sell.time_in_force = TimeInForce::ImmediateOrCancel;
+    ioc_sell.reduce_only = true;
+    ioc_sell.label = "hedge";
+    runCase("OrderEncoder OrderRequest limit IOC reduce_only", kIterations, [&](int i) {
+        ioc_sell.amount = 10.0 + i % 7;
+        g_sink = g_sink + encoder.encodeOrder(i, ioc_sell).size();
+    });
+    OrderRequest market_buy = OrderRequest::market(kAsset, Side::Buy, 10.0);
+    runCase("OrderEncoder OrderRequest market", kIterations, [&](int i) {
+        market_buy.amount = 10.0 + i % 7;
+        g_sink = g_sink + encoder.encodeOrder(i, market_buy).size();
+    });
+    OrderRequest stop_sell = OrderRequest::limit(kAsset, Side::Sell, 10.0, 49000.0);
+    stop_sell.type = OrderType::StopLimit;
+    stop_sell.trigger_price = 49100.0;
+    runCase("OrderEncoder OrderRequest stop_limit", kIterations, [&](int i) {
+        stop_sell.trigger_price = 49100.0 + i % 13;
+        g_sink = g_sink + encoder.encodeOrder(i, stop_sell).size();
+    });
+
+    // Instrument grids: ticks and lots rendered with each class's fixed decimals
+    InstrumentSpec perpetual = specFor(kAsset, InstrumentKind::Future, 0.5, 10.0);
+    InstrumentSpec option = specFor(kOption, InstrumentKind::Option, 0.0005, 0.1);
+    InstrumentSpec generic = specFor("BTC_USDC-PERPETUAL", InstrumentKind::Future, 1.0, 0.001);
+    OrderRequest grid_buy = OrderRequest::limit(kAsset, Side::Buy, 10.0, 50000.5);
+    grid_buy.post_only = true;
+    runCase("OrderEncoder perpetual grid private/buy", kIterations, [&](int i) {
+        grid_buy.amount = 10.0 * (1 + i % 7);
+        grid_buy.price = 50000.5 + i % 13;
+        g_sink = g_sink + encoder.encodeOrder(i, grid_buy, perpetual).size();
+    });
+    OrderRequest option_buy = OrderRequest::limit(kOption, Side::Buy, 0.1, 0.0125);
+    option_buy.post_only = true;
+    runCase("OrderEncoder option private/buy", kIterations, [&](int i) {
+        g_sink = g_sink + encoder.encodeBuy(i, kOption, 0.1 * (1 + i % 7), 0.0125 + 0.0005 * (i % 13)).size();
+    });
+    runCase("OrderEncoder option grid private/buy", kIterations, [&](int i) {
+        option_buy.amount = 0.1 * (1 + i % 7);
+        option_buy.price = 0.0125 + 0.0005 * (i % 13);
+        g_sink = g_sink + encoder.encodeOrder(i, option_buy, option).size();
+    });
+    OrderRequest generic_buy = OrderRequest::limit("BTC_USDC-PERPETUAL", Side::Buy, 0.001, 50000.0);
+    runCase("OrderEncoder generic grid private/buy", kIterations, [&](int i) {
+        generic_buy.amount = 0.001 * (1 + i % 7);
+        generic_buy.price = 50000.0 + i % 13;
+        g_sink = g_sink + encoder.encodeOrder(i, generic_buy, generic).size();
+    });
+    runCase("Grid rounding price + amount", kIterations, [&](int i) {
+        g_sink = g_sink + toPrice(50000.37 + i % 13, perpetual, Rounding::Down).ticks + toQty(15.0 + i % 7, perpetual).lots;
+    });
+
+    runCase("OrderEncoder private/cancel", kIterations, [&](int i) {
+        g_sink = g_sink + encoder.encodeCancel(i, kOrderRef).size();
+    });
+    runCase("OrderEncoder private/edit", kIterations, [&](int i) {
+        g_sink = g_sink + encoder.encodeEdit(i, kOrderRef, 50000.5 + i % 13, 10.0 + i % 7).size();
+    });
+    runCase("OrderEncoder perpetual grid private/edit", kIterations, [&](int i) {
+        g_sink = g_sink + encoder.encodeEdit(i, kOrderRef, 50000.5 + i % 13, 10.0 * (1 + i % 7), perpetual).size();
+    });
+
+    // Encode plus hand-off into the connector's write slots. No io thread drains
+    // the ring here, so each round fills a fresh connector built outside the timing.
+    long allocations = 0;
+    std::chrono::steady_clock::duration elapsed{};
+    int frames = 0;
+    for (int round = 0; round < 64; ++round) {
+        auto connector = std::make_unique<WsConnector>("localhost", "443", "/ws/api/v2");
+
+        uint64_t allocations_before = HeapCounter::thread().allocations;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < WsConnector::kWriteSlots; ++i, ++frames) {
+            connector->transmitAsync(encoder.encodeBuy(frames, kAsset, 10.0, 50000.5));
+        }
+        elapsed += std::chrono::steady_clock::now() - start;
+        allocations += static_cast<long>(HeapCounter::thread().allocations - allocations_before);
+    }
+    std::cout << "encode + WsConnector::transmitAsync: "
+              << std::chrono::duration<double, std::nano>(elapsed).count() / frames << " ns/op, "
+              << static_cast<double>(allocations) / frames << " allocations/op" << std::endl;
+
+    return allocations == 0 ? 0 : 1;
+}
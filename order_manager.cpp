@@ -1,25 +1,160 @@
 #include "order_manager.h"
-#include <rapidjson/prettywriter.h>  // Include this at the top of the file
+#include "ws_connector.h"
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include "logger.h"
+#include "performance_tracker.h"
+
+namespace {
 
-// Helper function to pretty-print JSON
-std::string prettyPrintJson(const rapidjson::Document& doc) {
+std::string serializeValue(const rapidjson::Value& value) {
     rapidjson::StringBuffer buffer;
-    rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
-    doc.Accept(writer);
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    value.Accept(writer);
     return buffer.GetString();
 }
 
-#include "ws_connector.h"
-#include <iostream>
-#include <stdexcept>
-#include "performance_tracker.h"
+// Bridges the callback engine to a future for callers that want to block
+std::pair<OrderManager::ResponseHandler, std::future<rapidjson::Document>> makePromiseHandler() {
+    auto promise = std::make_shared<std::promise<rapidjson::Document>>();
+    std::future<rapidjson::Document> future = promise->get_future();
+    OrderManager::ResponseHandler handler = [promise](rapidjson::Document& reply) {
+        promise->set_value(std::move(reply));
+    };
+    return {std::move(handler), std::move(future)};
+}
 
-alignas(64) std::atomic<int> OrderManager::sequence_num_{1};
-thread_local rapidjson::Document OrderManager::json_cache_;
+// Throws with the exchange error if the reply carries one
+void checkReply(const rapidjson::Document& reply, const char* context) {
+    if (reply.HasMember("error")) {
+        throw std::runtime_error(std::string(context) + ": " + serializeValue(reply["error"]));
+    }
+}
+
+// Fills the envelope fields that RpcStatus, OrderAck and BookSnapshot share
+template <typename Reply>
+void setError(Reply& reply, int seq, std::string_view reason) {
+    reply.id = seq;
+    reply.error_code = -1;
+    reply.error_message.assign(reason.data(), reason.size());
+}
+
+const PerformanceTracker::ProbeId kSendProbe = PerformanceTracker::registerProbe("rpc.send");
+const PerformanceTracker::ProbeId kAckProbe = PerformanceTracker::registerProbe("rpc.ack");
+const PerformanceTracker::ProbeId kParseProbe = PerformanceTracker::registerProbe("feed.parse");
+const PerformanceTracker::ProbeId kDispatchProbe = PerformanceTracker::registerProbe("feed.dispatch");
+
+// user.* channels are private and need the authenticated session
+bool hasPrivateChannel(const std::vector<std::string>& channels) {
+    for (const auto& channel : channels) {
+        if (channel.compare(0, 5, "user.") == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Renew the token once this much of its lifetime has passed, and retry a failed renewal after kAuthRetryNs
+constexpr double kAuthRefreshFraction = 0.8;
+constexpr int64_t kAuthRetryNs = 1000000000;
+
+// What the buy/sell shorthands have always sent
+OrderRequest postOnlyLimit(std::string_view asset, Side side, double qty, double rate) {
+    OrderRequest request = OrderRequest::limit(asset, side, qty, rate);
+    request.post_only = true;
+    return request;
+}
+
+void throwIfRefused(RiskCheck result) {
+    if (result != RiskCheck::Passed) {
+        throw std::runtime_error(std::string("Risk check failed: ") + toString(result));
+    }
+}
 
-OrderManager::OrderManager(WsConnector& ws_conn) : ws_conn_(ws_conn) {}
+constexpr const char* kQueueFull = "WebSocket write queue full";
+
+RequestStatus failed(OrderErrc error, const char* reason, RiskCheck risk = RiskCheck::Passed) {
+    return RequestStatus{make_error_code(error), risk, reason};
+}
+
+// How the throwing calls report what the try* calls return
+void throwIfFailed(const RequestStatus& status) {
+    if (status.ok()) {
+        return;
+    }
+    if (status.error == OrderErrc::RiskRefused) {
+        throw std::runtime_error(std::string("Risk check failed: ") + status.reason);
+    }
+    if (status.error == OrderErrc::InvalidRequest) {
+        throw std::invalid_argument(status.reason);
+    }
+    throw std::runtime_error(status.reason);
+}
+
+class OrderErrorCategory : public std::error_category {
+public:
+    const char* name() const noexcept override { return "order"; }
+
+    std::string message(int error) const override {
+        switch (static_cast<OrderErrc>(error)) {
+        case OrderErrc::Rejected:
+            return "Rejected by the exchange";
+        case OrderErrc::RiskRefused:
+            return "Refused by the risk gate";
+        case OrderErrc::InvalidRequest:
+            return "Invalid request";
+        case OrderErrc::NotSent:
+            return "Request not sent";
+        case OrderErrc::NoReply:
+            return "No reply before the connection closed";
+        }
+        return "Unknown order error";
+    }
+};
+
+}  // namespace
+
+const std::error_category& orderErrorCategory() {
+    static const OrderErrorCategory category;
+    return category;
+}
+
+std::error_code make_error_code(OrderErrc error) {
+    return std::error_code(static_cast<int>(error), orderErrorCategory());
+}
+
+alignas(64) std::atomic<int> OrderManager::sequence_num_{1};
+thread_local rapidjson::StringBuffer OrderManager::request_buffer_;
+thread_local OrderEncoder OrderManager::order_encoder_;
+thread_local ResponseParser OrderManager::response_parser_;
+thread_local OrderManager::BatchFrames OrderManager::batch_frames_;
+
+OrderManager::OrderManager(WsConnector& ws_conn)
+    : OrderManager(std::make_unique<ConnectionPool>(ws_conn), nullptr) {}
+
+OrderManager::OrderManager(ConnectionPool& pool)
+    : OrderManager(nullptr, &pool) {}
+
+OrderManager::OrderManager(std::unique_ptr<ConnectionPool> owned_pool, ConnectionPool* pool)
+    : owned_pool_(std::move(owned_pool)),
+      pool_(pool ? *pool : *owned_pool_),
+      links_(new Link[pool_.size()]),
+      risk_gate_(instruments_),
+      position_store_(instruments_),
+      books_(new std::atomic<TrackedBook*>[InstrumentCache::kMaxInstruments]),
+      pending_requests_(kMaxInFlight) {
+    for (size_t i = 0; i < InstrumentCache::kMaxInstruments; ++i) {
+        books_[i].store(nullptr, std::memory_order_relaxed);
+    }
+    order_store_.setExposureListener([this](const OrderRecord& order, double working_delta, double filled_delta) {
+        risk_gate_.onExposure(order.instrument_name.view(), order.is_buy, working_delta, filled_delta);
+    });
+}
 
 OrderManager::~OrderManager() {
+    stop();
+    std::unique_lock<std::shared_mutex> lock(feed_mutex_);
     feed_handlers_.clear();
 }
 
@@ -27,268 +162,1715 @@ int OrderManager::generateSequenceNum() {
     return sequence_num_.fetch_add(1, std::memory_order_relaxed);
 }
 
-void OrderManager::processMarketFeed(const rapidjson::Document& feed) {
-    for (const auto& [asset, handler] : feed_handlers_) {
-        if (feed.HasMember(asset.c_str())) {
-            handler(feed);
+void OrderManager::start() {
+    if (running_.exchange(true)) {
+        return;
+    }
+
+    int64_t now = PerformanceTracker::now();
+    try {
+        for (size_t link = 0; link < pool_.size(); ++link) {
+            links_[link].last_receive_ns.store(now, std::memory_order_relaxed);
+            pool_.connection(link).startReading(
+                [this, link](std::string_view frame) { onFrame(link, frame); },
+                [this](const std::string& reason) { onConnectionClosed(reason); });
         }
+    } catch (...) {
+        stop();
+        throw;
     }
 }
 
-void OrderManager::onFeedReceived(const rapidjson::Document& market_feed) {
-    auto feed_start = PerformanceTracker::beginTiming();
-    processMarketFeed(market_feed);
-    PerformanceTracker::endTiming(feed_start, "Feed Processing Time");
+void OrderManager::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+
+    for (size_t link = 0; link < pool_.size(); ++link) {
+        pool_.connection(link).stopReading();
+    }
+    failPendingRequests("Order manager stopped");
 }
 
-rapidjson::Document OrderManager::performAuthentication(const std::string& id, const std::string& secret) {
+void OrderManager::onConnectionClosed(const std::string& reason) {
+    failPendingRequests("Connection closed: " + reason);
+    if (!running_.load(std::memory_order_acquire)) {
+        return;  // stop() closed it
+    }
+
+    // Deltas stop with the connection; readers must not see the stale book as current
+    resetTrackedBooks();
+    if (disconnect_handler_) {
+        disconnect_handler_(reason);
+    }
+}
+
+void OrderManager::enableHeartbeat(int interval_seconds) {
     try {
-        json_cache_.SetObject();
-        auto& allocator = json_cache_.GetAllocator();
+        for (size_t link = 0; link < pool_.size(); ++link) {
+            int seq = generateSequenceNum();
+            rapidjson::Document result = call(link, seq, buildHeartbeatRequest(seq, interval_seconds));
+            checkReply(result, "Heartbeat error");
+        }
+        heartbeat_interval_.store(interval_seconds, std::memory_order_relaxed);
+    } catch (const std::exception& ex) {
+        LOG_ERROR("Heartbeat setup error: {}", ex.what());
+        throw;
+    }
+}
 
-        json_cache_.AddMember("jsonrpc", "2.0", allocator);
-        json_cache_.AddMember("method", "public/auth", allocator);
+void OrderManager::sendTest() {
+    for (size_t link = 0; link < pool_.size(); ++link) {
+        sendTest(link);
+    }
+}
 
-        rapidjson::Value params(rapidjson::kObjectType);
-        params.AddMember("grant_type", "client_credentials", allocator);
-        params.AddMember("client_id", rapidjson::Value(id.c_str(), allocator), allocator);
-        params.AddMember("client_secret", rapidjson::Value(secret.c_str(), allocator), allocator);
+void OrderManager::sendTest(size_t link) {
+    int seq = generateSequenceNum();
+    sendWithoutReply(link, seq, buildTestRequest(seq));
+}
+
+int64_t OrderManager::lastReceiveNs() const {
+    int64_t quietest = links_[0].last_receive_ns.load(std::memory_order_relaxed);
+    for (size_t link = 1; link < pool_.size(); ++link) {
+        quietest = std::min(quietest, links_[link].last_receive_ns.load(std::memory_order_relaxed));
+    }
+    return quietest;
+}
 
-        json_cache_.AddMember("params", params, allocator);
-        json_cache_.AddMember("id", generateSequenceNum(), allocator);
+void OrderManager::restoreSession() {
+    std::string id;
+    std::string secret;
+    {
+        std::lock_guard<std::mutex> lock(auth_mutex_);
+        id = client_id_;
+        secret = client_secret_;
+    }
+    if (!id.empty()) {
+        performAuthentication(id, secret);  // Authentication belongs to the connections, so new ones need it again
+    }
 
-        rapidjson::StringBuffer buffer;
-        rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-        json_cache_.Accept(writer);
+    std::vector<std::string> channels;
+    {
+        std::shared_lock<std::shared_mutex> lock(feed_mutex_);
+        channels = feed_handlers_.channels();
+    }
+    if (!channels.empty()) {
+        subscribe(channels);
+    }
 
-        ws_conn_.transmit(buffer.GetString());
-        std::string reply = ws_conn_.receive();
+    int interval = heartbeat_interval_.load(std::memory_order_relaxed);
+    if (interval > 0) {
+        enableHeartbeat(interval);
+    }
+}
 
-        rapidjson::Document result;
-        result.Parse(reply.c_str());
+size_t OrderManager::pendingRequests() const {
+    std::lock_guard<std::mutex> lock(pending_mutex_);
+    return pending_count_;
+}
 
-        if (!result.HasMember("result")) {
-            throw std::runtime_error("Auth error: " + reply);
+void OrderManager::registerRequest(int seq, int64_t sent_ns, ReplyHandler handler) {
+    ReplyHandler expired;
+    int expired_seq = 0;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        PendingRequest& slot = pending_requests_[static_cast<size_t>(seq) & (kMaxInFlight - 1)];
+        if (slot.active) {
+            // A request kMaxInFlight ids old never got its reply; give up on it
+            expired = std::move(slot.handler);
+            expired_seq = slot.seq;
+            --pending_count_;
         }
+        slot.seq = seq;
+        slot.active = true;
+        slot.sent_ns = sent_ns;
+        slot.handler = std::move(handler);
+        ++pending_count_;
+    }
 
-        // Store the access token for future requests
-        access_token_ = result["result"]["access_token"].GetString();
+    if (expired_seq != 0) {
+        settleRequest(expired_seq, "Request expired without reply");
+        deliverError(expired, expired_seq, "Request expired without reply");
+    }
+}
 
-        rapidjson::Document auth_result;
-        auth_result.SetObject();
-        auth_result.CopyFrom(result["result"], auth_result.GetAllocator());
+void OrderManager::abandonRequest(int seq, std::string_view reason) {
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        PendingRequest& slot = pending_requests_[static_cast<size_t>(seq) & (kMaxInFlight - 1)];
+        if (!slot.active || slot.seq != seq) {
+            return;  // The reply got there first
+        }
+        slot.handler = std::monostate{};
+        slot.active = false;
+        --pending_count_;
+    }
+    settleRequest(seq, reason);
+}
 
-        return auth_result;
-    } catch (const std::exception& ex) {
-        std::cerr << "Authentication issue: " << ex.what() << std::endl;
+void OrderManager::settleRequest(int seq, std::string_view reason) {
+    // As if the exchange had refused it: a pending order stops counting against the risk limits
+    // and a pending cancel leaves its order open; a late reply or user.orders still corrects both
+    OrderAck error;
+    setError(error, seq, reason);
+    order_store_.onReply(seq, error);
+}
+
+void OrderManager::sendRequest(size_t link, int seq, std::string_view payload, ReplyHandler handler) {
+    if (!trySendRequest(link, seq, payload, std::move(handler))) {
+        throw std::runtime_error(kQueueFull);
+    }
+}
+
+bool OrderManager::trySendRequest(size_t link, int seq, std::string_view payload, ReplyHandler handler) {
+    int64_t send_start = PerformanceTracker::now();
+
+    // Register before writing so a fast reply always finds its caller
+    registerRequest(seq, send_start, std::move(handler));
+
+    bool queued = false;
+    try {
+        queued = pool_.connection(link).tryTransmitAsync(&payload, 1);
+    } catch (...) {
+        abandonRequest(seq, "Request not sent");
         throw;
     }
+    if (!queued) {
+        abandonRequest(seq, "Request not sent");
+        return false;
+    }
+    PerformanceTracker::record(kSendProbe, PerformanceTracker::now() - send_start);
+    return true;
 }
 
-rapidjson::Document OrderManager::submitBuyOrder(const std::string& asset, double qty, double rate) {
+RequestStatus OrderManager::checkBatch(size_t count) const {
+    if (!running_.load(std::memory_order_acquire)) {
+        return failed(OrderErrc::NotSent, "Batch requests need start()");
+    }
+    if (count > WsConnector::kWriteSlots) {
+        return failed(OrderErrc::InvalidRequest, "Batch larger than the write queue");
+    }
+    return RequestStatus{};
+}
+
+template <typename Encode>
+RequestStatus OrderManager::trySendBatch(size_t link, size_t count, Encode&& encode, BatchHandler handler) {
+    if (count == 0) {
+        // Still on the io thread and never inside this call, as for a batch with replies
+        boost::asio::post(pool_.connection(link).executor(), [handler = std::move(handler)] {
+            BatchResult empty;
+            handler(empty);
+        });
+        return RequestStatus{};
+    }
+
+    int64_t send_start = PerformanceTracker::now();
+    BatchFrames& frames = batch_frames_;
+    frames.bytes.clear();
+    frames.ends.clear();
+    frames.seqs.clear();
+    frames.views.clear();
+    for (size_t i = 0; i < count; ++i) {
+        int seq = generateSequenceNum();
+        std::string_view payload;
+        RequestStatus status = encode(i, seq, payload);
+        if (!status.ok()) {
+            return status;  // Nothing registered yet
+        }
+        frames.bytes.append(payload);
+        frames.ends.push_back(frames.bytes.size());
+        frames.seqs.push_back(seq);
+    }
+    size_t begin = 0;
+    for (size_t end : frames.ends) {
+        frames.views.emplace_back(frames.bytes.data() + begin, end - begin);
+        begin = end;
+    }
+
+    struct BatchState {
+        BatchResult result;
+        std::atomic<size_t> remaining;
+        BatchHandler handler;
+        int64_t start_ns;
+    };
+    auto state = std::make_shared<BatchState>();
+    state->result.acks.resize(count);
+    state->remaining.store(count, std::memory_order_relaxed);
+    state->handler = std::move(handler);
+    state->start_ns = send_start;
+
+    // Every leg is registered before the burst so no reply can beat its slot
+    for (size_t i = 0; i < count; ++i) {
+        AckHandler leg = [state, i](const OrderAck& ack) {
+            state->result.acks[i] = ack;
+            if (state->remaining.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+                return;
+            }
+            BatchResult& result = state->result;
+            for (const OrderAck& reply : result.acks) {
+                ++(reply.ok() ? result.succeeded : result.failed);
+            }
+            result.elapsed_ns = PerformanceTracker::now() - state->start_ns;
+            state->handler(result);
+        };
+        registerRequest(frames.seqs[i], send_start, std::move(leg));
+    }
+
+    bool queued = false;
     try {
-        json_cache_.SetObject();
-        auto& allocator = json_cache_.GetAllocator();
+        queued = pool_.connection(link).tryTransmitAsync(frames.views.data(), frames.views.size());
+    } catch (...) {
+        for (int seq : frames.seqs) {
+            abandonRequest(seq, "Request not sent");
+        }
+        throw;
+    }
+    if (!queued) {
+        for (int seq : frames.seqs) {
+            abandonRequest(seq, "Request not sent");
+        }
+        return failed(OrderErrc::NotSent, kQueueFull);
+    }
+    PerformanceTracker::record(kSendProbe, PerformanceTracker::now() - send_start);
+    return RequestStatus{};
+}
 
-        json_cache_.AddMember("jsonrpc", "2.0", allocator);
-        json_cache_.AddMember("method", "private/buy", allocator);
-        json_cache_.AddMember("id", generateSequenceNum(), allocator);
+rapidjson::Document OrderManager::call(size_t link, int seq, std::string_view payload) {
+    if (running_.load(std::memory_order_acquire)) {
+        auto [handler, reply] = makePromiseHandler();
+        sendRequest(link, seq, payload, std::move(handler));
+        int64_t timeout_ms = request_timeout_ms_.load(std::memory_order_relaxed);
+        if (timeout_ms > 0 && reply.wait_for(std::chrono::milliseconds(timeout_ms)) != std::future_status::ready) {
+            std::string reason = "No reply to request " + std::to_string(seq) + " within " +
+                                 std::to_string(timeout_ms) + " ms";
+            abandonRequest(seq, reason);
+            throw std::runtime_error(reason);
+        }
+        return reply.get();
+    }
 
-        rapidjson::Value params(rapidjson::kObjectType);
-        params.AddMember("instrument_name", rapidjson::Value(asset.c_str(), allocator), allocator);
-        params.AddMember("amount", qty, allocator);
-        params.AddMember("price", rate, allocator);
-        params.AddMember("type", "limit", allocator);
-        params.AddMember("post_only", true, allocator);
-        params.AddMember("access_token", rapidjson::Value(access_token_.c_str(), allocator), allocator);  // Auth
+    // Blocking fallback before start(): skip frames until our id comes back
+    try {
+        return receiveReply(link, seq, payload);
+    } catch (const std::exception& ex) {
+        settleRequest(seq, ex.what());
+        throw;
+    }
+}
 
-        json_cache_.AddMember("params", params, allocator);
+rapidjson::Document OrderManager::receiveReply(size_t link, int seq, std::string_view payload) {
+    WsConnector& connection = pool_.connection(link);
+    connection.transmit(payload);
+    while (true) {
+        std::string_view frame = connection.receiveView();  // Valid until the next receive
+        MessageArena::Cycle cycle;
 
-        rapidjson::StringBuffer buffer;
-        rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-        json_cache_.Accept(writer);
+        const ParsedMessage* message = parseFrame(frame);
+        if (!message) {
+            continue;
+        }
+        if (!message->has_id) {
+            onFeedReceived(*message, frame);
+            continue;
+        }
+        if (message->status.id == seq) {
+            onReply(*message);
 
-        ws_conn_.transmit(buffer.GetString());
-        std::string reply = ws_conn_.receive();
+            rapidjson::Document result;
+            result.Parse(frame.data(), frame.size());
+            return result;
+        }
+    }
+}
 
-        rapidjson::Document result;
-        result.Parse(reply.c_str());
+void OrderManager::onFrame(size_t link, std::string_view frame) {
+    links_[link].last_receive_ns.store(PerformanceTracker::now(), std::memory_order_relaxed);
+    MessageArena::Cycle cycle;  // Whatever handling this frame takes from the thread's arena goes back after it
+    const ParsedMessage* message = parseFrame(frame);
+    if (!message) {
+        LOG_WARN("Discarding malformed frame: {}", frame);
+        return;
+    }
 
-        if (result.HasMember("error")) {
-            throw std::runtime_error("Buy order error: " + std::string(buffer.GetString()));
+    if (message->has_id) {
+        onReply(*message);
+        completeRequest(*message, frame);
+        return;
+    }
+    if (message->test_request) {
+        sendTest(link);  // The exchange closes the connection if this goes unanswered
+        return;
+    }
+
+    onFeedReceived(*message, frame);  // Unsolicited notification
+}
+
+void OrderManager::replayFrame(std::string_view frame) {
+    MessageArena::Cycle cycle;
+    const ParsedMessage* message = parseFrame(frame);
+    // A captured reply answers another session's request, and a captured test_request was answered live
+    if (!message || message->has_id || message->test_request) {
+        return;
+    }
+    onFeedReceived(*message, frame);
+}
+
+const ParsedMessage* OrderManager::parseFrame(std::string_view frame) {
+    ResponseParser& parser = response_parser_;
+    PerformanceTracker::Timer timer(kParseProbe);
+    return parser.parse(frame.data(), frame.size()) ? &parser.message() : nullptr;
+}
+
+void OrderManager::onReply(const ParsedMessage& reply) {
+    // Order replies, mass-cancel counts and errors that may answer an order request move the order store first
+    order_store_.onReply(reply.status.id, reply.ack);
+
+    // A full book in any reply reseeds the local copy when the instrument is tracked
+    if (!reply.has_book || reply.book.is_change || !reply.status.ok() || reply.book.instrument_name.empty()) {
+        return;
+    }
+    if (TrackedBook* tracked = findTrackedBook(reply.book.instrument_name.view())) {
+        std::shared_lock<std::shared_mutex> feed_lock(feed_mutex_);
+        std::lock_guard<std::mutex> lock(tracked->mutex);
+        tracked->book.apply(reply.book);
+        notifyBookListener(*tracked);
+    }
+}
+
+void OrderManager::completeRequest(const ParsedMessage& reply, std::string_view frame) {
+    int seq = reply.status.id;
+    ReplyHandler handler;
+    int64_t sent_ns = 0;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        PendingRequest& slot = pending_requests_[static_cast<size_t>(seq) & (kMaxInFlight - 1)];
+        if (!slot.active || slot.seq != seq) {
+            return;  // Late reply for a request nobody waits on anymore
+        }
+        handler = std::move(slot.handler);
+        sent_ns = slot.sent_ns;
+        slot.handler = std::monostate{};
+        slot.active = false;
+        --pending_count_;
+    }
+    PerformanceTracker::record(kAckProbe, PerformanceTracker::now() - sent_ns);
+
+    std::visit([&](auto& callback) {
+        using Callback = std::decay_t<decltype(callback)>;
+        if constexpr (!std::is_same_v<Callback, std::monostate>) {
+            if (!callback) {
+                return;
+            }
+            if constexpr (std::is_same_v<Callback, ResponseHandler>) {
+                // Only DOM consumers pay for the full parse
+                rapidjson::Document document;
+                document.Parse(frame.data(), frame.size());
+                callback(document);
+            } else if constexpr (std::is_same_v<Callback, AckHandler>) {
+                callback(reply.ack);
+            } else if constexpr (std::is_same_v<Callback, BookHandler>) {
+                callback(reply.book);
+            } else if constexpr (std::is_same_v<Callback, PositionsHandler>) {
+                callback(reply.status, reply.positions);
+            } else {
+                callback(reply.status, reply.result_count);
+            }
         }
+    }, handler);
+}
 
-        return result;
+void OrderManager::failPendingRequests(const std::string& reason) {
+    std::vector<std::pair<int, ReplyHandler>> orphaned;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        for (PendingRequest& slot : pending_requests_) {
+            if (slot.active) {
+                orphaned.emplace_back(slot.seq, std::move(slot.handler));
+                slot.handler = std::monostate{};
+                slot.active = false;
+            }
+        }
+        pending_count_ = 0;
+    }
+
+    for (auto& [seq, handler] : orphaned) {
+        settleRequest(seq, reason);
+        deliverError(handler, seq, reason);
+    }
+}
+
+void OrderManager::deliverError(ReplyHandler& handler, int seq, std::string_view reason) {
+    std::visit([&](auto& callback) {
+        using Callback = std::decay_t<decltype(callback)>;
+        if constexpr (!std::is_same_v<Callback, std::monostate>) {
+            if (!callback) {
+                return;
+            }
+            if constexpr (std::is_same_v<Callback, ResponseHandler>) {
+                rapidjson::Document error_reply = makeErrorReply(seq, reason);
+                callback(error_reply);
+            } else if constexpr (std::is_same_v<Callback, AckHandler>) {
+                OrderAck ack;
+                setError(ack, seq, reason);
+                callback(ack);
+            } else if constexpr (std::is_same_v<Callback, BookHandler>) {
+                BookSnapshot book;
+                setError(book, seq, reason);
+                callback(book);
+            } else if constexpr (std::is_same_v<Callback, PositionsHandler>) {
+                RpcStatus status;
+                setError(status, seq, reason);
+                callback(status, {});
+            } else {
+                RpcStatus status;
+                setError(status, seq, reason);
+                callback(status, 0);
+            }
+        }
+    }, handler);
+}
+
+rapidjson::Document OrderManager::makeErrorReply(int seq, std::string_view reason) {
+    rapidjson::Document error_reply;
+    error_reply.SetObject();
+    auto& allocator = error_reply.GetAllocator();
+
+    rapidjson::Value error(rapidjson::kObjectType);
+    error.AddMember("code", -1, allocator);
+    error.AddMember("message", rapidjson::Value(reason.data(), static_cast<rapidjson::SizeType>(reason.size()),
+                                                allocator), allocator);
+    error_reply.AddMember("id", seq, allocator);
+    error_reply.AddMember("error", error, allocator);
+    return error_reply;
+}
+
+void OrderManager::processMarketFeed(const ParsedMessage& feed, std::string_view frame) {
+    // Only subscription notifications carry market data
+    if (!feed.is_subscription || feed.channel.empty()) {
+        return;
+    }
+
+    std::shared_lock<std::shared_mutex> lock(feed_mutex_);
+    if (const auto* handler = feed_handlers_.find(feed.channel.view())) {
+        (*handler)(FeedMessage(feed, frame));
+    }
+}
+
+void OrderManager::onFeedReceived(const ParsedMessage& market_feed, std::string_view frame) {
+    PerformanceTracker::Timer timer(kDispatchProbe);
+    processMarketFeed(market_feed, frame);
+}
+
+std::string_view OrderManager::serializeRequest(const rapidjson::Value& request) {
+    rapidjson::StringBuffer& buffer = request_buffer_;
+    buffer.Clear();  // Keeps its capacity
+    ArenaStackAllocator stack_allocator;
+    rapidjson::Writer<rapidjson::StringBuffer, rapidjson::UTF8<>, rapidjson::UTF8<>, ArenaStackAllocator> writer(
+        buffer, &stack_allocator);
+    request.Accept(writer);
+    return std::string_view(buffer.GetString(), buffer.GetSize());
+}
+
+std::string_view OrderManager::buildSubscriptionRequest(int seq, const char* method, const std::vector<std::string>& channels) {
+    MessageArena::Cycle cycle;
+    ScratchDocument request;
+    request->SetObject();
+    auto& allocator = request->GetAllocator();
+
+    request->AddMember("jsonrpc", "2.0", allocator);
+    request->AddMember("method", rapidjson::StringRef(method), allocator);
+    request->AddMember("id", seq, allocator);
+
+    rapidjson::Value channel_list(rapidjson::kArrayType);
+    for (const auto& channel : channels) {
+        rapidjson::Value name(channel.c_str(), allocator);
+        channel_list.PushBack(name, allocator);
+    }
+
+    rapidjson::Value params(rapidjson::kObjectType);
+    params.AddMember("channels", channel_list, allocator);
+
+    request->AddMember("params", params, allocator);
+
+    return serializeRequest(*request);
+}
+
+std::string_view OrderManager::buildHeartbeatRequest(int seq, int interval_seconds) {
+    MessageArena::Cycle cycle;
+    ScratchDocument request;
+    request->SetObject();
+    auto& allocator = request->GetAllocator();
+
+    request->AddMember("jsonrpc", "2.0", allocator);
+    request->AddMember("method", "public/set_heartbeat", allocator);
+    request->AddMember("id", seq, allocator);
+
+    rapidjson::Value params(rapidjson::kObjectType);
+    params.AddMember("interval", interval_seconds, allocator);
+
+    request->AddMember("params", params, allocator);
+
+    return serializeRequest(*request);
+}
+
+std::string_view OrderManager::buildTestRequest(int seq) {
+    MessageArena::Cycle cycle;
+    ScratchDocument request;
+    request->SetObject();
+    auto& allocator = request->GetAllocator();
+
+    request->AddMember("jsonrpc", "2.0", allocator);
+    request->AddMember("method", "public/test", allocator);
+    request->AddMember("id", seq, allocator);
+
+    return serializeRequest(*request);
+}
+
+std::string_view OrderManager::buildAuthRequest(int seq, const std::string& id, const std::string& secret) {
+    MessageArena::Cycle cycle;
+    ScratchDocument request;
+    request->SetObject();
+    auto& allocator = request->GetAllocator();
+
+    request->AddMember("jsonrpc", "2.0", allocator);
+    request->AddMember("method", "public/auth", allocator);
+
+    rapidjson::Value params(rapidjson::kObjectType);
+    params.AddMember("grant_type", "client_credentials", allocator);
+    params.AddMember("client_id", rapidjson::Value(id.c_str(), allocator), allocator);
+    params.AddMember("client_secret", rapidjson::Value(secret.c_str(), allocator), allocator);
+
+    request->AddMember("params", params, allocator);
+    request->AddMember("id", seq, allocator);
+
+    return serializeRequest(*request);
+}
+
+std::string_view OrderManager::buildRefreshRequest(int seq, const std::string& refresh_token) {
+    MessageArena::Cycle cycle;
+    ScratchDocument request;
+    request->SetObject();
+    auto& allocator = request->GetAllocator();
+
+    request->AddMember("jsonrpc", "2.0", allocator);
+    request->AddMember("method", "public/auth", allocator);
+
+    rapidjson::Value params(rapidjson::kObjectType);
+    params.AddMember("grant_type", "refresh_token", allocator);
+    params.AddMember("refresh_token", rapidjson::Value(refresh_token.c_str(), allocator), allocator);
+
+    request->AddMember("params", params, allocator);
+    request->AddMember("id", seq, allocator);
+
+    return serializeRequest(*request);
+}
+
+std::string_view OrderManager::buildOrderBookRequest(int seq, const std::string& asset) {
+    MessageArena::Cycle cycle;
+    ScratchDocument request;
+    request->SetObject();
+    auto& allocator = request->GetAllocator();
+
+    request->AddMember("jsonrpc", "2.0", allocator);
+    request->AddMember("method", "public/get_order_book", allocator);
+    request->AddMember("id", seq, allocator);
+
+    rapidjson::Value params(rapidjson::kObjectType);
+    params.AddMember("instrument_name", rapidjson::Value(asset.c_str(), allocator), allocator);
+
+    request->AddMember("params", params, allocator);
+
+    return serializeRequest(*request);
+}
+
+std::string_view OrderManager::buildInstrumentsRequest(int seq, const std::string& curr, const std::string& type,
+                                                  bool is_expired) {
+    MessageArena::Cycle cycle;
+    ScratchDocument request;
+    request->SetObject();
+    auto& allocator = request->GetAllocator();
+
+    request->AddMember("jsonrpc", "2.0", allocator);
+    request->AddMember("method", "public/get_instruments", allocator);
+    request->AddMember("id", seq, allocator);
+
+    rapidjson::Value params(rapidjson::kObjectType);
+    params.AddMember("currency", rapidjson::Value(curr.c_str(), allocator), allocator);
+    if (!type.empty() && type != "any") {
+        params.AddMember("kind", rapidjson::Value(type.c_str(), allocator), allocator);
+    }
+    params.AddMember("expired", is_expired, allocator);
+
+    request->AddMember("params", params, allocator);
+
+    return serializeRequest(*request);
+}
+
+std::string_view OrderManager::buildPositionsRequest(int seq, std::string_view currency) {
+    MessageArena::Cycle cycle;
+    ScratchDocument request;
+    request->SetObject();
+    auto& allocator = request->GetAllocator();
+
+    request->AddMember("jsonrpc", "2.0", allocator);
+    request->AddMember("method", "private/get_positions", allocator);
+    request->AddMember("id", seq, allocator);
+
+    rapidjson::Value params(rapidjson::kObjectType);
+    params.AddMember("currency", rapidjson::Value(currency.data(), static_cast<rapidjson::SizeType>(currency.size()),
+                                                  allocator), allocator);  // Required
+
+    request->AddMember("params", params, allocator);
+
+    return serializeRequest(*request);
+}
+
+rapidjson::Document OrderManager::performAuthentication(const std::string& id, const std::string& secret) {
+    try {
+        rapidjson::Document auth_result;
+        for (size_t link : pool_.members(ConnectionRole::OrderEntry)) {
+            int seq = generateSequenceNum();
+            rapidjson::Document result = call(link, seq, buildAuthRequest(seq, id, secret));
+
+            if (!result.HasMember("result")) {
+                throw std::runtime_error("Auth error: " + serializeValue(result));
+            }
+
+            // The connection is now authenticated; only the refresh token is needed from here on
+            storeSessionToken(link, result["result"]);
+            if (auth_result.IsNull()) {
+                // Keep the first reply and lift its result to the root: swapped in place, nothing copied
+                rapidjson::Value session;
+                session.Swap(result["result"]);
+                static_cast<rapidjson::Value&>(result).Swap(session);
+                auth_result.Swap(result);
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(auth_mutex_);
+            client_id_ = id;
+            client_secret_ = secret;
+        }
+
+        return auth_result;
     } catch (const std::exception& ex) {
-        std::cerr << "Buy order error: " << ex.what() << std::endl;
+        LOG_ERROR("Authentication issue: {}", ex.what());
         throw;
     }
 }
 
-rapidjson::Document OrderManager::removeOrder(const std::string& order_ref) {
-    try {
-        json_cache_.SetObject();
-        auto& allocator = json_cache_.GetAllocator();
+void OrderManager::storeSessionToken(size_t link, const rapidjson::Value& result) {
+    int64_t now = PerformanceTracker::now();
+    int64_t lifetime_ns = 0;
+    if (result.HasMember("expires_in") && result["expires_in"].IsNumber()) {
+        lifetime_ns = static_cast<int64_t>(result["expires_in"].GetDouble() * 1e9);
+    }
 
-        json_cache_.AddMember("jsonrpc", "2.0", allocator);
-        json_cache_.AddMember("method", "private/cancel", allocator);
-        json_cache_.AddMember("id", generateSequenceNum(), allocator);
+    Link& state = links_[link];
+    bool refreshable = false;
+    {
+        std::lock_guard<std::mutex> lock(auth_mutex_);
+        state.refresh_token.clear();
+        if (result.HasMember("refresh_token") && result["refresh_token"].IsString()) {
+            state.refresh_token = result["refresh_token"].GetString();
+        }
+        refreshable = !state.refresh_token.empty();
+    }
+    state.auth_expires_ns.store(lifetime_ns > 0 ? now + lifetime_ns : 0, std::memory_order_relaxed);
+    state.auth_refresh_due_ns.store(lifetime_ns > 0 && refreshable
+                                        ? now + static_cast<int64_t>(lifetime_ns * kAuthRefreshFraction) : 0,
+                                    std::memory_order_relaxed);
+}
 
-        rapidjson::Value params(rapidjson::kObjectType);
-        params.AddMember("order_id", rapidjson::Value(order_ref.c_str(), allocator), allocator);
-        params.AddMember("access_token", rapidjson::Value(access_token_.c_str(), allocator), allocator);  // Auth
+int64_t OrderManager::authExpiresNs() const {
+    int64_t earliest = 0;
+    for (size_t link : pool_.members(ConnectionRole::OrderEntry)) {
+        int64_t expires_ns = links_[link].auth_expires_ns.load(std::memory_order_relaxed);
+        if (expires_ns != 0 && (earliest == 0 || expires_ns < earliest)) {
+            earliest = expires_ns;
+        }
+    }
+    return earliest;
+}
 
-        json_cache_.AddMember("params", params, allocator);
+void OrderManager::refreshAuthenticationIfDue(int64_t now_ns) {
+    if (!running_.load(std::memory_order_acquire)) {
+        return;
+    }
+    for (size_t link : pool_.members(ConnectionRole::OrderEntry)) {
+        refreshLink(link, now_ns);
+    }
+}
 
-        rapidjson::StringBuffer buffer;
-        rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-        json_cache_.Accept(writer);
+void OrderManager::refreshLink(size_t link, int64_t now_ns) {
+    Link& state = links_[link];
+    int64_t due_ns = state.auth_refresh_due_ns.load(std::memory_order_relaxed);
+    if (due_ns == 0 || now_ns < due_ns) {
+        return;
+    }
+    if (state.auth_refresh_in_flight.exchange(true, std::memory_order_acq_rel)) {
+        return;
+    }
 
-        ws_conn_.transmit(buffer.GetString());
-        std::string reply = ws_conn_.receive();
+    int seq = generateSequenceNum();
+    std::string payload;
+    {
+        std::lock_guard<std::mutex> lock(auth_mutex_);
+        payload = buildRefreshRequest(seq, state.refresh_token);
+    }
+    try {
+        sendRequest(link, seq, payload,
+                    ResponseHandler([this, link](rapidjson::Document& reply) { onRefreshReply(link, reply); }));
+    } catch (const std::exception& ex) {
+        state.auth_refresh_in_flight.store(false, std::memory_order_release);
+        state.auth_refresh_due_ns.store(now_ns + kAuthRetryNs, std::memory_order_relaxed);
+        LOG_ERROR("Access token refresh not sent: {}", ex.what());
+    }
+}
 
-        rapidjson::Document result;
-        result.Parse(reply.c_str());
+void OrderManager::onRefreshReply(size_t link, rapidjson::Document& reply) {
+    Link& state = links_[link];
+    if (reply.HasMember("result") && reply["result"].IsObject() && reply["result"].HasMember("access_token")) {
+        storeSessionToken(link, reply["result"]);
+        LOG_INFO("Access token refreshed on connection {}", link);
+    } else {
+        // Retried shortly; a reconnect re-authenticates with the client credentials regardless
+        state.auth_refresh_due_ns.store(PerformanceTracker::now() + kAuthRetryNs, std::memory_order_relaxed);
+        LOG_ERROR("Access token refresh failed: {}", serializeValue(reply));
+    }
+    state.auth_refresh_in_flight.store(false, std::memory_order_release);
+}
 
-        if (result.HasMember("error")) {
-            throw std::runtime_error("Order removal error: " + std::string(buffer.GetString()));
+rapidjson::Document OrderManager::submitOrder(const OrderRequest& request) {
+    int seq = 0;
+    try {
+        OrderRequest order = alignToGrid(request);
+        admitOrder(order);
+        seq = generateSequenceNum();
+        noteSubmit(seq, order);
+        rapidjson::Document result = call(orderLink(order.instrument), seq, encodeOrder(seq, order));
+        checkReply(result, request.side == Side::Buy ? "Buy order error" : "Sell order error");
+        return result;
+    } catch (const std::exception& ex) {
+        if (seq != 0) {
+            settleRequest(seq, ex.what());  // No-op if the reply settled it; else releases the reservation
         }
+        LOG_ERROR("{} order error: {}", request.side == Side::Buy ? "Buy" : "Sell", ex.what());
+        throw;
+    }
+}
+
+rapidjson::Document OrderManager::submitBuyOrder(const std::string& asset, double qty, double rate) {
+    return submitOrder(postOnlyLimit(asset, Side::Buy, qty, rate));
+}
+
+rapidjson::Document OrderManager::submitSellOrder(const std::string& asset, double qty, double rate) {
+    return submitOrder(postOnlyLimit(asset, Side::Sell, qty, rate));
+}
 
+rapidjson::Document OrderManager::removeOrder(const std::string& order_ref) {
+    try {
+        int seq = generateSequenceNum();
+        std::string_view payload = order_encoder_.encodeCancel(seq, order_ref);
+        order_store_.onCancel(seq, order_ref);  // After encoding, which can throw; a lost reply reverts it
+        rapidjson::Document result = call(orderLinkFor(order_ref), seq, payload);
+        checkReply(result, "Order removal error");
         return result;
     } catch (const std::exception& ex) {
-        std::cerr << "Order removal error: " << ex.what() << std::endl;
+        LOG_ERROR("Order removal error: {}", ex.what());
         throw;
     }
 }
 
 rapidjson::Document OrderManager::updateOrder(const std::string& order_ref, double new_rate, double new_qty) {
     try {
-        json_cache_.SetObject();
-        auto& allocator = json_cache_.GetAllocator();
-
-        json_cache_.AddMember("jsonrpc", "2.0", allocator);
-        json_cache_.AddMember("method", "private/edit", allocator);
-        json_cache_.AddMember("id", generateSequenceNum(), allocator);
+        int seq = generateSequenceNum();
+        rapidjson::Document result = call(orderLinkFor(order_ref), seq, encodeEdit(seq, order_ref, new_rate, new_qty));
+        checkReply(result, "Order update error");
+        return result;
+    } catch (const std::exception& ex) {
+        LOG_ERROR("Order update error: {}", ex.what());
+        throw;
+    }
+}
 
-        rapidjson::Value params(rapidjson::kObjectType);
-        params.AddMember("order_id", rapidjson::Value(order_ref.c_str(), allocator), allocator);
-        params.AddMember("price", new_rate, allocator);  // Corrected
-        params.AddMember("amount", new_qty, allocator);  // Corrected
-        params.AddMember("quantity", new_qty, allocator);  // Required for contracts
-        params.AddMember("access_token", rapidjson::Value(access_token_.c_str(), allocator), allocator);  // Auth
+rapidjson::Document OrderManager::fetchPositions(const std::string& currency) {
+    try {
+        int seq = generateSequenceNum();
+        std::string_view payload = buildPositionsRequest(seq, currency);
+        LOG_DEBUG("fetchPositions request: {}", payload);
 
-        json_cache_.AddMember("params", params, allocator);
+        rapidjson::Document result = call(orderLink({}), seq, payload);
+        LOG_DEBUG("fetchPositions response: {}", serializeValue(result));
 
-        rapidjson::StringBuffer buffer;
-        rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-        json_cache_.Accept(writer);
+        checkReply(result, "Position fetch error");
+        return result;
+    } catch (const std::exception& ex) {
+        LOG_ERROR("Position fetch error: {}", ex.what());
+        throw;
+    }
+}
 
-        ws_conn_.transmit(buffer.GetString());
-        std::string reply = ws_conn_.receive();
+rapidjson::Document OrderManager::retrieveInstruments(const std::string& curr, const std::string& type,
+                                                      bool is_expired) {
+    try {
+        int seq = generateSequenceNum();
+        rapidjson::Document result = call(marketDataLink({}), seq, buildInstrumentsRequest(seq, curr, type, is_expired));
+        checkReply(result, "Instrument list error");
+        if (!result.HasMember("result") || !result["result"].IsArray()) {
+            throw std::runtime_error("Instrument list error: no result array");
+        }
 
-        rapidjson::Document result;
-        result.Parse(reply.c_str());
+        size_t loaded = 0;
+        for (const rapidjson::Value& entry : result["result"].GetArray()) {
+            if (!entry.IsObject() || !entry.HasMember("instrument_name") || !entry["instrument_name"].IsString()) {
+                continue;
+            }
+            auto text = [&entry](const char* key) {
+                return entry.HasMember(key) && entry[key].IsString()
+                           ? std::string_view(entry[key].GetString(), entry[key].GetStringLength())
+                           : std::string_view();
+            };
+            auto number = [&entry](const char* key) {
+                return entry.HasMember(key) && entry[key].IsNumber() ? entry[key].GetDouble() : 0.0;
+            };
+
+            InstrumentInfo info;
+            std::string_view name = text("instrument_name");
+            std::string_view base_currency = text("base_currency");
+            info.name.assign(name.data(), name.size());
+            info.base_currency.assign(base_currency.data(), base_currency.size());
+            info.kind = parseInstrumentKind(text("kind"));
+            info.tick_size = number("tick_size");
+            info.contract_size = number("contract_size");
+            info.min_trade_amount = number("min_trade_amount");
+            instruments_.update(info);
+            ++loaded;
+        }
+        LOG_INFO("Loaded {} {} {} instruments", loaded, curr, type);
+        return result;
+    } catch (const std::exception& ex) {
+        LOG_ERROR("Instrument list error: {}", ex.what());
+        throw;
+    }
+}
 
-        if (result.HasMember("error")) {
-            throw std::runtime_error("Order update error: " + std::string(buffer.GetString()));
+size_t OrderManager::loadInstruments(const std::string& curr, const std::string& type, const std::string& cache_path,
+                                     int64_t max_age_seconds) {
+    InstrumentKind kind = type.empty() || type == "any" ? InstrumentKind::Unknown : parseInstrumentKind(type);
+    if (instruments_.load(cache_path, max_age_seconds) > 0) {
+        size_t cached = instruments_.list(curr, kind).size();
+        if (cached > 0) {
+            LOG_INFO("Warm start: {} {} {} instruments from {}", cached, curr, type, cache_path);
+            return cached;
         }
+    }
+
+    retrieveInstruments(curr, type, false);
+    try {
+        instruments_.save(cache_path);
+    } catch (const std::exception& ex) {
+        LOG_WARN("Instrument cache not saved: {}", ex.what());
+    }
+    return instruments_.list(curr, kind).size();
+}
+
+rapidjson::Document OrderManager::retrieveOrderBook(const std::string& asset) {
+    try {
+        int seq = generateSequenceNum();
+        std::string_view payload = buildOrderBookRequest(seq, asset);
+        LOG_DEBUG("retrieveOrderBook request: {}", payload);
+
+        rapidjson::Document result = call(marketDataLink(asset), seq, payload);
+        LOG_DEBUG("retrieveOrderBook response: {}", serializeValue(result));
 
+        checkReply(result, "Order book error");
         return result;
     } catch (const std::exception& ex) {
-        std::cerr << "Order update error: " << ex.what() << std::endl;
+        LOG_ERROR("Order book error: {}", ex.what());
         throw;
     }
 }
 
- rapidjson::Document OrderManager::fetchPositions() {
+void OrderManager::submitOrderAsync(const OrderRequest& request, AckHandler handler) {
+    throwIfFailed(trySubmitOrderAsync(request, std::move(handler)));
+}
+
+RequestStatus OrderManager::trySubmitOrderAsync(const OrderRequest& request, AckHandler handler) {
+    OrderRequest order;
+    RequestStatus status = prepareOrder(request, order);
+    if (!status.ok()) {
+        return status;
+    }
+    RiskCheck result = risk_gate_.check(order, PerformanceTracker::now());
+    if (result != RiskCheck::Passed) {
+        return failed(OrderErrc::RiskRefused, toString(result), result);
+    }
+    int seq = generateSequenceNum();
+    noteSubmit(seq, order);
+    bool sent = false;
     try {
-        json_cache_.SetObject();
-        auto& allocator = json_cache_.GetAllocator();
+        sent = trySendRequest(orderLink(order.instrument), seq, encodeOrder(seq, order), std::move(handler));
+    } catch (const std::exception& ex) {
+        settleRequest(seq, ex.what());  // Retired as refused, which releases its reservation
+        risk_gate_.releaseRate();
+        throw;
+    }
+    if (!sent) {
+        // An unsent request is settled like a refusal, so its reservation is already back
+        risk_gate_.releaseRate();
+        return failed(OrderErrc::NotSent, kQueueFull);
+    }
+    return RequestStatus{};
+}
 
-        json_cache_.AddMember("jsonrpc", "2.0", allocator);
-        json_cache_.AddMember("method", "private/get_positions", allocator);
-        json_cache_.AddMember("id", generateSequenceNum(), allocator);
+void OrderManager::submitBuyOrderAsync(std::string_view asset, double qty, double rate, AckHandler handler) {
+    submitOrderAsync(postOnlyLimit(asset, Side::Buy, qty, rate), std::move(handler));
+}
 
-        rapidjson::Value params(rapidjson::kObjectType);
-        params.AddMember("currency", "BTC", allocator);  // Required
-        params.AddMember("access_token", rapidjson::Value(access_token_.c_str(), allocator), allocator);  // Auth
+void OrderManager::submitSellOrderAsync(std::string_view asset, double qty, double rate, AckHandler handler) {
+    submitOrderAsync(postOnlyLimit(asset, Side::Sell, qty, rate), std::move(handler));
+}
 
-        json_cache_.AddMember("params", params, allocator);
+void OrderManager::removeOrderAsync(std::string_view order_ref, AckHandler handler) {
+    throwIfFailed(tryRemoveOrderAsync(order_ref, std::move(handler)));
+}
 
-        rapidjson::StringBuffer buffer;
-        rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-        json_cache_.Accept(writer);
+void OrderManager::updateOrderAsync(std::string_view order_ref, double new_rate, double new_qty, AckHandler handler) {
+    throwIfFailed(tryUpdateOrderAsync(order_ref, new_rate, new_qty, std::move(handler)));
+}
 
-        // Debug: Print the request payload
-        std::cout << "Request Payload (fetchPositions): " << buffer.GetString() << std::endl;
+RequestStatus OrderManager::tryRemoveOrderAsync(std::string_view order_ref, AckHandler handler) {
+    if (const char* invalid = OrderEncoder::invalidText(order_ref)) {
+        return failed(OrderErrc::InvalidRequest, invalid);
+    }
+    int seq = generateSequenceNum();
+    std::string_view payload = order_encoder_.encodeCancel(seq, order_ref);
+    order_store_.onCancel(seq, order_ref);  // A failed send reverts it
+    if (!trySendRequest(orderLinkFor(order_ref), seq, payload, std::move(handler))) {
+        return failed(OrderErrc::NotSent, kQueueFull);
+    }
+    return RequestStatus{};
+}
 
-        ws_conn_.transmit(buffer.GetString());
-        std::string reply = ws_conn_.receive();
+RequestStatus OrderManager::tryUpdateOrderAsync(std::string_view order_ref, double new_rate, double new_qty,
+                                                AckHandler handler) {
+    int seq = generateSequenceNum();
+    std::string_view payload;
+    RequestStatus status = encodeEdit(seq, order_ref, new_rate, new_qty, payload);
+    if (!status.ok()) {
+        return status;
+    }
+    if (!trySendRequest(orderLinkFor(order_ref), seq, payload, std::move(handler))) {
+        return failed(OrderErrc::NotSent, kQueueFull);  // Settling the edit gave back what it held
+    }
+    return RequestStatus{};
+}
 
-        // Debug: Print the API response
-        std::cout << "API Response (fetchPositions): " << reply << std::endl;
+std::string_view OrderManager::encodeMassCancel(int seq, const char* method, const OrderFilter& filter) {
+    std::string_view key;
+    std::string_view value;
+    if (!filter.instrument.empty()) {
+        key = "instrument_name";
+        value = filter.instrument;
+    } else if (!filter.currency.empty()) {
+        key = "currency";
+        value = filter.currency;
+    } else if (!filter.label.empty()) {
+        key = "label";
+        value = filter.label;
+    }
+    std::string_view payload = order_encoder_.encodeCancelAll(seq, method, key, value);
+    order_store_.onCancelAll(seq, filter);  // After encoding, which can throw
+    return payload;
+}
 
-        rapidjson::Document result;
-        result.Parse(reply.c_str());
+int64_t OrderManager::massCancel(const char* method, const OrderFilter& filter) {
+    try {
+        int seq = generateSequenceNum();
+        rapidjson::Document result = call(orderLink(filter.instrument), seq, encodeMassCancel(seq, method, filter));
+        checkReply(result, "Mass cancel error");
+        return result.HasMember("result") && result["result"].IsInt64() ? result["result"].GetInt64() : 0;
+    } catch (const std::exception& ex) {
+        LOG_ERROR("Mass cancel error: {}", ex.what());
+        throw;
+    }
+}
 
-        if (result.HasMember("error")) {
-            throw std::runtime_error("Position fetch error: " + std::string(buffer.GetString()));
-        }
+void OrderManager::massCancelAsync(const char* method, const OrderFilter& filter, CancelAllHandler handler) {
+    int seq = generateSequenceNum();
+    sendRequest(orderLink(filter.instrument), seq, encodeMassCancel(seq, method, filter), std::move(handler));
+}
 
-        // Pretty-print the result
-        std::cout << "Position Details:\n" << prettyPrintJson(result) << std::endl;
+int64_t OrderManager::cancelAll() {
+    return massCancel("private/cancel_all", OrderFilter{});
+}
 
-        return result;
+int64_t OrderManager::cancelAllByInstrument(const std::string& asset) {
+    return massCancel("private/cancel_all_by_instrument", OrderFilter{asset, {}, {}});
+}
+
+int64_t OrderManager::cancelAllByCurrency(const std::string& currency) {
+    return massCancel("private/cancel_all_by_currency", OrderFilter{{}, currency, {}});
+}
+
+int64_t OrderManager::cancelByLabel(const std::string& label) {
+    return massCancel("private/cancel_by_label", OrderFilter{{}, {}, label});
+}
+
+void OrderManager::cancelAllAsync(CancelAllHandler handler) {
+    massCancelAsync("private/cancel_all", OrderFilter{}, std::move(handler));
+}
+
+void OrderManager::cancelAllByInstrumentAsync(std::string_view asset, CancelAllHandler handler) {
+    massCancelAsync("private/cancel_all_by_instrument", OrderFilter{asset, {}, {}}, std::move(handler));
+}
+
+void OrderManager::cancelAllByCurrencyAsync(std::string_view currency, CancelAllHandler handler) {
+    massCancelAsync("private/cancel_all_by_currency", OrderFilter{{}, currency, {}}, std::move(handler));
+}
+
+void OrderManager::cancelByLabelAsync(std::string_view label, CancelAllHandler handler) {
+    massCancelAsync("private/cancel_by_label", OrderFilter{{}, {}, label}, std::move(handler));
+}
+
+void OrderManager::submitOrdersAsync(const std::vector<OrderRequest>& requests, BatchHandler handler) {
+    throwIfFailed(trySubmitOrdersAsync(requests, std::move(handler)));
+}
+
+void OrderManager::updateOrdersAsync(const std::vector<BatchEdit>& edits, BatchHandler handler) {
+    throwIfFailed(tryUpdateOrdersAsync(edits, std::move(handler)));
+}
+
+RequestStatus OrderManager::trySubmitOrdersAsync(const std::vector<OrderRequest>& requests, BatchHandler handler) {
+    // Everything that can fail without a reservation goes first
+    RequestStatus status = checkBatch(requests.size());
+    if (!status.ok()) {
+        return status;
+    }
+    std::vector<OrderRequest> orders(requests.size());
+    for (size_t i = 0; i < requests.size(); ++i) {
+        status = prepareOrder(requests[i], orders[i]);
+        if (!status.ok()) {
+            return status;
+        }
+    }
+    // All legs pass or none is sent
+    int64_t now_ns = PerformanceTracker::now();
+    for (size_t i = 0; i < orders.size(); ++i) {
+        RiskCheck result = risk_gate_.check(orders[i], now_ns);
+        if (result != RiskCheck::Passed) {
+            while (i > 0) {
+                risk_gate_.release(orders[--i]);
+            }
+            return failed(OrderErrc::RiskRefused, toString(result), result);
+        }
+    }
+    // One connection carries the whole burst, the one of the first leg's instrument
+    size_t link = orderLink(orders.empty() ? std::string_view() : orders.front().instrument);
+    std::vector<int> noted;
+    noted.reserve(orders.size());
+    // Settling a noted leg releases its reservation; the others were only reserved. Either way
+    // the leg's throttle slot goes back too.
+    auto unwind = [&](std::string_view reason) {
+        for (size_t i = 0; i < orders.size(); ++i) {
+            if (i < noted.size()) {
+                settleRequest(noted[i], reason);
+                risk_gate_.releaseRate();
+            } else {
+                risk_gate_.release(orders[i]);
+            }
+        }
+    };
+    try {
+        status = trySendBatch(link, orders.size(), [&](size_t i, int seq, std::string_view& payload) {
+            noteSubmit(seq, orders[i]);
+            noted.push_back(seq);
+            payload = encodeOrder(seq, orders[i]);
+            return RequestStatus{};
+        }, std::move(handler));
     } catch (const std::exception& ex) {
-        std::cerr << "Position fetch error: " << ex.what() << std::endl;
+        unwind(ex.what());
         throw;
     }
+    if (!status.ok()) {
+        unwind(status.reason);
+    }
+    return status;
 }
-rapidjson::Document OrderManager::retrieveOrderBook(const std::string& asset) {
+
+RequestStatus OrderManager::tryUpdateOrdersAsync(const std::vector<BatchEdit>& edits, BatchHandler handler) {
+    RequestStatus status = checkBatch(edits.size());
+    if (!status.ok()) {
+        return status;
+    }
+    size_t link = edits.empty() ? orderLink({}) : orderLinkFor(edits.front().order_ref);
+    std::vector<int> checked;
+    checked.reserve(edits.size());
+    // All legs pass or none is sent: give back what the earlier legs reserved
+    auto unwind = [&](std::string_view reason) {
+        for (int seq : checked) {
+            settleRequest(seq, reason);
+        }
+    };
     try {
-        json_cache_.SetObject();
-        auto& allocator = json_cache_.GetAllocator();
+        status = trySendBatch(link, edits.size(), [&](size_t i, int seq, std::string_view& payload) {
+            const BatchEdit& edit = edits[i];
+            RequestStatus leg = encodeEdit(seq, edit.order_ref, edit.new_rate, edit.new_qty, payload);
+            if (leg.ok()) {
+                checked.push_back(seq);
+            }
+            return leg;
+        }, std::move(handler));
+    } catch (const std::exception& ex) {
+        unwind(ex.what());
+        throw;
+    }
+    if (!status.ok()) {
+        unwind(status.reason);
+    }
+    return status;
+}
 
-        json_cache_.AddMember("jsonrpc", "2.0", allocator);
-        json_cache_.AddMember("method", "public/get_order_book", allocator);
-        json_cache_.AddMember("id", generateSequenceNum(), allocator);
+BatchResult OrderManager::submitOrders(const std::vector<OrderRequest>& orders) {
+    std::promise<BatchResult> promise;
+    std::future<BatchResult> result = promise.get_future();
+    submitOrdersAsync(orders, [&promise](BatchResult& batch) { promise.set_value(std::move(batch)); });
+    return result.get();
+}
 
-        rapidjson::Value params(rapidjson::kObjectType);
-        params.AddMember("instrument_name", rapidjson::Value(asset.c_str(), allocator), allocator);
+BatchResult OrderManager::updateOrders(const std::vector<BatchEdit>& edits) {
+    std::promise<BatchResult> promise;
+    std::future<BatchResult> result = promise.get_future();
+    updateOrdersAsync(edits, [&promise](BatchResult& batch) { promise.set_value(std::move(batch)); });
+    return result.get();
+}
 
-        json_cache_.AddMember("params", params, allocator);
+void OrderManager::retrieveOrderBookAsync(const std::string& asset, BookHandler handler) {
+    int seq = generateSequenceNum();
+    sendRequest(marketDataLink(asset), seq, buildOrderBookRequest(seq, asset), std::move(handler));
+}
 
-        rapidjson::StringBuffer buffer;
-        rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-        json_cache_.Accept(writer);
+void OrderManager::fetchPositionsAsync(std::string_view currency, PositionsHandler handler) {
+    int seq = generateSequenceNum();
+    sendRequest(orderLink({}), seq, buildPositionsRequest(seq, currency), std::move(handler));
+}
 
-        // Debug: Print the request payload
-        std::cout << "Request Payload (retrieveOrderBook): " << buffer.GetString() << std::endl;
+std::future<rapidjson::Document> OrderManager::submitOrderAsync(const OrderRequest& request) {
+    OrderRequest order = alignToGrid(request);
+    admitOrder(order);
+    auto [handler, reply] = makePromiseHandler();
+    int seq = generateSequenceNum();
+    noteSubmit(seq, order);
+    try {
+        sendRequest(orderLink(order.instrument), seq, encodeOrder(seq, order), std::move(handler));
+    } catch (const std::exception& ex) {
+        settleRequest(seq, ex.what());
+        risk_gate_.releaseRate();
+        throw;
+    }
+    return std::move(reply);
+}
 
-        ws_conn_.transmit(buffer.GetString());
-        std::string reply = ws_conn_.receive();
+std::future<rapidjson::Document> OrderManager::submitBuyOrderAsync(const std::string& asset, double qty, double rate) {
+    return submitOrderAsync(postOnlyLimit(asset, Side::Buy, qty, rate));
+}
 
-        // Debug: Print the API response
-        std::cout << "API Response (retrieveOrderBook): " << reply << std::endl;
+std::future<rapidjson::Document> OrderManager::submitSellOrderAsync(const std::string& asset, double qty, double rate) {
+    return submitOrderAsync(postOnlyLimit(asset, Side::Sell, qty, rate));
+}
 
-        rapidjson::Document result;
-        result.Parse(reply.c_str());
+std::future<rapidjson::Document> OrderManager::removeOrderAsync(const std::string& order_ref) {
+    auto [handler, reply] = makePromiseHandler();
+    int seq = generateSequenceNum();
+    std::string_view payload = order_encoder_.encodeCancel(seq, order_ref);
+    order_store_.onCancel(seq, order_ref);
+    sendRequest(orderLinkFor(order_ref), seq, payload, std::move(handler));
+    return std::move(reply);
+}
 
-        if (result.HasMember("error")) {
-            throw std::runtime_error("Order book error: " + std::string(buffer.GetString()));
+std::future<rapidjson::Document> OrderManager::updateOrderAsync(const std::string& order_ref, double new_rate, double new_qty) {
+    auto [handler, reply] = makePromiseHandler();
+    int seq = generateSequenceNum();
+    sendRequest(orderLinkFor(order_ref), seq, encodeEdit(seq, order_ref, new_rate, new_qty),
+                std::move(handler));
+    return std::move(reply);
+}
+
+std::future<rapidjson::Document> OrderManager::retrieveOrderBookAsync(const std::string& asset) {
+    auto [handler, reply] = makePromiseHandler();
+    int seq = generateSequenceNum();
+    sendRequest(marketDataLink(asset), seq, buildOrderBookRequest(seq, asset), std::move(handler));
+    return std::move(reply);
+}
+
+std::future<rapidjson::Document> OrderManager::fetchPositionsAsync(const std::string& currency) {
+    auto [handler, reply] = makePromiseHandler();
+    int seq = generateSequenceNum();
+    sendRequest(orderLink({}), seq, buildPositionsRequest(seq, currency), std::move(handler));
+    return std::move(reply);
+}
+
+rapidjson::Document OrderManager::subscribe(const std::vector<std::string>& channels) {
+    try {
+        return changeSubscriptions(true, channels);
+    } catch (const std::exception& ex) {
+        LOG_ERROR("Subscription error: {}", ex.what());
+        throw;
+    }
+}
+
+rapidjson::Document OrderManager::unsubscribe(const std::vector<std::string>& channels) {
+    try {
+        return changeSubscriptions(false, channels);
+    } catch (const std::exception& ex) {
+        LOG_ERROR("Unsubscribe error: {}", ex.what());
+        throw;
+    }
+}
+
+rapidjson::Document OrderManager::changeSubscriptions(bool subscribe, const std::vector<std::string>& channels) {
+    // One request per connection involved; the replies' channel lists are merged in connection order
+    std::vector<std::vector<std::string>> by_link(pool_.size());
+    for (const auto& channel : channels) {
+        by_link[channelLink(channel)].push_back(channel);
+    }
+
+    rapidjson::Document merged;
+    merged.SetObject();
+    for (size_t link = 0; link < by_link.size(); ++link) {
+        const std::vector<std::string>& group = by_link[link];
+        if (group.empty()) {
+            continue;
         }
+        const char* method = hasPrivateChannel(group) ? (subscribe ? "private/subscribe" : "private/unsubscribe")
+                                                      : (subscribe ? "public/subscribe" : "public/unsubscribe");
+        int seq = generateSequenceNum();
+        rapidjson::Document result = call(link, seq, buildSubscriptionRequest(seq, method, group));
+        checkReply(result, subscribe ? "Subscription error" : "Unsubscribe error");
+
+        if (!merged.HasMember("result")) {
+            merged.Swap(result);
+        } else if (merged["result"].IsArray() && result.HasMember("result") && result["result"].IsArray()) {
+            for (rapidjson::Value& channel : result["result"].GetArray()) {
+                merged["result"].PushBack(rapidjson::Value(channel, merged.GetAllocator()), merged.GetAllocator());
+            }
+        }
+    }
+    return merged;
+}
+
+std::string OrderManager::bookChannel(const std::string& asset, const std::string& interval) {
+    return "book." + asset + "." + interval;
+}
+
+std::string OrderManager::tradesChannel(const std::string& asset, const std::string& interval) {
+    return "trades." + asset + "." + interval;
+}
+
+std::string OrderManager::tickerChannel(const std::string& asset, const std::string& interval) {
+    return "ticker." + asset + "." + interval;
+}
+
+std::string OrderManager::ordersChannel(const std::string& scope) {
+    return "user.orders." + scope + ".raw";
+}
+
+std::string OrderManager::userTradesChannel(const std::string& scope) {
+    return "user.trades." + scope + ".raw";
+}
+
+std::string OrderManager::markChannel(const std::string& asset) {
+    return "incremental_ticker." + asset;
+}
+
+OrderRequest OrderManager::alignToGrid(const OrderRequest& request) const {
+    OrderRequest order;
+    if (!alignToGrid(request, order)) {
+        const InstrumentSpec* spec = instruments_.spec(order.instrument_id);
+        throw std::invalid_argument("Order amount " + std::to_string(order.amount) + " on " +
+                                    std::string(order.instrument) + " is below one lot of " +
+                                    std::to_string(spec->lot.step()));
+    }
+    return order;
+}
+
+bool OrderManager::alignToGrid(const OrderRequest& request, OrderRequest& order) const {
+    order = request;
+    if (order.instrument_id == kNoInstrument) {
+        order.instrument_id = instruments_.find(order.instrument);  // Saves the risk gate the same lookup
+    }
+    const InstrumentSpec* spec = instruments_.spec(order.instrument_id);
+    if (!spec) {
+        return true;  // No reference data: sent as given
+    }
+
+    Qty amount = toQty(order.amount, *spec);
+    if (amount.lots <= 0) {
+        return false;
+    }
+    order.amount = toDouble(amount, *spec);
+    Rounding passive = order.side == Side::Buy ? Rounding::Down : Rounding::Up;
+    order.price = toDouble(toPrice(order.price, *spec, passive), *spec);
+    order.trigger_price = toDouble(toPrice(order.trigger_price, *spec, Rounding::Nearest), *spec);
+    return true;
+}
+
+RequestStatus OrderManager::prepareOrder(const OrderRequest& request, OrderRequest& order) const {
+    if (!alignToGrid(request, order)) {
+        return failed(OrderErrc::InvalidRequest, "Order amount below one lot");
+    }
+    if (const char* invalid = OrderEncoder::invalidOrder(order)) {
+        return failed(OrderErrc::InvalidRequest, invalid);
+    }
+    return RequestStatus{};
+}
+
+std::string_view OrderManager::encodeOrder(int seq, const OrderRequest& request) const {
+    const InstrumentSpec* spec = instruments_.spec(request.instrument_id);
+    return spec ? order_encoder_.encodeOrder(seq, request, *spec) : order_encoder_.encodeOrder(seq, request);
+}
+
+std::string_view OrderManager::encodeEdit(int seq, std::string_view order_ref, double new_rate, double new_qty) {
+    std::string_view payload;
+    throwIfFailed(encodeEdit(seq, order_ref, new_rate, new_qty, payload));
+    return payload;
+}
 
-        // Pretty-print the result
-        std::cout << "Order Book Data:\n" << prettyPrintJson(result) << std::endl;
+RequestStatus OrderManager::encodeEdit(int seq, std::string_view order_ref, double new_rate, double new_qty,
+                                       std::string_view& payload) {
+    if (const char* invalid = OrderEncoder::invalidText(order_ref)) {
+        return failed(OrderErrc::InvalidRequest, invalid);
+    }
+    // The order's side decides the rounding and the risk check; orders the store never saw go out as given
+    std::optional<OrderRecord> order = order_store_.find(order_ref);
+    const InstrumentSpec* spec = order ? instruments_.spec(instruments_.find(order->instrument_name.view())) : nullptr;
+    if (spec) {
+        Qty amount = toQty(new_qty, *spec);
+        if (amount.lots <= 0) {
+            return failed(OrderErrc::InvalidRequest, "Edited amount below one lot");
+        }
+        new_qty = toDouble(amount, *spec);
+        new_rate = toDouble(toPrice(new_rate, *spec, order->is_buy ? Rounding::Down : Rounding::Up), *spec);
+        payload = order_encoder_.encodeEdit(seq, order_ref, new_rate, new_qty, *spec);
+    } else {
+        payload = order_encoder_.encodeEdit(seq, order_ref, new_rate, new_qty);
+    }
+    if (order && risk_gate_.enabled()) {
+        RiskCheck result = admitEdit(seq, *order, new_rate, new_qty);
+        if (result != RiskCheck::Passed) {
+            return failed(OrderErrc::RiskRefused, toString(result), result);
+        }
+    }
+    return RequestStatus{};
+}
 
+RiskCheck OrderManager::admitEdit(int seq, const OrderRecord& order, double new_rate, double new_qty) {
+    Side side = order.is_buy ? Side::Buy : Side::Sell;
+    OrderRequest edited = OrderRequest::limit(order.instrument_name.view(), side, new_qty, new_rate);
+    double working = order.isOpen() ? std::max(order.amount - order.filled_amount, 0.0) : 0.0;
+    double growth = std::max(new_qty - order.filled_amount - working, 0.0);
+    RiskCheck result = risk_gate_.checkEdit(edited, growth);
+    if (result != RiskCheck::Passed) {
         return result;
+    }
+
+    // Held until the edit's reply is in, then given back by the store; an order that finished
+    // meanwhile will refuse the edit, so nothing needs holding
+    if (growth > 0.0 && !order_store_.onEdit(seq, order.order_id.view(), growth)) {
+        risk_gate_.onExposure(edited.instrument, order.is_buy, -growth, 0.0);
+    }
+    return RiskCheck::Passed;
+}
+
+void OrderManager::admitOrder(const OrderRequest& request) {
+    throwIfRefused(risk_gate_.check(request, PerformanceTracker::now()));
+}
+
+void OrderManager::noteSubmit(int seq, const OrderRequest& request) {
+    if (!order_store_.onSubmit(seq, request)) {
+        // Nothing will ever report this order's exposure back, so do not hold it against the limits.
+        // It is still sent, so it keeps its throttle slot.
+        risk_gate_.onExposure(request.instrument, request.side == Side::Buy, -request.amount, 0.0);
+        LOG_WARN("Order store full, request {} on {} is not tracked", seq, request.instrument);
+    }
+}
+
+void OrderManager::trackOrders(const std::string& scope) {
+    std::string channel = ordersChannel(scope);
+    registerMarketFeed(channel, [this](const FeedMessage& message) {
+        if (message.hasOrder()) {
+            order_store_.onUpdate(message.order());
+            if (order_listener_) {
+                order_listener_(message.order());  // Dispatch holds feed_mutex_ shared
+            }
+        }
+    });
+    subscribe({channel});
+}
+
+void OrderManager::trackPositions(const std::vector<std::string>& currencies, std::chrono::seconds reconcile_interval) {
+    try {
+        {
+            std::lock_guard<std::mutex> lock(positions_mutex_);
+            reconcile_currencies_ = currencies;
+        }
+
+        std::string channel = userTradesChannel("any.any");
+        registerMarketFeed(channel, [this](const FeedMessage& message) {
+            int64_t now = PerformanceTracker::now();
+            for (const TradeFill& fill : message.trades()) {
+                position_store_.onFill(fill, now);
+            }
+        });
+        subscribe({channel});
+
+        // Starting positions. Snapshots and fills share the first order-entry connection, so a fill
+        // is either in a snapshot or arrives after it.
+        for (const std::string& currency : currencies) {
+            std::promise<RpcStatus> loaded;
+            std::future<RpcStatus> status = loaded.get_future();
+            fetchPositionsAsync(currency, [this, &currency, &loaded](const RpcStatus& reply,
+                                                                     const std::vector<PositionSnapshot>& positions) {
+                applyPositions(currency, reply, positions);
+                loaded.set_value(reply);
+            });
+            RpcStatus reply = status.get();
+            if (!reply.ok()) {
+                throw std::runtime_error("Position snapshot for " + currency + ": " +
+                                         std::string(reply.error_message.view()));
+            }
+        }
+        subscribeMarks();
+
+        int64_t interval_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(reconcile_interval).count();
+        reconcile_due_ns_.store(PerformanceTracker::now() + interval_ns, std::memory_order_relaxed);
+        reconcile_interval_ns_.store(interval_ns, std::memory_order_release);
     } catch (const std::exception& ex) {
-        std::cerr << "Order book error: " << ex.what() << std::endl;
+        LOG_ERROR("Position tracking error: {}", ex.what());
         throw;
     }
 }
 
+void OrderManager::reconcilePositionsIfDue(int64_t now_ns) {
+    int64_t interval_ns = reconcile_interval_ns_.load(std::memory_order_acquire);
+    if (interval_ns == 0 || !running_.load(std::memory_order_acquire) ||
+        now_ns < reconcile_due_ns_.load(std::memory_order_relaxed) ||
+        reconciles_in_flight_.load(std::memory_order_acquire) > 0) {
+        return;
+    }
+    reconcile_due_ns_.store(now_ns + interval_ns, std::memory_order_relaxed);
+
+    subscribeMarks();
+
+    // The configured currencies plus any a fill has brought in since
+    std::vector<std::string> currencies;
+    {
+        std::lock_guard<std::mutex> lock(positions_mutex_);
+        currencies = reconcile_currencies_;
+    }
+    for (std::string& currency : position_store_.currencies()) {
+        if (std::find(currencies.begin(), currencies.end(), currency) == currencies.end()) {
+            currencies.push_back(std::move(currency));
+        }
+    }
+
+    reconciles_in_flight_.store(static_cast<int>(currencies.size()), std::memory_order_release);
+    for (const std::string& currency : currencies) {
+        try {
+            fetchPositionsAsync(currency, [this, currency](const RpcStatus& reply,
+                                                           const std::vector<PositionSnapshot>& positions) {
+                applyPositions(currency, reply, positions);
+                reconciles_in_flight_.fetch_sub(1, std::memory_order_acq_rel);
+            });
+        } catch (const std::exception& ex) {
+            reconciles_in_flight_.fetch_sub(1, std::memory_order_acq_rel);
+            LOG_ERROR("Position snapshot for {} not sent: {}", currency, ex.what());
+        }
+    }
+}
+
+void OrderManager::applyPositions(const std::string& currency, const RpcStatus& status,
+                                  const std::vector<PositionSnapshot>& positions) {
+    if (!status.ok()) {
+        LOG_ERROR("Position snapshot for {} failed: {}", currency, status.error_message.view());
+        return;
+    }
+    // A fill racing its own snapshot can be counted twice; the next snapshot corrects it
+    size_t corrected = position_store_.reconcile(currency, positions, PerformanceTracker::now());
+    if (corrected > 0) {
+        LOG_WARN("Position snapshot for {} corrected {} positions", currency, corrected);
+    }
+}
+
+void OrderManager::subscribeMarks() {
+    if (!running_.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    for (const PositionRecord& position : position_store_.positions()) {
+        if (position.isFlat()) {
+            continue;
+        }
+        {
+            std::lock_guard<std::mutex> lock(positions_mutex_);
+            if (std::find(mark_feeds_.begin(), mark_feeds_.end(), position.id) != mark_feeds_.end()) {
+                continue;
+            }
+            mark_feeds_.push_back(position.id);
+        }
+
+        // Registered first so restoreSession() re-subscribes it; the reply is only checked
+        std::string channel = markChannel(std::string(position.instrument_name.view()));
+        InstrumentId id = position.id;
+        registerMarketFeed(channel, [this, id](const FeedMessage& message) {
+            position_store_.onMark(id, message.markPrice());
+        });
+        int seq = generateSequenceNum();
+        try {
+            sendRequest(channelLink(channel), seq, buildSubscriptionRequest(seq, "public/subscribe", {channel}),
+                        ResponseHandler([channel](rapidjson::Document& reply) {
+                            if (reply.HasMember("error")) {
+                                LOG_ERROR("Mark subscription for {} failed: {}", channel, serializeValue(reply["error"]));
+                            }
+                        }));
+        } catch (const std::exception& ex) {
+            LOG_ERROR("Mark subscription for {} not sent: {}", channel, ex.what());  // restoreSession() retries it
+        }
+    }
+}
+
+std::vector<OrderRecord> OrderManager::openOrders(std::string_view asset) const {
+    std::vector<OrderRecord> open;
+    order_store_.openOrders(open, asset);
+    return open;
+}
+
+void OrderManager::trackOrderBook(const std::string& asset, double tick_size) {
+    InstrumentId id = instruments_.intern(asset);
+    if (tick_size <= 0.0) {
+        tick_size = instruments_.tickSize(id);
+    }
+    TrackedBook* tracked = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(books_mutex_);
+        if (books_[id].load(std::memory_order_relaxed)) {
+            return;
+        }
+        auto book = std::make_unique<TrackedBook>(tick_size > 0.0 ? tick_size : OrderBook::kDefaultTickSize);
+        book->id = id;
+        book->asset = asset;
+        book->channel = bookChannel(asset);
+        book->link = channelLink(book->channel);
+        tracked = book.get();
+        book_storage_.push_back(std::move(book));
+        books_[id].store(tracked, std::memory_order_release);
+    }
+
+    // The first notification after subscribing is a full snapshot
+    registerMarketFeed(tracked->channel,
+        [this, tracked](const FeedMessage& message) { onBookNotification(*tracked, message.book()); });
+    subscribe({tracked->channel});
+}
+
+OrderManager::TrackedBook* OrderManager::findTrackedBook(InstrumentId asset) const {
+    return asset < InstrumentCache::kMaxInstruments ? books_[asset].load(std::memory_order_acquire) : nullptr;
+}
+
+OrderManager::TrackedBook* OrderManager::findTrackedBook(std::string_view asset) const {
+    return findTrackedBook(instruments_.find(asset));
+}
+
+void OrderManager::onBookNotification(TrackedBook& tracked, const BookSnapshot& update) {
+    std::lock_guard<std::mutex> lock(tracked.mutex);
+    if (tracked.book.apply(update)) {
+        tracked.resync_pending = false;
+        notifyBookListener(tracked);
+        return;
+    }
+
+    if (tracked.resync_pending) {
+        return;  // Deltas keep failing until the fresh snapshot lands
+    }
+    tracked.resync_pending = true;
+
+    // change_id gap: resubscribing makes the exchange send a new snapshot
+    LOG_WARN("Order book gap on {}, resubscribing", tracked.channel);
+    int unsubscribe_seq = generateSequenceNum();
+    sendWithoutReply(tracked.link, unsubscribe_seq, buildSubscriptionRequest(unsubscribe_seq, "public/unsubscribe", {tracked.channel}));
+    int subscribe_seq = generateSequenceNum();
+    sendWithoutReply(tracked.link, subscribe_seq, buildSubscriptionRequest(subscribe_seq, "public/subscribe", {tracked.channel}));
+}
+
+void OrderManager::notifyBookListener(const TrackedBook& tracked) {
+    // Callers hold feed_mutex_ (shared) and the book's mutex
+    const OrderBook::Level* bid = tracked.book.bestBid();
+    const OrderBook::Level* ask = tracked.book.bestAsk();
+    risk_gate_.onQuote(tracked.id, bid ? tracked.book.toPrice(bid->price) : 0.0,
+                       ask ? tracked.book.toPrice(ask->price) : 0.0);
+    if (book_listener_) {
+        book_listener_(tracked.asset, tracked.book);
+    }
+}
+
+void OrderManager::resetTrackedBooks() {
+    std::lock_guard<std::mutex> books_lock(books_mutex_);
+    for (const auto& tracked : book_storage_) {
+        std::lock_guard<std::mutex> lock(tracked->mutex);
+        tracked->book.clear();
+        tracked->resync_pending = false;
+        risk_gate_.onQuote(tracked->id, 0.0, 0.0);  // Orders needing a reference price wait for the resync
+    }
+}
+
+void OrderManager::setBookListener(BookListener listener) {
+    std::unique_lock<std::shared_mutex> lock(feed_mutex_);
+    book_listener_ = std::move(listener);
+}
 
-void OrderManager::registerMarketFeed(const std::string& asset, std::function<void(const rapidjson::Document&)> handler) {
-    feed_handlers_.emplace(asset, std::move(handler));
-}
\ No newline at end of file
+void OrderManager::setOrderListener(OrderListener listener) {
+    std::unique_lock<std::shared_mutex> lock(feed_mutex_);
+    order_listener_ = std::move(listener);
+}
+
+void OrderManager::sendWithoutReply(size_t link, int seq, std::string_view payload) {
+    if (running_.load(std::memory_order_acquire)) {
+        sendRequest(link, seq, payload, ReplyHandler{});
+    } else {
+        pool_.connection(link).transmit(payload);
+    }
+}
+
+size_t OrderManager::orderLinkFor(std::string_view order_ref) const {
+    // Edits and cancels follow their order's instrument; with one order-entry connection there is nothing to look up
+    if (pool_.members(ConnectionRole::OrderEntry).size() == 1) {
+        return orderLink({});
+    }
+    std::optional<OrderRecord> order = order_store_.find(order_ref);
+    return orderLink(order ? order->instrument_name.view() : std::string_view());
+}
+
+size_t OrderManager::channelLink(std::string_view channel) const {
+    if (channel.compare(0, 5, "user.") == 0) {
+        return orderLink({});
+    }
+
+    // <kind>.<instrument>.<interval>, e.g. book.BTC-PERPETUAL.100ms
+    size_t begin = channel.find('.');
+    if (begin == std::string_view::npos) {
+        return marketDataLink({});
+    }
+    size_t end = channel.find('.', begin + 1);
+    return marketDataLink(channel.substr(begin + 1, end == std::string_view::npos ? end : end - begin - 1));
+}
+
+void OrderManager::registerMarketFeed(const std::string& channel, ChannelRegistry::FeedHandler handler) {
+    std::unique_lock<std::shared_mutex> lock(feed_mutex_);
+    feed_handlers_.add(channel, std::move(handler));
+}
+
+void OrderManager::unregisterMarketFeed(const std::string& channel) {
+    std::unique_lock<std::shared_mutex> lock(feed_mutex_);
+    feed_handlers_.remove(channel);
+}
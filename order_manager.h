@@ -2,44 +2,430 @@
 #define ORDER_MANAGER_H
 
 #include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
 #include <string>
+#include <string_view>
+#include <system_error>
 #include <functional>
-#include <unordered_map>
+#include <memory>
+#include <variant>
+#include <vector>
 #include <boost/container/flat_map.hpp>
 #include <rapidjson/document.h>
 #include <rapidjson/stringbuffer.h>
 #include <rapidjson/writer.h>
+#include "channel_registry.h"
+#include "connection_pool.h"
+#include "instrument_cache.h"
+#include "memory_arena.h"
+#include "order_book.h"
+#include "order_encoder.h"
+#include "order_request.h"
+#include "order_store.h"
+#include "position_store.h"
+#include "response_parser.h"
+#include "risk_gate.h"
 
 class WsConnector;
 
+// One leg of a bulk edit; order_ref must outlive the call
+struct BatchEdit {
+    std::string_view order_ref;
+    double new_rate = 0.0;
+    double new_qty = 0.0;
+};
+
+// Aggregated outcome of a batch: one ack per leg, in request order
+struct BatchResult {
+    std::vector<OrderAck> acks;
+    size_t succeeded = 0;
+    size_t failed = 0;
+    int64_t elapsed_ns = 0;  // First frame queued to last reply
+};
+
+// Why an order request failed. The try* calls return the local failures; the awaitable API
+// also completes with the other two.
+enum class OrderErrc {
+    Rejected = 1,    // The exchange refused it; the reply carries its code and message
+    RiskRefused,     // The risk gate refused it; nothing was sent
+    InvalidRequest,  // Could not be encoded, e.g. an amount below one lot or a batch over the write queue
+    NotSent,         // The write queue was full, or a batch came before start()
+    NoReply,         // The connection closed or the manager stopped before the reply
+};
+
+const std::error_category& orderErrorCategory();
+std::error_code make_error_code(OrderErrc error);
+
+namespace std {
+template <>
+struct is_error_code_enum<OrderErrc> : true_type {};
+}  // namespace std
+
+// Outcome of a try* request. Unless ok(), nothing was sent or registered and the handler never runs.
+struct RequestStatus {
+    std::error_code error;
+    RiskCheck risk = RiskCheck::Passed;  // The failed check when refused by the risk gate
+    const char* reason = "";             // Static text
+
+    bool ok() const { return !error; }
+};
+
 class OrderManager {
 public:
-    explicit OrderManager(WsConnector& ws_conn);
+    // Invoked on the WsConnector io thread with the reply (or a synthesized error) for one request
+    using ResponseHandler = std::function<void(rapidjson::Document&)>;
+    // Typed variants are filled by the SAX pass and never build a DOM
+    using AckHandler = std::function<void(const OrderAck&)>;
+    using BookHandler = std::function<void(const BookSnapshot&)>;
+    using PositionsHandler = std::function<void(const RpcStatus&, const std::vector<PositionSnapshot>&)>;
+    using CancelAllHandler = std::function<void(const RpcStatus&, int64_t cancelled)>;
+    // Runs on the reader thread after each applied book update, with the book locked
+    using BookListener = std::function<void(std::string_view asset, const OrderBook& book)>;
+    // Runs on the reader thread for each user.orders update, after the order store has applied it
+    using OrderListener = std::function<void(const OrderAck& update)>;
+    // Runs on the io thread when the connection drops under a running manager, not after stop()
+    using DisconnectHandler = std::function<void(const std::string& reason)>;
+
+    explicit OrderManager(WsConnector& ws_conn);  // Everything on one connection
+    // Orders and private requests go to the pool's order-entry connections, public
+    // subscriptions and snapshots to its market-data connections, each by instrument
+    explicit OrderManager(ConnectionPool& pool);
     ~OrderManager();
 
+    // Pipelined mode: replies are matched to callers by JSON-RPC id on each connection's io thread
+    void start();
+    void stop();
+
+    // Connection upkeep, driven by ConnectionSupervisor. Set the handler before start().
+    void setDisconnectHandler(DisconnectHandler handler) { disconnect_handler_ = std::move(handler); }
+    // public/set_heartbeat; the exchange's test_requests are then answered on the reader thread
+    void enableHeartbeat(int interval_seconds);
+    void sendTest();  // public/test on every connection without waiting; the reply only counts as traffic
+    // On a fresh connection after start(): re-authenticates with the last credentials, re-subscribes
+    // every registered channel and re-enables the heartbeat. Tracked books resync from new snapshots.
+    void restoreSession();
+    int64_t lastReceiveNs() const;  // Latest frame on the quietest connection
+    ConnectionPool& connections() { return pool_; }
+    // Blocking requests after start() give up after this long without a reply; 0 waits forever
+    void setRequestTimeout(std::chrono::milliseconds timeout) { request_timeout_ms_.store(timeout.count()); }
+
+    // Authenticates each order-entry connection itself: private requests on it carry no access_token.
+    // Returns the first connection's auth result.
     rapidjson::Document performAuthentication(const std::string& id, const std::string& secret);
+    // Renews each session with grant_type=refresh_token once 80% of the token's lifetime has passed.
+    // Only queues the request; the reply is applied on the io thread. ConnectionSupervisor calls it every tick.
+    void refreshAuthenticationIfDue(int64_t now_ns);
+    int64_t authExpiresNs() const;  // Earliest expiry of any session, 0 if unknown
+    // public/get_instruments; every instrument in the reply lands in the instrument cache.
+    // An empty or "any" type asks for all kinds.
     rapidjson::Document retrieveInstruments(const std::string& curr, const std::string& type, bool is_expired);
+    // Startup load: reads cache_path when it is fresh and covers the currency and kind, otherwise
+    // fetches the live instruments and saves them there. Returns how many match.
+    size_t loadInstruments(const std::string& curr, const std::string& type, const std::string& cache_path,
+                           int64_t max_age_seconds = 24 * 3600);
+    // Any side, type and time-in-force; the buy/sell shorthands send post-only limit orders
+    rapidjson::Document submitOrder(const OrderRequest& request);
     rapidjson::Document submitBuyOrder(const std::string& asset, double qty, double rate);
+    rapidjson::Document submitSellOrder(const std::string& asset, double qty, double rate);
     rapidjson::Document removeOrder(const std::string& order_ref);
     rapidjson::Document updateOrder(const std::string& order_ref, double new_rate, double new_qty);
     rapidjson::Document retrieveOrderBook(const std::string& asset);
-    rapidjson::Document fetchPositions();
+    rapidjson::Document fetchPositions(const std::string& currency = "BTC");
+
+    std::future<rapidjson::Document> submitOrderAsync(const OrderRequest& request);
+    std::future<rapidjson::Document> submitBuyOrderAsync(const std::string& asset, double qty, double rate);
+    std::future<rapidjson::Document> submitSellOrderAsync(const std::string& asset, double qty, double rate);
+    std::future<rapidjson::Document> removeOrderAsync(const std::string& order_ref);
+    std::future<rapidjson::Document> updateOrderAsync(const std::string& order_ref, double new_rate, double new_qty);
+    std::future<rapidjson::Document> retrieveOrderBookAsync(const std::string& asset);
+    std::future<rapidjson::Document> fetchPositionsAsync(const std::string& currency = "BTC");
+
+    void submitOrderAsync(const OrderRequest& request, AckHandler handler);
+    void submitBuyOrderAsync(std::string_view asset, double qty, double rate, AckHandler handler);
+    void submitSellOrderAsync(std::string_view asset, double qty, double rate, AckHandler handler);
+    void removeOrderAsync(std::string_view order_ref, AckHandler handler);
+    void updateOrderAsync(std::string_view order_ref, double new_rate, double new_qty, AckHandler handler);
+    // The same without exceptions, for the awaitable API: risk refusals, invalid requests and a full
+    // write queue come back as a status. The calls above throw them.
+    RequestStatus trySubmitOrderAsync(const OrderRequest& request, AckHandler handler);
+    RequestStatus tryRemoveOrderAsync(std::string_view order_ref, AckHandler handler);
+    RequestStatus tryUpdateOrderAsync(std::string_view order_ref, double new_rate, double new_qty, AckHandler handler);
+    void retrieveOrderBookAsync(const std::string& asset, BookHandler handler);
+    void fetchPositionsAsync(std::string_view currency, PositionsHandler handler);
+
+    // Mass cancels: the exchange matches the orders, the reply carries how many went
+    int64_t cancelAll();
+    int64_t cancelAllByInstrument(const std::string& asset);
+    int64_t cancelAllByCurrency(const std::string& currency);
+    int64_t cancelByLabel(const std::string& label);
+    void cancelAllAsync(CancelAllHandler handler);
+    void cancelAllByInstrumentAsync(std::string_view asset, CancelAllHandler handler);
+    void cancelAllByCurrencyAsync(std::string_view currency, CancelAllHandler handler);
+    void cancelByLabelAsync(std::string_view label, CancelAllHandler handler);
+
+    // Bulk entry, after start(): every leg is encoded and registered, then all frames are queued
+    // in one burst. The handler runs once, on the io thread, when the last reply is in.
+    // At most WsConnector::kWriteSlots legs per batch.
+    using BatchHandler = std::function<void(BatchResult&)>;
+    void submitOrdersAsync(const std::vector<OrderRequest>& orders, BatchHandler handler);
+    void updateOrdersAsync(const std::vector<BatchEdit>& edits, BatchHandler handler);
+    RequestStatus trySubmitOrdersAsync(const std::vector<OrderRequest>& orders, BatchHandler handler);
+    RequestStatus tryUpdateOrdersAsync(const std::vector<BatchEdit>& edits, BatchHandler handler);
+    BatchResult submitOrders(const std::vector<OrderRequest>& orders);
+    BatchResult updateOrders(const std::vector<BatchEdit>& edits);
+
+    size_t pendingRequests() const;
+
+    // Runs a captured frame through the reader thread's parse and feed dispatch, for replay. Replies
+    // and test_requests are skipped: nothing completes a live request, nothing is sent, and the
+    // connections' receive times are left alone, so it is safe without a connection.
+    void replayFrame(std::string_view frame);
+
+    // Streaming market data: handlers receive each notification on their channel
+    void registerMarketFeed(const std::string& channel, ChannelRegistry::FeedHandler handler);
+    void unregisterMarketFeed(const std::string& channel);
+    rapidjson::Document subscribe(const std::vector<std::string>& channels);
+    rapidjson::Document unsubscribe(const std::vector<std::string>& channels);
+
+    static std::string bookChannel(const std::string& asset, const std::string& interval = "100ms");
+    static std::string tradesChannel(const std::string& asset, const std::string& interval = "100ms");
+    static std::string tickerChannel(const std::string& asset, const std::string& interval = "100ms");
+    static std::string ordersChannel(const std::string& scope);  // Always raw: one order per notification
+    static std::string userTradesChannel(const std::string& scope);  // Own fills, raw like ordersChannel
+    static std::string markChannel(const std::string& asset);  // incremental_ticker: only changed fields
+
+    // Local L2 books kept current from book.* deltas; reads never touch the socket.
+    // tick_size 0 takes the instrument's cached tick size, or OrderBook::kDefaultTickSize without one.
+    void trackOrderBook(const std::string& asset, double tick_size = 0.0);
+    template <typename Fn>
+    bool readOrderBook(std::string_view asset, Fn&& fn) const;  // False if untracked or not yet synced
+    template <typename Fn>
+    bool readOrderBook(InstrumentId asset, Fn&& fn) const;
+    void setBookListener(BookListener listener);
 
-    void registerMarketFeed(const std::string& asset, std::function<void(const rapidjson::Document&)> handler);
+    // Client-side order state: fed by replies, and by user.orders once trackOrders() subscribes.
+    // Queries are answered locally without an RPC.
+    void trackOrders(const std::string& scope = "any.any");  // Instrument name or "<kind>.<currency>"
+    std::optional<OrderRecord> findOrder(std::string_view order_id) const { return order_store_.find(order_id); }
+    std::vector<OrderRecord> openOrders(std::string_view asset = {}) const;
+    void setOrderListener(OrderListener listener);
+    const OrderStore& orders() const { return order_store_; }
+
+    // Net position and PnL per instrument, applied from user.trades fills and marked from
+    // incremental_ticker; lookups are local. Loads a private/get_positions snapshot per currency
+    // first, then reconcilePositionsIfDue() repeats it every reconcile_interval in the background.
+    // Call after start() and authentication.
+    void trackPositions(const std::vector<std::string>& currencies = {"BTC"},
+                        std::chrono::seconds reconcile_interval = std::chrono::seconds(30));
+    // Queues a snapshot request per currency once one is due, and subscribes marks for instruments
+    // that opened a position since. Replies are applied on the io thread. ConnectionSupervisor calls it every tick.
+    void reconcilePositionsIfDue(int64_t now_ns);
+    std::optional<PositionRecord> findPosition(std::string_view asset) const { return position_store_.find(asset); }
+    const PositionStore& positions() const { return position_store_; }
+
+    // Pre-trade checks every new order and edit passes before it is encoded; a rejected request throws
+    // std::runtime_error without sending, or comes back from a try* call as RiskRefused. Configure
+    // limits before trading; an empty gate passes all.
+    RiskGate& riskGate() { return risk_gate_; }
+
+    // Name to dense id for every instrument this manager has seen, plus reference data
+    InstrumentCache& instruments() { return instruments_; }
+    const InstrumentCache& instruments() const { return instruments_; }
 
 private:
-    std::string access_token_;
+    OrderManager(std::unique_ptr<ConnectionPool> owned_pool, ConnectionPool* pool);
+
+    // Session credentials; the order path never reads them
+    mutable std::mutex auth_mutex_;
+    std::string client_id_;  // Kept for re-authenticating after a reconnect
+    std::string client_secret_;
      int generateSequenceNum();
-     
-    void processMarketFeed(const rapidjson::Document& feed);
-    void onFeedReceived(const rapidjson::Document& market_feed);
 
-    WsConnector& ws_conn_;
-    thread_local static rapidjson::Document json_cache_;
+    // Cold-path requests, built as DOMs in the thread's MessageArena; a view stays valid until the next build
+    std::string_view buildAuthRequest(int seq, const std::string& id, const std::string& secret);
+    std::string_view buildRefreshRequest(int seq, const std::string& refresh_token);
+    std::string_view buildOrderBookRequest(int seq, const std::string& asset);
+    std::string_view buildInstrumentsRequest(int seq, const std::string& curr, const std::string& type, bool is_expired);
+    std::string_view buildPositionsRequest(int seq, std::string_view currency);
+    std::string_view buildHeartbeatRequest(int seq, int interval_seconds);
+    std::string_view buildTestRequest(int seq);
+    std::string_view buildSubscriptionRequest(int seq, const char* method, const std::vector<std::string>& channels);
+    std::string_view serializeRequest(const rapidjson::Value& request);
+
+    // Request/response engine
+    using ReplyHandler = std::variant<std::monostate, ResponseHandler, AckHandler, BookHandler, PositionsHandler,
+                                      CancelAllHandler>;
+
+    void sendRequest(size_t link, int seq, std::string_view payload, ReplyHandler handler);
+    bool trySendRequest(size_t link, int seq, std::string_view payload, ReplyHandler handler);  // False if queue full
+    void registerRequest(int seq, int64_t sent_ns, ReplyHandler handler);
+    void abandonRequest(int seq, std::string_view reason);  // Not sent, or no longer waited on
+    // A request whose reply will never be seen; the order store settles any order it concerns
+    void settleRequest(int seq, std::string_view reason);
+    RequestStatus checkBatch(size_t count) const;  // Started, and within the write queue
+    // After checkBatch. encode(i, seq, payload) returns a status; the first failure stops the batch unsent.
+    template <typename Encode>
+    RequestStatus trySendBatch(size_t link, size_t count, Encode&& encode, BatchHandler handler);
+    int64_t massCancel(const char* method, const OrderFilter& filter);
+    void massCancelAsync(const char* method, const OrderFilter& filter, CancelAllHandler handler);
+    std::string_view encodeMassCancel(int seq, const char* method, const OrderFilter& filter);
+    rapidjson::Document call(size_t link, int seq, std::string_view payload);
+    rapidjson::Document receiveReply(size_t link, int seq, std::string_view payload);  // call() before start()
+    rapidjson::Document changeSubscriptions(bool subscribe, const std::vector<std::string>& channels);
+    void onFrame(size_t link, std::string_view frame);
+    // Through the thread's SAX parser; nullptr if malformed, else valid until the thread's next parse
+    static const ParsedMessage* parseFrame(std::string_view frame);
+    void onReply(const ParsedMessage& reply);
+    void completeRequest(const ParsedMessage& reply, std::string_view frame);
+    void failPendingRequests(const std::string& reason);
+    static void deliverError(ReplyHandler& handler, int seq, std::string_view reason);
+    static rapidjson::Document makeErrorReply(int seq, std::string_view reason);
+
+    struct TrackedBook {
+        explicit TrackedBook(double tick_size) : book(tick_size) {}
+
+        mutable std::mutex mutex;  // Feed writer on the io thread vs. readers anywhere
+        OrderBook book;
+        InstrumentId id = kNoInstrument;
+        std::string asset;
+        std::string channel;
+        size_t link = 0;  // Connection carrying the channel
+        bool resync_pending = false;
+    };
+
+    TrackedBook* findTrackedBook(InstrumentId asset) const;
+    TrackedBook* findTrackedBook(std::string_view asset) const;
+    void onBookNotification(TrackedBook& tracked, const BookSnapshot& update);
+    void notifyBookListener(const TrackedBook& tracked);
+    void resetTrackedBooks();
+    void storeSessionToken(size_t link, const rapidjson::Value& result);
+    void refreshLink(size_t link, int64_t now_ns);
+    void onRefreshReply(size_t link, rapidjson::Document& reply);
+    void onConnectionClosed(const std::string& reason);
+    void sendTest(size_t link);
+    void sendWithoutReply(size_t link, int seq, std::string_view payload);
+
+    // Routing: order traffic by instrument over the order-entry connections, channels by
+    // instrument over the market-data ones; user.* channels need an authenticated connection
+    size_t orderLink(std::string_view instrument) const { return pool_.route(ConnectionRole::OrderEntry, instrument); }
+    size_t orderLinkFor(std::string_view order_ref) const;
+    size_t marketDataLink(std::string_view instrument) const {
+        return pool_.route(ConnectionRole::MarketData, instrument);
+    }
+    size_t channelLink(std::string_view channel) const;
+    void applyPositions(const std::string& currency, const RpcStatus& status,
+                        const std::vector<PositionSnapshot>& positions);
+    void subscribeMarks();
+    // Onto the instrument's tick and lot grid once its reference data is loaded: the price
+    // away from the touch, the trigger to the nearest tick, the amount down. Throws below one lot.
+    OrderRequest alignToGrid(const OrderRequest& request) const;
+    bool alignToGrid(const OrderRequest& request, OrderRequest& order) const;  // False below one lot
+    // Onto the grid and checked for encoding; any failure but a risk refusal
+    RequestStatus prepareOrder(const OrderRequest& request, OrderRequest& order) const;
+    std::string_view encodeOrder(int seq, const OrderRequest& request) const;  // After alignToGrid
+    // Onto the grid and through the risk gate, which holds any growth in working amount until the
+    // reply. Throws on a refusal.
+    std::string_view encodeEdit(int seq, std::string_view order_ref, double new_rate, double new_qty);
+    RequestStatus encodeEdit(int seq, std::string_view order_ref, double new_rate, double new_qty,
+                             std::string_view& payload);
+    RiskCheck admitEdit(int seq, const OrderRecord& order, double new_rate, double new_qty);
+    void admitOrder(const OrderRequest& request);
+    void noteSubmit(int seq, const OrderRequest& request);
+
+    void processMarketFeed(const ParsedMessage& feed, std::string_view frame);
+    void onFeedReceived(const ParsedMessage& market_feed, std::string_view frame);
+
+    std::unique_ptr<ConnectionPool> owned_pool_;  // Wraps the single connection
+    ConnectionPool& pool_;
 
-    std::unordered_map<std::string, std::function<void(const rapidjson::Document&)>> feed_handlers_;
+    // Per connection; sessions are authenticated per connection
+    struct Link {
+        std::atomic<int64_t> last_receive_ns{0};  // Arrival of the latest frame, for stall detection
+        std::string refresh_token;                // Guarded by auth_mutex_
+        std::atomic<int64_t> auth_expires_ns{0};
+        std::atomic<int64_t> auth_refresh_due_ns{0};  // 0 when there is nothing to refresh
+        std::atomic<bool> auth_refresh_in_flight{false};
+    };
+    std::unique_ptr<Link[]> links_;
+    thread_local static rapidjson::StringBuffer request_buffer_;  // Serialized requests; views valid until the next build
+    thread_local static OrderEncoder order_encoder_;  // Per-thread buffer for buy/sell/cancel/edit frames
+    thread_local static ResponseParser response_parser_;  // Reused SAX state for incoming frames
+
+    // Per-thread staging for bulk requests: encoded frames back to back, then views into them
+    struct BatchFrames {
+        std::string bytes;
+        std::vector<size_t> ends;
+        std::vector<int> seqs;
+        std::vector<std::string_view> views;
+    };
+    thread_local static BatchFrames batch_frames_;
+
+    mutable std::shared_mutex feed_mutex_;  // Writers are registrations; the reader thread only shares it
+    ChannelRegistry feed_handlers_;
+    BookListener book_listener_;  // Also guarded by feed_mutex_
+    OrderListener order_listener_;  // Likewise
+
+    InstrumentCache instruments_;
+    RiskGate risk_gate_;
+    OrderStore order_store_;  // Reports exposure changes to risk_gate_
+    PositionStore position_store_;
+
+    // Position tracking, configured by trackPositions
+    std::mutex positions_mutex_;  // Guards reconcile_currencies_ and mark_feeds_
+    std::vector<std::string> reconcile_currencies_;
+    std::vector<InstrumentId> mark_feeds_;  // Instruments with a mark subscription
+    std::atomic<int64_t> reconcile_interval_ns_{0};  // 0 until trackPositions
+    std::atomic<int64_t> reconcile_due_ns_{0};
+    std::atomic<int> reconciles_in_flight_{0};
+
+    // Tracked books by InstrumentId; a slot is set once and the book lives as long as the manager
+    std::mutex books_mutex_;  // Serializes trackOrderBook
+    std::vector<std::unique_ptr<TrackedBook>> book_storage_;
+    std::unique_ptr<std::atomic<TrackedBook*>[]> books_;
+
+    // In-flight table indexed by seq & (kMaxInFlight - 1); fixed size so sending never allocates
+    struct PendingRequest {
+        int seq = 0;
+        bool active = false;
+        int64_t sent_ns = 0;  // For the rpc.ack round-trip probe
+        ReplyHandler handler;
+    };
+    static constexpr size_t kMaxInFlight = 4096;
+
+    mutable std::mutex pending_mutex_;
+    std::vector<PendingRequest> pending_requests_;
+    size_t pending_count_ = 0;
+    std::atomic<bool> running_{false};
+
+    DisconnectHandler disconnect_handler_;
+    std::atomic<int> heartbeat_interval_{0};  // Seconds; re-sent on restoreSession
+    std::atomic<int64_t> request_timeout_ms_{0};
 
     static std::atomic<int> sequence_num_;  // Removed alignas(64) from here
 };
 
+template <typename Fn>
+bool OrderManager::readOrderBook(std::string_view asset, Fn&& fn) const {
+    return readOrderBook(instruments_.find(asset), std::forward<Fn>(fn));
+}
+
+template <typename Fn>
+bool OrderManager::readOrderBook(InstrumentId asset, Fn&& fn) const {
+    TrackedBook* tracked = findTrackedBook(asset);
+    if (!tracked) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(tracked->mutex);
+    if (!tracked->book.isSynced()) {
+        return false;
+    }
+    fn(static_cast<const OrderBook&>(tracked->book));
+    return true;
+}
+
 #endif // ORDER_MANAGER_H
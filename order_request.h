@@ -0,0 +1,56 @@
+#ifndef ORDER_REQUEST_H
+#define ORDER_REQUEST_H
+
+#include <cstdint>
+#include <string_view>
+#include "instrument_cache.h"
+
+enum class Side : uint8_t { Buy, Sell };
+
+enum class OrderType : uint8_t { Limit, Market, StopLimit, StopMarket };
+
+enum class TimeInForce : uint8_t { GoodTilCancelled, GoodTilDay, FillOrKill, ImmediateOrCancel };
+
+// Compile-time facts about each order type; the encoder only emits the fields a type uses
+template <OrderType Type>
+struct OrderTypeTraits {
+    static constexpr bool kHasPrice = Type == OrderType::Limit || Type == OrderType::StopLimit;
+    static constexpr bool kHasTrigger = Type == OrderType::StopLimit || Type == OrderType::StopMarket;
+    static constexpr bool kAllowsPostOnly = Type == OrderType::Limit;  // Deribit ignores it elsewhere
+};
+
+// One new order as the gateway sends it. Views must outlive the submit call.
+// instrument and label go into the frame verbatim: the encoder refuses text that would need JSON escaping.
+struct OrderRequest {
+    std::string_view instrument;
+    InstrumentId instrument_id = kNoInstrument;  // Optional; lets per-instrument lookups skip hashing the name
+    Side side = Side::Buy;
+    OrderType type = OrderType::Limit;
+    double amount = 0.0;
+    double price = 0.0;          // Limit and stop-limit only
+    double trigger_price = 0.0;  // Stop orders only; triggers on last price
+    TimeInForce time_in_force = TimeInForce::GoodTilCancelled;
+    bool post_only = false;      // Limit only
+    bool reduce_only = false;
+    std::string_view label;      // Up to 64 characters; empty sends none
+
+    static OrderRequest limit(std::string_view instrument, Side side, double amount, double price) {
+        OrderRequest request;
+        request.instrument = instrument;
+        request.side = side;
+        request.amount = amount;
+        request.price = price;
+        return request;
+    }
+
+    static OrderRequest market(std::string_view instrument, Side side, double amount) {
+        OrderRequest request;
+        request.instrument = instrument;
+        request.side = side;
+        request.type = OrderType::Market;
+        request.amount = amount;
+        return request;
+    }
+};
+
+#endif // ORDER_REQUEST_H
@@ -0,0 +1,318 @@
+#include "order_script.h"
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include "logger.h"
+
+namespace {
+
+// How long an edit or cancel waits for its order, and the replay for outstanding replies
+constexpr auto kReplyTimeout = std::chrono::seconds(5);
+
+enum class Outcome : uint8_t { Pending, Live, Failed };
+
+// Shared with the reply handlers, which may outlive run() when a reply is late
+struct ReplayState {
+    std::mutex mutex;
+    std::condition_variable replied;
+    std::vector<std::string> order_ids;
+    std::vector<Outcome> orders;
+    size_t outstanding = 0;
+    size_t accepted = 0;
+    size_t rejected = 0;
+};
+
+double parseNumber(const std::string& token, const char* what) {
+    size_t used = 0;
+    double value = 0.0;
+    try {
+        value = std::stod(token, &used);
+    } catch (const std::exception&) {
+        used = 0;
+    }
+    if (used != token.size() || value < 0.0) {
+        throw std::runtime_error(std::string("bad ") + what + " \"" + token + "\"");
+    }
+    return value;
+}
+
+Side parseSide(const std::string& token) {
+    if (token == "buy") {
+        return Side::Buy;
+    }
+    if (token == "sell") {
+        return Side::Sell;
+    }
+    throw std::runtime_error("expected buy or sell, got \"" + token + "\"");
+}
+
+}  // namespace
+
+std::vector<ScriptCommand> parseOrderScript(std::istream& in, const std::string& source) {
+    std::vector<ScriptCommand> script;
+    size_t orders = 0;
+    std::string text;
+    int line = 0;
+
+    while (std::getline(in, text)) {
+        ++line;
+        size_t comment = text.find('#');
+        // "#n" order references are not comments
+        while (comment != std::string::npos && comment + 1 < text.size() && std::isdigit(text[comment + 1])) {
+            comment = text.find('#', comment + 1);
+        }
+        std::istringstream words(text.substr(0, comment));
+        std::vector<std::string> tokens;
+        for (std::string token; words >> token;) {
+            tokens.push_back(token);
+        }
+        if (tokens.empty()) {
+            continue;
+        }
+
+        try {
+            ScriptCommand command;
+            command.line = line;
+            const std::string& verb = tokens[0];
+            auto expect = [&](size_t min, size_t max) {
+                if (tokens.size() < min || tokens.size() > max) {
+                    throw std::runtime_error("wrong number of arguments to " + verb);
+                }
+            };
+            auto reference = [&](const std::string& token) -> size_t {
+                size_t target;
+                if (token == "last") {
+                    target = orders;
+                } else if (token.size() > 1 && token[0] == '#') {
+                    target = static_cast<size_t>(parseNumber(token.substr(1), "order reference"));
+                } else {
+                    throw std::runtime_error("expected #n or last, got \"" + token + "\"");
+                }
+                if (target == 0 || target > orders) {
+                    throw std::runtime_error("\"" + token + "\" refers to no earlier order");
+                }
+                return target - 1;
+            };
+
+            if (verb == "buy" || verb == "sell") {
+                expect(4, 6);
+                command.side = parseSide(verb);
+                command.instrument = tokens[1];
+                command.amount = parseNumber(tokens[2], "amount");
+                command.price = parseNumber(tokens[3], "price");
+                for (size_t i = 4; i < tokens.size(); ++i) {
+                    if (tokens[i] == "post_only") {
+                        command.post_only = true;
+                    } else if (tokens[i] == "reduce_only") {
+                        command.reduce_only = true;
+                    } else {
+                        throw std::runtime_error("unknown flag \"" + tokens[i] + "\"");
+                    }
+                }
+                command.order = orders++;
+            } else if (verb == "market") {
+                expect(4, 5);
+                command.order_type = OrderType::Market;
+                command.side = parseSide(tokens[1]);
+                command.instrument = tokens[2];
+                command.amount = parseNumber(tokens[3], "amount");
+                if (tokens.size() == 5) {
+                    if (tokens[4] != "reduce_only") {
+                        throw std::runtime_error("unknown flag \"" + tokens[4] + "\"");
+                    }
+                    command.reduce_only = true;
+                }
+                command.order = orders++;
+            } else if (verb == "edit") {
+                expect(4, 4);
+                command.type = ScriptCommand::Type::Edit;
+                command.order = reference(tokens[1]);
+                command.price = parseNumber(tokens[2], "price");
+                command.amount = parseNumber(tokens[3], "amount");
+            } else if (verb == "cancel") {
+                expect(2, 2);
+                command.type = ScriptCommand::Type::Cancel;
+                command.order = reference(tokens[1]);
+            } else if (verb == "cancel_all") {
+                expect(1, 2);
+                command.type = ScriptCommand::Type::CancelAll;
+                if (tokens.size() == 2) {
+                    command.instrument = tokens[1];
+                }
+            } else if (verb == "wait") {
+                expect(2, 2);
+                command.type = ScriptCommand::Type::Wait;
+                command.wait_ms = static_cast<int64_t>(parseNumber(tokens[1], "wait"));
+            } else {
+                throw std::runtime_error("unknown command \"" + verb + "\"");
+            }
+            script.push_back(std::move(command));
+        } catch (const std::runtime_error& ex) {
+            throw std::runtime_error(source + ":" + std::to_string(line) + ": " + ex.what());
+        }
+    }
+    return script;
+}
+
+std::vector<ScriptCommand> loadOrderScript(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("Cannot open order script " + path);
+    }
+    return parseOrderScript(file, path);
+}
+
+ScriptRunner::ScriptRunner(OrderManager& order_mgr, double rate)
+    : order_mgr_(order_mgr),
+      rate_(rate),
+      order_probe_(PerformanceTracker::registerProbe("script.order")),
+      edit_probe_(PerformanceTracker::registerProbe("script.edit")),
+      cancel_probe_(PerformanceTracker::registerProbe("script.cancel")),
+      cancel_all_probe_(PerformanceTracker::registerProbe("script.cancel_all")) {}
+
+ScriptResult ScriptRunner::run(const std::vector<ScriptCommand>& script, const std::atomic<bool>& interrupted) {
+    auto state = std::make_shared<ReplayState>();
+    for (const ScriptCommand& command : script) {
+        if (command.type == ScriptCommand::Type::Order) {
+            state->orders.resize(command.order + 1, Outcome::Pending);
+        }
+    }
+    state->order_ids.resize(state->orders.size());
+
+    ScriptResult result;
+    auto interval = rate_ > 0.0 ? std::chrono::nanoseconds(static_cast<int64_t>(1e9 / rate_))
+                                : std::chrono::nanoseconds(0);
+    auto next_send = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point first_send;
+    std::chrono::steady_clock::time_point last_send;
+
+    // Reply bookkeeping on the io thread; the latency sample is taken before the lock
+    auto finish = [state](int line, bool ok, std::string_view error) {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        --state->outstanding;
+        if (ok) {
+            ++state->accepted;
+        } else {
+            ++state->rejected;
+            LOG_WARN("Script line {} rejected: {}", line, error);
+        }
+        state->replied.notify_all();
+    };
+
+    for (const ScriptCommand& command : script) {
+        if (interrupted.load()) {
+            break;
+        }
+        if (command.type == ScriptCommand::Type::Wait) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(command.wait_ms));
+            next_send = std::chrono::steady_clock::now();
+            continue;
+        }
+
+        std::string order_id;
+        if (command.type == ScriptCommand::Type::Edit || command.type == ScriptCommand::Type::Cancel) {
+            std::unique_lock<std::mutex> lock(state->mutex);
+            state->replied.wait_for(lock, kReplyTimeout,
+                                    [&] { return state->orders[command.order] != Outcome::Pending; });
+            if (state->orders[command.order] != Outcome::Live) {
+                LOG_WARN("Script line {} skipped: its order is not live", command.line);
+                ++result.skipped;
+                continue;
+            }
+            order_id = state->order_ids[command.order];
+        }
+
+        if (interval.count() > 0) {
+            std::this_thread::sleep_until(next_send);
+            next_send += interval;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            ++state->outstanding;
+        }
+        last_send = std::chrono::steady_clock::now();
+        if (result.sent++ == 0) {
+            first_send = last_send;
+        }
+        int64_t sent_ns = PerformanceTracker::now();
+
+        try {
+            switch (command.type) {
+            case ScriptCommand::Type::Order: {
+                OrderRequest request = command.order_type == OrderType::Market
+                    ? OrderRequest::market(command.instrument, command.side, command.amount)
+                    : OrderRequest::limit(command.instrument, command.side, command.amount, command.price);
+                request.post_only = command.post_only;
+                request.reduce_only = command.reduce_only;
+                order_mgr_.submitOrderAsync(request,
+                    [state, finish, line = command.line, order = command.order, sent_ns, probe = order_probe_](const OrderAck& ack) {
+                        PerformanceTracker::record(probe, PerformanceTracker::now() - sent_ns);
+                        {
+                            std::lock_guard<std::mutex> lock(state->mutex);
+                            state->orders[order] = ack.ok() ? Outcome::Live : Outcome::Failed;
+                            state->order_ids[order] = std::string(ack.order_id.view());
+                        }
+                        finish(line, ack.ok(), ack.error_message.view());
+                    });
+                break;
+            }
+            case ScriptCommand::Type::Edit:
+                order_mgr_.updateOrderAsync(order_id, command.price, command.amount,
+                    [finish, line = command.line, sent_ns, probe = edit_probe_](const OrderAck& ack) {
+                        PerformanceTracker::record(probe, PerformanceTracker::now() - sent_ns);
+                        finish(line, ack.ok(), ack.error_message.view());
+                    });
+                break;
+            case ScriptCommand::Type::Cancel:
+                order_mgr_.removeOrderAsync(order_id,
+                    [finish, line = command.line, sent_ns, probe = cancel_probe_](const OrderAck& ack) {
+                        PerformanceTracker::record(probe, PerformanceTracker::now() - sent_ns);
+                        finish(line, ack.ok(), ack.error_message.view());
+                    });
+                break;
+            case ScriptCommand::Type::CancelAll: {
+                auto handler = [finish, line = command.line, sent_ns, probe = cancel_all_probe_](const RpcStatus& status,
+                                                                                        int64_t) {
+                    PerformanceTracker::record(probe, PerformanceTracker::now() - sent_ns);
+                    finish(line, status.ok(), status.error_message.view());
+                };
+                if (command.instrument.empty()) {
+                    order_mgr_.cancelAllAsync(handler);
+                } else {
+                    order_mgr_.cancelAllByInstrumentAsync(command.instrument, handler);
+                }
+                break;
+            }
+            case ScriptCommand::Type::Wait:
+                break;
+            }
+        } catch (const std::exception& ex) {
+            // Refused before it went out, e.g. by the risk gate
+            if (command.type == ScriptCommand::Type::Order) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->orders[command.order] = Outcome::Failed;
+            }
+            finish(command.line, false, ex.what());
+        }
+
+        if (interval.count() == 0) {
+            std::unique_lock<std::mutex> lock(state->mutex);
+            state->replied.wait_for(lock, kReplyTimeout, [&] { return state->outstanding == 0; });
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->replied.wait_for(lock, kReplyTimeout, [&] { return state->outstanding == 0; });
+    result.accepted = state->accepted;
+    result.rejected = state->rejected;
+    result.unanswered = state->outstanding;
+    result.send_seconds = std::chrono::duration<double>(last_send - first_send).count();
+    return result;
+}
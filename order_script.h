@@ -0,0 +1,73 @@
+#ifndef ORDER_SCRIPT_H
+#define ORDER_SCRIPT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+#include "order_manager.h"
+#include "performance_tracker.h"
+
+// One line of an order script. Scripts are plain text, one command per line, '#' starts
+// a comment:
+//   buy BTC-PERPETUAL 10 64000 [post_only] [reduce_only]   limit order
+//   sell BTC-PERPETUAL 10 66000
+//   market buy BTC-PERPETUAL 10
+//   edit #1 64010 20        price then amount of the first order line; "last" is the latest one
+//   cancel last
+//   cancel_all [BTC-PERPETUAL]
+//   wait 250                milliseconds, outside the pacing
+struct ScriptCommand {
+    enum class Type : uint8_t { Order, Edit, Cancel, CancelAll, Wait };
+
+    Type type = Type::Order;
+    int line = 0;
+    std::string instrument;  // Order; CancelAll, empty for every instrument
+    Side side = Side::Buy;
+    OrderType order_type = OrderType::Limit;
+    bool post_only = false;
+    bool reduce_only = false;
+    double amount = 0.0;
+    double price = 0.0;
+    size_t order = 0;     // Order: its index among the script's orders. Edit/Cancel: the one it targets.
+    int64_t wait_ms = 0;
+};
+
+// Throws std::runtime_error naming the source and line of the first bad command
+std::vector<ScriptCommand> parseOrderScript(std::istream& in, const std::string& source);
+std::vector<ScriptCommand> loadOrderScript(const std::string& path);
+
+struct ScriptResult {
+    size_t sent = 0;
+    size_t accepted = 0;
+    size_t rejected = 0;     // By the exchange or the risk gate
+    size_t skipped = 0;      // Edits and cancels whose order never went live
+    size_t unanswered = 0;   // Still outstanding when the replay gave up waiting
+    double send_seconds = 0.0;  // First send to last send
+
+    double achievedRate() const { return send_seconds > 0.0 ? (sent - 1) / send_seconds : 0.0; }
+};
+
+// Replays a parsed script through OrderManager's async API. With a rate, sends are paced
+// at that many commands per second and never wait for replies, except that an edit or
+// cancel waits for the order it targets to be acknowledged. With rate 0 each command
+// waits for its reply. The time from send to reply of every command is recorded under
+// the script.order, script.edit, script.cancel and script.cancel_all probes.
+class ScriptRunner {
+public:
+    ScriptRunner(OrderManager& order_mgr, double rate);
+
+    ScriptResult run(const std::vector<ScriptCommand>& script, const std::atomic<bool>& interrupted);
+
+private:
+    OrderManager& order_mgr_;
+    double rate_;
+    PerformanceTracker::ProbeId order_probe_;
+    PerformanceTracker::ProbeId edit_probe_;
+    PerformanceTracker::ProbeId cancel_probe_;
+    PerformanceTracker::ProbeId cancel_all_probe_;
+};
+
+#endif // ORDER_SCRIPT_H
@@ -0,0 +1,535 @@
+#include "order_store.h"
+#include <algorithm>
+#include "performance_tracker.h"
+
+namespace {
+
+size_t roundUpToPowerOfTwo(size_t value) {
+    size_t result = 8;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+// Exchange order_state to our state; nullopt leaves the record as it is
+std::optional<OrderState> stateFromExchange(std::string_view order_state, double filled_amount) {
+    if (order_state == "open" || order_state == "untriggered") {
+        return filled_amount > 0.0 ? OrderState::PartiallyFilled : OrderState::Open;
+    }
+    if (order_state == "filled") {
+        return OrderState::Filled;
+    }
+    if (order_state == "cancelled" || order_state == "rejected") {
+        return OrderState::Cancelled;
+    }
+    return std::nullopt;
+}
+
+double workingAmount(const OrderRecord& order) {
+    return order.isOpen() ? std::max(order.amount - order.filled_amount, 0.0) : 0.0;
+}
+
+}  // namespace
+
+const char* toString(OrderState state) {
+    switch (state) {
+    case OrderState::PendingNew:
+        return "pending-new";
+    case OrderState::Open:
+        return "open";
+    case OrderState::PartiallyFilled:
+        return "partially-filled";
+    case OrderState::PendingCancel:
+        return "pending-cancel";
+    case OrderState::Filled:
+        return "filled";
+    case OrderState::Cancelled:
+        return "cancelled";
+    }
+    return "unknown";
+}
+
+bool OrderFilter::matches(const OrderRecord& order) const {
+    std::string_view name = order.instrument_name.view();
+    return (instrument.empty() || name == instrument) &&
+           (currency.empty() || (name.size() > currency.size() && name.compare(0, currency.size(), currency) == 0 &&
+                                 (name[currency.size()] == '-' || name[currency.size()] == '_'))) &&
+           (label.empty() || order.label.view() == label);
+}
+
+OrderStore::OrderStore(size_t capacity)
+    : records_(std::max<size_t>(capacity, 1)),
+      retired_(records_.size()),
+      by_id_(roundUpToPowerOfTwo(records_.size() * 2)),
+      by_seq_(roundUpToPowerOfTwo(records_.size() * 6)),
+      open_position_(records_.size()) {
+    free_.reserve(records_.size());
+    for (size_t i = records_.size(); i > 0; --i) {
+        free_.push_back(static_cast<uint32_t>(i - 1));
+    }
+    open_.reserve(records_.size());
+    mass_cancels_.reserve(16);
+}
+
+void OrderStore::setExposureListener(ExposureListener listener) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    exposure_listener_ = std::move(listener);
+}
+
+void OrderStore::notifyExposure(const OrderRecord& entry, double working_before, double filled_before) {
+    double working_delta = workingAmount(entry) - working_before;
+    double filled_delta = entry.filled_amount - filled_before;
+    if (exposure_listener_ && (working_delta != 0.0 || filled_delta != 0.0)) {
+        exposure_listener_(entry, working_delta, filled_delta);
+    }
+}
+
+uint64_t OrderStore::hashId(std::string_view order_id) {
+    // FNV-1a, as for channel names
+    uint64_t value = 14695981039346656037ull;
+    for (unsigned char c : order_id) {
+        value ^= c;
+        value *= 1099511628211ull;
+    }
+    return value;
+}
+
+uint64_t OrderStore::hashSeq(int seq) {
+    // Odd multiplier: consecutive ids land in distinct low bits
+    return static_cast<uint64_t>(static_cast<uint32_t>(seq)) * 0x9E3779B97F4A7C15ull;
+}
+
+void OrderStore::indexInsert(SlabArray<IndexSlot>& index, uint64_t hash, uint32_t record) {
+    size_t mask = index.size() - 1;
+    size_t pos = hash & mask;
+    while (index[pos].record != kNone) {
+        pos = (pos + 1) & mask;
+    }
+    index[pos].hash = hash;
+    index[pos].record = record;
+}
+
+void OrderStore::indexErase(SlabArray<IndexSlot>& index, uint64_t hash, uint32_t record) {
+    size_t mask = index.size() - 1;
+    size_t pos = hash & mask;
+    while (index[pos].record != kNone && !(index[pos].hash == hash && index[pos].record == record)) {
+        pos = (pos + 1) & mask;
+    }
+    if (index[pos].record == kNone) {
+        return;
+    }
+    index[pos] = IndexSlot{};
+
+    // Backward-shift the rest of the cluster, as ChannelRegistry does
+    size_t next = (pos + 1) & mask;
+    while (index[next].record != kNone) {
+        size_t home = index[next].hash & mask;
+        if (((next - home) & mask) >= ((next - pos) & mask)) {
+            index[pos] = index[next];
+            index[next] = IndexSlot{};
+            pos = next;
+        }
+        next = (next + 1) & mask;
+    }
+}
+
+uint32_t OrderStore::findId(std::string_view order_id) const {
+    uint64_t hash = hashId(order_id);
+    size_t mask = by_id_.size() - 1;
+    for (size_t pos = hash & mask; by_id_[pos].record != kNone; pos = (pos + 1) & mask) {
+        if (by_id_[pos].hash == hash && records_[by_id_[pos].record].order_id.view() == order_id) {
+            return by_id_[pos].record;
+        }
+    }
+    return kNone;
+}
+
+uint32_t OrderStore::findSeq(int seq) const {
+    uint64_t hash = hashSeq(seq);
+    size_t mask = by_seq_.size() - 1;
+    for (size_t pos = hash & mask; by_seq_[pos].record != kNone; pos = (pos + 1) & mask) {
+        const OrderRecord& record = records_[by_seq_[pos].record];
+        if (by_seq_[pos].hash == hash && (record.seq == seq || record.cancel_seq == seq || record.edit_seq == seq)) {
+            return by_seq_[pos].record;
+        }
+    }
+    return kNone;
+}
+
+uint32_t OrderStore::allocate() {
+    uint32_t record = kNone;
+    if (!free_.empty()) {
+        record = free_.back();
+        free_.pop_back();
+    } else if (retired_count_ > 0) {
+        // Oldest finished order makes room
+        record = retired_[retired_head_];
+        retired_head_ = (retired_head_ + 1) % retired_.size();
+        --retired_count_;
+        unindex(record);
+    } else {
+        return kNone;  // Every record is an open order
+    }
+
+    records_[record] = OrderRecord{};
+    open_position_[record] = static_cast<uint32_t>(open_.size());
+    open_.push_back(record);
+    return record;
+}
+
+void OrderStore::unindex(uint32_t record) {
+    const OrderRecord& entry = records_[record];
+    if (!entry.order_id.empty()) {
+        indexErase(by_id_, hashId(entry.order_id.view()), record);
+    }
+    if (entry.seq != 0) {
+        indexErase(by_seq_, hashSeq(entry.seq), record);
+    }
+    if (entry.cancel_seq != 0) {
+        indexErase(by_seq_, hashSeq(entry.cancel_seq), record);
+    }
+    if (entry.edit_seq != 0) {
+        indexErase(by_seq_, hashSeq(entry.edit_seq), record);
+    }
+}
+
+void OrderStore::releaseEdit(OrderRecord& entry) {
+    if (entry.edit_reserved != 0.0 && exposure_listener_) {
+        exposure_listener_(entry, -entry.edit_reserved, 0.0);
+    }
+    entry.edit_reserved = 0.0;
+}
+
+void OrderStore::retire(uint32_t record) {
+    releaseEdit(records_[record]);  // No edit can grow a finished order
+
+    // Swap-remove from the open list
+    uint32_t position = open_position_[record];
+    uint32_t last = open_.back();
+    open_[position] = last;
+    open_position_[last] = position;
+    open_.pop_back();
+
+    retired_[(retired_head_ + retired_count_) % retired_.size()] = record;
+    ++retired_count_;
+}
+
+void OrderStore::release(uint32_t record) {
+    // Only for open records nobody else can find anymore
+    uint32_t position = open_position_[record];
+    uint32_t last = open_.back();
+    open_[position] = last;
+    open_position_[last] = position;
+    open_.pop_back();
+
+    unindex(record);
+    free_.push_back(record);
+}
+
+void OrderStore::bindOrderId(uint32_t record, std::string_view order_id) {
+    OrderRecord& entry = records_[record];
+    entry.order_id.assign(order_id.data(), order_id.size());
+    indexInsert(by_id_, hashId(entry.order_id.view()), record);
+}
+
+void OrderStore::apply(uint32_t record, const OrderAck& update) {
+    OrderRecord& entry = records_[record];
+    if (!entry.isOpen()) {
+        if (entry.cancel_presumed && update.filled_amount > entry.filled_amount) {
+            // The mass cancel raced a fill: the order is gone, but the fill still moves the position
+            double filled = entry.filled_amount;
+            entry.filled_amount = update.filled_amount;
+            entry.average_price = update.average_price;
+            entry.updated_ns = PerformanceTracker::now();
+            if (stateFromExchange(update.order_state.view(), update.filled_amount) == OrderState::Filled) {
+                entry.state = OrderState::Filled;
+            }
+            notifyExposure(entry, 0.0, filled);
+        }
+        return;  // Late update for a finished order
+    }
+
+    double working = workingAmount(entry);
+    double filled = entry.filled_amount;
+    if (!update.instrument_name.empty()) {
+        entry.instrument_name = update.instrument_name;
+    }
+    if (!update.label.empty()) {
+        entry.label = update.label;
+    }
+    if (!update.direction.empty()) {
+        entry.is_buy = update.direction.view() == "buy";
+    }
+    entry.amount = update.amount;
+    entry.filled_amount = update.filled_amount;
+    entry.price = update.price;
+    entry.average_price = update.average_price;
+    entry.updated_ns = PerformanceTracker::now();
+
+    std::optional<OrderState> next = stateFromExchange(update.order_state.view(), update.filled_amount);
+    // A fill or edit that races a cancel leaves the order pending-cancel; still waiting on it
+    if (next && !(entry.state == OrderState::PendingCancel &&
+                  (*next == OrderState::Open || *next == OrderState::PartiallyFilled))) {
+        entry.state = *next;
+    }
+    notifyExposure(entry, working, filled);
+    if (!entry.isOpen()) {
+        retire(record);
+    }
+}
+
+bool OrderStore::onSubmit(int seq, const OrderRequest& request) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint32_t record = allocate();
+    if (record == kNone) {
+        return false;
+    }
+
+    OrderRecord& entry = records_[record];
+    entry.seq = seq;
+    entry.state = OrderState::PendingNew;
+    entry.is_buy = request.side == Side::Buy;
+    entry.instrument_name.assign(request.instrument.data(), request.instrument.size());
+    entry.label.assign(request.label.data(), request.label.size());
+    entry.amount = request.amount;
+    entry.price = request.price;
+    entry.updated_ns = PerformanceTracker::now();
+    indexInsert(by_seq_, hashSeq(seq), record);
+    return true;
+}
+
+void OrderStore::markCancelling(uint32_t record, int seq, bool indexed) {
+    OrderRecord& entry = records_[record];
+    if (entry.cancel_seq != 0) {
+        indexErase(by_seq_, hashSeq(entry.cancel_seq), record);  // No-op for a mass cancel's id
+    }
+    entry.cancel_seq = seq;
+    entry.state = OrderState::PendingCancel;
+    entry.updated_ns = PerformanceTracker::now();
+    if (indexed) {
+        indexInsert(by_seq_, hashSeq(seq), record);
+    }
+}
+
+void OrderStore::onCancel(int seq, std::string_view order_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint32_t record = findId(order_id);
+    if (record != kNone && records_[record].isOpen()) {
+        markCancelling(record, seq, true);
+    }
+}
+
+bool OrderStore::onEdit(int seq, std::string_view order_id, double reserved) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint32_t record = findId(order_id);
+    if (record == kNone || !records_[record].isOpen()) {
+        return false;
+    }
+
+    // An edit sent before the previous one's reply takes over its reservation
+    OrderRecord& entry = records_[record];
+    if (entry.edit_seq != 0) {
+        indexErase(by_seq_, hashSeq(entry.edit_seq), record);
+    }
+    entry.edit_seq = seq;
+    entry.edit_reserved += reserved;
+    indexInsert(by_seq_, hashSeq(seq), record);
+    return true;
+}
+
+size_t OrderStore::onCancelAll(int seq, const OrderFilter& filter) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t marked = 0;
+    for (uint32_t record : open_) {
+        // Orders still pending-new have no id the exchange could have matched yet
+        if (records_[record].state != OrderState::PendingNew && filter.matches(records_[record])) {
+            // Not indexed: n records under one id would make one long probe cluster
+            markCancelling(record, seq, false);
+            ++marked;
+        }
+    }
+    if (marked > 0) {
+        mass_cancels_.push_back(seq);
+    }
+    return marked;
+}
+
+void OrderStore::finishCancelAll(int seq, const OrderAck& reply) {
+    // Backwards, so the record retire() swaps into each slot has already been seen
+    for (size_t i = open_.size(); i > 0; --i) {
+        uint32_t record = open_[i - 1];
+        if (records_[record].cancel_seq == seq) {
+            finishCancel(record, seq, reply);
+        }
+    }
+}
+
+void OrderStore::finishCancel(uint32_t record, int seq, const OrderAck& reply) {
+    OrderRecord& entry = records_[record];
+    indexErase(by_seq_, hashSeq(seq), record);
+    entry.cancel_seq = 0;
+
+    if (!reply.ok()) {
+        // Cancel refused: the order is still live as far as we know; user.orders corrects us if not
+        if (entry.state == OrderState::PendingCancel) {
+            entry.state = entry.filled_amount > 0.0 ? OrderState::PartiallyFilled : OrderState::Open;
+        }
+        return;
+    }
+    if (!reply.order_id.empty()) {
+        apply(record, reply);
+        return;
+    }
+
+    // Mass cancels only return a count; everything they covered is gone
+    if (entry.state == OrderState::PendingCancel) {
+        double working = workingAmount(entry);
+        entry.state = OrderState::Cancelled;
+        entry.cancel_presumed = true;
+        notifyExposure(entry, working, entry.filled_amount);
+        entry.updated_ns = PerformanceTracker::now();
+        retire(record);
+    }
+}
+
+void OrderStore::finishEdit(uint32_t record, int seq, const OrderAck& reply) {
+    OrderRecord& entry = records_[record];
+    indexErase(by_seq_, hashSeq(seq), record);
+    entry.edit_seq = 0;
+
+    // The reply's amount reaches the limits through apply(); the reservation stood in for it until now
+    releaseEdit(entry);
+    if (reply.ok() && !reply.order_id.empty()) {
+        apply(record, reply);
+    }
+}
+
+void OrderStore::onReply(int seq, const OrderAck& reply) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto mass_cancel = std::find(mass_cancels_.begin(), mass_cancels_.end(), seq);
+    if (mass_cancel != mass_cancels_.end()) {
+        mass_cancels_.erase(mass_cancel);
+        finishCancelAll(seq, reply);
+        return;
+    }
+
+    uint32_t record = findSeq(seq);
+    if (record == kNone) {
+        // Not one of ours by id, e.g. an edit; apply it if it names an order
+        if (reply.ok() && !reply.order_id.empty()) {
+            updateLocked(reply);
+        }
+        return;
+    }
+
+    if (records_[record].cancel_seq == seq) {
+        finishCancel(record, seq, reply);
+        return;
+    }
+
+    if (records_[record].edit_seq == seq) {
+        finishEdit(record, seq, reply);
+        return;
+    }
+
+    OrderRecord& entry = records_[record];
+    if (!entry.isOpen() && entry.order_id.empty()) {
+        // Settled as refused when its reply was lost, yet the exchange took it
+        if (reply.ok() && !reply.order_id.empty()) {
+            updateLocked(reply);
+        }
+        return;
+    }
+    if (entry.state != OrderState::PendingNew) {
+        if (reply.ok()) {
+            apply(record, reply);
+        }
+        return;
+    }
+
+    if (!reply.ok() || reply.order_id.empty()) {
+        double working = workingAmount(entry);
+        entry.state = OrderState::Cancelled;  // Rejected
+        notifyExposure(entry, working, entry.filled_amount);
+        entry.updated_ns = PerformanceTracker::now();
+        retire(record);
+        return;
+    }
+
+    uint32_t known = findId(reply.order_id.view());
+    if (known != kNone) {
+        // user.orders beat the reply and already reported the order; keep that record and give it our seq
+        double working = workingAmount(entry);
+        entry.amount = 0.0;
+        notifyExposure(entry, working, entry.filled_amount);
+        release(record);
+        records_[known].seq = seq;
+        indexInsert(by_seq_, hashSeq(seq), known);
+        apply(known, reply);
+        return;
+    }
+    bindOrderId(record, reply.order_id.view());
+    apply(record, reply);
+}
+
+void OrderStore::onUpdate(const OrderAck& update) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    updateLocked(update);
+}
+
+void OrderStore::updateLocked(const OrderAck& update) {
+    if (update.order_id.empty()) {
+        return;
+    }
+
+    uint32_t record = findId(update.order_id.view());
+    if (record == kNone) {
+        std::optional<OrderState> state = stateFromExchange(update.order_state.view(), update.filled_amount);
+        if (!state || *state == OrderState::Filled || *state == OrderState::Cancelled) {
+            return;  // Nothing to track
+        }
+        record = allocate();
+        if (record == kNone) {
+            return;
+        }
+        records_[record].state = *state;
+        bindOrderId(record, update.order_id.view());
+    }
+    apply(record, update);
+}
+
+std::optional<OrderRecord> OrderStore::find(std::string_view order_id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint32_t record = findId(order_id);
+    if (record == kNone) {
+        return std::nullopt;
+    }
+    return records_[record];
+}
+
+std::optional<OrderRecord> OrderStore::findBySeq(int seq) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint32_t record = findSeq(seq);
+    if (record == kNone) {
+        return std::nullopt;
+    }
+    return records_[record];
+}
+
+size_t OrderStore::openOrders(std::vector<OrderRecord>& out, std::string_view instrument) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t added = 0;
+    for (uint32_t record : open_) {
+        if (instrument.empty() || records_[record].instrument_name.view() == instrument) {
+            out.push_back(records_[record]);
+            ++added;
+        }
+    }
+    return added;
+}
+
+size_t OrderStore::openCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return open_.size();
+}
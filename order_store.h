@@ -0,0 +1,141 @@
+#ifndef ORDER_STORE_H
+#define ORDER_STORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <vector>
+#include "memory_arena.h"
+#include "order_request.h"
+#include "response_parser.h"
+
+enum class OrderState : uint8_t {
+    PendingNew,       // Sent, no reply yet
+    Open,
+    PartiallyFilled,
+    PendingCancel,    // Cancel sent, no reply yet
+    Filled,
+    Cancelled,        // Also covers rejected submissions
+};
+
+const char* toString(OrderState state);
+
+// One order as the client knows it. Fixed size so the store can pool them.
+struct OrderRecord {
+    int seq = 0;         // JSON-RPC id of the submitting request; 0 for orders first seen in user.orders
+    int cancel_seq = 0;  // Id of the outstanding cancel or mass cancel, if any
+    int edit_seq = 0;    // Id of the latest outstanding edit, if any
+    OrderState state = OrderState::PendingNew;
+    bool is_buy = true;
+    bool cancel_presumed = false;  // Retired on a mass cancel's count, so fills reported later still count
+    FixedString<64> order_id;  // Empty until the exchange acknowledges
+    FixedString<64> instrument_name;
+    FixedString<64> label;
+    double amount = 0.0;
+    double filled_amount = 0.0;
+    double price = 0.0;
+    double average_price = 0.0;
+    double edit_reserved = 0.0;  // Working amount the risk gate holds for outstanding edits
+    int64_t updated_ns = 0;
+
+    bool isOpen() const { return state != OrderState::Filled && state != OrderState::Cancelled; }
+};
+
+// Which orders a mass cancel covers; empty fields match everything
+struct OrderFilter {
+    std::string_view instrument;
+    std::string_view currency;  // Instrument name prefix before '-' or '_', e.g. "BTC" for BTC-PERPETUAL
+    std::string_view label;
+
+    bool matches(const OrderRecord& order) const;
+};
+
+// Client-side order state, kept current from request replies and user.orders
+// notifications. Records live in a pool allocated up front and are indexed by
+// exchange order_id and by client sequence id through open-addressing tables,
+// so updates and lookups never allocate. Finished orders stay queryable until
+// their record is needed again, oldest first. All methods are thread-safe.
+class OrderStore {
+public:
+    static constexpr size_t kDefaultCapacity = 4096;
+
+    // Called under the store lock whenever an order's working amount (unfilled while open, 0 once
+    // finished) or filled amount moves. A submit itself is not reported: whoever submits already
+    // counts the request amount as working.
+    using ExposureListener = std::function<void(const OrderRecord& order, double working_delta, double filled_delta)>;
+
+    explicit OrderStore(size_t capacity = kDefaultCapacity);
+
+    void setExposureListener(ExposureListener listener);
+
+    // Request side: called before the request is written
+    bool onSubmit(int seq, const OrderRequest& request);  // False if full
+    void onCancel(int seq, std::string_view order_id);
+    // reserved is extra working amount the caller already holds against the limits for this edit.
+    // It is given back through the exposure listener once the edit's reply settles. False if the
+    // order is not open, and then nothing is taken over.
+    bool onEdit(int seq, std::string_view order_id, double reserved);
+    size_t onCancelAll(int seq, const OrderFilter& filter);  // Marks every acknowledged match pending-cancel
+
+    // Reply to any request; ignored unless it concerns a known order. A request whose reply is
+    // lost is reported as an error: a pending submit is settled as refused, a pending cancel
+    // reverts to open. A late reply or user.orders reinstates an order that went through anyway.
+    void onReply(int seq, const OrderAck& reply);
+    // user.orders notification; orders placed elsewhere are picked up too
+    void onUpdate(const OrderAck& update);
+
+    std::optional<OrderRecord> find(std::string_view order_id) const;
+    std::optional<OrderRecord> findBySeq(int seq) const;
+    // Appends open orders (all states but filled and cancelled), optionally for one instrument
+    size_t openOrders(std::vector<OrderRecord>& out, std::string_view instrument = {}) const;
+    size_t openCount() const;
+    size_t capacity() const { return records_.size(); }
+
+private:
+    static constexpr uint32_t kNone = UINT32_MAX;
+
+    struct IndexSlot {
+        uint64_t hash = 0;
+        uint32_t record = kNone;
+    };
+
+    void updateLocked(const OrderAck& update);
+    uint32_t allocate();
+    void release(uint32_t record);  // Back to the free list at once
+    void retire(uint32_t record);   // Finished; recycled after older finished records
+    void unindex(uint32_t record);
+    void apply(uint32_t record, const OrderAck& update);
+    void finishCancel(uint32_t record, int seq, const OrderAck& reply);
+    void finishCancelAll(int seq, const OrderAck& reply);
+    void finishEdit(uint32_t record, int seq, const OrderAck& reply);
+    void releaseEdit(OrderRecord& entry);
+    void markCancelling(uint32_t record, int seq, bool indexed);
+    void bindOrderId(uint32_t record, std::string_view order_id);
+    void notifyExposure(const OrderRecord& entry, double working_before, double filled_before);
+
+    uint32_t findId(std::string_view order_id) const;
+    uint32_t findSeq(int seq) const;
+    void indexInsert(SlabArray<IndexSlot>& index, uint64_t hash, uint32_t record);
+    void indexErase(SlabArray<IndexSlot>& index, uint64_t hash, uint32_t record);
+
+    static uint64_t hashId(std::string_view order_id);
+    static uint64_t hashSeq(int seq);
+
+    mutable std::mutex mutex_;
+    SlabArray<OrderRecord> records_;       // Records and indexes are mapped once, on huge pages if configured
+    std::vector<uint32_t> free_;           // Never-used or recycled records
+    std::vector<uint32_t> retired_;        // Ring of finished records, oldest at retired_head_
+    size_t retired_head_ = 0;
+    size_t retired_count_ = 0;
+    SlabArray<IndexSlot> by_id_;           // Power-of-two sizes, at most half full
+    SlabArray<IndexSlot> by_seq_;          // Holds submit, cancel and edit ids
+    std::vector<int> mass_cancels_;        // Outstanding mass-cancel ids; their orders are found through open_
+    std::vector<uint32_t> open_;           // Dense list of open records for queries
+    std::vector<uint32_t> open_position_;  // Where each record sits in open_
+    ExposureListener exposure_listener_;
+};
+
+#endif // ORDER_STORE_H
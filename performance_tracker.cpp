@@ -1,12 +1,235 @@
 #include "performance_tracker.h"
-#include <iostream>
+#include <algorithm>
+#include <condition_variable>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
 
-std::chrono::high_resolution_clock::time_point PerformanceTracker::beginTiming() {
-    return std::chrono::high_resolution_clock::now();
+namespace {
+
+constexpr size_t kLinearLimit = size_t{2} << PerformanceTracker::kSubBucketBits;  // Exact below 64 ns
+constexpr size_t kSubBuckets = size_t{1} << PerformanceTracker::kSubBucketBits;
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::string> names;
+    // Blocks outlive their threads so samples from finished threads still get reported
+    std::vector<std::shared_ptr<void>> thread_blocks;
+};
+
+Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+struct Reporter {
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    std::thread thread;
+    std::ostream* out = nullptr;
+};
+
+Reporter& reporter() {
+    static Reporter instance;
+    return instance;
+}
+
+}  // namespace
+
+PerformanceTracker::Histogram::Histogram() {
+    for (auto& count : counts) {
+        count.store(0, std::memory_order_relaxed);
+    }
+}
+
+PerformanceTracker::ThreadHistograms::ThreadHistograms() {
+    for (auto& probe : probes) {
+        probe.store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+PerformanceTracker::ThreadHistograms::~ThreadHistograms() {
+    for (auto& probe : probes) {
+        delete probe.load(std::memory_order_relaxed);
+    }
+}
+
+size_t PerformanceTracker::bucketIndex(int64_t nanos) {
+    if (nanos < 0) {
+        return 0;
+    }
+    uint64_t value = static_cast<uint64_t>(nanos);
+    if (value < kLinearLimit) {
+        return static_cast<size_t>(value);
+    }
+
+    size_t exponent = 63 - static_cast<size_t>(__builtin_clzll(value));
+    size_t mantissa = static_cast<size_t>(value >> (exponent - kSubBucketBits));  // In [32, 64)
+    size_t index = kLinearLimit + (exponent - kSubBucketBits - 1) * kSubBuckets + (mantissa - kSubBuckets);
+    return index < kBuckets ? index : kBuckets - 1;
+}
+
+int64_t PerformanceTracker::bucketUpperBound(size_t index) {
+    if (index < kLinearLimit) {
+        return static_cast<int64_t>(index);
+    }
+
+    size_t exponent = (index - kLinearLimit) / kSubBuckets + kSubBucketBits + 1;
+    uint64_t mantissa = (index - kLinearLimit) % kSubBuckets + kSubBuckets;
+    return static_cast<int64_t>(((mantissa + 1) << (exponent - kSubBucketBits)) - 1);
+}
+
+PerformanceTracker::ProbeId PerformanceTracker::registerProbe(const std::string& name) {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    for (size_t i = 0; i < reg.names.size(); ++i) {
+        if (reg.names[i] == name) {
+            return static_cast<ProbeId>(i);
+        }
+    }
+    if (reg.names.size() == kMaxProbes) {
+        throw std::length_error("Too many performance probes");
+    }
+    reg.names.push_back(name);
+    return static_cast<ProbeId>(reg.names.size() - 1);
 }
 
-void PerformanceTracker::endTiming(const std::chrono::high_resolution_clock::time_point& start, const std::string& task) {
-    auto finish = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double> duration = finish - start;
-    std::cout << task << " took: " << duration.count() << " seconds" << std::endl;
-}
\ No newline at end of file
+PerformanceTracker::ThreadHistograms& PerformanceTracker::localHistograms() {
+    thread_local ThreadHistograms* local = [] {
+        auto block = std::make_shared<ThreadHistograms>();
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        reg.thread_blocks.push_back(block);
+        return block.get();
+    }();
+    return *local;
+}
+
+void PerformanceTracker::record(ProbeId probe, int64_t nanos) {
+    ThreadHistograms& local = localHistograms();
+    Histogram* histogram = local.probes[probe].load(std::memory_order_relaxed);
+    if (!histogram) {
+        histogram = new Histogram();  // Once per probe per thread
+        local.probes[probe].store(histogram, std::memory_order_release);
+    }
+
+    // Single writer per histogram: plain load/store, no locked read-modify-write
+    auto& count = histogram->counts[bucketIndex(nanos)];
+    count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    histogram->total.store(histogram->total.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if (nanos > histogram->max.load(std::memory_order_relaxed)) {
+        histogram->max.store(nanos, std::memory_order_relaxed);
+    }
+}
+
+std::vector<PerformanceTracker::Summary> PerformanceTracker::snapshot() {
+    std::vector<std::string> names;
+    std::vector<const ThreadHistograms*> blocks;
+    {
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        names = reg.names;
+        for (const auto& block : reg.thread_blocks) {
+            blocks.push_back(static_cast<const ThreadHistograms*>(block.get()));
+        }
+    }
+
+    std::vector<Summary> summaries;
+    std::vector<uint64_t> merged(kBuckets);
+    for (size_t probe = 0; probe < names.size(); ++probe) {
+        std::fill(merged.begin(), merged.end(), 0);
+        uint64_t total = 0;
+        int64_t max = 0;
+        for (const ThreadHistograms* block : blocks) {
+            const Histogram* histogram = block->probes[probe].load(std::memory_order_acquire);
+            if (!histogram) {
+                continue;
+            }
+            for (size_t i = 0; i < kBuckets; ++i) {
+                uint64_t count = histogram->counts[i].load(std::memory_order_relaxed);
+                merged[i] += count;
+                total += count;
+            }
+            max = std::max(max, histogram->max.load(std::memory_order_relaxed));
+        }
+        if (total == 0) {
+            continue;
+        }
+
+        auto percentile = [&](double fraction) {
+            uint64_t rank = static_cast<uint64_t>(fraction * static_cast<double>(total - 1)) + 1;
+            uint64_t seen = 0;
+            for (size_t i = 0; i < kBuckets; ++i) {
+                seen += merged[i];
+                if (seen >= rank) {
+                    return std::min(bucketUpperBound(i), max);
+                }
+            }
+            return max;
+        };
+        summaries.push_back(Summary{names[probe], total, percentile(0.50), percentile(0.99), percentile(0.999), max});
+    }
+    return summaries;
+}
+
+void PerformanceTracker::report(std::ostream& out) {
+    std::vector<Summary> summaries = snapshot();
+    if (summaries.empty()) {
+        return;
+    }
+
+    out << std::left << std::setw(28) << "probe" << std::right << std::setw(12) << "count"
+        << std::setw(12) << "p50 ns" << std::setw(12) << "p99 ns" << std::setw(12) << "p99.9 ns"
+        << std::setw(14) << "max ns" << '\n';
+    for (const Summary& summary : summaries) {
+        out << std::left << std::setw(28) << summary.name << std::right << std::setw(12) << summary.count
+            << std::setw(12) << summary.p50 << std::setw(12) << summary.p99 << std::setw(12) << summary.p999
+            << std::setw(14) << summary.max << '\n';
+    }
+    out.flush();
+}
+
+void PerformanceTracker::startReporter(std::chrono::milliseconds interval, std::ostream& out) {
+    Reporter& rep = reporter();
+    std::lock_guard<std::mutex> lock(rep.mutex);
+    if (rep.thread.joinable()) {
+        return;
+    }
+
+    rep.stopping = false;
+    rep.out = &out;
+    rep.thread = std::thread([interval, &rep] {
+        std::unique_lock<std::mutex> lock(rep.mutex);
+        while (!rep.wake.wait_for(lock, interval, [&rep] { return rep.stopping; })) {
+            lock.unlock();
+            report(*rep.out);
+            lock.lock();
+        }
+    });
+}
+
+void PerformanceTracker::stopReporter() {
+    Reporter& rep = reporter();
+    {
+        std::lock_guard<std::mutex> lock(rep.mutex);
+        if (!rep.thread.joinable()) {
+            return;
+        }
+        rep.stopping = true;
+    }
+    rep.wake.notify_all();
+    rep.thread.join();
+    report(*rep.out);
+}
+
+std::chrono::steady_clock::time_point PerformanceTracker::beginTiming() {
+    return std::chrono::steady_clock::now();
+}
+
+void PerformanceTracker::endTiming(const std::chrono::steady_clock::time_point& start, const std::string& task) {
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    record(registerProbe(task), std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+}
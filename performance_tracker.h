@@ -1,13 +1,84 @@
 #ifndef PERFORMANCE_TRACKER_H
 #define PERFORMANCE_TRACKER_H
 
+#include <atomic>
 #include <chrono>
+#include <cstdint>
+#include <iostream>
 #include <string>
+#include <vector>
 
+// Low-overhead latency instrumentation. Probes are registered once by name;
+// record() adds a nanosecond sample to the calling thread's own log-linear
+// histogram (about 3% resolution) with no locks or shared writes. A background
+// reporter merges all threads and prints p50/p99/p99.9/max per probe.
 class PerformanceTracker {
 public:
-    static std::chrono::high_resolution_clock::time_point beginTiming();
-    static void endTiming(const std::chrono::high_resolution_clock::time_point& start, const std::string& task);
+    using ProbeId = uint16_t;
+
+    static constexpr size_t kMaxProbes = 64;
+    static constexpr size_t kSubBucketBits = 5;  // 32 linear steps per power of two
+    static constexpr size_t kBuckets = 1280;     // Covers up to ~73 minutes
+
+    struct Summary {
+        std::string name;
+        uint64_t count;
+        int64_t p50;
+        int64_t p99;
+        int64_t p999;
+        int64_t max;
+    };
+
+    // Scoped probe: records the lifetime of the object
+    class Timer {
+    public:
+        explicit Timer(ProbeId probe) : probe_(probe), start_(now()) {}
+        ~Timer() { record(probe_, now() - start_); }
+
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+
+    private:
+        ProbeId probe_;
+        int64_t start_;
+    };
+
+    static ProbeId registerProbe(const std::string& name);  // Same name returns the same id
+    static int64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+    static void record(ProbeId probe, int64_t nanos);
+
+    static std::vector<Summary> snapshot();  // Merged over all threads, probes with samples only
+    static void report(std::ostream& out);
+    static void startReporter(std::chrono::milliseconds interval, std::ostream& out = std::cout);
+    static void stopReporter();  // Prints a final report
+
+    static size_t bucketIndex(int64_t nanos);
+    static int64_t bucketUpperBound(size_t index);
+
+    // Coarse timing of named operations; the name lookup takes a lock, so keep these off the hot path
+    static std::chrono::steady_clock::time_point beginTiming();
+    static void endTiming(const std::chrono::steady_clock::time_point& start, const std::string& task);
+
+private:
+    struct Histogram {
+        std::atomic<uint64_t> counts[kBuckets];
+        std::atomic<uint64_t> total{0};
+        std::atomic<int64_t> max{0};
+
+        Histogram();
+    };
+
+    struct ThreadHistograms {
+        std::atomic<Histogram*> probes[kMaxProbes];
+
+        ThreadHistograms();
+        ~ThreadHistograms();
+    };
+
+    static ThreadHistograms& localHistograms();
 };
 
-#endif // PERFORMANCE_TRACKER_H
\ No newline at end of file
+#endif // PERFORMANCE_TRACKER_H
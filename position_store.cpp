@@ -0,0 +1,251 @@
+#include "position_store.h"
+#include <algorithm>
+#include <cmath>
+#include "logger.h"
+
+namespace {
+
+// Sizes closer to zero than this after a fill are flat; Deribit amounts are far coarser
+constexpr double kFlatEpsilon = 1e-9;
+// Reconcile tolerances: exchange and client round differently
+constexpr double kSizeTolerance = 1e-9;
+constexpr double kPriceTolerance = 1e-6;  // Relative
+
+double profit(PnlModel model, double size, double entry, double exit) {
+    if (size == 0.0 || entry <= 0.0 || exit <= 0.0) {
+        return 0.0;
+    }
+    return model == PnlModel::Inverse ? size * (1.0 / entry - 1.0 / exit) : size * (exit - entry);
+}
+
+bool differs(double local, double exchange, double tolerance) {
+    return std::abs(local - exchange) > tolerance * std::max(1.0, std::abs(exchange));
+}
+
+}  // namespace
+
+PnlModel pnlModel(std::string_view instrument) {
+    if (instrument.find('_') != std::string_view::npos) {
+        return PnlModel::Linear;
+    }
+    return std::count(instrument.begin(), instrument.end(), '-') == 1 ? PnlModel::Inverse : PnlModel::Linear;
+}
+
+std::string_view settlementCurrency(std::string_view instrument) {
+    size_t dash = instrument.find('-');
+    std::string_view base = instrument.substr(0, dash);
+    size_t underscore = base.find('_');
+    return underscore == std::string_view::npos ? base : base.substr(underscore + 1);
+}
+
+PositionStore::PositionStore(InstrumentCache& instruments)
+    : instruments_(instruments),
+      entries_(new std::atomic<Entry*>[InstrumentCache::kMaxInstruments]) {
+    for (size_t i = 0; i < InstrumentCache::kMaxInstruments; ++i) {
+        entries_[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+PositionStore::Entry* PositionStore::findEntry(InstrumentId instrument) const {
+    return instrument < InstrumentCache::kMaxInstruments ? entries_[instrument].load(std::memory_order_acquire)
+                                                         : nullptr;
+}
+
+PositionStore::Entry& PositionStore::entry(std::string_view instrument) {
+    InstrumentId id = instruments_.intern(instrument);
+    if (Entry* existing = findEntry(id)) {
+        return *existing;
+    }
+
+    std::lock_guard<std::mutex> lock(entries_mutex_);
+    if (Entry* existing = entries_[id].load(std::memory_order_relaxed)) {
+        return *existing;
+    }
+    auto created = std::make_unique<Entry>();
+    PositionRecord& record = created->record;
+    record.id = id;
+    record.instrument_name.assign(instrument.data(), instrument.size());
+    std::string_view currency = settlementCurrency(instrument);
+    record.currency.assign(currency.data(), currency.size());
+    record.model = pnlModel(instrument);
+
+    Entry* published = created.get();
+    storage_.push_back(std::move(created));
+    entries_[id].store(published, std::memory_order_release);
+    return *published;
+}
+
+void PositionStore::applyFill(PositionRecord& record, bool is_buy, double amount, double price) {
+    double signed_amount = is_buy ? amount : -amount;
+    double size = record.size;
+
+    if (size == 0.0 || (size > 0.0) == is_buy) {
+        // Opening or adding: the entry price is the amount-weighted mean, harmonic for inverse contracts
+        double open = std::abs(size);
+        if (open == 0.0) {
+            record.average_price = price;
+        } else if (record.model == PnlModel::Inverse) {
+            record.average_price = (open + amount) / (open / record.average_price + amount / price);
+        } else {
+            record.average_price = (open * record.average_price + amount * price) / (open + amount);
+        }
+        record.size = size + signed_amount;
+        return;
+    }
+
+    // Reducing, and possibly flipping: the closed part books against the entry price
+    double closed = std::min(amount, std::abs(size));
+    record.realized_pnl += profit(record.model, size > 0.0 ? closed : -closed, record.average_price, price);
+    record.size = size + signed_amount;
+    if (std::abs(record.size) < kFlatEpsilon) {
+        record.size = 0.0;
+        record.average_price = 0.0;
+    } else if ((record.size > 0.0) != (size > 0.0)) {
+        record.average_price = price;  // The remainder opened at this fill
+    }
+}
+
+void PositionStore::markToMarket(PositionRecord& record) {
+    record.unrealized_pnl = profit(record.model, record.size, record.average_price, record.mark_price);
+}
+
+bool PositionStore::onFill(const TradeFill& fill, int64_t now_ns) {
+    if (fill.instrument_name.empty() || fill.amount <= 0.0 || fill.price <= 0.0) {
+        return false;
+    }
+
+    Entry& target = entry(fill.instrument_name.view());
+    std::lock_guard<std::mutex> lock(target.mutex);
+    PositionRecord& record = target.record;
+    if (fill.trade_seq != 0 && fill.trade_seq <= record.last_trade_seq) {
+        return false;  // Delivered twice
+    }
+
+    applyFill(record, fill.isBuy(), fill.amount, fill.price);
+    record.fees += fill.fee;
+    if (fill.mark_price > 0.0) {
+        record.mark_price = fill.mark_price;
+    }
+    markToMarket(record);
+    if (fill.trade_seq != 0) {
+        record.last_trade_seq = fill.trade_seq;
+    }
+    ++record.fills;
+    record.updated_ns = now_ns;
+    fills_applied_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void PositionStore::onMark(InstrumentId instrument, double mark_price) {
+    Entry* target = findEntry(instrument);
+    if (!target || mark_price <= 0.0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(target->mutex);
+    target->record.mark_price = mark_price;
+    markToMarket(target->record);
+}
+
+size_t PositionStore::reconcile(std::string_view currency, const std::vector<PositionSnapshot>& snapshot,
+                                int64_t now_ns) {
+    size_t corrected = 0;
+    std::vector<InstrumentId> reported;
+    reported.reserve(snapshot.size());
+
+    for (const PositionSnapshot& position : snapshot) {
+        if (position.instrument_name.empty()) {
+            continue;
+        }
+        Entry& target = entry(position.instrument_name.view());
+        std::lock_guard<std::mutex> lock(target.mutex);
+        PositionRecord& record = target.record;
+        reported.push_back(record.id);
+
+        bool size_drift = differs(record.size, position.size, kSizeTolerance);
+        bool price_drift = position.size != 0.0 &&
+                           differs(record.average_price, position.average_price, kPriceTolerance);
+        if (size_drift || price_drift) {
+            LOG_WARN("Position on {} drifted: local {} @ {}, exchange {} @ {}", record.instrument_name.view(),
+                     record.size, record.average_price, position.size, position.average_price);
+            record.size = position.size;
+            record.average_price = position.size != 0.0 ? position.average_price : 0.0;
+            record.updated_ns = now_ns;
+            ++corrected;
+        }
+        if (position.mark_price > 0.0) {
+            record.mark_price = position.mark_price;
+        }
+        markToMarket(record);
+    }
+
+    // Anything tracked in this currency the exchange did not list is flat there
+    std::vector<Entry*> tracked;
+    {
+        std::lock_guard<std::mutex> lock(entries_mutex_);
+        for (const auto& stored : storage_) {
+            tracked.push_back(stored.get());
+        }
+    }
+    for (Entry* target : tracked) {
+        std::lock_guard<std::mutex> lock(target->mutex);
+        PositionRecord& record = target->record;
+        if (record.currency.view() != currency || record.size == 0.0 ||
+            std::find(reported.begin(), reported.end(), record.id) != reported.end()) {
+            continue;
+        }
+        LOG_WARN("Position on {} drifted: local {} @ {}, exchange flat", record.instrument_name.view(), record.size,
+                 record.average_price);
+        record.size = 0.0;
+        record.average_price = 0.0;
+        record.updated_ns = now_ns;
+        markToMarket(record);
+        ++corrected;
+    }
+
+    corrections_.fetch_add(corrected, std::memory_order_relaxed);
+    return corrected;
+}
+
+std::optional<PositionRecord> PositionStore::find(InstrumentId instrument) const {
+    Entry* target = findEntry(instrument);
+    if (!target) {
+        return std::nullopt;
+    }
+    std::lock_guard<std::mutex> lock(target->mutex);
+    return target->record;
+}
+
+std::vector<PositionRecord> PositionStore::positions(std::string_view currency) const {
+    std::vector<PositionRecord> out;
+    std::lock_guard<std::mutex> lock(entries_mutex_);
+    for (const auto& stored : storage_) {
+        std::lock_guard<std::mutex> record_lock(stored->mutex);
+        if (currency.empty() || stored->record.currency.view() == currency) {
+            out.push_back(stored->record);
+        }
+    }
+    return out;
+}
+
+PnlTotals PositionStore::totals(std::string_view currency) const {
+    PnlTotals totals;
+    for (const PositionRecord& record : positions(currency)) {
+        totals.realized_pnl += record.realized_pnl;
+        totals.unrealized_pnl += record.unrealized_pnl;
+        totals.fees += record.fees;
+        totals.open_positions += record.isFlat() ? 0 : 1;
+    }
+    return totals;
+}
+
+std::vector<std::string> PositionStore::currencies() const {
+    std::vector<std::string> out;
+    std::lock_guard<std::mutex> lock(entries_mutex_);
+    for (const auto& stored : storage_) {
+        std::string_view currency = stored->record.currency.view();  // Fixed once the entry is published
+        if (std::find(out.begin(), out.end(), currency) == out.end()) {
+            out.emplace_back(currency);
+        }
+    }
+    return out;
+}
@@ -0,0 +1,104 @@
+#ifndef POSITION_STORE_H
+#define POSITION_STORE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "instrument_cache.h"
+#include "response_parser.h"
+
+// How an instrument's profit accrues
+enum class PnlModel : uint8_t {
+    Linear,   // size * (exit - entry): options, USDC-margined contracts and spot
+    Inverse,  // size * (1 / entry - 1 / exit) with size in USD: coin-margined futures and perpetuals
+};
+
+// From the instrument name alone: BTC-PERPETUAL and BTC-27MAR26 are inverse, anything with
+// a strike or an underscore is linear
+PnlModel pnlModel(std::string_view instrument);
+// Currency the instrument's PnL settles in, as private/get_positions takes it: BTC for
+// BTC-PERPETUAL and BTC options, USDC for BTC_USDC-PERPETUAL
+std::string_view settlementCurrency(std::string_view instrument);
+
+// One instrument's position as the client knows it
+struct PositionRecord {
+    InstrumentId id = kNoInstrument;
+    FixedString<64> instrument_name;
+    FixedString<16> currency;  // Settlement currency, which every PnL field is in
+    PnlModel model = PnlModel::Linear;
+    double size = 0.0;            // Signed: positive is long
+    double average_price = 0.0;   // Entry price of the open size, 0 when flat
+    double realized_pnl = 0.0;    // Booked by fills since tracking started, before fees
+    double unrealized_pnl = 0.0;  // Open size against mark_price
+    double mark_price = 0.0;
+    double fees = 0.0;
+    int64_t last_trade_seq = 0;
+    uint64_t fills = 0;
+    int64_t updated_ns = 0;
+
+    bool isFlat() const { return size == 0.0; }
+};
+
+// Sum over every position settling in one currency
+struct PnlTotals {
+    double realized_pnl = 0.0;
+    double unrealized_pnl = 0.0;
+    double fees = 0.0;
+    size_t open_positions = 0;
+};
+
+// Net positions and PnL per instrument, kept current from user.trades fills and
+// mark prices. Records are indexed by InstrumentId like tracked books, so a
+// lookup is one array load and a per-record lock; a fill or mark touches one
+// record and never allocates once the instrument has been seen. The exchange's
+// private/get_positions snapshot is authoritative: reconcile() overwrites the size
+// and entry price of any position that drifted, e.g. through a missed fill or a
+// settlement. All methods are thread-safe.
+class PositionStore {
+public:
+    explicit PositionStore(InstrumentCache& instruments);
+
+    // Applies one execution; false for a trade_seq the instrument has already seen
+    bool onFill(const TradeFill& fill, int64_t now_ns);
+    void onMark(InstrumentId instrument, double mark_price);
+    // Snapshot for one settlement currency. Tracked positions in that currency the snapshot
+    // leaves out are flat on the exchange. Returns how many positions were corrected.
+    size_t reconcile(std::string_view currency, const std::vector<PositionSnapshot>& snapshot, int64_t now_ns);
+
+    std::optional<PositionRecord> find(InstrumentId instrument) const;
+    std::optional<PositionRecord> find(std::string_view instrument) const { return find(instruments_.find(instrument)); }
+    // Every instrument traded or reported since tracking started, flat ones included
+    std::vector<PositionRecord> positions(std::string_view currency = {}) const;
+    PnlTotals totals(std::string_view currency) const;
+    std::vector<std::string> currencies() const;
+
+    uint64_t fillsApplied() const { return fills_applied_.load(std::memory_order_relaxed); }
+    uint64_t corrections() const { return corrections_.load(std::memory_order_relaxed); }
+
+private:
+    struct Entry {
+        mutable std::mutex mutex;  // Fills and reconciles on the order-entry thread vs. marks and readers
+        PositionRecord record;
+    };
+
+    Entry& entry(std::string_view instrument);  // Created on first sight
+    Entry* findEntry(InstrumentId instrument) const;
+
+    static void applyFill(PositionRecord& record, bool is_buy, double amount, double price);
+    static void markToMarket(PositionRecord& record);
+
+    InstrumentCache& instruments_;
+    mutable std::mutex entries_mutex_;  // Serializes creation and listing
+    std::vector<std::unique_ptr<Entry>> storage_;
+    std::unique_ptr<std::atomic<Entry*>[]> entries_;  // By InstrumentId; set once
+    std::atomic<uint64_t> fills_applied_{0};
+    std::atomic<uint64_t> corrections_{0};
+};
+
+#endif // POSITION_STORE_H
@@ -0,0 +1,589 @@
+#include "response_parser.h"
+#include <rapidjson/memorystream.h>
+
+namespace {
+
+enum class Field : uint8_t {
+    Other,
+    Id,
+    Method,
+    Error,
+    Code,
+    Message,
+    Result,
+    Order,
+    Params,
+    Channel,
+    Data,
+    Bids,
+    Asks,
+    Type,
+    ChangeId,
+    PrevChangeId,
+    OrderId,
+    OrderState,
+    InstrumentName,
+    Label,
+    Direction,
+    Kind,
+    Amount,
+    FilledAmount,
+    Price,
+    AveragePrice,
+    Size,
+    MarkPrice,
+    FloatingProfitLoss,
+    RealizedProfitLoss,
+    TradeId,
+    TradeSeq,
+    Fee,
+    FeeCurrency,
+};
+
+// Where the parser currently is; decides which struct a value lands in
+enum class Scope : uint8_t {
+    Ignore,
+    Root,
+    Error,
+    Params,
+    Result,       // result object: cancel ack or order book
+    ResultArray,  // result array: positions
+    Position,
+    Order,        // result.order of buy/sell/edit
+    Data,         // params.data of a notification
+    DataArray,    // params.data array: user.trades
+    Trade,
+    BidLevels,
+    AskLevels,
+    BidLevel,
+    AskLevel,
+};
+
+Field lookupField(const char* str, rapidjson::SizeType length) {
+    std::string_view key(str, length);
+    switch (length) {
+    case 2:
+        if (key == "id") return Field::Id;
+        break;
+    case 3:
+        if (key == "fee") return Field::Fee;
+        break;
+    case 4:
+        if (key == "code") return Field::Code;
+        if (key == "data") return Field::Data;
+        if (key == "bids") return Field::Bids;
+        if (key == "asks") return Field::Asks;
+        if (key == "type") return Field::Type;
+        if (key == "kind") return Field::Kind;
+        if (key == "size") return Field::Size;
+        break;
+    case 5:
+        if (key == "error") return Field::Error;
+        if (key == "order") return Field::Order;
+        if (key == "label") return Field::Label;
+        if (key == "price") return Field::Price;
+        break;
+    case 6:
+        if (key == "method") return Field::Method;
+        if (key == "result") return Field::Result;
+        if (key == "params") return Field::Params;
+        if (key == "amount") return Field::Amount;
+        break;
+    case 7:
+        if (key == "message") return Field::Message;
+        if (key == "channel") return Field::Channel;
+        break;
+    case 8:
+        if (key == "order_id") return Field::OrderId;
+        if (key == "trade_id") return Field::TradeId;
+        break;
+    case 9:
+        if (key == "change_id") return Field::ChangeId;
+        if (key == "direction") return Field::Direction;
+        if (key == "trade_seq") return Field::TradeSeq;
+        break;
+    case 10:
+        if (key == "mark_price") return Field::MarkPrice;
+        break;
+    case 11:
+        if (key == "order_state") return Field::OrderState;
+        break;
+    case 12:
+        if (key == "fee_currency") return Field::FeeCurrency;
+        break;
+    case 13:
+        if (key == "filled_amount") return Field::FilledAmount;
+        if (key == "average_price") return Field::AveragePrice;
+        break;
+    case 14:
+        if (key == "prev_change_id") return Field::PrevChangeId;
+        break;
+    case 15:
+        if (key == "instrument_name") return Field::InstrumentName;
+        break;
+    case 20:
+        if (key == "floating_profit_loss") return Field::FloatingProfitLoss;
+        if (key == "realized_profit_loss") return Field::RealizedProfitLoss;
+        break;
+    default:
+        break;
+    }
+    return Field::Other;
+}
+
+}  // namespace
+
+class ResponseParser::Handler : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, Handler> {
+public:
+    explicit Handler(ParsedMessage& message) : message_(message) {}
+
+    bool Null() { return true; }
+    bool Bool(bool) { return true; }
+    bool Int(int value) { return onInteger(value); }
+    bool Uint(unsigned value) { return onInteger(value); }
+    bool Int64(int64_t value) { return onInteger(value); }
+    bool Uint64(uint64_t value) { return onInteger(static_cast<int64_t>(value)); }
+    bool Double(double value) { return onNumber(value); }
+
+    bool String(const char* str, rapidjson::SizeType length, bool) {
+        Field field = currentField();
+        switch (scope()) {
+        case Scope::Root:
+            if (field == Field::Method) {
+                message_.method.assign(str, length);
+                message_.is_subscription = message_.method.view() == "subscription";
+            }
+            break;
+        case Scope::Error:
+            if (field == Field::Message) {
+                message_.status.error_message.assign(str, length);
+            }
+            break;
+        case Scope::Params:
+            if (field == Field::Channel) {
+                message_.channel.assign(str, length);
+            } else if (field == Field::Type) {
+                message_.test_request = std::string_view(str, length) == "test_request";
+            }
+            break;
+        case Scope::Result:
+        case Scope::Data:
+            if (field == Field::Type) {
+                message_.book.is_change = std::string_view(str, length) == "change";
+                message_.has_book = true;
+            } else if (field == Field::InstrumentName) {
+                message_.book.instrument_name.assign(str, length);
+            }
+            onOrderString(field, str, length);
+            break;
+        case Scope::Order:
+            onOrderString(field, str, length);
+            break;
+        case Scope::Position:
+            onPositionString(field, str, length);
+            break;
+        case Scope::Trade:
+            onTradeString(field, str, length);
+            break;
+        case Scope::BidLevel:
+        case Scope::AskLevel:
+            // ["new"|"change"|"delete", price, amount]
+            level_delete_ = std::string_view(str, length) == "delete";
+            break;
+        default:
+            break;
+        }
+        return true;
+    }
+
+    bool Key(const char* str, rapidjson::SizeType length, bool) {
+        if (depth_ <= kMaxDepth) {
+            keys_[depth_ - 1] = lookupField(str, length);
+        }
+        return true;
+    }
+
+    bool StartObject() { return push(childScope(false)); }
+    bool EndObject(rapidjson::SizeType) { return pop(); }
+    bool StartArray() {
+        Scope child = childScope(true);
+        if (child == Scope::BidLevel || child == Scope::AskLevel) {
+            level_values_ = 0;
+            level_delete_ = false;
+        }
+        return push(child);
+    }
+    bool EndArray(rapidjson::SizeType) {
+        Scope ending = scope();
+        if ((ending == Scope::BidLevel || ending == Scope::AskLevel) && level_values_ == 2) {
+            auto& side = ending == Scope::BidLevel ? message_.book.bids : message_.book.asks;
+            side.push_back(BookLevelUpdate{level_numbers_[0], level_delete_ ? 0.0 : level_numbers_[1]});
+        }
+        return pop();
+    }
+
+private:
+    static constexpr int kMaxDepth = 16;
+
+    Scope scope() const { return depth_ > 0 && depth_ <= kMaxDepth ? scopes_[depth_ - 1] : Scope::Ignore; }
+    Field currentField() const { return depth_ > 0 && depth_ <= kMaxDepth ? keys_[depth_ - 1] : Field::Other; }
+
+    Scope childScope(bool is_array) const {
+        if (depth_ == 0) {
+            return is_array ? Scope::Ignore : Scope::Root;
+        }
+
+        Scope parent = scope();
+        Field field = currentField();
+        switch (parent) {
+        case Scope::Root:
+            if (field == Field::Error && !is_array) return Scope::Error;
+            if (field == Field::Params && !is_array) return Scope::Params;
+            if (field == Field::Result) return is_array ? Scope::ResultArray : Scope::Result;
+            break;
+        case Scope::Params:
+            if (field == Field::Data) return is_array ? Scope::DataArray : Scope::Data;
+            break;
+        case Scope::DataArray:
+            if (!is_array) return Scope::Trade;
+            break;
+        case Scope::Result:
+        case Scope::Data:
+            if (is_array && field == Field::Bids) return Scope::BidLevels;
+            if (is_array && field == Field::Asks) return Scope::AskLevels;
+            if (!is_array && field == Field::Order && parent == Scope::Result) return Scope::Order;
+            break;
+        case Scope::ResultArray:
+            if (!is_array) return Scope::Position;
+            break;
+        case Scope::BidLevels:
+            if (is_array) return Scope::BidLevel;
+            break;
+        case Scope::AskLevels:
+            if (is_array) return Scope::AskLevel;
+            break;
+        default:
+            break;
+        }
+        return Scope::Ignore;
+    }
+
+    bool push(Scope child) {
+        if (child == Scope::Position) {
+            message_.positions.emplace_back();
+            message_.has_positions = true;
+        } else if (child == Scope::Trade) {
+            message_.trades.emplace_back();
+            message_.has_trades = true;
+        } else if (child == Scope::BidLevels || child == Scope::AskLevels) {
+            message_.has_book = true;
+        }
+
+        if (depth_ < kMaxDepth) {
+            scopes_[depth_] = child;
+            keys_[depth_] = Field::Other;
+        }
+        ++depth_;
+        return true;
+    }
+
+    bool pop() {
+        --depth_;
+        return true;
+    }
+
+    bool onInteger(int64_t value) {
+        Field field = currentField();
+        switch (scope()) {
+        case Scope::Root:
+            if (field == Field::Id) {
+                message_.has_id = true;
+                message_.status.id = static_cast<int>(value);
+            } else if (field == Field::Result) {
+                message_.result_count = value;
+            }
+            return true;
+        case Scope::Error:
+            if (field == Field::Code) {
+                message_.status.error_code = static_cast<int>(value);
+            }
+            return true;
+        case Scope::Result:
+        case Scope::Data:
+            if (field == Field::ChangeId) {
+                message_.book.change_id = value;
+                message_.has_book = true;
+                return true;
+            }
+            if (field == Field::PrevChangeId) {
+                message_.book.prev_change_id = value;
+                return true;
+            }
+            break;
+        case Scope::Trade:
+            if (field == Field::TradeSeq) {
+                message_.trades.back().trade_seq = value;
+                return true;
+            }
+            break;
+        default:
+            break;
+        }
+        return onNumber(static_cast<double>(value));
+    }
+
+    bool onNumber(double value) {
+        Field field = currentField();
+        switch (scope()) {
+        case Scope::Data:
+            if (field == Field::MarkPrice) {
+                message_.mark_price = value;
+                break;
+            }
+            onOrderNumber(field, value);
+            break;
+        case Scope::Result:
+        case Scope::Order:
+            onOrderNumber(field, value);
+            break;
+        case Scope::Position:
+            onPositionNumber(field, value);
+            break;
+        case Scope::Trade:
+            onTradeNumber(field, value);
+            break;
+        case Scope::BidLevel:
+        case Scope::AskLevel:
+            if (level_values_ < 2) {
+                level_numbers_[level_values_++] = value;
+            }
+            break;
+        default:
+            break;
+        }
+        return true;
+    }
+
+    void onOrderString(Field field, const char* str, rapidjson::SizeType length) {
+        OrderAck& ack = message_.ack;
+        switch (field) {
+        case Field::OrderId:
+            ack.order_id.assign(str, length);
+            message_.has_order = true;
+            break;
+        case Field::OrderState:
+            ack.order_state.assign(str, length);
+            break;
+        case Field::InstrumentName:
+            ack.instrument_name.assign(str, length);
+            break;
+        case Field::Label:
+            ack.label.assign(str, length);
+            break;
+        case Field::Direction:
+            ack.direction.assign(str, length);
+            break;
+        default:
+            break;
+        }
+    }
+
+    void onOrderNumber(Field field, double value) {
+        OrderAck& ack = message_.ack;
+        switch (field) {
+        case Field::Amount:
+            ack.amount = value;
+            break;
+        case Field::FilledAmount:
+            ack.filled_amount = value;
+            break;
+        case Field::Price:
+            ack.price = value;
+            break;
+        case Field::AveragePrice:
+            ack.average_price = value;
+            break;
+        default:
+            break;
+        }
+    }
+
+    void onPositionString(Field field, const char* str, rapidjson::SizeType length) {
+        PositionSnapshot& position = message_.positions.back();
+        switch (field) {
+        case Field::InstrumentName:
+            position.instrument_name.assign(str, length);
+            break;
+        case Field::Kind:
+            position.kind.assign(str, length);
+            break;
+        case Field::Direction:
+            position.direction.assign(str, length);
+            break;
+        default:
+            break;
+        }
+    }
+
+    void onPositionNumber(Field field, double value) {
+        PositionSnapshot& position = message_.positions.back();
+        switch (field) {
+        case Field::Size:
+            position.size = value;
+            break;
+        case Field::AveragePrice:
+            position.average_price = value;
+            break;
+        case Field::MarkPrice:
+            position.mark_price = value;
+            break;
+        case Field::FloatingProfitLoss:
+            position.floating_profit_loss = value;
+            break;
+        case Field::RealizedProfitLoss:
+            position.realized_profit_loss = value;
+            break;
+        default:
+            break;
+        }
+    }
+
+    void onTradeString(Field field, const char* str, rapidjson::SizeType length) {
+        TradeFill& trade = message_.trades.back();
+        switch (field) {
+        case Field::TradeId:
+            trade.trade_id.assign(str, length);
+            break;
+        case Field::InstrumentName:
+            trade.instrument_name.assign(str, length);
+            break;
+        case Field::OrderId:
+            trade.order_id.assign(str, length);
+            break;
+        case Field::Direction:
+            trade.direction.assign(str, length);
+            break;
+        case Field::FeeCurrency:
+            trade.fee_currency.assign(str, length);
+            break;
+        default:
+            break;
+        }
+    }
+
+    void onTradeNumber(Field field, double value) {
+        TradeFill& trade = message_.trades.back();
+        switch (field) {
+        case Field::Amount:
+            trade.amount = value;
+            break;
+        case Field::Price:
+            trade.price = value;
+            break;
+        case Field::MarkPrice:
+            trade.mark_price = value;
+            break;
+        case Field::Fee:
+            trade.fee = value;
+            break;
+        default:
+            break;
+        }
+    }
+
+    ParsedMessage& message_;
+    int depth_ = 0;
+    Scope scopes_[kMaxDepth];
+    Field keys_[kMaxDepth];
+
+    double level_numbers_[2] = {0.0, 0.0};
+    int level_values_ = 0;
+    bool level_delete_ = false;
+};
+
+ResponseParser::ResponseParser() {
+    message_.book.bids.reserve(1024);
+    message_.book.asks.reserve(1024);
+    message_.positions.reserve(64);
+    message_.trades.reserve(64);
+}
+
+void ResponseParser::reset() {
+    message_.has_id = false;
+    message_.status = RpcStatus{};
+    message_.is_subscription = false;
+    message_.method.clear();
+    message_.channel.clear();
+    message_.test_request = false;
+    message_.result_count = 0;
+
+    message_.has_order = false;
+    message_.ack = OrderAck{};
+
+    message_.has_book = false;
+    message_.book.id = 0;
+    message_.book.error_code = 0;
+    message_.book.error_message.clear();
+    message_.book.instrument_name.clear();
+    message_.book.is_change = false;
+    message_.book.change_id = 0;
+    message_.book.prev_change_id = 0;
+    message_.book.bids.clear();  // Keeps capacity
+    message_.book.asks.clear();
+
+    message_.has_positions = false;
+    message_.positions.clear();
+
+    message_.has_trades = false;
+    message_.trades.clear();
+    message_.mark_price = 0.0;
+}
+
+void ResponseParser::finish() {
+    // Replies carry the envelope id and error on every typed view
+    const RpcStatus& status = message_.status;
+    message_.ack.id = status.id;
+    message_.ack.error_code = status.error_code;
+    message_.ack.error_message = status.error_message;
+    message_.book.id = status.id;
+    message_.book.error_code = status.error_code;
+    message_.book.error_message = status.error_message;
+}
+
+bool ResponseParser::parse(const char* data, size_t length) {
+    reset();
+    Handler handler(message_);
+    rapidjson::MemoryStream stream(data, length);
+    bool ok = !reader_.Parse<rapidjson::kParseDefaultFlags>(stream, handler).IsError();
+    finish();
+    return ok;
+}
+
+bool ResponseParser::parseInsitu(char* data) {
+    reset();
+    Handler handler(message_);
+    rapidjson::InsituStringStream stream(data);
+    bool ok = !reader_.Parse<rapidjson::kParseInsituFlag>(stream, handler).IsError();
+    finish();
+    return ok;
+}
+
+const rapidjson::Value& FeedMessage::data() const {
+    static const rapidjson::Value kNull;
+
+    if (!document_) {
+        document_.emplace();
+        (*document_)->Parse(raw_.data(), raw_.size());
+    }
+    const ArenaDocument& document = **document_;
+    if (document.HasParseError() || !document.IsObject()) {
+        return kNull;
+    }
+
+    auto params_it = document.FindMember("params");
+    if (params_it == document.MemberEnd() || !params_it->value.IsObject()) {
+        return kNull;
+    }
+    auto data_it = params_it->value.FindMember("data");
+    return data_it != params_it->value.MemberEnd() ? data_it->value : kNull;
+}
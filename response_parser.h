@@ -0,0 +1,171 @@
+#ifndef RESPONSE_PARSER_H
+#define RESPONSE_PARSER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string_view>
+#include <vector>
+#include <rapidjson/document.h>
+#include <rapidjson/reader.h>
+#include "memory_arena.h"
+
+// Inline, truncating string so parsed messages never own heap memory
+template <size_t N>
+struct FixedString {
+    char data[N];
+    size_t size = 0;
+
+    void assign(const char* str, size_t length) {
+        size = std::min(length, N);
+        std::memcpy(data, str, size);
+    }
+    void clear() { size = 0; }
+    bool empty() const { return size == 0; }
+    std::string_view view() const { return std::string_view(data, size); }
+};
+
+// JSON-RPC envelope outcome shared by every typed reply
+struct RpcStatus {
+    int id = 0;
+    int error_code = 0;  // Non-zero when the exchange rejected the request
+    FixedString<128> error_message;
+
+    bool ok() const { return error_code == 0; }
+};
+
+struct OrderAck {
+    int id = 0;
+    int error_code = 0;
+    FixedString<128> error_message;
+
+    FixedString<64> order_id;
+    FixedString<24> order_state;
+    FixedString<64> instrument_name;
+    FixedString<64> label;
+    FixedString<8> direction;
+    double amount = 0.0;
+    double filled_amount = 0.0;
+    double price = 0.0;
+    double average_price = 0.0;
+
+    bool ok() const { return error_code == 0; }
+};
+
+struct BookLevelUpdate {
+    double price;
+    double amount;  // 0 removes the level
+};
+
+struct BookSnapshot {
+    int id = 0;
+    int error_code = 0;
+    FixedString<128> error_message;
+
+    FixedString<64> instrument_name;
+    bool is_change = false;  // Delta against prev_change_id rather than a full snapshot
+    int64_t change_id = 0;
+    int64_t prev_change_id = 0;
+    std::vector<BookLevelUpdate> bids;
+    std::vector<BookLevelUpdate> asks;
+
+    bool ok() const { return error_code == 0; }
+};
+
+struct PositionSnapshot {
+    FixedString<64> instrument_name;
+    FixedString<16> kind;
+    FixedString<8> direction;
+    double size = 0.0;
+    double average_price = 0.0;
+    double mark_price = 0.0;
+    double floating_profit_loss = 0.0;
+    double realized_profit_loss = 0.0;
+};
+
+// One execution from a user.trades notification
+struct TradeFill {
+    FixedString<64> trade_id;
+    int64_t trade_seq = 0;  // Increases per instrument
+    FixedString<64> instrument_name;
+    FixedString<64> order_id;
+    FixedString<8> direction;
+    double amount = 0.0;
+    double price = 0.0;
+    double mark_price = 0.0;
+    double fee = 0.0;
+    FixedString<8> fee_currency;
+
+    bool isBuy() const { return direction.view() == "buy"; }
+};
+
+// Everything the hot path needs from one frame, filled by a single SAX pass
+struct ParsedMessage {
+    bool has_id = false;
+    RpcStatus status;
+    bool is_subscription = false;
+    FixedString<32> method;
+    FixedString<96> channel;
+    bool test_request = false;  // heartbeat notification the exchange wants answered with public/test
+    int64_t result_count = 0;  // Integer "result", e.g. how many orders cancel_all removed
+
+    bool has_order = false;
+    OrderAck ack;
+    bool has_book = false;
+    BookSnapshot book;
+    bool has_positions = false;
+    std::vector<PositionSnapshot> positions;
+    bool has_trades = false;
+    std::vector<TradeFill> trades;
+    double mark_price = 0.0;  // params.data.mark_price of a notification, e.g. a ticker; 0 if absent
+};
+
+// Pulls the envelope, order acks, book snapshots/deltas, positions and fills out of a
+// JSON-RPC frame without building a DOM. All storage is reused across frames,
+// so steady-state parsing does not allocate.
+class ResponseParser {
+public:
+    ResponseParser();
+
+    bool parse(const char* data, size_t length);  // Leaves the input untouched
+    bool parseInsitu(char* data);                 // NUL-terminated; strings are decoded in place
+
+    const ParsedMessage& message() const { return message_; }
+
+private:
+    class Handler;
+
+    void reset();
+    void finish();
+
+    rapidjson::Reader reader_;  // Keeps its scratch stack between frames
+    ParsedMessage message_;
+};
+
+// What a channel handler sees: the prehashed channel, a typed book for book.*
+// channels, a typed order for user.orders.*.raw, typed fills for user.trades.*,
+// and params.data as a DOM only if the handler asks for it. That DOM is built in
+// the thread's MessageArena and released with the frame's cycle.
+class FeedMessage {
+public:
+    FeedMessage(const ParsedMessage& parsed, std::string_view raw) : parsed_(parsed), raw_(raw) {}
+
+    std::string_view channel() const { return parsed_.channel.view(); }
+    bool hasBook() const { return parsed_.has_book; }
+    const BookSnapshot& book() const { return parsed_.book; }
+    bool hasOrder() const { return parsed_.has_order; }
+    const OrderAck& order() const { return parsed_.ack; }
+    bool hasTrades() const { return parsed_.has_trades; }
+    const std::vector<TradeFill>& trades() const { return parsed_.trades; }
+    double markPrice() const { return parsed_.mark_price; }
+    const rapidjson::Value& data() const;
+
+private:
+    const ParsedMessage& parsed_;
+    std::string_view raw_;
+    mutable std::optional<ScratchDocument> document_;
+};
+
+#endif // RESPONSE_PARSER_H
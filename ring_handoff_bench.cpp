@@ -0,0 +1,108 @@
+// Measures thread-to-thread handoff latency through SpscRing and MpscRing.
+// Each message carries its steady_clock send time; the consumer records
+// now - sent. Optional arguments pin the consumer and producers to cores:
+//   ring_handoff_bench [consumer_core] [producer_core] [second_producer_core]
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "ring_buffer.h"
+#include "thread_affinity.h"
+
+namespace {
+
+constexpr size_t kMessages = 1000000;
+constexpr size_t kRingSize = 4096;
+
+struct Message {
+    int64_t sent_ns;
+    uint64_t seq;
+    char payload[48];  // About the size of a top-of-book update
+};
+
+int64_t nowNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Producers pace themselves so the ring stays near empty and we measure handoff, not queueing
+void paceFor(int64_t nanos) {
+    int64_t until = nowNanos() + nanos;
+    while (nowNanos() < until) {
+    }
+}
+
+void report(const char* name, std::vector<int64_t>& latencies) {
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p) {
+        return latencies[std::min(latencies.size() - 1, static_cast<size_t>(p * latencies.size()))];
+    };
+    std::cout << name << " (" << latencies.size() << " msgs)"
+              << "  p50 " << percentile(0.50) << " ns"
+              << "  p99 " << percentile(0.99) << " ns"
+              << "  p99.9 " << percentile(0.999) << " ns"
+              << "  max " << latencies.back() << " ns" << std::endl;
+}
+
+template <typename Ring>
+void runCase(const char* name, int producers, int consumer_core, const std::vector<int>& producer_cores) {
+    auto ring = std::make_unique<Ring>();
+    std::atomic<bool> go{false};
+    size_t per_producer = kMessages / static_cast<size_t>(producers);
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p] {
+            pinCurrentThreadToCore(producer_cores[static_cast<size_t>(p)]);
+            while (!go.load(std::memory_order_acquire)) {
+            }
+
+            Message message{};
+            for (size_t i = 0; i < per_producer; ++i) {
+                message.seq = i;
+                message.sent_ns = nowNanos();
+                while (!ring->tryPush(message)) {
+                }
+                paceFor(200);
+            }
+        });
+    }
+
+    std::vector<int64_t> latencies;
+    latencies.reserve(per_producer * static_cast<size_t>(producers));
+    std::thread consumer([&] {
+        pinCurrentThreadToCore(consumer_core);
+        Message message;
+        while (latencies.size() < latencies.capacity()) {
+            if (ring->tryPop(message)) {
+                latencies.push_back(nowNanos() - message.sent_ns);
+            }
+        }
+    });
+
+    go.store(true, std::memory_order_release);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    consumer.join();
+
+    report(name, latencies);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int consumer_core = argc > 1 ? std::atoi(argv[1]) : -1;
+    int producer_core = argc > 2 ? std::atoi(argv[2]) : -1;
+    int second_producer_core = argc > 3 ? std::atoi(argv[3]) : -1;
+
+    runCase<SpscRing<Message, kRingSize>>("SpscRing handoff", 1, consumer_core, {producer_core});
+    runCase<MpscRing<Message, kRingSize>>("MpscRing handoff, 1 producer", 1, consumer_core, {producer_core});
+    runCase<MpscRing<Message, kRingSize>>("MpscRing handoff, 2 producers", 2, consumer_core,
+                                          {producer_core, second_producer_core});
+    return 0;
+}
@@ -0,0 +1,232 @@
+#include "risk_gate.h"
+#include <algorithm>
+#include <cmath>
+
+const char* toString(RiskCheck check) {
+    switch (check) {
+    case RiskCheck::Passed:
+        return "passed";
+    case RiskCheck::UnknownInstrument:
+        return "no limits for instrument";
+    case RiskCheck::OrderSize:
+        return "order size";
+    case RiskCheck::PriceCollar:
+        return "price collar";
+    case RiskCheck::NoReference:
+        return "no reference price";
+    case RiskCheck::Position:
+        return "position limit";
+    case RiskCheck::Notional:
+        return "notional limit";
+    case RiskCheck::Throttled:
+        return "order rate";
+    }
+    return "unknown";
+}
+
+RiskGate::RiskGate(InstrumentCache& instruments)
+    : instruments_(instruments),
+      risk_(new InstrumentRisk[InstrumentCache::kMaxInstruments]) {}
+
+double RiskGate::add(std::atomic<double>& value, double delta) {
+    double current = value.load(std::memory_order_relaxed);
+    while (!value.compare_exchange_weak(current, current + delta, std::memory_order_acq_rel,
+                                        std::memory_order_relaxed)) {
+    }
+    return current + delta;
+}
+
+RiskGate::InstrumentRisk* RiskGate::find(std::string_view instrument) const {
+    InstrumentId id = instruments_.find(instrument);
+    if (id == kNoInstrument || !risk_[id].configured.load(std::memory_order_acquire)) {
+        return nullptr;
+    }
+    return &risk_[id];
+}
+
+RiskGate::InstrumentRisk* RiskGate::find(const OrderRequest& request) const {
+    if (request.instrument_id == kNoInstrument || request.instrument_id >= instruments_.size()) {
+        return find(request.instrument);
+    }
+    InstrumentRisk& entry = risk_[request.instrument_id];
+    return entry.configured.load(std::memory_order_acquire) ? &entry : nullptr;
+}
+
+void RiskGate::setLimits(std::string_view instrument, const RiskLimits& limits) {
+    InstrumentRisk& entry = risk_[instruments_.intern(instrument)];
+    entry.max_order_amount.store(limits.max_order_amount, std::memory_order_relaxed);
+    entry.price_collar.store(limits.price_collar, std::memory_order_relaxed);
+    entry.max_position.store(limits.max_position, std::memory_order_relaxed);
+    entry.max_notional.store(limits.max_notional, std::memory_order_relaxed);
+    if (!entry.configured.exchange(true, std::memory_order_acq_rel)) {
+        configured_.fetch_add(1, std::memory_order_release);
+    }
+}
+
+void RiskGate::setRateLimit(double orders_per_second, uint32_t burst) {
+    int64_t interval = orders_per_second > 0.0 ? static_cast<int64_t>(1e9 / orders_per_second) : 0;
+    rate_tolerance_ns_.store(interval * std::max<int64_t>(burst, 1), std::memory_order_relaxed);
+    rate_interval_ns_.store(interval, std::memory_order_release);
+}
+
+bool RiskGate::admitRate(int64_t now_ns) {
+    int64_t interval = rate_interval_ns_.load(std::memory_order_acquire);
+    if (interval == 0) {
+        return true;
+    }
+    int64_t tolerance = rate_tolerance_ns_.load(std::memory_order_relaxed);
+
+    // Each order pushes the arrival time one interval out; a burst may run ahead of now by the tolerance
+    int64_t arrival = next_arrival_ns_.load(std::memory_order_relaxed);
+    while (true) {
+        int64_t next = std::max(arrival, now_ns) + interval;
+        if (next - now_ns > tolerance) {
+            return false;
+        }
+        if (next_arrival_ns_.compare_exchange_weak(arrival, next, std::memory_order_relaxed)) {
+            return true;
+        }
+    }
+}
+
+bool RiskGate::reserve(std::atomic<double>& working, double amount, double limit) {
+    // Add first and back out on a breach, so racing submitters cannot both slip under the limit
+    double exposure = add(working, amount);
+    if (exposure > limit) {
+        add(working, -amount);
+        return false;
+    }
+    return true;
+}
+
+RiskCheck RiskGate::check(const OrderRequest& request, int64_t now_ns) {
+    if (!enabled()) {
+        return admitRate(now_ns) ? RiskCheck::Passed : RiskCheck::Throttled;
+    }
+    InstrumentRisk* entry = find(request);
+    if (!entry) {
+        return RiskCheck::UnknownInstrument;
+    }
+    RiskCheck result = checkLimits(*entry, request, request.amount);
+    if (result != RiskCheck::Passed) {
+        return result;
+    }
+
+    if (!admitRate(now_ns)) {
+        add(request.side == Side::Buy ? entry->working_buy : entry->working_sell, -request.amount);
+        return RiskCheck::Throttled;
+    }
+    return RiskCheck::Passed;
+}
+
+RiskCheck RiskGate::checkEdit(const OrderRequest& request, double working_growth) {
+    if (!enabled()) {
+        return RiskCheck::Passed;
+    }
+    InstrumentRisk* entry = find(request);
+    if (!entry) {
+        return RiskCheck::UnknownInstrument;
+    }
+    return checkLimits(*entry, request, working_growth);
+}
+
+RiskCheck RiskGate::checkLimits(InstrumentRisk& entry, const OrderRequest& request, double reserve_amount) {
+    bool is_buy = request.side == Side::Buy;
+    double max_order_amount = entry.max_order_amount.load(std::memory_order_relaxed);
+    if (!(request.amount > 0.0) || (max_order_amount > 0.0 && request.amount > max_order_amount)) {
+        return RiskCheck::OrderSize;
+    }
+
+    // Fat-finger collar against the far touch: buys may not lift far above the ask, sells not hit far below the bid
+    double touch = (is_buy ? entry.best_ask : entry.best_bid).load(std::memory_order_relaxed);
+    double collar = entry.price_collar.load(std::memory_order_relaxed);
+    if (collar > 0.0 && (request.type == OrderType::Limit || request.type == OrderType::Market)) {
+        if (touch <= 0.0) {
+            return RiskCheck::NoReference;
+        }
+        if (request.type == OrderType::Limit &&
+            (is_buy ? request.price > touch * (1.0 + collar) : request.price < touch * (1.0 - collar))) {
+            return RiskCheck::PriceCollar;
+        }
+    }
+    if (!(reserve_amount > 0.0)) {
+        return RiskCheck::Passed;  // An edit that does not add working amount cannot breach the limits
+    }
+
+    // Worst case: every working order on this side fills; reserve against the tighter of the two limits
+    double position = entry.position.load(std::memory_order_relaxed);
+    if (!is_buy) {
+        position = -position;  // Along the order's side
+    }
+    double limit = INFINITY;
+    RiskCheck breach = RiskCheck::Position;
+    double max_position = entry.max_position.load(std::memory_order_relaxed);
+    if (max_position > 0.0) {
+        limit = max_position - position;
+    }
+    double max_notional = entry.max_notional.load(std::memory_order_relaxed);
+    if (max_notional > 0.0) {
+        double price = request.type == OrderType::Limit || request.type == OrderType::StopLimit ? request.price
+                       : request.type == OrderType::StopMarket ? request.trigger_price
+                                                               : touch;
+        if (!(price > 0.0)) {
+            return RiskCheck::NoReference;
+        }
+        if (max_notional / price - position < limit) {
+            limit = max_notional / price - position;
+            breach = RiskCheck::Notional;
+        }
+    }
+    if (!reserve(is_buy ? entry.working_buy : entry.working_sell, reserve_amount, limit)) {
+        return breach;
+    }
+    return RiskCheck::Passed;
+}
+
+void RiskGate::release(const OrderRequest& request) {
+    releaseRate();
+    if (InstrumentRisk* entry = find(request)) {
+        add(request.side == Side::Buy ? entry->working_buy : entry->working_sell, -request.amount);
+    }
+}
+
+void RiskGate::releaseRate() {
+    int64_t interval = rate_interval_ns_.load(std::memory_order_acquire);
+    if (interval != 0) {
+        // Pulls the arrival time back one interval; admitRate never lets it count from before now
+        next_arrival_ns_.fetch_sub(interval, std::memory_order_relaxed);
+    }
+}
+
+void RiskGate::onQuote(InstrumentId instrument, double best_bid, double best_ask) {
+    if (instrument < InstrumentCache::kMaxInstruments) {
+        risk_[instrument].best_bid.store(best_bid, std::memory_order_relaxed);
+        risk_[instrument].best_ask.store(best_ask, std::memory_order_relaxed);
+    }
+}
+
+void RiskGate::onExposure(std::string_view instrument, bool is_buy, double working_delta, double filled_delta) {
+    InstrumentRisk* entry = find(instrument);
+    if (!entry) {
+        return;
+    }
+    if (working_delta != 0.0) {
+        add(is_buy ? entry->working_buy : entry->working_sell, working_delta);
+    }
+    if (filled_delta != 0.0) {
+        add(entry->position, is_buy ? filled_delta : -filled_delta);
+    }
+}
+
+double RiskGate::position(std::string_view instrument) const {
+    const InstrumentRisk* entry = find(instrument);
+    return entry ? entry->position.load(std::memory_order_relaxed) : 0.0;
+}
+
+double RiskGate::working(std::string_view instrument, Side side) const {
+    const InstrumentRisk* entry = find(instrument);
+    if (!entry) {
+        return 0.0;
+    }
+    return (side == Side::Buy ? entry->working_buy : entry->working_sell).load(std::memory_order_relaxed);
+}
@@ -0,0 +1,99 @@
+#ifndef RISK_GATE_H
+#define RISK_GATE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include "instrument_cache.h"
+#include "order_request.h"
+
+// Per-instrument pre-trade limits; 0 disables a check
+struct RiskLimits {
+    double max_order_amount = 0.0;
+    double price_collar = 0.0;   // Limit prices at most this fraction through the far touch, e.g. 0.02
+    double max_position = 0.0;   // |filled position + working orders on the order's side|
+    double max_notional = 0.0;   // The same worst-case position valued at the order price
+};
+
+enum class RiskCheck : uint8_t {
+    Passed,
+    UnknownInstrument,  // No limits configured for it
+    OrderSize,
+    PriceCollar,
+    NoReference,        // Collar or notional needs a touch price and the book has none
+    Position,
+    Notional,
+    Throttled,
+};
+
+const char* toString(RiskCheck check);
+
+// Pre-trade checks in front of the order gateway. Limits, touch prices and
+// exposure live in a flat array indexed by InstrumentId, and every field is an
+// atomic, so a check is an id lookup (free when the request carries one), a few
+// loads and two CAS loops: no locks and no allocation.
+// Working exposure is reserved when an order passes and released through
+// onExposure as the order store sees the order fill, get cancelled or rejected.
+// A gate with no instruments configured passes everything and tracks nothing.
+class RiskGate {
+public:
+    explicit RiskGate(InstrumentCache& instruments);
+
+    // Configuration; may run while checks are in flight
+    void setLimits(std::string_view instrument, const RiskLimits& limits);
+    void setRateLimit(double orders_per_second, uint32_t burst);  // 0 disables the throttle
+
+    // Reserves the order's amount as working exposure when it passes
+    RiskCheck check(const OrderRequest& request, int64_t now_ns);
+    // A working order edited to request.amount and request.price: the size and collar checks, and the
+    // position and notional limits for working_growth, which it reserves when it passes. Not throttled.
+    RiskCheck checkEdit(const OrderRequest& request, double working_growth);
+    // Gives back the reservation and the throttle slot of an order that passed but was never sent
+    void release(const OrderRequest& request);
+    // Gives back only the throttle slot, for an unsent order whose reservation the store already settled
+    void releaseRate();
+
+    // Book side: 0 means the side is empty
+    void onQuote(InstrumentId instrument, double best_bid, double best_ask);
+    // Order store side: working (unfilled, live) and filled amount changes of one order
+    void onExposure(std::string_view instrument, bool is_buy, double working_delta, double filled_delta);
+
+    bool enabled() const { return configured_.load(std::memory_order_acquire) != 0; }
+    double position(std::string_view instrument) const;
+    double working(std::string_view instrument, Side side) const;
+
+private:
+    struct alignas(64) InstrumentRisk {
+        std::atomic<bool> configured{false};
+        std::atomic<double> max_order_amount{0.0};
+        std::atomic<double> price_collar{0.0};
+        std::atomic<double> max_position{0.0};
+        std::atomic<double> max_notional{0.0};
+        std::atomic<double> best_bid{0.0};
+        std::atomic<double> best_ask{0.0};
+        std::atomic<double> position{0.0};  // Signed filled amount
+        std::atomic<double> working_buy{0.0};
+        std::atomic<double> working_sell{0.0};
+    };
+
+    InstrumentRisk* find(std::string_view instrument) const;
+    InstrumentRisk* find(const OrderRequest& request) const;
+    RiskCheck checkLimits(InstrumentRisk& entry, const OrderRequest& request, double reserve_amount);
+    bool reserve(std::atomic<double>& working, double amount, double limit);
+    bool admitRate(int64_t now_ns);
+
+    static double add(std::atomic<double>& value, double delta);
+
+    InstrumentCache& instruments_;
+    std::unique_ptr<InstrumentRisk[]> risk_;  // By InstrumentId
+    std::atomic<size_t> configured_{0};
+
+    // Generic cell rate algorithm: one theoretical arrival time, advanced per order
+    std::atomic<int64_t> rate_interval_ns_{0};
+    std::atomic<int64_t> rate_tolerance_ns_{0};
+    std::atomic<int64_t> next_arrival_ns_{0};
+};
+
+#endif // RISK_GATE_H
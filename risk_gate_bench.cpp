@@ -0,0 +1,112 @@
+#include "risk_gate.h"
+#include "heap_counter.h"
+#include "performance_tracker.h"
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr int kIterations = 1000000;
+constexpr size_t kInstruments = 64;  // Configured alongside the one under test, so lookups probe a real table
+
+volatile size_t g_sink = 0;  // Keeps the check results observable
+
+template <typename Fn>
+long runCase(const char* name, int iterations, Fn&& fn) {
+    uint64_t allocations_before = HeapCounter::thread().allocations;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        fn(i);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    long allocations = static_cast<long>(HeapCounter::thread().allocations - allocations_before);
+
+    double ns_per_op = std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+    std::cout << name << ": " << ns_per_op << " ns/op, "
+              << static_cast<double>(allocations) / iterations << " allocations/op" << std::endl;
+    return allocations;
+}
+
+}  // namespace
+
+int main() {
+    if (!HeapCounter::enabled()) {
+        std::cout << "Heap allocations are not counted in this build (TRADING_COUNT_ALLOCATIONS=OFF)" << std::endl;
+    }
+    std::vector<std::string> names;
+    for (size_t i = 0; i < kInstruments; ++i) {
+        names.push_back("BTC-" + std::to_string(27 + i) + "DEC25");
+    }
+    names.push_back("BTC-PERPETUAL");
+
+    RiskLimits limits;
+    limits.max_order_amount = 1000.0;
+    limits.price_collar = 0.02;
+    limits.max_position = 100000.0;
+    limits.max_notional = 1e10;
+
+    InstrumentCache instruments;
+    RiskGate gate(instruments);
+    for (const std::string& name : names) {
+        gate.setLimits(name, limits);
+        gate.onQuote(instruments.find(name), 49999.5, 50000.5);
+    }
+
+    OrderRequest buy = OrderRequest::limit("BTC-PERPETUAL", Side::Buy, 10.0, 49990.0);
+    OrderRequest sell = OrderRequest::limit("BTC-PERPETUAL", Side::Sell, 10.0, 50010.0);
+    long allocations = 0;
+
+    // Each passing check reserves; giving it back keeps exposure flat across iterations
+    allocations += runCase("RiskGate::check limit buy + release", kIterations, [&](int i) {
+        buy.price = 49990.0 + i % 13;
+        g_sink = g_sink + static_cast<size_t>(gate.check(buy, PerformanceTracker::now()));
+        gate.release(buy);
+    });
+    allocations += runCase("RiskGate::check limit sell + release", kIterations, [&](int i) {
+        sell.price = 50010.0 - i % 13;
+        g_sink = g_sink + static_cast<size_t>(gate.check(sell, PerformanceTracker::now()));
+        gate.release(sell);
+    });
+
+    // The id is resolved once up front, as a strategy holding InstrumentIds would
+    OrderRequest buy_by_id = buy;
+    buy_by_id.instrument_id = instruments.find(buy.instrument);
+    allocations += runCase("RiskGate::check limit buy by id + release", kIterations, [&](int i) {
+        buy_by_id.price = 49990.0 + i % 13;
+        g_sink = g_sink + static_cast<size_t>(gate.check(buy_by_id, PerformanceTracker::now()));
+        gate.release(buy_by_id);
+    });
+
+    std::vector<OrderRequest> spread;
+    for (const std::string& name : names) {
+        spread.push_back(OrderRequest::limit(name, Side::Buy, 10.0, 49990.0));
+    }
+    allocations += runCase("RiskGate::check across 65 instruments", kIterations, [&](int i) {
+        const OrderRequest& request = spread[static_cast<size_t>(i) % spread.size()];
+        g_sink = g_sink + static_cast<size_t>(gate.check(request, PerformanceTracker::now()));
+        gate.release(request);
+    });
+
+    OrderRequest fat_finger = OrderRequest::limit("BTC-PERPETUAL", Side::Buy, 10.0, 55000.0);
+    allocations += runCase("RiskGate::check rejected by collar", kIterations, [&](int) {
+        g_sink = g_sink + static_cast<size_t>(gate.check(fat_finger, PerformanceTracker::now()));
+    });
+
+    // Fills come back through onExposure the way the order store reports them
+    allocations += runCase("RiskGate::check + fill via onExposure", kIterations, [&](int i) {
+        OrderRequest& request = i % 2 == 0 ? buy : sell;
+        g_sink = g_sink + static_cast<size_t>(gate.check(request, PerformanceTracker::now()));
+        gate.onExposure(request.instrument, request.side == Side::Buy, -request.amount, request.amount);
+    });
+
+    gate.setRateLimit(1e9, 1000);  // Never binds; measures the extra CAS
+    allocations += runCase("RiskGate::check + release, throttle on", kIterations, [&](int i) {
+        buy.price = 49990.0 + i % 13;
+        g_sink = g_sink + static_cast<size_t>(gate.check(buy, PerformanceTracker::now()));
+        gate.release(buy);
+    });
+
+    return allocations == 0 ? 0 : 1;
+}
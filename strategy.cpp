@@ -0,0 +1,337 @@
+#include "strategy.h"
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <rapidjson/document.h>
+#include <rapidjson/error/en.h>
+#include "logger.h"
+
+namespace {
+
+// A quote command that got no reply in this long is given up on
+constexpr int64_t kPendingTimeoutNs = 2000000000;
+
+double number(const rapidjson::Value& object, const char* name, double fallback) {
+    auto member = object.FindMember(name);
+    if (member == object.MemberEnd()) {
+        return fallback;
+    }
+    if (!member->value.IsNumber()) {
+        throw std::runtime_error(std::string("\"") + name + "\" is not a number");
+    }
+    return member->value.GetDouble();
+}
+
+// Rests quote_amount offset_ticks behind the touch on both sides of every instrument and
+// follows the touch with edits once it moves requote_ticks away. One command per side is
+// in flight at a time.
+class TouchQuoter : public Strategy {
+public:
+    explicit TouchQuoter(const StrategyConfig& config)
+        : amount_(config.param("quote_amount", 10.0)),
+          offset_ticks_(config.param("offset_ticks", 2.0)),
+          requote_ticks_(config.param("requote_ticks", 1.0)) {}
+
+    void onStart() override {
+        for (const std::string& instrument : context().config().instruments) {
+            books_[instrument];
+        }
+    }
+
+    void onBook(const MarketEvent& top) override {
+        auto found = books_.find(top.instrument_name.view());
+        if (found == books_.end()) {
+            return;
+        }
+        Book& book = found->second;
+        double tick = context().tickSize(top.instrument_name.view());
+        if (top.bid_price > 0.0) {
+            requote(top, book.bid, true, top.bid_price - offset_ticks_ * tick, tick);
+        }
+        if (top.ask_price > 0.0) {
+            requote(top, book.ask, false, top.ask_price + offset_ticks_ * tick, tick);
+        }
+    }
+
+    void onOrderUpdate(const OrderAck& ack) override {
+        if (!ack.ok()) {
+            // Rejections name no order, so every command in flight on the instrument is
+            // released; exchange rejections name no instrument either
+            LOG_WARN("Quote rejected: {} {}", ack.error_code, ack.error_message.view());
+            for (auto& [name, book] : books_) {
+                if (ack.instrument_name.empty() || ack.instrument_name.view() == name) {
+                    book.bid.pending_ns = 0;
+                    book.ask.pending_ns = 0;
+                }
+            }
+            return;
+        }
+
+        auto found = books_.find(ack.instrument_name.view());
+        if (found == books_.end() || ack.order_id.empty()) {
+            return;
+        }
+        Quote& quote = ack.direction.view() == "buy" ? found->second.bid : found->second.ask;
+        std::string_view state = ack.order_state.view();
+        bool live = state == "open" || state == "untriggered";
+
+        if (quote.order_id.empty() && live) {
+            quote.order_id = ack.order_id;
+        } else if (quote.order_id.view() != ack.order_id.view()) {
+            if (live && quote.pending_ns == 0) {
+                context().cancel(ack.order_id.view());  // A duplicate from a released command
+            }
+            return;
+        }
+        quote.price = ack.price;
+        quote.pending_ns = 0;
+        if (!live) {
+            quote.order_id.clear();  // Filled or cancelled: quote afresh on the next update
+        }
+    }
+
+private:
+    struct Quote {
+        FixedString<64> order_id;
+        double price = 0.0;
+        int64_t pending_ns = 0;  // When the outstanding command went out; 0 when none
+    };
+
+    struct Book {
+        Quote bid;
+        Quote ask;
+    };
+
+    void requote(const MarketEvent& top, Quote& quote, bool is_buy, double target, double tick) {
+        if (target <= 0.0) {
+            return;
+        }
+        if (quote.pending_ns != 0 && top.received_ns - quote.pending_ns < kPendingTimeoutNs) {
+            return;
+        }
+
+        std::string_view instrument = top.instrument_name.view();
+        bool sent;
+        if (quote.order_id.empty()) {
+            sent = is_buy ? context().buy(instrument, amount_, target) : context().sell(instrument, amount_, target);
+        } else if (std::abs(quote.price - target) >= requote_ticks_ * tick - tick / 2) {
+            sent = context().edit(quote.order_id.view(), target, amount_);
+        } else {
+            return;
+        }
+        quote.pending_ns = sent ? top.received_ns : 0;
+    }
+
+    double amount_;
+    double offset_ticks_;
+    double requote_ticks_;
+    std::unordered_map<std::string_view, Book> books_;  // Keys point into the config's instrument names
+};
+
+std::mutex& registryMutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+std::unordered_map<std::string, StrategyFactory>& registry() {
+    static std::unordered_map<std::string, StrategyFactory> factories = {
+        {"touch_quoter", [](const StrategyConfig& config) { return std::make_unique<TouchQuoter>(config); }},
+    };
+    return factories;
+}
+
+}  // namespace
+
+double StrategyConfig::param(const std::string& name, double fallback) const {
+    auto found = params.find(name);
+    return found != params.end() ? found->second : fallback;
+}
+
+StrategyConfig loadStrategyConfig(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("Cannot open strategy config " + path);
+    }
+    std::stringstream text;
+    text << file.rdbuf();
+
+    rapidjson::Document doc;
+    doc.Parse(text.str().c_str());
+    if (doc.HasParseError()) {
+        throw std::runtime_error(path + ": " + rapidjson::GetParseError_En(doc.GetParseError()) + " at offset " +
+                                 std::to_string(doc.GetErrorOffset()));
+    }
+
+    try {
+        if (!doc.IsObject() || !doc.HasMember("strategy") || !doc["strategy"].IsString()) {
+            throw std::runtime_error("\"strategy\" must name a strategy");
+        }
+        StrategyConfig config;
+        config.strategy = doc["strategy"].GetString();
+
+        if (!doc.HasMember("instruments") || !doc["instruments"].IsArray() || doc["instruments"].Empty()) {
+            throw std::runtime_error("\"instruments\" must list at least one instrument");
+        }
+        for (const auto& instrument : doc["instruments"].GetArray()) {
+            if (!instrument.IsString()) {
+                throw std::runtime_error("\"instruments\" must hold names");
+            }
+            config.instruments.emplace_back(instrument.GetString(), instrument.GetStringLength());
+        }
+
+        config.run_seconds = static_cast<int>(number(doc, "run_seconds", 0));
+        if (doc.HasMember("cancel_on_stop")) {
+            config.cancel_on_stop = doc["cancel_on_stop"].IsTrue();
+        }
+
+        if (doc.HasMember("risk") && doc["risk"].IsObject()) {
+            const rapidjson::Value& risk = doc["risk"];
+            config.risk.max_order_amount = number(risk, "max_order_amount", 0.0);
+            config.risk.price_collar = number(risk, "price_collar", 0.0);
+            config.risk.max_position = number(risk, "max_position", 0.0);
+            config.risk.max_notional = number(risk, "max_notional", 0.0);
+            config.orders_per_second = number(risk, "orders_per_second", 0.0);
+            config.burst = static_cast<uint32_t>(number(risk, "burst", 1.0));
+        }
+
+        if (doc.HasMember("pipeline") && doc["pipeline"].IsObject()) {
+            const rapidjson::Value& pipeline = doc["pipeline"];
+            config.pipeline.network_core = static_cast<int>(number(pipeline, "network_core", -1));
+            config.pipeline.strategy_core = static_cast<int>(number(pipeline, "strategy_core", -1));
+            config.pipeline.gateway_core = static_cast<int>(number(pipeline, "gateway_core", -1));
+        }
+
+        if (doc.HasMember("params") && doc["params"].IsObject()) {
+            const rapidjson::Value& params = doc["params"];
+            for (auto param = params.MemberBegin(); param != params.MemberEnd(); ++param) {
+                if (!param->value.IsNumber()) {
+                    throw std::runtime_error("param \"" + std::string(param->name.GetString()) + "\" is not a number");
+                }
+                config.params[param->name.GetString()] = param->value.GetDouble();
+            }
+        }
+        return config;
+    } catch (const std::runtime_error& ex) {
+        throw std::runtime_error(path + ": " + ex.what());
+    }
+}
+
+void registerStrategy(const std::string& name, StrategyFactory factory) {
+    std::lock_guard<std::mutex> lock(registryMutex());
+    registry()[name] = std::move(factory);
+}
+
+std::unique_ptr<Strategy> createStrategy(const StrategyConfig& config) {
+    StrategyFactory factory;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        auto found = registry().find(config.strategy);
+        if (found == registry().end()) {
+            throw std::runtime_error("Unknown strategy " + config.strategy);
+        }
+        factory = found->second;
+    }
+    return factory(config);
+}
+
+bool StrategyContext::buy(std::string_view instrument, double amount, double price) {
+    return place(OrderCommand::Type::Buy, instrument, {}, amount, price);
+}
+
+bool StrategyContext::sell(std::string_view instrument, double amount, double price) {
+    return place(OrderCommand::Type::Sell, instrument, {}, amount, price);
+}
+
+bool StrategyContext::cancel(std::string_view order_id) {
+    return place(OrderCommand::Type::Cancel, {}, order_id, 0.0, 0.0);
+}
+
+bool StrategyContext::edit(std::string_view order_id, double price, double amount) {
+    return place(OrderCommand::Type::Edit, {}, order_id, amount, price);
+}
+
+double StrategyContext::tickSize(std::string_view instrument) const {
+    InstrumentCache& instruments = order_mgr_.instruments();
+    double tick_size = instruments.tickSize(instruments.find(instrument));
+    return tick_size > 0.0 ? tick_size : OrderBook::kDefaultTickSize;
+}
+
+bool StrategyContext::place(OrderCommand::Type type, std::string_view instrument, std::string_view order_id,
+                            double amount, double price) {
+    OrderCommand command;
+    command.type = type;
+    command.instrument_name.assign(instrument.data(), instrument.size());
+    command.order_id.assign(order_id.data(), order_id.size());
+    command.amount = amount;
+    command.price = price;
+    command.enqueued_ns = TradingPipeline::nowNanos();
+    return pipeline_.submit(command);
+}
+
+StrategyRunner::StrategyRunner(OrderManager& order_mgr, WsConnector& market_data, StrategyConfig config)
+    : order_mgr_(order_mgr), market_data_(market_data), config_(std::move(config)) {}
+
+void StrategyRunner::run(const std::atomic<bool>& interrupted) {
+    std::unique_ptr<Strategy> strategy = createStrategy(config_);
+
+    RiskGate& risk = order_mgr_.riskGate();
+    for (const std::string& instrument : config_.instruments) {
+        risk.setLimits(instrument, config_.risk);
+    }
+    risk.setRateLimit(config_.orders_per_second, config_.burst);
+
+    TradingPipeline pipeline(market_data_, order_mgr_, config_.pipeline);
+    StrategyContext context(pipeline, order_mgr_, config_);
+    strategy->context_ = &context;
+    strategy->onStart();
+
+    Strategy& running = *strategy;
+    pipeline.start(
+        [&running](const MarketEvent& event) {
+            if (event.kind == MarketEvent::Kind::BookTop) {
+                running.onBook(event);
+            } else {
+                running.onTrade(event);
+            }
+        },
+        [&running](const OrderAck& ack) { running.onOrderUpdate(ack); });
+
+    try {
+        for (const std::string& instrument : config_.instruments) {
+            pipeline.streamBook(instrument, context.tickSize(instrument));
+            pipeline.streamTrades(instrument);
+        }
+        LOG_INFO("Strategy {} running on {} instruments", config_.strategy, config_.instruments.size());
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(config_.run_seconds);
+        while (!interrupted.load() && (config_.run_seconds <= 0 || std::chrono::steady_clock::now() < deadline)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    } catch (const std::exception& ex) {
+        LOG_ERROR("Strategy {} stopped: {}", config_.strategy, ex.what());
+        pipeline.stop();
+        strategy->onStop();
+        throw;
+    }
+
+    pipeline.stop();
+    strategy->onStop();
+    LOG_INFO("Strategy {} stopped; dropped {} market events and {} acks", config_.strategy,
+             pipeline.droppedMarketEvents(), pipeline.droppedAcks());
+
+    if (config_.cancel_on_stop) {
+        for (const std::string& instrument : config_.instruments) {
+            try {
+                int64_t cancelled = order_mgr_.cancelAllByInstrument(instrument);
+                LOG_INFO("Cancelled {} orders on {}", cancelled, instrument);
+            } catch (const std::exception& ex) {
+                LOG_ERROR("Mass cancel on {} failed: {}", instrument, ex.what());
+            }
+        }
+    }
+}
@@ -0,0 +1,118 @@
+#ifndef STRATEGY_H
+#define STRATEGY_H
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "order_manager.h"
+#include "trading_pipeline.h"
+
+class WsConnector;
+
+// What a headless run trades and how, from a JSON file:
+//   {
+//     "strategy": "touch_quoter",
+//     "instruments": ["BTC-PERPETUAL"],
+//     "run_seconds": 60,
+//     "cancel_on_stop": true,
+//     "risk": {"max_order_amount": 100, "price_collar": 0.05, "max_position": 1000,
+//              "max_notional": 0, "orders_per_second": 20, "burst": 40},
+//     "pipeline": {"network_core": -1, "strategy_core": -1, "gateway_core": -1},
+//     "params": {"quote_amount": 10, "offset_ticks": 2}
+//   }
+// Everything but "strategy" and "instruments" is optional; params are the strategy's own.
+struct StrategyConfig {
+    std::string strategy;
+    std::vector<std::string> instruments;
+    int run_seconds = 0;  // 0 runs until interrupted
+    bool cancel_on_stop = true;
+    RiskLimits risk;  // Applied to every instrument
+    double orders_per_second = 0.0;
+    uint32_t burst = 1;
+    PipelineConfig pipeline;
+    std::map<std::string, double> params;
+
+    double param(const std::string& name, double fallback) const;
+};
+
+// Throws std::runtime_error naming the file and the problem
+StrategyConfig loadStrategyConfig(const std::string& path);
+
+// A strategy's handle on the market: orders go through the pipeline's gateway thread,
+// state queries are answered from OrderManager's local stores
+class StrategyContext {
+public:
+    StrategyContext(TradingPipeline& pipeline, OrderManager& order_mgr, const StrategyConfig& config)
+        : pipeline_(pipeline), order_mgr_(order_mgr), config_(config) {}
+
+    // Post-only limit orders; false when the order queue is full
+    bool buy(std::string_view instrument, double amount, double price);
+    bool sell(std::string_view instrument, double amount, double price);
+    bool cancel(std::string_view order_id);
+    bool edit(std::string_view order_id, double price, double amount);
+
+    std::optional<PositionRecord> position(std::string_view instrument) const {
+        return order_mgr_.findPosition(instrument);
+    }
+    double tickSize(std::string_view instrument) const;  // OrderBook::kDefaultTickSize without reference data
+    const StrategyConfig& config() const { return config_; }
+
+private:
+    bool place(OrderCommand::Type type, std::string_view instrument, std::string_view order_id, double amount,
+               double price);
+
+    TradingPipeline& pipeline_;
+    OrderManager& order_mgr_;
+    const StrategyConfig& config_;
+};
+
+// Callbacks run one at a time, so a strategy needs no locking of its own: onStart and
+// onStop on the runner's thread around the pipeline, the rest on its strategy thread.
+// Callbacks must not block; orders go out through context().
+class Strategy {
+public:
+    virtual ~Strategy() = default;
+
+    virtual void onStart() {}
+    virtual void onBook(const MarketEvent& top) = 0;  // Top of book after each applied update
+    virtual void onTrade(const MarketEvent&) {}       // Public trades on the configured instruments
+    // Replies to the strategy's own orders and every user.orders update, fills included
+    virtual void onOrderUpdate(const OrderAck&) {}
+    virtual void onStop() {}
+
+protected:
+    StrategyContext& context() { return *context_; }
+
+private:
+    friend class StrategyRunner;
+    StrategyContext* context_ = nullptr;
+};
+
+using StrategyFactory = std::function<std::unique_ptr<Strategy>(const StrategyConfig&)>;
+
+// Strategies a config can name. "touch_quoter" is built in.
+void registerStrategy(const std::string& name, StrategyFactory factory);
+std::unique_ptr<Strategy> createStrategy(const StrategyConfig& config);  // Throws for an unknown name
+
+// Runs one strategy headless on a TradingPipeline. OrderManager must be started and
+// authenticated; market_data is the connection the instruments' books arrive on.
+class StrategyRunner {
+public:
+    StrategyRunner(OrderManager& order_mgr, WsConnector& market_data, StrategyConfig config);
+
+    // Applies the risk limits, streams the instruments and blocks until run_seconds pass or
+    // interrupted is set. Afterwards the strategy's instruments are mass-cancelled if configured.
+    void run(const std::atomic<bool>& interrupted);
+
+private:
+    OrderManager& order_mgr_;
+    WsConnector& market_data_;
+    StrategyConfig config_;
+};
+
+#endif // STRATEGY_H
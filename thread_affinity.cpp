@@ -0,0 +1,33 @@
+#include "thread_affinity.h"
+#include <cstring>
+#include <pthread.h>
+#include <sched.h>
+#include "logger.h"
+
+namespace {
+
+bool pinHandle(pthread_t handle, int core) {
+    if (core < 0) {
+        return true;
+    }
+
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(core, &cpus);
+    int err = pthread_setaffinity_np(handle, sizeof(cpus), &cpus);
+    if (err != 0) {
+        LOG_WARN("Failed to pin thread to core {}: {}", core, std::strerror(err));
+        return false;
+    }
+    return true;
+}
+
+}  // namespace
+
+bool pinThreadToCore(std::thread& thread, int core) {
+    return pinHandle(thread.native_handle(), core);
+}
+
+bool pinCurrentThreadToCore(int core) {
+    return pinHandle(pthread_self(), core);
+}
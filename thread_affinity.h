@@ -0,0 +1,11 @@
+#ifndef THREAD_AFFINITY_H
+#define THREAD_AFFINITY_H
+
+#include <thread>
+
+// Pin a thread to one CPU core. A negative core leaves the thread unpinned.
+// Returns false (and logs) if the OS rejects the request.
+bool pinThreadToCore(std::thread& thread, int core);
+bool pinCurrentThreadToCore(int core);
+
+#endif // THREAD_AFFINITY_H
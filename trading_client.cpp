@@ -1,147 +1,373 @@
 #include "api_credentials.h"
+#include "connection_pool.h"
+#include "connection_supervisor.h"
+#include "frame_journal.h"
 #include "ws_connector.h"
 #include "order_manager.h"
+#include "order_script.h"
+#include "strategy.h"
+#include "logger.h"
 #include "performance_tracker.h"
+#include <atomic>
+#include <csignal>
+#include <cstdlib>
+#include <stdexcept>
 #include <iostream>
 #include <string>
 #include <exception>
 #include <memory>
-#include <map>
+#include <set>
+#include <vector>
+#include <optional>
 #include <chrono>
 #include <thread>
 #include <rapidjson/document.h>
+#include <rapidjson/prettywriter.h>
+#include <rapidjson/stringbuffer.h>
 
-void runTradingOperations() {
-    try {
-        WsConnector ws_client("test.deribit.com", "443", "/ws/api/v2");
+// Pretty-print a reply for the console; only used on the interactive path
+std::string prettyPrintJson(const rapidjson::Document& doc) {
+    rapidjson::StringBuffer buffer;
+    rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+    doc.Accept(writer);
+    return buffer.GetString();
+}
 
-        std::cout << "Initiating WebSocket connection..." << std::endl;
-        ws_client.establishConnection();
-
-        int retry_count = 0;
-        const int max_retries = 5;
-        while (!ws_client.isConnected() && retry_count < max_retries) {
-            std::this_thread::sleep_for(std::chrono::seconds(1));
-            retry_count++;
-            std::cout << "Retrying connection... (" << retry_count << "/" << max_retries << ")" << std::endl;
-        }
+// Pre-trade limits for every instrument traded from the menu; the collar is against the local book
+const RiskLimits kClientRiskLimits = [] {
+    RiskLimits limits;
+    limits.max_order_amount = 10000.0;
+    limits.price_collar = 0.05;
+    limits.max_position = 100000.0;
+    return limits;
+}();
 
-        if (!ws_client.isConnected()) {
-            std::cerr << "Connection failed after " << max_retries << " retries." << std::endl;
-            return;
-        }
+// Set by SIGINT/SIGTERM; only the headless modes watch it, the menu quits through option 8
+std::atomic<bool> g_interrupted{false};
 
-        auto order_mgr = std::make_unique<OrderManager>(ws_client);
-        rapidjson::Document auth_data = order_mgr->performAuthentication(get_client_id(), get_client_secret());
+void onSignal(int) {
+    g_interrupted.store(true);
+}
 
-        if (auth_data.HasMember("error")) {
-            std::cerr << "Authentication error.\n";
-            return;
-        }
+// Command line:
+//   trading_client                                  interactive menu
+//   trading_client --strategy <config.json>         run a strategy headless, see strategy.h
+//   trading_client --script <file> [--rate <n/s>]   replay an order script, see order_script.h
+struct ClientOptions {
+    std::optional<StrategyConfig> strategy;
+    std::optional<std::vector<ScriptCommand>> script;
+    double rate = 0.0;  // Script commands per second; 0 waits for each reply
+};
 
-        std::cout << "Authentication Successful.\n";
+// Loads the strategy config or script up front, so a bad one fails before anything connects
+ClientOptions parseOptions(int argc, char* argv[]) {
+    ClientOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            throw std::runtime_error("Missing value for " + arg);
+        }
+        if (arg == "--strategy") {
+            options.strategy = loadStrategyConfig(argv[++i]);
+        } else if (arg == "--script") {
+            options.script = loadOrderScript(argv[++i]);
+        } else if (arg == "--rate") {
+            options.rate = std::atof(argv[++i]);
+        } else {
+            throw std::runtime_error("Unknown argument " + arg);
+        }
+    }
+    if (options.strategy && options.script) {
+        throw std::runtime_error("--strategy and --script are exclusive");
+    }
+    return options;
+}
 
-        std::unordered_map<std::string, rapidjson::Document> active_orders;
+// Interactive menu; each option's latency covers only its network call, not the prompts
+void runMenu(OrderManager& order_mgr) {
+    order_mgr.riskGate().setRateLimit(5.0, 10);  // Well inside the exchange's own order rate limits
+    std::set<std::string> risk_configured;
 
-        while (true) {
-            std::string asset_name, order_ref;
-            double qty, rate;
+    while (true) {
+        std::string asset_name, order_ref;
+        double qty, rate;
 
-            std::cout << "\n=== Trading Options ===\n";
-            std::cout << "1. Create New Order\n2. Remove Order\n3. Update Order\n";
-            std::cout << "4. Fetch Order Book\n5. Check Positions\n6. Quit\n";
-            std::cout << "Select an option: ";
-            int selection;
-            std::cin >> selection;
+        std::cout << "\n=== Trading Options ===\n";
+        std::cout << "1. Create New Order\n2. Remove Order\n3. Update Order\n";
+        std::cout << "4. Fetch Order Book\n5. Check Positions\n6. Stream Market Data\n7. Open Orders\n8. Quit\n";
+        std::cout << "Select an option: ";
+        int selection;
+        std::cin >> selection;
 
-            auto operation_start = PerformanceTracker::beginTiming();
+        if (selection == 8) {
+            std::cout << "Shutting down trading client.\n";
+            break;
+        }
 
-            if (selection == 6) {
-                std::cout << "Shutting down trading client.\n";
-                break;
-            }
+        switch (selection) {
+            case 1: {
+                std::string side, type;
+                std::cout << "Asset name (e.g., BTC-PERPETUAL): ";
+                std::cin >> asset_name;
+                std::cout << "Side (buy/sell): ";
+                std::cin >> side;
+                std::cout << "Type (limit/market): ";
+                std::cin >> type;
+                std::cout << "Quantity: ";
+                std::cin >> qty;
 
-            switch (selection) {
-                case 1:
-                    std::cout << "Asset name (e.g., BTC-PERPETUAL): ";
-                    std::cin >> asset_name;
-                    std::cout << "Quantity: ";
-                    std::cin >> qty;
+                Side order_side = side == "sell" ? Side::Sell : Side::Buy;
+                OrderRequest request = OrderRequest::market(asset_name, order_side, qty);
+                if (type != "market") {
                     std::cout << "Rate: ";
                     std::cin >> rate;
-                    try {
-                        active_orders[asset_name] = order_mgr->submitBuyOrder(asset_name, qty, rate);
-                        std::cout << "Order Submitted.\n";
-                    } catch (const std::exception& ex) {
-                        std::cerr << "Order submission failed: " << ex.what() << std::endl;
-                    }
-                    break;
-
-                case 2:
-                    std::cout << "Order reference to cancel: ";
-                    std::cin >> order_ref;
-                    try {
-                        rapidjson::Document cancel_result = order_mgr->removeOrder(order_ref);
-                        std::cout << "Cancellation Successful.\n";
-                    } catch (const std::exception& ex) {
-                        std::cerr << "Cancellation failed: " << ex.what() << std::endl;
+                    request = OrderRequest::limit(asset_name, order_side, qty, rate);
+                    request.post_only = true;
+                }
+                try {
+                    if (risk_configured.insert(asset_name).second) {
+                        // The collar needs a touch price, so the first order on an instrument starts its book
+                        order_mgr.riskGate().setLimits(asset_name, kClientRiskLimits);
+                        order_mgr.trackOrderBook(asset_name);
+                        for (int wait = 0; wait < 100 && !order_mgr.readOrderBook(asset_name, [](const OrderBook&) {});
+                             ++wait) {
+                            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                        }
                     }
-                    break;
+                    auto network_start = PerformanceTracker::beginTiming();
+                    rapidjson::Document order_result = order_mgr.submitOrder(request);
+                    PerformanceTracker::endTiming(network_start, "Trading Operation Duration");
+                    const rapidjson::Value& order = order_result["result"]["order"];
+                    std::cout << "Order Submitted: " << order["order_id"].GetString() << " ("
+                              << order["order_state"].GetString() << ")\n";
+                } catch (const std::exception& ex) {
+                    std::cerr << "Order submission failed: " << ex.what() << std::endl;
+                }
+                break;
+            }
 
-                case 3:
-                    std::cout << "Order reference to update: ";
-                    std::cin >> order_ref;
-                    std::cout << "New rate: ";
-                    std::cin >> rate;
-                    std::cout << "New quantity: ";
-                    std::cin >> qty;
-                    try {
-                        rapidjson::Document update_result = order_mgr->updateOrder(order_ref, rate, qty);
-                        std::cout << "Update Successful.\n";
-                    } catch (const std::exception& ex) {
-                        std::cerr << "Update failed: " << ex.what() << std::endl;
-                    }
-                    break;
+            case 2:
+                std::cout << "Order reference to cancel: ";
+                std::cin >> order_ref;
+                try {
+                    auto network_start = PerformanceTracker::beginTiming();
+                    rapidjson::Document cancel_result = order_mgr.removeOrder(order_ref);
+                    PerformanceTracker::endTiming(network_start, "Trading Operation Duration");
+                    std::cout << "Cancellation Successful.\n";
+                } catch (const std::exception& ex) {
+                    std::cerr << "Cancellation failed: " << ex.what() << std::endl;
+                }
+                break;
+
+            case 3:
+                std::cout << "Order reference to update: ";
+                std::cin >> order_ref;
+                std::cout << "New rate: ";
+                std::cin >> rate;
+                std::cout << "New quantity: ";
+                std::cin >> qty;
+                try {
+                    auto network_start = PerformanceTracker::beginTiming();
+                    rapidjson::Document update_result = order_mgr.updateOrder(order_ref, rate, qty);
+                    PerformanceTracker::endTiming(network_start, "Trading Operation Duration");
+                    std::cout << "Update Successful.\n";
+                } catch (const std::exception& ex) {
+                    std::cerr << "Update failed: " << ex.what() << std::endl;
+                }
+                break;
+
+            case 4:
+                std::cout << "Asset name (e.g., BTC-PERPETUAL): ";
+                std::cin >> asset_name;
+                try {
+                    // Served from the local book once tracked; otherwise fetch and start tracking
+                    bool served_locally = order_mgr.readOrderBook(asset_name, [](const OrderBook& book) {
+                        for (size_t i = 0; i < 5; ++i) {
+                            const OrderBook::Level* bid = book.level(OrderBook::Side::Bid, i);
+                            const OrderBook::Level* ask = book.level(OrderBook::Side::Ask, i);
+                            if (!bid && !ask) {
+                                break;
+                            }
+                            if (bid) {
+                                std::cout << bid->amount << " @ " << book.toPrice(bid->price);
+                            }
+                            std::cout << "\t|\t";
+                            if (ask) {
+                                std::cout << ask->amount << " @ " << book.toPrice(ask->price);
+                            }
+                            std::cout << "\n";
+                        }
+                    });
 
-                case 4:
-                    std::cout << "Asset name (e.g., BTC-PERPETUAL): ";
-                    std::cin >> asset_name;
-                    try {
-                        rapidjson::Document book_data = order_mgr->retrieveOrderBook(asset_name);
+                    if (served_locally) {
+                        std::cout << "Order Book Read Locally.\n";
+                    } else {
+                        auto network_start = PerformanceTracker::beginTiming();
+                        rapidjson::Document book_data = order_mgr.retrieveOrderBook(asset_name);
+                        PerformanceTracker::endTiming(network_start, "Trading Operation Duration");
+                        std::cout << "Order Book Data:\n" << prettyPrintJson(book_data) << std::endl;
+                        order_mgr.trackOrderBook(asset_name);
                         std::cout << "Order Book Retrieved.\n";
-                    } catch (const std::exception& ex) {
-                        std::cerr << "Order book retrieval failed: " << ex.what() << std::endl;
                     }
-                    break;
-
-                case 5:
-                    try {
-                        rapidjson::Document position_data = order_mgr->fetchPositions();
-                        std::cout << "Positions Retrieved.\n";
-                    } catch (const std::exception& ex) {
-                        std::cerr << "Position fetch failed: " << ex.what() << std::endl;
+                } catch (const std::exception& ex) {
+                    std::cerr << "Order book retrieval failed: " << ex.what() << std::endl;
+                }
+                break;
+
+            case 5: {
+                // Answered from the position store; no request goes out
+                const PositionStore& positions = order_mgr.positions();
+                for (const std::string& currency : positions.currencies()) {
+                    for (const PositionRecord& position : positions.positions(currency)) {
+                        std::cout << position.instrument_name.view() << "  " << position.size << " @ "
+                                  << position.average_price << "  mark " << position.mark_price << "  upl "
+                                  << position.unrealized_pnl << "  rpl " << position.realized_pnl << "\n";
                     }
-                    break;
+                    PnlTotals totals = positions.totals(currency);
+                    std::cout << currency << " total: upl " << totals.unrealized_pnl << "  rpl "
+                              << totals.realized_pnl << "  fees " << totals.fees << "\n";
+                }
+                std::cout << "Positions Read Locally.\n";
+                break;
+            }
+
+            case 6:
+                std::cout << "Asset name (e.g., BTC-PERPETUAL): ";
+                std::cin >> asset_name;
+                try {
+                    // Ticker updates print from the reader thread as they arrive
+                    order_mgr.registerMarketFeed(OrderManager::tickerChannel(asset_name),
+                        [asset_name](const FeedMessage& message) {
+                            const rapidjson::Value& ticker = message.data();
+                            if (ticker.IsObject() && ticker.HasMember("best_bid_price") && ticker.HasMember("best_ask_price")) {
+                                std::cout << asset_name << " bid " << ticker["best_bid_price"].GetDouble()
+                                          << " / ask " << ticker["best_ask_price"].GetDouble() << std::endl;
+                            }
+                        });
+                    auto network_start = PerformanceTracker::beginTiming();
+                    order_mgr.subscribe({OrderManager::tickerChannel(asset_name)});
+                    PerformanceTracker::endTiming(network_start, "Trading Operation Duration");
+                    std::cout << "Streaming Started.\n";
+                } catch (const std::exception& ex) {
+                    std::cerr << "Subscription failed: " << ex.what() << std::endl;
+                }
+                break;
+
+            case 7: {
+                // Answered from the local order store; no request goes out
+                std::vector<OrderRecord> open_orders = order_mgr.openOrders();
+                for (const OrderRecord& order : open_orders) {
+                    std::cout << order.order_id.view() << "  " << order.instrument_name.view() << "  "
+                              << (order.is_buy ? "buy " : "sell ") << order.amount << " @ " << order.price
+                              << "  filled " << order.filled_amount << "  " << toString(order.state) << "\n";
+                }
+                std::cout << open_orders.size() << " Open Orders.\n";
+                break;
+            }
+
+            default:
+                std::cout << "Invalid option selected.\n";
+                break;
+        }
+    }
+}
+
+void runTradingOperations(const ClientOptions& options) {
+    try {
+        // DERIBIT_CAPTURE_FILE records every received frame for journal_replay
+        std::optional<FrameJournalWriter> journal;
+        if (const char* capture_path = std::getenv("DERIBIT_CAPTURE_FILE")) {
+            journal.emplace(capture_path);
+        }
+
+        // Order entry and market data on separate sockets, so book traffic never delays an ack
+        ConnectionPool connections(get_api_host(), get_api_port(), "/ws/api/v2");
+        connections.captureTo(journal ? &*journal : nullptr);
+
+        auto order_mgr = std::make_unique<OrderManager>(connections);
+
+        // Reconnects, re-authenticates and re-subscribes on its own after a drop or a stalled link
+        ConnectionSupervisor supervisor(*order_mgr);
+        std::cout << "Initiating WebSocket connection..." << std::endl;
+        try {
+            supervisor.start();
+        } catch (const std::exception& ex) {
+            std::cerr << "Connection failed: " << ex.what() << std::endl;
+            return;
+        }
+
+        // From here on replies are matched by request id on the connector's io thread
+        rapidjson::Document auth_data = order_mgr->performAuthentication(get_client_id(), get_client_secret());
+
+        if (auth_data.HasMember("error")) {
+            std::cerr << "Authentication error.\n";
+            return;
+        }
+
+        std::cout << "Authentication Successful.\n";
+
+        // Tick sizes for local books; the cache file saves the fetch on the next start within a day
+        try {
+            size_t instruments = order_mgr->loadInstruments("BTC", "any", "instruments.cache");
+            std::cout << "Instruments loaded: " << instruments << "\n";
+        } catch (const std::exception& ex) {
+            std::cerr << "Instrument list unavailable: " << ex.what() << std::endl;
+        }
+
+        // Keeps the local order store in step with fills and cancels from any session
+        try {
+            order_mgr->trackOrders();
+        } catch (const std::exception& ex) {
+            std::cerr << "Order updates unavailable: " << ex.what() << std::endl;
+        }
+        // Positions and PnL from own fills; the supervisor reconciles them against the exchange
+        try {
+            order_mgr->trackPositions({"BTC"});
+        } catch (const std::exception& ex) {
+            std::cerr << "Position tracking unavailable: " << ex.what() << std::endl;
+        }
 
-                default:
-                    std::cout << "Invalid option selected.\n";
-                    break;
+        if (options.strategy) {
+            std::signal(SIGINT, onSignal);
+            std::signal(SIGTERM, onSignal);
+            // Every market-data io thread feeds the pipeline's market ring; this connection is the one
+            // whose reader the strategy's network_core pins
+            WsConnector& market_data = connections.connection(connections.route(ConnectionRole::MarketData));
+            StrategyRunner(*order_mgr, market_data, *options.strategy).run(g_interrupted);
+        } else if (options.script) {
+            std::signal(SIGINT, onSignal);
+            std::signal(SIGTERM, onSignal);
+            ScriptResult result = ScriptRunner(*order_mgr, options.rate).run(*options.script, g_interrupted);
+            std::cout << "Script finished: " << result.sent << " sent, " << result.accepted << " accepted, "
+                      << result.rejected << " rejected, " << result.skipped << " skipped, " << result.unanswered
+                      << " unanswered";
+            if (result.achievedRate() > 0.0) {
+                std::cout << ", " << result.achievedRate() << " commands/s";
             }
-            PerformanceTracker::endTiming(operation_start, "Trading Operation Duration");
+            std::cout << std::endl;
+        } else {
+            runMenu(*order_mgr);
         }
 
-        ws_client.disconnect();
+        supervisor.stop();
+        connections.disconnect();
     } catch (const std::exception& ex) {
         std::cerr << "Trading operation error: " << ex.what() << std::endl;
     }
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+    Logger::start("trading_client.log");
+    // Latency histograms go to stderr so they don't interleave with the menu prompts
+    PerformanceTracker::startReporter(std::chrono::seconds(30), std::clog);
+    int status = 0;
     try {
-        runTradingOperations();
+        runTradingOperations(parseOptions(argc, argv));
     } catch (const std::exception& ex) {
         std::cerr << "Critical failure: " << ex.what() << std::endl;
-        return 1;
+        status = 1;
     }
-    return 0;
+    PerformanceTracker::stopReporter();
+    Logger::stop();
+    return status;
 }
@@ -0,0 +1,224 @@
+#include "trading_pipeline.h"
+#include <chrono>
+#include <stdexcept>
+#include "logger.h"
+#include "thread_affinity.h"
+#include "ws_connector.h"
+
+namespace {
+
+// Pinned stages own their core and spin; unpinned ones give the core back when idle
+inline void idle(bool spin) {
+    if (!spin) {
+        std::this_thread::yield();
+    }
+}
+
+}  // namespace
+
+TradingPipeline::TradingPipeline(WsConnector& ws_conn, OrderManager& order_mgr, PipelineConfig config)
+    : ws_conn_(ws_conn),
+      order_mgr_(order_mgr),
+      config_(config),
+      market_events_(std::make_unique<MpscRing<MarketEvent, kMarketRingSize>>()),
+      acks_(std::make_unique<MpscRing<OrderAck, kAckRingSize>>()),
+      orders_(std::make_unique<MpscRing<OrderCommand, kOrderRingSize>>()),
+      forward_ack_([this](const OrderAck& ack) { publishAck(ack); }) {
+    order_mgr_.setBookListener([this](std::string_view asset, const OrderBook& book) {
+        MarketEvent event;
+        event.kind = MarketEvent::Kind::BookTop;
+        event.instrument_name.assign(asset.data(), asset.size());
+        event.change_id = book.changeId();
+        if (const OrderBook::Level* bid = book.bestBid()) {
+            event.bid_price = book.toPrice(bid->price);
+            event.bid_amount = bid->amount;
+        }
+        if (const OrderBook::Level* ask = book.bestAsk()) {
+            event.ask_price = book.toPrice(ask->price);
+            event.ask_amount = ask->amount;
+        }
+        event.received_ns = nowNanos();
+        publishMarketEvent(event);
+    });
+    // Updates to any order, e.g. fills of resting quotes, once OrderManager::trackOrders() runs
+    order_mgr_.setOrderListener([this](const OrderAck& update) { publishAck(update); });
+}
+
+TradingPipeline::~TradingPipeline() {
+    stop();
+    order_mgr_.setBookListener(nullptr);
+    order_mgr_.setOrderListener(nullptr);
+    // The handlers capture this: once unregistered no frame reaches them, and a reconnect does not resubscribe
+    for (const std::string& channel : trade_channels_) {
+        order_mgr_.unregisterMarketFeed(channel);
+    }
+    if (!trade_channels_.empty()) {
+        try {
+            order_mgr_.unsubscribe(trade_channels_);
+        } catch (const std::exception& ex) {
+            LOG_WARN("Trade feeds left subscribed: {}", ex.what());
+        }
+    }
+}
+
+int64_t TradingPipeline::nowNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void TradingPipeline::start(MarketEventHandler on_market, AckHandler on_ack) {
+    if (running_.exchange(true)) {
+        throw std::logic_error("TradingPipeline already running");
+    }
+
+    on_market_ = std::move(on_market);
+    on_ack_ = std::move(on_ack);
+
+    if (config_.network_core >= 0) {
+        ws_conn_.pinReaderThread(config_.network_core);
+    }
+    strategy_thread_ = std::thread([this] { runStrategy(); });
+    gateway_thread_ = std::thread([this] { runGateway(); });
+}
+
+void TradingPipeline::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+
+    if (gateway_thread_.joinable()) {
+        gateway_thread_.join();
+    }
+    if (strategy_thread_.joinable()) {
+        strategy_thread_.join();
+    }
+}
+
+void TradingPipeline::streamBook(const std::string& asset, double tick_size) {
+    order_mgr_.trackOrderBook(asset, tick_size);  // Every applied update reaches the book listener
+}
+
+void TradingPipeline::streamTrades(const std::string& asset) {
+    std::string channel = OrderManager::tradesChannel(asset);
+    order_mgr_.registerMarketFeed(channel, [this](const FeedMessage& message) {
+        const rapidjson::Value& trades = message.data();
+        if (!trades.IsArray()) {
+            return;
+        }
+
+        int64_t received_ns = nowNanos();
+        for (const auto& trade : trades.GetArray()) {
+            if (!trade.IsObject() || !trade.HasMember("price") || !trade.HasMember("amount")) {
+                continue;
+            }
+
+            MarketEvent event;
+            event.kind = MarketEvent::Kind::Trade;
+            if (trade.HasMember("instrument_name")) {
+                event.instrument_name.assign(trade["instrument_name"].GetString(),
+                                             trade["instrument_name"].GetStringLength());
+            }
+            event.trade_price = trade["price"].GetDouble();
+            event.trade_amount = trade["amount"].GetDouble();
+            event.trade_is_buy = trade.HasMember("direction") &&
+                                 std::string_view(trade["direction"].GetString()) == "buy";
+            event.received_ns = received_ns;
+            publishMarketEvent(event);
+        }
+    });
+    trade_channels_.push_back(channel);
+    order_mgr_.subscribe({channel});
+}
+
+bool TradingPipeline::submit(const OrderCommand& command) {
+    return orders_->tryPush(command);
+}
+
+void TradingPipeline::publishMarketEvent(const MarketEvent& event) {
+    // Never block the reader: a strategy that falls behind loses updates, not the socket
+    if (!market_events_->tryPush(event)) {
+        dropped_events_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void TradingPipeline::publishAck(const OrderAck& ack) {
+    if (!acks_->tryPush(ack)) {
+        dropped_acks_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void TradingPipeline::runStrategy() {
+    pinCurrentThreadToCore(config_.strategy_core);
+    bool spin = config_.strategy_core >= 0;
+
+    MarketEvent event;
+    OrderAck ack;
+    while (true) {
+        bool busy = false;
+        while (market_events_->tryPop(event)) {
+            busy = true;
+            if (on_market_) {
+                on_market_(event);
+            }
+        }
+        while (acks_->tryPop(ack)) {
+            busy = true;
+            if (on_ack_) {
+                on_ack_(ack);
+            }
+        }
+
+        if (!busy) {
+            if (!running_.load(std::memory_order_acquire)) {
+                break;  // Drained
+            }
+            idle(spin);
+        }
+    }
+}
+
+void TradingPipeline::runGateway() {
+    pinCurrentThreadToCore(config_.gateway_core);
+    bool spin = config_.gateway_core >= 0;
+
+    OrderCommand command;
+    while (true) {
+        if (orders_->tryPop(command)) {
+            dispatch(command);
+            continue;
+        }
+
+        if (!running_.load(std::memory_order_acquire)) {
+            break;
+        }
+        idle(spin);
+    }
+}
+
+void TradingPipeline::dispatch(const OrderCommand& command) {
+    try {
+        switch (command.type) {
+        case OrderCommand::Type::Buy:
+            order_mgr_.submitBuyOrderAsync(command.instrument_name.view(), command.amount, command.price, forward_ack_);
+            break;
+        case OrderCommand::Type::Sell:
+            order_mgr_.submitSellOrderAsync(command.instrument_name.view(), command.amount, command.price, forward_ack_);
+            break;
+        case OrderCommand::Type::Cancel:
+            order_mgr_.removeOrderAsync(command.order_id.view(), forward_ack_);
+            break;
+        case OrderCommand::Type::Edit:
+            order_mgr_.updateOrderAsync(command.order_id.view(), command.price, command.amount, forward_ack_);
+            break;
+        }
+    } catch (const std::exception& ex) {
+        // Report through the same path as exchange rejections
+        LOG_ERROR("Order dispatch failed: {}", ex.what());
+        OrderAck ack;
+        ack.error_code = -1;
+        ack.error_message.assign(ex.what(), std::char_traits<char>::length(ex.what()));
+        ack.instrument_name = command.instrument_name;
+        ack.order_id = command.order_id;
+        publishAck(ack);
+    }
+}
@@ -0,0 +1,118 @@
+#ifndef TRADING_PIPELINE_H
+#define TRADING_PIPELINE_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "order_manager.h"
+#include "response_parser.h"
+#include "ring_buffer.h"
+
+class WsConnector;
+
+// Decoded market update handed from the network thread to the strategy thread
+struct MarketEvent {
+    enum class Kind : uint8_t { BookTop, Trade };
+
+    Kind kind = Kind::BookTop;
+    FixedString<64> instrument_name;
+    int64_t change_id = 0;      // BookTop
+    double bid_price = 0.0;     // BookTop; 0 when the side is empty
+    double bid_amount = 0.0;
+    double ask_price = 0.0;
+    double ask_amount = 0.0;
+    double trade_price = 0.0;   // Trade
+    double trade_amount = 0.0;
+    bool trade_is_buy = false;
+    int64_t received_ns = 0;    // steady_clock when the network thread decoded it
+};
+
+// Order request queued to the gateway thread
+struct OrderCommand {
+    enum class Type : uint8_t { Buy, Sell, Cancel, Edit };
+
+    Type type = Type::Buy;
+    FixedString<64> instrument_name;  // Buy/Sell
+    FixedString<64> order_id;         // Cancel/Edit
+    double amount = 0.0;
+    double price = 0.0;
+    int64_t enqueued_ns = 0;
+};
+
+struct PipelineConfig {
+    // Cores for each stage; -1 leaves the thread unpinned. Pinned stages busy-spin.
+    int network_core = -1;
+    int strategy_core = -1;
+    int gateway_core = -1;
+};
+
+// Staged threading model:
+//   network (market-data io threads) --MPSC MarketEvent--> strategy thread
+//   any thread --MPSC OrderCommand--> gateway thread --> OrderManager
+//   network/gateway --MPSC OrderAck--> strategy thread (command replies and user.orders updates)
+// The gateway encodes orders and registers them for reply matching; the socket
+// write itself still runs on the io thread, which owns the beast stream.
+// With a ConnectionPool, instruments may stream over different market-data connections, and
+// the book listener fires for every tracked book, so each of their io threads produces into
+// the market ring. ws_conn is the connection whose reader network_core pins.
+class TradingPipeline {
+public:
+    using MarketEventHandler = std::function<void(const MarketEvent&)>;
+    using AckHandler = OrderManager::AckHandler;
+
+    static constexpr size_t kMarketRingSize = 8192;
+    static constexpr size_t kOrderRingSize = 1024;
+    static constexpr size_t kAckRingSize = 1024;
+
+    TradingPipeline(WsConnector& ws_conn, OrderManager& order_mgr, PipelineConfig config = {});
+    ~TradingPipeline();
+
+    // Handlers run on the strategy thread. OrderManager::start() should already be running.
+    void start(MarketEventHandler on_market, AckHandler on_ack = nullptr);
+    void stop();
+    bool isRunning() const { return running_.load(std::memory_order_acquire); }
+
+    // Feeds forwarded to the strategy thread. Trade feeds are unregistered and unsubscribed on destruction.
+    void streamBook(const std::string& asset, double tick_size = OrderBook::kDefaultTickSize);
+    void streamTrades(const std::string& asset);
+
+    bool submit(const OrderCommand& command);  // Any thread; false when the order queue is full
+
+    uint64_t droppedMarketEvents() const { return dropped_events_.load(std::memory_order_relaxed); }
+    uint64_t droppedAcks() const { return dropped_acks_.load(std::memory_order_relaxed); }
+
+    static int64_t nowNanos();
+
+private:
+    void runStrategy();
+    void runGateway();
+    void dispatch(const OrderCommand& command);
+    void publishMarketEvent(const MarketEvent& event);  // Any io thread
+    void publishAck(const OrderAck& ack);
+
+    WsConnector& ws_conn_;
+    OrderManager& order_mgr_;
+    PipelineConfig config_;
+
+    std::unique_ptr<MpscRing<MarketEvent, kMarketRingSize>> market_events_;  // Every market-data io thread
+    std::unique_ptr<MpscRing<OrderAck, kAckRingSize>> acks_;  // Errors can come from any thread
+    std::unique_ptr<MpscRing<OrderCommand, kOrderRingSize>> orders_;
+
+    std::vector<std::string> trade_channels_;  // Registered by streamTrades; dropped on destruction
+
+    MarketEventHandler on_market_;
+    AckHandler on_ack_;
+    AckHandler forward_ack_;  // Passed with every order; captures only this
+
+    std::atomic<bool> running_{false};
+    std::atomic<uint64_t> dropped_events_{0};
+    std::atomic<uint64_t> dropped_acks_{0};
+    std::thread strategy_thread_;
+    std::thread gateway_thread_;
+};
+
+#endif // TRADING_PIPELINE_H
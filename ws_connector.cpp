@@ -1,11 +1,36 @@
 #include "ws_connector.h"
+#include "thread_affinity.h"
 #include <boost/asio/ip/tcp.hpp>
-#include <iostream>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#ifdef __linux__
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#endif
+#include "frame_journal.h"
+#include "logger.h"
+#include "performance_tracker.h"
 
 namespace ssl_alias = boost::asio::ssl;
 namespace ip_alias = boost::asio::ip;
 namespace beast_alias = boost::beast;
 
+namespace {
+
+// Time from transmitAsync queuing a frame until the socket write completes
+const PerformanceTracker::ProbeId kWriteProbe = PerformanceTracker::registerProbe("ws.write");
+
+// SSL_CTX ex_data slot pointing back at the owning connector; asio keeps its own state in app_data
+int connectorSlot() {
+    static const int slot = SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+    return slot;
+}
+
+}  // namespace
+
 // Define the custom teardown function in the boost::beast namespace
 namespace boost {
 namespace beast {
@@ -15,19 +40,32 @@ void teardown(
     error_code& ec) {
     stream.shutdown(ec); // Gracefully shut down the SSL stream
 }
+
+template <class TeardownHandler>
+void async_teardown(
+    role_type /*role*/,
+    ssl_alias::stream<ip_alias::tcp::socket>& stream,
+    TeardownHandler&& handler) {
+    stream.async_shutdown(std::forward<TeardownHandler>(handler));
+}
 } // namespace beast
 } // namespace boost
 
-WsConnector::WsConnector(const std::string& server, const std::string& port_num, const std::string& path)
+WsConnector::WsConnector(const std::string& server, const std::string& port_num, const std::string& path,
+                         size_t receive_limit)
     : server_(server),
       port_num_(port_num),
       path_(path),
       io_service_(),
       ssl_ctx_(ssl_alias::context::tlsv13_client),
       dns_resolver_(io_service_),
-      ws_stream_(io_service_, ssl_ctx_),
-      receive_buffer_(8192)  // Pre-allocated buffer to avoid heap fragmentation
+      receive_limit_(receive_limit),
+      receive_buffer_(receive_limit + 1),  // One spare byte for the NUL terminator
+      write_slots_(kWriteSlots)
 {
+    // Pre-allocated so typical frames never grow the buffer
+    receive_buffer_.reserve(std::min<size_t>(8192, receive_limit + 1));
+
     // Configure SSL context for security
     ssl_ctx_.set_options(ssl_alias::context::default_workarounds |
                          ssl_alias::context::no_sslv2 |
@@ -36,81 +74,395 @@ WsConnector::WsConnector(const std::string& server, const std::string& port_num,
 
     SSL_CTX_set_options(ssl_ctx_.native_handle(), SSL_OP_NO_COMPRESSION);
     SSL_CTX_set_mode(ssl_ctx_.native_handle(), SSL_MODE_RELEASE_BUFFERS);
-    SSL_CTX_set_session_cache_mode(ssl_ctx_.native_handle(), SSL_SESS_CACHE_CLIENT);
+    SSL_CTX_set_session_cache_mode(ssl_ctx_.native_handle(), SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_set_ex_data(ssl_ctx_.native_handle(), connectorSlot(), this);
+    SSL_CTX_sess_set_new_cb(ssl_ctx_.native_handle(), &WsConnector::onNewSession);
 
     const char* ciphers = "TLS_AES_256_GCM_SHA384:TLS_CHACHA20_POLY1305_SHA256:ECDHE-ECDSA-AES256-GCM-SHA384";
     if (SSL_CTX_set_cipher_list(ssl_ctx_.native_handle(), ciphers) != 1) {
-        std::cerr << "Failed to configure cipher suite" << std::endl;
+        LOG_WARN("Failed to configure cipher suite");
     }
 }
 
+WsConnector::~WsConnector() {
+    stopReading();
+    if (tls_session_) {
+        SSL_SESSION_free(tls_session_);
+    }
+}
+
+int WsConnector::onNewSession(SSL* ssl, SSL_SESSION* session) {
+    auto* self = static_cast<WsConnector*>(SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), connectorSlot()));
+    // A copy: OpenSSL marks the live session unresumable when the connection later dies on an error
+    SSL_SESSION* copy = SSL_SESSION_dup(session);
+    if (!copy) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(self->session_mutex_);
+    if (self->tls_session_) {
+        SSL_SESSION_free(self->tls_session_);
+    }
+    self->tls_session_ = copy;
+    return 0;  // The original stays with OpenSSL
+}
+
 void WsConnector::establishConnection() {
     try {
+        ws_stream_.reset();
+        ws_stream_.emplace(io_service_, ssl_ctx_);
+        ws_stream_->read_message_max(receive_limit_);
+        session_resumed_.store(false, std::memory_order_release);
+
+        // Opened by hand so buffer sizes are in place before the SYN, which fixes the window scale
         auto endpoints = dns_resolver_.resolve(server_, port_num_);
-        boost::asio::connect(ws_stream_.next_layer().next_layer(), endpoints);
-        
+        ip_alias::tcp::socket& socket = ws_stream_->next_layer().next_layer();
+        boost::system::error_code connect_err = boost::asio::error::host_not_found;
+        for (const auto& entry : endpoints) {
+            boost::system::error_code ignored;
+            socket.close(ignored);
+            socket.open(entry.endpoint().protocol());
+            applySocketTuning();
+            socket.connect(entry.endpoint(), connect_err);
+            if (!connect_err) {
+                break;
+            }
+        }
+        if (connect_err) {
+            throw boost::system::system_error(connect_err);
+        }
+
         // Disable Nagle's algorithm for lower latency
         ip_alias::tcp::no_delay no_delay(true);
-        ws_stream_.next_layer().next_layer().set_option(no_delay);
+        socket.set_option(no_delay);
+        rearmQuickAck();
 
-        ws_stream_.next_layer().handshake(ssl_alias::stream_base::client);
+        SSL* ssl = ws_stream_->next_layer().native_handle();
+        SSL_set_tlsext_host_name(ssl, server_.c_str());
+        {
+            std::lock_guard<std::mutex> lock(session_mutex_);
+            // Offered as a copy too, so a failed attempt cannot spoil the stored ticket
+            SSL_SESSION* offer = tls_session_ && SSL_SESSION_is_resumable(tls_session_) ? SSL_SESSION_dup(tls_session_)
+                                                                                         : nullptr;
+            if (offer) {
+                SSL_set_session(ssl, offer);
+                SSL_SESSION_free(offer);  // The SSL holds its own reference
+            }
+        }
+        ws_stream_->next_layer().handshake(ssl_alias::stream_base::client);
+        session_resumed_.store(SSL_session_reused(ssl) == 1, std::memory_order_release);
 
-        ws_stream_.set_option(beast_alias::websocket::stream_base::decorator(
+        ws_stream_->set_option(beast_alias::websocket::stream_base::decorator(
             [](beast_alias::websocket::request_type& request) {
                 request.set(beast_alias::http::field::user_agent, "CustomTradingApp");
             }));
 
-        ws_stream_.handshake(server_, path_);
+        ws_stream_->handshake(server_, path_);
     } catch (const std::exception& ex) {
-        std::cerr << "Connection attempt failed: " << ex.what() << std::endl;
+        LOG_ERROR("Connection attempt failed: {}", ex.what());
         throw;
     }
 }
 
-void WsConnector::transmit(const std::string& data) {
+void WsConnector::applySocketTuning() {
+#ifdef __linux__
+    int fd = ws_stream_->next_layer().next_layer().native_handle();
+    auto set = [fd](int level, int option, int value, const char* name) {
+        if (value > 0 && setsockopt(fd, level, option, &value, sizeof(value)) != 0) {
+            LOG_WARN("{} not applied: {}", name, std::strerror(errno));
+        }
+    };
+    set(SOL_SOCKET, SO_RCVBUF, tuning_.receive_buffer_bytes, "SO_RCVBUF");
+    set(SOL_SOCKET, SO_SNDBUF, tuning_.send_buffer_bytes, "SO_SNDBUF");
+#ifdef SO_BUSY_POLL
+    set(SOL_SOCKET, SO_BUSY_POLL, tuning_.busy_poll_us, "SO_BUSY_POLL");  // Raising it may need CAP_NET_ADMIN
+#endif
+#endif
+}
+
+void WsConnector::rearmQuickAck() {
+#ifdef __linux__
+    if (tuning_.quick_ack) {
+        int enable = 1;
+        setsockopt(ws_stream_->next_layer().next_layer().native_handle(), IPPROTO_TCP, TCP_QUICKACK, &enable,
+                   sizeof(enable));
+    }
+#endif
+}
+
+void WsConnector::transmit(std::string_view data) {
     try {
-        ws_stream_.write(boost::asio::buffer(data));
+        ws_stream_->write(boost::asio::buffer(data));
     } catch (const std::exception& ex) {
-        std::cerr << "Data transmission failed: " << ex.what() << std::endl;
+        LOG_ERROR("Data transmission failed: {}", ex.what());
         throw;
     }
 }
 
 std::string WsConnector::receive() {
-    try {
-        beast_alias::flat_buffer buffer;
-        ws_stream_.read(buffer);
+    return std::string(receiveView());
+}
+
+std::string_view WsConnector::receiveView() {
+    MutableFrame frame = receiveInsitu();
+    return std::string_view(frame.data, frame.size);
+}
 
-        // Convert buffer to string using Boost.Beast utility
-        return beast_alias::buffers_to_string(buffer.data());
+WsConnector::MutableFrame WsConnector::receiveInsitu() {
+    try {
+        readFrame();
+        return terminateFrame();
     } catch (const std::exception& ex) {
-        std::cerr << "Data reception failed: " << ex.what() << std::endl;
+        LOG_ERROR("Data reception failed: {}", ex.what());
         throw;
     }
 }
 
+void WsConnector::readFrame() {
+    receive_buffer_.clear();
+    ws_stream_->read(receive_buffer_);
+    rearmQuickAck();
+}
+
+WsConnector::MutableFrame WsConnector::terminateFrame() {
+    // Write the NUL into spare capacity without committing it, so size() stays the payload
+    size_t size = receive_buffer_.size();
+    auto spare = receive_buffer_.prepare(1);
+    static_cast<char*>(spare.data())[0] = '\0';
+    MutableFrame frame{static_cast<char*>(receive_buffer_.data().data()), size};
+
+    // Captured before any handler sees it, since in-situ parsing rewrites the buffer
+    if (capture_journal_) {
+        captureFrame(std::string_view(frame.data, frame.size));
+    }
+    return frame;
+}
+
+void WsConnector::captureFrame(std::string_view frame) {
+    try {
+        capture_journal_->append(frame);
+    } catch (const std::exception& ex) {
+        LOG_ERROR("Frame capture stopped: {}", ex.what());
+        capture_journal_ = nullptr;
+    }
+}
+
 bool WsConnector::isConnected() const {
-    return ws_stream_.is_open();
+    return ws_stream_ && ws_stream_->is_open();
 }
 
 void WsConnector::disconnect() {
+    if (io_thread_.joinable()) {
+        stopReading();  // The close handshake already ran on the io thread
+        return;
+    }
+    if (!ws_stream_ || !ws_stream_->next_layer().lowest_layer().is_open()) {
+        return;
+    }
+
     try {
         beast_alias::error_code err;
-        ws_stream_.close(beast_alias::websocket::close_code::normal, err);
+        ws_stream_->close(beast_alias::websocket::close_code::normal, err);
         if (err) {
-            std::cerr << "WebSocket shutdown error: " << err.message() << std::endl;
+            LOG_WARN("WebSocket shutdown error: {}", err.message());
         }
 
-        beast_alias::teardown(beast_alias::role_type::client, ws_stream_.next_layer(), err);
+        beast_alias::teardown(beast_alias::role_type::client, ws_stream_->next_layer(), err);
         if (err && err != boost::asio::error::eof) {
-            std::cerr << "SSL shutdown error: " << err.message() << std::endl;
+            LOG_WARN("SSL shutdown error: {}", err.message());
         }
 
-        ws_stream_.next_layer().lowest_layer().close(err);
+        ws_stream_->next_layer().lowest_layer().close(err);
         if (err) {
-            std::cerr << "Socket closure error: " << err.message() << std::endl;
+            LOG_WARN("Socket closure error: {}", err.message());
         }
     } catch (const std::exception& ex) {
-        std::cerr << "Disconnection error: " << ex.what() << std::endl;
+        LOG_WARN("Disconnection error: {}", ex.what());
     }
 }
+
+void WsConnector::abort() {
+    auto close_socket = [this] {
+        beast_alias::error_code err;
+        ws_stream_->next_layer().lowest_layer().close(err);
+    };
+    if (!ws_stream_) {
+        return;
+    }
+    if (io_thread_.joinable()) {
+        boost::asio::post(io_service_, close_socket);  // The socket belongs to the io thread while reading
+    } else {
+        close_socket();
+    }
+}
+
+void WsConnector::startReading(FrameHandler on_frame, CloseHandler on_close) {
+    if (io_thread_.joinable()) {
+        throw std::logic_error("WsConnector reader already running");
+    }
+    if (!ws_stream_) {
+        throw std::logic_error("WsConnector has no connection to read");
+    }
+
+    frame_handler_ = std::move(on_frame);
+    close_handler_ = std::move(on_close);
+    io_work_.emplace(io_service_.get_executor());
+    io_service_.restart();
+
+    doRead();
+    io_thread_ = std::thread([this] { runReader(); });
+}
+
+void WsConnector::runReader() {
+    if (!tuning_.spin) {
+        io_service_.run();
+        return;
+    }
+
+    // Never sleeps in epoll: each poll() checks the socket and runs whatever is ready.
+    // poll() stops the io_context once stopReading() has released the work guard.
+    bool pinned = tuning_.spin_core >= 0 && pinCurrentThreadToCore(tuning_.spin_core);
+    while (!io_service_.stopped()) {
+        if (io_service_.poll() == 0 && !pinned) {
+            std::this_thread::yield();  // Sharing a core, so let the others run
+        }
+    }
+}
+
+void WsConnector::stopReading() {
+    if (!io_thread_.joinable()) {
+        return;
+    }
+
+    boost::asio::post(io_service_, [this] {
+        if (ws_stream_->is_open()) {
+            ws_stream_->async_close(beast_alias::websocket::close_code::normal,
+                [this](beast_alias::error_code) { io_work_.reset(); });
+        } else {
+            io_work_.reset();
+        }
+    });
+    io_thread_.join();
+
+    // After a drop the reader has already exited and the close above never ran; drain it
+    // now rather than let it fire on the next connection's io thread
+    io_service_.restart();
+    io_service_.poll();
+
+    beast_alias::error_code err;
+    ws_stream_->next_layer().lowest_layer().close(err);
+
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    write_head_ = write_tail_;
+    write_active_ = false;
+}
+
+bool WsConnector::isReading() const {
+    return io_thread_.joinable();
+}
+
+bool WsConnector::pinReaderThread(int core) {
+    return io_thread_.joinable() && pinThreadToCore(io_thread_, core);
+}
+
+void WsConnector::transmitAsync(std::string_view data) {
+    transmitAsync(&data, 1);
+}
+
+void WsConnector::transmitAsync(const std::string_view* frames, size_t count) {
+    if (!tryTransmitAsync(frames, count)) {
+        throw std::runtime_error("WebSocket write queue full");
+    }
+}
+
+bool WsConnector::tryTransmitAsync(const std::string_view* frames, size_t count) {
+    if (count == 0) {
+        return true;
+    }
+    int64_t enqueued_ns = PerformanceTracker::now();
+    bool wake_io = false;
+    {
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        if (kWriteSlots - (write_tail_ - write_head_) < count) {
+            return false;
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            std::string_view data = frames[i];
+            WriteSlot& slot = write_slots_[write_tail_ % kWriteSlots];
+            if (data.size() <= kWriteSlotSize) {
+                std::memcpy(slot.data.data(), data.data(), data.size());
+                slot.size = data.size();
+                slot.overflow.clear();
+            } else {
+                slot.overflow.assign(data);  // Rare large frame, e.g. a long subscribe list
+            }
+            slot.enqueued_ns = enqueued_ns;
+            ++write_tail_;
+        }
+
+        wake_io = !write_active_;
+        write_active_ = true;
+    }
+
+    if (wake_io) {
+        boost::asio::post(io_service_, bindHandlerMemory(handler_memory_, [this] { doWrite(); }));
+    }
+    return true;
+}
+
+void WsConnector::doRead() {
+    receive_buffer_.clear();
+    auto on_read = [this](beast_alias::error_code err, std::size_t) {
+        if (err) {
+            if (err != beast_alias::websocket::error::closed && err != boost::asio::error::operation_aborted) {
+                LOG_ERROR("Data reception failed: {}", err.message());
+            }
+            io_work_.reset();
+            if (close_handler_) {
+                close_handler_(err.message());
+            }
+            return;
+        }
+
+        rearmQuickAck();
+        MutableFrame frame = terminateFrame();
+        frame_handler_(std::string_view(frame.data, frame.size));
+        doRead();
+    };
+    ws_stream_->async_read(receive_buffer_, bindHandlerMemory(handler_memory_, std::move(on_read)));
+}
+
+void WsConnector::doWrite() {
+    boost::asio::const_buffer frame;
+    int64_t enqueued_ns = 0;
+    {
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        if (write_head_ == write_tail_) {
+            write_active_ = false;
+            return;
+        }
+
+        const WriteSlot& slot = write_slots_[write_head_ % kWriteSlots];
+        enqueued_ns = slot.enqueued_ns;
+        frame = slot.overflow.empty() ? boost::asio::buffer(slot.data.data(), slot.size)
+                                      : boost::asio::buffer(slot.overflow);
+    }
+
+    auto on_written = [this, enqueued_ns](beast_alias::error_code err, std::size_t) {
+        if (err) {
+            LOG_ERROR("Data transmission failed: {}", err.message());
+            std::lock_guard<std::mutex> lock(write_mutex_);
+            write_head_ = write_tail_;
+            write_active_ = false;
+            return;
+        }
+
+        PerformanceTracker::record(kWriteProbe, PerformanceTracker::now() - enqueued_ns);
+        {
+            std::lock_guard<std::mutex> lock(write_mutex_);
+            ++write_head_;
+        }
+        doWrite();
+    };
+    ws_stream_->async_write(frame, bindHandlerMemory(handler_memory_, std::move(on_written)));
+}
@@ -1,32 +1,147 @@
 #ifndef WS_CONNECTOR_H
 #define WS_CONNECTOR_H
 
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <utility>  // Boost 1.74's awaitable.hpp uses std::exchange without including it
 #include <vector>
 #include <boost/asio.hpp>
 #include <boost/asio/ssl.hpp>
 #include <boost/beast.hpp>
+#include "memory_arena.h"
+
+class FrameJournalWriter;
+
+// Opt-in low-latency socket settings; the defaults leave the kernel's behaviour alone.
+// The socket options are Linux only and ignored elsewhere.
+struct SocketTuning {
+    int busy_poll_us = 0;          // SO_BUSY_POLL: a read polls the device queue this long before sleeping
+    int receive_buffer_bytes = 0;  // SO_RCVBUF, set before connecting; fixing it turns off autotuning
+    int send_buffer_bytes = 0;     // SO_SNDBUF
+    bool quick_ack = false;        // TCP_QUICKACK, re-armed after every read since the kernel clears it
+    bool spin = false;             // The reader polls in a loop instead of sleeping in epoll
+    int spin_core = -1;            // Pins a spinning reader; unpinned it yields between empty polls
+};
 
 class alignas(64) WsConnector {
 public:
-    WsConnector(const std::string& server, const std::string& port_num, const std::string& path);
+    // The frame views the receive buffer and is only valid for the duration of the call
+    using FrameHandler = std::function<void(std::string_view)>;
+    using CloseHandler = std::function<void(const std::string&)>;
+
+    // Writable, NUL-terminated frame for in-situ parsing; valid until the next read
+    struct MutableFrame {
+        char* data;
+        size_t size;
+    };
+
+    static constexpr size_t kWriteSlotSize = 1024;  // Larger frames spill to a heap string
+    static constexpr size_t kWriteSlots = 256;      // Frames queued ahead of the socket
+    static constexpr size_t kDefaultReceiveLimit = 1 << 20;  // Largest accepted inbound frame
+
+    WsConnector(const std::string& server, const std::string& port_num, const std::string& path,
+                size_t receive_limit = kDefaultReceiveLimit);
+    ~WsConnector();
+
+    // Taken by the next establishConnection() and startReading()
+    void setSocketTuning(const SocketTuning& tuning) { tuning_ = tuning; }
+    const SocketTuning& socketTuning() const { return tuning_; }
+
+    // Opens a fresh TCP/TLS/WebSocket stream; call again after a drop, while not reading.
+    // Offers the last TLS session ticket, so a reconnect skips the full handshake when the server agrees.
     void establishConnection();
-    void transmit(const std::string& data);
-    std::string receive();
+    bool sessionResumed() const { return session_resumed_.load(std::memory_order_acquire); }
+    void transmit(std::string_view data);
+    std::string receive();             // Copies the frame; prefer the views below on hot paths
+    std::string_view receiveView();    // Valid until the next receive call
+    MutableFrame receiveInsitu();      // Same buffer, writable and NUL-terminated
+    size_t receiveLimit() const { return receive_limit_; }
     bool isConnected() const;
     void disconnect();
+    void abort();  // Drops the socket without a close handshake, e.g. on a stall; a reader ends through on_close
+
+    // Asynchronous mode: one reader on io_service_ hands every frame to on_frame
+    void startReading(FrameHandler on_frame, CloseHandler on_close = nullptr);
+    void stopReading();
+    bool isReading() const;
+    bool pinReaderThread(int core);  // False unless reading and the OS accepts the core
+    void transmitAsync(std::string_view data);  // Copies into a preallocated write slot; safe from any thread
+    // Queues all frames or none under one lock with one io wake-up, so they go out back to back
+    void transmitAsync(const std::string_view* frames, size_t count);
+    // The same without throwing: false, and nothing queued, when the write queue lacks room for them all
+    bool tryTransmitAsync(const std::string_view* frames, size_t count);
+    // The reader's io_context; work posted here runs on the io thread between frames
+    boost::asio::io_context::executor_type executor() { return io_service_.get_executor(); }
+
+    // Appends every received frame to journal, stamped on arrival; nullptr stops. Set while not reading.
+    void captureTo(FrameJournalWriter* journal) { capture_journal_ = journal; }
 
 private:
+    struct WriteSlot {
+        std::array<char, kWriteSlotSize> data;
+        size_t size = 0;
+        int64_t enqueued_ns = 0;
+        std::string overflow;
+    };
+
+    using WebSocketStream = boost::beast::websocket::stream<boost::asio::ssl::stream<boost::asio::ip::tcp::socket>>;
+
+    static int onNewSession(SSL* ssl, SSL_SESSION* session);
+
+    void applySocketTuning();
+    void rearmQuickAck();
+    void runReader();  // io thread body
+    void readFrame();
+    MutableFrame terminateFrame();
+    void captureFrame(std::string_view frame);
+    void doRead();
+    void doWrite();
+
     std::string server_;
     std::string port_num_;
     std::string path_;
-    
+    SocketTuning tuning_;
+
     boost::asio::io_context io_service_;
     boost::asio::ssl::context ssl_ctx_;
     boost::asio::ip::tcp::resolver dns_resolver_;
-    boost::beast::websocket::stream<boost::asio::ssl::stream<boost::asio::ip::tcp::socket>> ws_stream_;
+    std::optional<WebSocketStream> ws_stream_;  // Rebuilt per connection; an SSL stream cannot be reused
+
+    // Latest ticket the server issued; TLS 1.3 sends them after the handshake, so they arrive on the reader
+    std::mutex session_mutex_;
+    SSL_SESSION* tls_session_ = nullptr;
+    std::atomic<bool> session_resumed_{false};
+
+    // One persistent inbound buffer shared by the blocking and async readers, which never
+    // run at the same time. Cleared before each read, so its capacity is reused.
+    size_t receive_limit_;
+    boost::beast::flat_buffer receive_buffer_;
+    FrameJournalWriter* capture_journal_ = nullptr;  // Written by whichever thread reads
+
+    // Only touched from the io thread while reading
+    FrameHandler frame_handler_;
+    CloseHandler close_handler_;
+
+    // Write ring: producers fill slots at write_tail_, the io thread drains from write_head_
+    std::mutex write_mutex_;
+    std::vector<WriteSlot> write_slots_;
+    size_t write_head_ = 0;
+    size_t write_tail_ = 0;
+    bool write_active_ = false;
+
+    // The wake-up post and the read and write operations reuse these blocks, so neither
+    // queuing a frame nor a steady stream of reads and writes allocates
+    HandlerMemory handler_memory_;
 
-    std::vector<char> receive_buffer_;  // Pre-allocated buffer to avoid heap fragmentation
+    std::optional<boost::asio::executor_work_guard<boost::asio::io_context::executor_type>> io_work_;
+    std::thread io_thread_;
 };
 
 #endif // WS_CONNECTOR_H